@@ -126,8 +126,12 @@ AAssetManager* BaseNativeApp::getAssetManager() {
 
 int32_t BaseNativeApp::handleInput(struct android_app* app, AInputEvent* event) {
 	if (AInputEvent_getType(event) == AINPUT_EVENT_TYPE_KEY) {
-		LOG_DEBUG("Input observed: %d", AKeyEvent_getKeyCode(event));
+		int32_t keyCode = AKeyEvent_getKeyCode(event);
+		LOG_DEBUG("Input observed: %d", keyCode);
 
+		if (AKeyEvent_getAction(event) == AKEY_EVENT_ACTION_DOWN) {
+			onKeyDown(keyCode);
+		}
 		return 1;
 	}
 
@@ -150,3 +154,4 @@ void BaseNativeApp::onFocusLost() {}
 void BaseNativeApp::onConfigChanged() {}
 void BaseNativeApp::onLowMemory() {}
 void BaseNativeApp::onSaveInstanceState() {}
+void BaseNativeApp::onKeyDown(int32_t) {}
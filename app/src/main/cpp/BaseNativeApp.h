@@ -34,6 +34,9 @@ class BaseNativeApp {
 		virtual void onLowMemory();
 		virtual void onSaveInstanceState();
 
+		/** Keys can also be sent from a computer with "adb shell input keyevent <code>". */
+		virtual void onKeyDown(int32_t keyCode);
+
 		virtual void beforeMainLoop();
 		virtual void handleMainLoop();
 		virtual void afterMainLoop();
@@ -0,0 +1,107 @@
+#include "Benchmarks.h"
+
+#include "AndroidLogging.h"
+#include "BvhBenchmark.h"
+#include "CullingBenchmark.h"
+#include "SceneBenchmark.h"
+#include "SortBenchmark.h"
+#include "ThreadPool.h"
+#include "TransformBenchmark.h"
+
+namespace {
+	const uint32_t CULLING_BENCHMARK_OBJECTS = 1000000;
+	const uint32_t BVH_BENCHMARK_OBJECTS = 100000;
+	const uint32_t SCENE_BENCHMARK_ENTITIES = 1000000;
+	const uint32_t TRANSFORM_BENCHMARK_NODES = 100000;
+	const uint32_t SORT_BENCHMARK_KEYS = 100000;
+
+	// Spread over several textures and blend modes, so batching has boundaries to respect
+	const uint32_t SPRITE_BENCHMARK_SPRITES = 100000;
+	const uint32_t SPRITE_BENCHMARK_WARMUP_FRAMES = 30;
+	const uint32_t SPRITE_BENCHMARK_MEASURED_FRAMES = 120;
+}
+
+std::vector<uint32_t> getBenchmarkThreadCounts() {
+	uint32_t hardwareThreads = ThreadPool::getDefaultWorkerCount() + 1;
+	std::vector<uint32_t> threadCounts;
+	for(uint32_t threads = 1; threads < hardwareThreads; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(hardwareThreads);
+	return threadCounts;
+}
+
+void Benchmarks::runStartupBenchmarks() {
+	if(startupFinished) {
+		return;
+	}
+
+	runCullingBenchmark(CULLING_BENCHMARK_OBJECTS);
+	runBvhBenchmark(BVH_BENCHMARK_OBJECTS);
+	runSceneBenchmark(SCENE_BENCHMARK_ENTITIES);
+	runTransformBenchmark(TRANSFORM_BENCHMARK_NODES);
+	runSortBenchmark(SORT_BENCHMARK_KEYS);
+	startupFinished = true;
+}
+
+bool Benchmarks::isFinished() const {
+	return phase == Phase::FINISHED;
+}
+
+const Benchmarks::FrameSetup& Benchmarks::getFrameSetup() const {
+	return setup;
+}
+
+void Benchmarks::addFrame(double cpuMilliseconds, double gpuMilliseconds, uint32_t drawCount) {
+	switch(phase) {
+		case Phase::INSTANCING:
+			instancingBenchmark.addFrame(cpuMilliseconds, gpuMilliseconds);
+			if(instancingBenchmark.isFinished()) {
+				startPhase(Phase::SPRITES);
+			} else {
+				setup.instanceCount = instancingBenchmark.getInstanceCount();
+			}
+			break;
+		case Phase::SPRITES:
+			addSpriteFrame(cpuMilliseconds, gpuMilliseconds, drawCount);
+			break;
+		case Phase::FINISHED:
+			break;
+	}
+}
+
+void Benchmarks::startPhase(Phase phase) {
+	this->phase = phase;
+	phaseFrames = 0;
+	cpuMilliseconds = 0.0;
+	gpuMilliseconds = 0.0;
+	gpuSamples = 0;
+
+	setup = FrameSetup();
+	if(phase == Phase::SPRITES) {
+		setup.spriteCount = SPRITE_BENCHMARK_SPRITES;
+	} else if(phase == Phase::FINISHED) {
+		LOG_INFO("Benchmarks finished.");
+	}
+}
+
+void Benchmarks::addSpriteFrame(double cpuMilliseconds, double gpuMilliseconds, uint32_t drawCount) {
+	phaseFrames++;
+	if(phaseFrames <= SPRITE_BENCHMARK_WARMUP_FRAMES) {
+		return;
+	}
+
+	this->cpuMilliseconds += cpuMilliseconds;
+	if(gpuMilliseconds >= 0.0) {
+		this->gpuMilliseconds += gpuMilliseconds;
+		gpuSamples++;
+	}
+	if(phaseFrames < SPRITE_BENCHMARK_WARMUP_FRAMES + SPRITE_BENCHMARK_MEASURED_FRAMES) {
+		return;
+	}
+
+	LOG_INFO("Sprite benchmark: %u sprites in %u draws, CPU %.3f ms, GPU %.3f ms per frame",
+			setup.spriteCount, drawCount, this->cpuMilliseconds / SPRITE_BENCHMARK_MEASURED_FRAMES,
+			gpuSamples > 0 ? this->gpuMilliseconds / gpuSamples : -1.0);
+	startPhase(Phase::FINISHED);
+}
@@ -0,0 +1,56 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include "InstancingBenchmark.h"
+
+#include <cstdint>
+#include <vector>
+
+/** Thread counts for CPU benchmarks to compare: powers of two below the hardware's, then all of it. */
+std::vector<uint32_t> getBenchmarkThreadCounts();
+
+/**
+ * Runs every benchmark, for builds with the BENCHMARKS option. The startup benchmarks time CPU
+ * systems on their own and block for several seconds. The frame benchmarks then take turns
+ * driving the frame loop: each frame the app draws what getFrameSetup asks for and hands back
+ * its times through addFrame. Once they finish, the app draws its normal scene again.
+ */
+class Benchmarks {
+	public:
+		/** What the app draws this frame. */
+		struct FrameSetup {
+			uint32_t instanceCount = 1;
+			uint32_t spriteCount = 0;
+		};
+
+		/** Runs the first time only; the display can be initialized again without repeating them. */
+		void runStartupBenchmarks();
+
+		bool isFinished() const;
+		const FrameSetup& getFrameSetup() const;
+
+		/** Records a frame drawn as set up. Pass a negative GPU time if none is available. */
+		void addFrame(double cpuMilliseconds, double gpuMilliseconds, uint32_t drawCount);
+
+	private:
+		enum class Phase {
+			INSTANCING,
+			SPRITES,
+			FINISHED
+		};
+
+		bool startupFinished = false;
+		Phase phase = Phase::INSTANCING;
+		FrameSetup setup;
+		InstancingBenchmark instancingBenchmark;
+
+		uint32_t phaseFrames = 0;
+		double cpuMilliseconds = 0.0;
+		double gpuMilliseconds = 0.0;
+		uint32_t gpuSamples = 0;
+
+		void startPhase(Phase phase);
+		void addSpriteFrame(double cpuMilliseconds, double gpuMilliseconds, uint32_t drawCount);
+};
+
+#endif
@@ -0,0 +1,334 @@
+#include "BindlessResources.h"
+
+#include "CapabilityUtils.h"
+
+#include <algorithm>
+
+const std::vector<const char*> DESCRIPTOR_INDEXING_DEVICE_EXTENSION_NAMES = {
+		VK_KHR_MAINTENANCE3_EXTENSION_NAME,
+		VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME};
+
+DescriptorIndexingSupport queryDescriptorIndexingSupport(VkInstance instance,
+		VkPhysicalDevice physicalDevice, bool physicalDeviceProperties2Enabled) {
+	DescriptorIndexingSupport support;
+	if(!physicalDeviceProperties2Enabled) {
+		return support;
+	}
+
+	for(const char* extensionName : DESCRIPTOR_INDEXING_DEVICE_EXTENSION_NAMES) {
+		if(!isPhysicalDeviceExtensionSupported(physicalDevice, extensionName)) {
+			return support;
+		}
+	}
+
+	auto getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+			vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+	auto getProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2KHR>(
+			vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR"));
+	if(getFeatures2 == nullptr || getProperties2 == nullptr) {
+		return support;
+	}
+
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2KHR features = {};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+	features.pNext = &indexingFeatures;
+	getFeatures2(physicalDevice, &features);
+
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = {};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2KHR properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+	properties.pNext = &indexingProperties;
+	getProperties2(physicalDevice, &properties);
+
+	support.supported = indexingFeatures.runtimeDescriptorArray &&
+			indexingFeatures.descriptorBindingPartiallyBound &&
+			indexingFeatures.descriptorBindingUpdateUnusedWhilePending &&
+			indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+			indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind;
+	support.nonUniformIndexing = indexingFeatures.shaderSampledImageArrayNonUniformIndexing &&
+			indexingFeatures.shaderStorageBufferArrayNonUniformIndexing;
+
+	// Combined image samplers count against both the sampler and the sampled image limits
+	support.maxSampledImages = std::min({
+			indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+			indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+			indexingProperties.maxDescriptorSetUpdateAfterBindSamplers});
+	support.maxStorageBuffers = std::min(
+			indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+			indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers);
+
+	return support;
+}
+
+VkPhysicalDeviceDescriptorIndexingFeaturesEXT getRequiredDescriptorIndexingFeatures(
+		const DescriptorIndexingSupport& support) {
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT features = {};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	features.runtimeDescriptorArray = VK_TRUE;
+	features.descriptorBindingPartiallyBound = VK_TRUE;
+	features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+	features.shaderSampledImageArrayNonUniformIndexing = support.nonUniformIndexing;
+	features.shaderStorageBufferArrayNonUniformIndexing = support.nonUniformIndexing;
+
+	return features;
+}
+
+uint32_t BindlessResources::Slots::acquire() {
+	if(!free.empty()) {
+		uint32_t index = free.back();
+		free.pop_back();
+		return index;
+	}
+
+	if(capacity != 0 && next == capacity) {
+		throw std::runtime_error("Bindless descriptor table is full.");
+	}
+
+	return next++;
+}
+
+void BindlessResources::Slots::release(uint32_t index, uint64_t frameNumber) {
+	retiring.push_back(std::make_pair(frameNumber, index));
+}
+
+void BindlessResources::Slots::reclaim(uint64_t frameNumber, uint32_t framesInFlight) {
+	while(!retiring.empty() && retiring.front().first + framesInFlight <= frameNumber) {
+		free.push_back(retiring.front().second);
+		retiring.pop_front();
+	}
+}
+
+void BindlessResources::initialize(VkDevice device, const DescriptorIndexingSupport& support,
+		DescriptorAllocator* descriptorAllocator, uint32_t framesInFlight,
+		uint32_t imageCapacity, uint32_t storageBufferCapacity) {
+	this->device = device;
+	this->descriptorAllocator = descriptorAllocator;
+	this->framesInFlight = framesInFlight;
+	bindless = support.supported;
+
+	if(bindless) {
+		imageCapacity = std::min(imageCapacity, support.maxSampledImages);
+		storageBufferCapacity = std::min(storageBufferCapacity, support.maxStorageBuffers);
+		createBindlessTable(imageCapacity, storageBufferCapacity);
+		LOG_INFO("Using bindless resources: %u images, %u storage buffers.",
+				imageCapacity, storageBufferCapacity);
+	} else {
+		createClassicLayout();
+		LOG_INFO("Descriptor indexing unavailable, binding resources per material.");
+	}
+}
+
+void BindlessResources::destroy() {
+	if(pool != VK_NULL_HANDLE) {
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	}
+	if(setLayout != VK_NULL_HANDLE) {
+		vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+	}
+
+	pool = VK_NULL_HANDLE;
+	setLayout = VK_NULL_HANDLE;
+	globalSet = VK_NULL_HANDLE;
+	imageSlots = Slots();
+	storageBufferSlots = Slots();
+	images.clear();
+	storageBuffers.clear();
+}
+
+bool BindlessResources::isBindless() const {
+	return bindless;
+}
+
+VkDescriptorSetLayout BindlessResources::getSetLayout() const {
+	return setLayout;
+}
+
+uint32_t BindlessResources::addImage(VkImageView imageView, VkSampler sampler,
+		VkImageLayout imageLayout) {
+	uint32_t index = imageSlots.acquire();
+	if(index >= images.size()) {
+		images.resize(index + 1);
+	}
+
+	VkDescriptorImageInfo& info = images[index];
+	info.imageView = imageView;
+	info.sampler = sampler;
+	info.imageLayout = imageLayout;
+
+	if(bindless) {
+		writeGlobal(IMAGE_BINDING, index, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &info, nullptr);
+	}
+
+	return index;
+}
+
+uint32_t BindlessResources::addStorageBuffer(VkBuffer buffer, VkDeviceSize offset,
+		VkDeviceSize range) {
+	uint32_t index = storageBufferSlots.acquire();
+	if(index >= storageBuffers.size()) {
+		storageBuffers.resize(index + 1);
+	}
+
+	VkDescriptorBufferInfo& info = storageBuffers[index];
+	info.buffer = buffer;
+	info.offset = offset;
+	info.range = range;
+
+	if(bindless) {
+		writeGlobal(STORAGE_BUFFER_BINDING, index, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &info);
+	}
+
+	return index;
+}
+
+void BindlessResources::removeImage(uint32_t index) {
+	// The view may be destroyed and its handle reused, which the classic path's cache can't tell apart
+	if(!bindless) {
+		descriptorAllocator->forget((uint64_t) images[index].imageView);
+	}
+	imageSlots.release(index, frameNumber);
+}
+
+void BindlessResources::removeStorageBuffer(uint32_t index) {
+	if(!bindless) {
+		descriptorAllocator->forget((uint64_t) storageBuffers[index].buffer);
+	}
+	storageBufferSlots.release(index, frameNumber);
+}
+
+void BindlessResources::beginFrame(uint64_t frameNumber) {
+	this->frameNumber = frameNumber;
+	imageSlots.reclaim(frameNumber, framesInFlight);
+	storageBufferSlots.reclaim(frameNumber, framesInFlight);
+}
+
+void BindlessResources::bindFrame(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint,
+		VkPipelineLayout pipelineLayout, uint32_t set) {
+	if(bindless) {
+		vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, set, 1, &globalSet,
+				0, nullptr);
+	}
+}
+
+void BindlessResources::bindMaterial(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint,
+		VkPipelineLayout pipelineLayout, uint32_t set, uint32_t imageIndex,
+		uint32_t storageBufferIndex) {
+	if(bindless || (imageIndex == NONE && storageBufferIndex == NONE)) {
+		return;
+	}
+
+	writer.clear();
+	if(imageIndex != NONE) {
+		const VkDescriptorImageInfo& image = images[imageIndex];
+		writer.bindImage(IMAGE_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				image.imageView, image.sampler, image.imageLayout);
+	}
+	if(storageBufferIndex != NONE) {
+		const VkDescriptorBufferInfo& buffer = storageBuffers[storageBufferIndex];
+		writer.bindBuffer(STORAGE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				buffer.buffer, buffer.offset, buffer.range);
+	}
+
+	VkDescriptorSet materialSet = descriptorAllocator->getCachedSet(setLayout, writer);
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, set, 1, &materialSet,
+			0, nullptr);
+}
+
+void BindlessResources::createBindlessTable(uint32_t imageCapacity,
+		uint32_t storageBufferCapacity) {
+	imageSlots.capacity = imageCapacity;
+	storageBufferSlots.capacity = storageBufferCapacity;
+
+	VkDescriptorSetLayoutBinding bindings[2] = {};
+	bindings[0].binding = IMAGE_BINDING;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = imageCapacity;
+	bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+	bindings[1].binding = STORAGE_BUFFER_BINDING;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[1].descriptorCount = storageBufferCapacity;
+	bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+	// Partially bound so unused slots can stay empty, and updatable while frames using other
+	// slots are still in flight
+	const VkDescriptorBindingFlagsEXT flags =
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+	const VkDescriptorBindingFlagsEXT bindingFlags[2] = { flags, flags };
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	bindingFlagsInfo.bindingCount = 2;
+	bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	layoutInfo.bindingCount = 2;
+	layoutInfo.pBindings = bindings;
+	assertSuccess(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout),
+			"Failed to create bindless descriptor set layout.");
+
+	const VkDescriptorPoolSize poolSizes[] = {
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageCapacity },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, storageBufferCapacity }};
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+	poolInfo.maxSets = 1;
+	assertSuccess(vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool),
+			"Failed to create bindless descriptor pool.");
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = pool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &setLayout;
+	assertSuccess(vkAllocateDescriptorSets(device, &allocInfo, &globalSet),
+			"Failed to allocate bindless descriptor set.");
+}
+
+void BindlessResources::createClassicLayout() {
+	VkDescriptorSetLayoutBinding bindings[2] = {};
+	bindings[0].binding = IMAGE_BINDING;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+	bindings[1].binding = STORAGE_BUFFER_BINDING;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 2;
+	layoutInfo.pBindings = bindings;
+	assertSuccess(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout),
+			"Failed to create material descriptor set layout.");
+}
+
+void BindlessResources::writeGlobal(uint32_t binding, uint32_t index, VkDescriptorType type,
+		const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo) {
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = globalSet;
+	write.dstBinding = binding;
+	write.dstArrayElement = index;
+	write.descriptorType = type;
+	write.descriptorCount = 1;
+	write.pImageInfo = imageInfo;
+	write.pBufferInfo = bufferInfo;
+
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
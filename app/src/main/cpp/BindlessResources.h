@@ -0,0 +1,116 @@
+#ifndef BINDLESS_RESOURCES_H
+#define BINDLESS_RESOURCES_H
+
+#include "vulkan_wrapper/vulkan_wrapper.h"
+#include "DescriptorAllocator.h"
+
+#include <deque>
+#include <vector>
+
+struct DescriptorIndexingSupport {
+	bool supported = false;
+	bool nonUniformIndexing = false;
+	uint32_t maxSampledImages = 0;
+	uint32_t maxStorageBuffers = 0;
+};
+
+/** Device extensions to enable alongside the features from getRequiredDescriptorIndexingFeatures. */
+extern const std::vector<const char*> DESCRIPTOR_INDEXING_DEVICE_EXTENSION_NAMES;
+
+/**
+ * Checks whether the device can back a bindless table. The feature query needs
+ * VK_KHR_get_physical_device_properties2, so pass false if the instance wasn't created with it and
+ * the device is reported as unsupported.
+ */
+DescriptorIndexingSupport queryDescriptorIndexingSupport(VkInstance instance,
+		VkPhysicalDevice physicalDevice, bool physicalDeviceProperties2Enabled);
+
+/** The features BindlessResources relies on, ready to chain into VkDeviceCreateInfo::pNext. */
+VkPhysicalDeviceDescriptorIndexingFeaturesEXT getRequiredDescriptorIndexingFeatures(
+		const DescriptorIndexingSupport& support);
+
+/**
+ * Sampled images and storage buffers addressed by index. With descriptor indexing every resource
+ * lives in one global, partially bound set that's bound once per frame, and shaders pick their
+ * resources with an index from push constants or instance data. Without it, each draw binds a
+ * small cached set holding just the resources it names, at the same set number, so the calling
+ * code is identical on both paths and only the shader variant differs:
+ *
+ *   binding 0: sampler2D textures[]  (or a single sampler2D)
+ *   binding 1: buffer storage[]      (or a single buffer)
+ */
+class BindlessResources {
+	public:
+		static const uint32_t IMAGE_BINDING = 0;
+		static const uint32_t STORAGE_BUFFER_BINDING = 1;
+		static const uint32_t NONE = static_cast<uint32_t>(-1);
+
+		void initialize(VkDevice device, const DescriptorIndexingSupport& support,
+				DescriptorAllocator* descriptorAllocator, uint32_t framesInFlight,
+				uint32_t imageCapacity, uint32_t storageBufferCapacity);
+		void destroy();
+
+		bool isBindless() const;
+
+		/** The layout to place at this table's set number when creating pipeline layouts. */
+		VkDescriptorSetLayout getSetLayout() const;
+
+		uint32_t addImage(VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout);
+		uint32_t addStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+
+		/**
+		 * The index is reused once every frame that might still be reading it has retired. The
+		 * resource itself can be destroyed then too; cached sets naming it are forgotten at once.
+		 */
+		void removeImage(uint32_t index);
+		void removeStorageBuffer(uint32_t index);
+
+		/** Reclaims indices released framesInFlight frames ago. Call after the frame's fence wait. */
+		void beginFrame(uint64_t frameNumber);
+
+		/** Binds the global table. A no-op on the classic path. */
+		void bindFrame(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint,
+				VkPipelineLayout pipelineLayout, uint32_t set);
+
+		/** Binds a per-material set on the classic path. A no-op when bindless, as the indices suffice. */
+		void bindMaterial(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint,
+				VkPipelineLayout pipelineLayout, uint32_t set, uint32_t imageIndex,
+				uint32_t storageBufferIndex);
+
+	private:
+		struct Slots {
+			uint32_t capacity = 0;
+			uint32_t next = 0;
+			std::vector<uint32_t> free;
+			std::deque<std::pair<uint64_t, uint32_t>> retiring;
+
+			uint32_t acquire();
+			void release(uint32_t index, uint64_t frameNumber);
+			void reclaim(uint64_t frameNumber, uint32_t framesInFlight);
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+		bool bindless = false;
+		DescriptorAllocator* descriptorAllocator = nullptr;
+		uint32_t framesInFlight = 0;
+		uint64_t frameNumber = 0;
+
+		VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+		VkDescriptorPool pool = VK_NULL_HANDLE;
+		VkDescriptorSet globalSet = VK_NULL_HANDLE;
+
+		Slots imageSlots;
+		Slots storageBufferSlots;
+
+		// The classic path rebuilds sets from these, so they're kept on both paths
+		std::vector<VkDescriptorImageInfo> images;
+		std::vector<VkDescriptorBufferInfo> storageBuffers;
+		DescriptorWriter writer;
+
+		void createBindlessTable(uint32_t imageCapacity, uint32_t storageBufferCapacity);
+		void createClassicLayout();
+		void writeGlobal(uint32_t binding, uint32_t index, VkDescriptorType type,
+				const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo);
+};
+
+#endif
@@ -0,0 +1,465 @@
+#include "BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+
+namespace {
+	enum class Containment { OUTSIDE, INTERSECTING, INSIDE };
+
+	Containment classify(const glm::vec4 planes[6], const Aabb& box) {
+		glm::vec3 center = box.getCenter();
+		glm::vec3 extents = box.getExtents();
+		Containment containment = Containment::INSIDE;
+		for(int i = 0; i < 6; i++) {
+			glm::vec3 normal(planes[i]);
+			float distance = glm::dot(normal, center) + planes[i].w;
+			float radius = glm::dot(glm::abs(normal), extents);
+			if(distance < -radius) {
+				return Containment::OUTSIDE;
+			}
+			if(distance < radius) {
+				containment = Containment::INTERSECTING;
+			}
+		}
+		return containment;
+	}
+}
+
+const uint32_t BoundingVolumeHierarchy::NONE;
+
+uint32_t BoundingVolumeHierarchy::insert(const Aabb& bounds) {
+	uint32_t id;
+	if(freeIds.empty()) {
+		id = static_cast<uint32_t>(objects.size());
+		objects.emplace_back();
+	} else {
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+
+	Object& object = objects[id];
+	object.bounds = bounds;
+	object.alive = true;
+	object.pendingIndex = static_cast<uint32_t>(pending.size());
+	pending.push_back(id);
+	aliveCount++;
+
+	return id;
+}
+
+void BoundingVolumeHierarchy::remove(uint32_t id) {
+	Object& object = objects[id];
+	object.alive = false;
+	aliveCount--;
+
+	if(object.pendingIndex != NONE) {
+		removePending(id);
+		freeIds.push_back(id);
+	} else {
+		// The id stays listed in its leaf until the next build, so it can't be reused before then
+		dirty = true;
+	}
+}
+
+void BoundingVolumeHierarchy::update(uint32_t id, const Aabb& bounds) {
+	Object& object = objects[id];
+	object.bounds = bounds;
+	if(object.pendingIndex == NONE) {
+		dirty = true;
+	}
+}
+
+void BoundingVolumeHierarchy::clear() {
+	nodes.clear();
+	objectIds.clear();
+	objects.clear();
+	freeIds.clear();
+	pending.clear();
+	aliveCount = 0;
+	dirty = false;
+	builtCost = cost = 0.0f;
+}
+
+void BoundingVolumeHierarchy::commit() {
+	if(nodes.empty() || pending.size() > aliveCount / REBUILD_PENDING_DIVISOR) {
+		build();
+		return;
+	}
+
+	if(dirty) {
+		refit();
+		if(cost > builtCost * REBUILD_COST_RATIO) {
+			build();
+		}
+	}
+}
+
+void BoundingVolumeHierarchy::build() {
+	nodes.clear();
+	objectIds.clear();
+	freeIds.clear();
+	pending.clear();
+	dirty = false;
+
+	centroids.resize(objects.size());
+	for(uint32_t id = 0; id < objects.size(); id++) {
+		Object& object = objects[id];
+		object.pendingIndex = NONE;
+		if(object.alive) {
+			objectIds.push_back(id);
+			centroids[id] = object.bounds.getCenter();
+		} else {
+			freeIds.push_back(id);
+		}
+	}
+
+	if(objectIds.empty()) {
+		builtCost = cost = 0.0f;
+		return;
+	}
+
+	// A binary tree over n leaves has 2n - 1 nodes, so node references survive the build
+	nodes.reserve(2 * objectIds.size());
+	Node root = {};
+	root.first = 0;
+	root.objectCount = static_cast<uint32_t>(objectIds.size());
+	nodes.push_back(root);
+
+	std::vector<std::pair<uint32_t, uint32_t>> stack = {{0, 0}};
+	while(!stack.empty()) {
+		std::pair<uint32_t, uint32_t> task = stack.back();
+		stack.pop_back();
+		split(task.first, task.second, stack);
+	}
+
+	builtCost = cost = computeCost();
+}
+
+void BoundingVolumeHierarchy::split(uint32_t nodeIndex, uint32_t depth,
+		std::vector<std::pair<uint32_t, uint32_t>>& stack) {
+	Node& node = nodes[nodeIndex];
+	uint32_t first = node.first;
+	uint32_t count = node.objectCount;
+
+	Aabb bounds;
+	Aabb centroidBounds;
+	for(uint32_t i = first; i < first + count; i++) {
+		bounds.grow(objects[objectIds[i]].bounds);
+		centroidBounds.grow(centroids[objectIds[i]]);
+	}
+	node.minimum = bounds.minimum;
+	node.maximum = bounds.maximum;
+
+	if(count <= MAX_LEAF_OBJECTS || depth + 1 >= MAX_DEPTH) {
+		return;
+	}
+
+	// Bin the centroids along each axis and pick the boundary with the lowest SAH cost
+	struct Bin {
+		Aabb bounds;
+		uint32_t count = 0;
+	};
+
+	float bestCost = std::numeric_limits<float>::max();
+	int bestAxis = -1;
+	uint32_t bestBoundary = 0;
+	for(int axis = 0; axis < 3; axis++) {
+		float minimum = centroidBounds.minimum[axis];
+		float extent = centroidBounds.maximum[axis] - minimum;
+		if(extent <= 0.0f) {
+			continue;
+		}
+
+		Bin bins[BIN_COUNT];
+		float scale = BIN_COUNT / extent;
+		for(uint32_t i = first; i < first + count; i++) {
+			uint32_t id = objectIds[i];
+			uint32_t bin = std::min(BIN_COUNT - 1,
+					static_cast<uint32_t>((centroids[id][axis] - minimum) * scale));
+			bins[bin].count++;
+			bins[bin].bounds.grow(objects[id].bounds);
+		}
+
+		// Boundary b puts bins [0, b] on the left
+		float leftAreas[BIN_COUNT - 1];
+		uint32_t leftCounts[BIN_COUNT - 1];
+		Aabb left;
+		uint32_t leftCount = 0;
+		for(uint32_t b = 0; b < BIN_COUNT - 1; b++) {
+			left.grow(bins[b].bounds);
+			leftCount += bins[b].count;
+			leftAreas[b] = left.getSurfaceArea();
+			leftCounts[b] = leftCount;
+		}
+
+		Aabb right;
+		uint32_t rightCount = 0;
+		for(uint32_t b = BIN_COUNT - 1; b > 0; b--) {
+			right.grow(bins[b].bounds);
+			rightCount += bins[b].count;
+
+			float splitCost = leftCounts[b - 1] * leftAreas[b - 1] + rightCount * right.getSurfaceArea();
+			if(leftCounts[b - 1] > 0 && rightCount > 0 && splitCost < bestCost) {
+				bestCost = splitCost;
+				bestAxis = axis;
+				bestBoundary = b - 1;
+			}
+		}
+	}
+
+	uint32_t leftCount = count / 2;
+	if(bestAxis >= 0) {
+		float minimum = centroidBounds.minimum[bestAxis];
+		float scale = BIN_COUNT / (centroidBounds.maximum[bestAxis] - minimum);
+		auto middle = std::partition(objectIds.begin() + first, objectIds.begin() + first + count,
+				[&](uint32_t id) {
+					uint32_t bin = std::min(BIN_COUNT - 1,
+							static_cast<uint32_t>((centroids[id][bestAxis] - minimum) * scale));
+					return bin <= bestBoundary;
+				});
+		leftCount = static_cast<uint32_t>(middle - (objectIds.begin() + first));
+	}
+	// Otherwise every centroid coincides, and any even split is as good as another
+
+	uint32_t childIndex = static_cast<uint32_t>(nodes.size());
+	Node child = {};
+	child.first = first;
+	child.objectCount = leftCount;
+	nodes.push_back(child);
+	child.first = first + leftCount;
+	child.objectCount = count - leftCount;
+	nodes.push_back(child);
+
+	nodes[nodeIndex].first = childIndex;
+	nodes[nodeIndex].objectCount = 0;
+	stack.push_back({childIndex, depth + 1});
+	stack.push_back({childIndex + 1, depth + 1});
+}
+
+void BoundingVolumeHierarchy::refit() {
+	// Children always follow their parents, so one backwards pass sees them first
+	for(size_t i = nodes.size(); i-- > 0;) {
+		Node& node = nodes[i];
+		Aabb bounds;
+		if(node.isLeaf()) {
+			for(uint32_t k = node.first; k < node.first + node.objectCount; k++) {
+				const Object& object = objects[objectIds[k]];
+				if(object.alive) {
+					bounds.grow(object.bounds);
+				}
+			}
+		} else {
+			bounds = nodes[node.first].getBounds();
+			bounds.grow(nodes[node.first + 1].getBounds());
+		}
+		node.minimum = bounds.minimum;
+		node.maximum = bounds.maximum;
+	}
+
+	dirty = false;
+	cost = computeCost();
+}
+
+uint32_t BoundingVolumeHierarchy::size() const {
+	return aliveCount;
+}
+
+uint32_t BoundingVolumeHierarchy::getNodeCount() const {
+	return static_cast<uint32_t>(nodes.size());
+}
+
+const Aabb& BoundingVolumeHierarchy::getBounds(uint32_t id) const {
+	return objects[id].bounds;
+}
+
+void BoundingVolumeHierarchy::queryFrustum(const glm::vec4 planes[6],
+		std::vector<uint32_t>& results) const {
+	for(uint32_t id : pending) {
+		if(isAabbInFrustum(planes, objects[id].bounds)) {
+			results.push_back(id);
+		}
+	}
+
+	if(nodes.empty()) {
+		return;
+	}
+
+	// Subtrees entirely inside the frustum are collected without testing anything below them
+	struct Entry {
+		uint32_t node;
+		bool inside;
+	};
+	Entry stack[MAX_DEPTH + 1];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = {0, false};
+
+	while(stackSize > 0) {
+		Entry entry = stack[--stackSize];
+		const Node& node = nodes[entry.node];
+		Aabb bounds = node.getBounds();
+		if(bounds.isEmpty()) {
+			continue;
+		}
+
+		bool inside = entry.inside;
+		if(!inside) {
+			Containment containment = classify(planes, bounds);
+			if(containment == Containment::OUTSIDE) {
+				continue;
+			}
+			inside = containment == Containment::INSIDE;
+		}
+
+		if(node.isLeaf()) {
+			for(uint32_t k = node.first; k < node.first + node.objectCount; k++) {
+				uint32_t id = objectIds[k];
+				const Object& object = objects[id];
+				if(object.alive && (inside || isAabbInFrustum(planes, object.bounds))) {
+					results.push_back(id);
+				}
+			}
+		} else {
+			stack[stackSize++] = {node.first, inside};
+			stack[stackSize++] = {node.first + 1, inside};
+		}
+	}
+}
+
+void BoundingVolumeHierarchy::queryOverlap(const Aabb& box, std::vector<uint32_t>& results) const {
+	for(uint32_t id : pending) {
+		if(box.overlaps(objects[id].bounds)) {
+			results.push_back(id);
+		}
+	}
+
+	if(nodes.empty()) {
+		return;
+	}
+
+	uint32_t stack[MAX_DEPTH + 1];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while(stackSize > 0) {
+		const Node& node = nodes[stack[--stackSize]];
+		if(!box.overlaps(node.getBounds())) {
+			continue;
+		}
+
+		if(node.isLeaf()) {
+			for(uint32_t k = node.first; k < node.first + node.objectCount; k++) {
+				uint32_t id = objectIds[k];
+				const Object& object = objects[id];
+				if(object.alive && box.overlaps(object.bounds)) {
+					results.push_back(id);
+				}
+			}
+		} else {
+			stack[stackSize++] = node.first;
+			stack[stackSize++] = node.first + 1;
+		}
+	}
+}
+
+uint32_t BoundingVolumeHierarchy::raycast(const glm::vec3& origin, const glm::vec3& direction,
+		float maxDistance, float& hitDistance) const {
+	glm::vec3 inverseDirection = 1.0f / direction;
+	uint32_t hit = NONE;
+	float nearest = maxDistance;
+	float entry;
+
+	for(uint32_t id : pending) {
+		if(intersectRayAabb(origin, inverseDirection, objects[id].bounds, nearest, entry)) {
+			hit = id;
+			nearest = entry;
+		}
+	}
+
+	if(!nodes.empty() && !nodes[0].getBounds().isEmpty() &&
+			intersectRayAabb(origin, inverseDirection, nodes[0].getBounds(), nearest, entry)) {
+		// Children are visited nearest first, and anything entered beyond the best hit is skipped
+		struct Entry {
+			uint32_t node;
+			float distance;
+		};
+		Entry stack[MAX_DEPTH + 1];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = {0, entry};
+
+		while(stackSize > 0) {
+			Entry current = stack[--stackSize];
+			if(current.distance > nearest) {
+				continue;
+			}
+
+			const Node& node = nodes[current.node];
+			if(node.isLeaf()) {
+				for(uint32_t k = node.first; k < node.first + node.objectCount; k++) {
+					uint32_t id = objectIds[k];
+					const Object& object = objects[id];
+					if(object.alive &&
+							intersectRayAabb(origin, inverseDirection, object.bounds, nearest, entry)) {
+						hit = id;
+						nearest = entry;
+					}
+				}
+				continue;
+			}
+
+			float leftDistance;
+			float rightDistance;
+			const Node& left = nodes[node.first];
+			const Node& right = nodes[node.first + 1];
+			bool leftHit = !left.getBounds().isEmpty() &&
+					intersectRayAabb(origin, inverseDirection, left.getBounds(), nearest, leftDistance);
+			bool rightHit = !right.getBounds().isEmpty() &&
+					intersectRayAabb(origin, inverseDirection, right.getBounds(), nearest, rightDistance);
+
+			if(leftHit && rightHit) {
+				if(leftDistance <= rightDistance) {
+					stack[stackSize++] = {node.first + 1, rightDistance};
+					stack[stackSize++] = {node.first, leftDistance};
+				} else {
+					stack[stackSize++] = {node.first, leftDistance};
+					stack[stackSize++] = {node.first + 1, rightDistance};
+				}
+			} else if(leftHit) {
+				stack[stackSize++] = {node.first, leftDistance};
+			} else if(rightHit) {
+				stack[stackSize++] = {node.first + 1, rightDistance};
+			}
+		}
+	}
+
+	if(hit != NONE) {
+		hitDistance = nearest;
+	}
+	return hit;
+}
+
+float BoundingVolumeHierarchy::computeCost() const {
+	if(nodes.empty()) {
+		return 0.0f;
+	}
+
+	float rootArea = nodes[0].getBounds().getSurfaceArea();
+	if(rootArea <= 0.0f) {
+		return 0.0f;
+	}
+
+	// Traversal and intersection are weighted equally
+	float total = 0.0f;
+	for(const Node& node : nodes) {
+		float area = node.getBounds().getSurfaceArea();
+		total += node.isLeaf() ? area * node.objectCount : area;
+	}
+	return total / rootArea;
+}
+
+void BoundingVolumeHierarchy::removePending(uint32_t id) {
+	uint32_t index = objects[id].pendingIndex;
+	uint32_t last = pending.back();
+	pending[index] = last;
+	objects[last].pendingIndex = index;
+	pending.pop_back();
+	objects[id].pendingIndex = NONE;
+}
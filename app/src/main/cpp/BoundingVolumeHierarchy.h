@@ -0,0 +1,106 @@
+#ifndef BOUNDING_VOLUME_HIERARCHY_H
+#define BOUNDING_VOLUME_HIERARCHY_H
+
+#include "MathUtils.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * A bounding volume hierarchy over objects that move, appear and disappear every frame. Objects
+ * are addressed by ids that stay valid until removed.
+ *
+ * The tree is built top down with a binned surface area heuristic and stored flattened: 32-byte
+ * nodes in one array, siblings side by side and children after their parents, so refitting is a
+ * single backwards sweep. Changes are batched until commit. Moved or removed objects refit the
+ * tree in place, while inserted ones wait in a short list that queries scan linearly. A full
+ * rebuild happens when that list grows or refitting has inflated the tree's cost too far.
+ */
+class BoundingVolumeHierarchy {
+	public:
+		static const uint32_t NONE = static_cast<uint32_t>(-1);
+
+		uint32_t insert(const Aabb& bounds);
+		void remove(uint32_t id);
+		void update(uint32_t id, const Aabb& bounds);
+		void clear();
+
+		/** Applies every change since the last commit. Call before querying. */
+		void commit();
+
+		/** Rebuilds the whole tree with the surface area heuristic. commit does this when needed. */
+		void build();
+
+		/** Recomputes node bounds bottom up, keeping the structure. commit does this when needed. */
+		void refit();
+
+		uint32_t size() const;
+		uint32_t getNodeCount() const;
+		const Aabb& getBounds(uint32_t id) const;
+
+		/** Appends the ids of objects touching the frustum, as given by extractFrustumPlanes. */
+		void queryFrustum(const glm::vec4 planes[6], std::vector<uint32_t>& results) const;
+
+		/** Appends the ids of objects overlapping the box. */
+		void queryOverlap(const Aabb& box, std::vector<uint32_t>& results) const;
+
+		/**
+		 * The object whose box the ray enters first, within maxDistance, or NONE. For picking with
+		 * exact geometry, test the returned object and fall back to queryOverlap for the rest.
+		 */
+		uint32_t raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+				float& hitDistance) const;
+
+	private:
+		static const uint32_t MAX_LEAF_OBJECTS = 4;
+		static const uint32_t BIN_COUNT = 12;
+
+		// Bounds traversal stacks; deeper nodes become leaves whatever their size
+		static const uint32_t MAX_DEPTH = 64;
+
+		// Rebuild once refitting makes the tree this much costlier than when it was built
+		static constexpr float REBUILD_COST_RATIO = 1.5f;
+
+		// Rebuild once more than 1 in this many objects are waiting to be inserted
+		static const uint32_t REBUILD_PENDING_DIVISOR = 16;
+
+		struct Node {
+			glm::vec3 minimum;
+			/** The first child for internal nodes, the first entry of objectIds for leaves. */
+			uint32_t first;
+			glm::vec3 maximum;
+			/** Zero for internal nodes. */
+			uint32_t objectCount;
+
+			bool isLeaf() const { return objectCount > 0; }
+			Aabb getBounds() const { return Aabb(minimum, maximum); }
+		};
+		static_assert(sizeof(Node) == 32, "Nodes should stay at half a cache line.");
+
+		struct Object {
+			Aabb bounds;
+			bool alive = false;
+			/** Where the object sits in pending, or NONE once it's in the tree. */
+			uint32_t pendingIndex = NONE;
+		};
+
+		std::vector<Node> nodes;
+		std::vector<uint32_t> objectIds;
+		std::vector<Object> objects;
+		std::vector<uint32_t> freeIds;
+		std::vector<uint32_t> pending;
+		uint32_t aliveCount = 0;
+		bool dirty = false;
+		float builtCost = 0.0f;
+		float cost = 0.0f;
+
+		// Build scratch, kept to avoid reallocating every rebuild
+		std::vector<glm::vec3> centroids;
+
+		void split(uint32_t nodeIndex, uint32_t depth, std::vector<std::pair<uint32_t, uint32_t>>& stack);
+		float computeCost() const;
+		void removePending(uint32_t id);
+};
+
+#endif
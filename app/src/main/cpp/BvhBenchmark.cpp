@@ -0,0 +1,107 @@
+#include "BvhBenchmark.h"
+
+#include "AndroidLogging.h"
+#include "BoundingVolumeHierarchy.h"
+#include "TimeUtils.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <random>
+
+void runBvhBenchmark(uint32_t objectCount, uint32_t queryCount) {
+	// Boxes scattered through a cube, the same distribution as the culling benchmark
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> size(0.1f, 2.0f);
+	std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	auto randomBox = [&](const glm::vec3& center) {
+		glm::vec3 extents(size(random), size(random), size(random));
+		return Aabb(center - extents, center + extents);
+	};
+
+	BoundingVolumeHierarchy bvh;
+	std::vector<uint32_t> ids;
+	std::vector<Aabb> boxes;
+	for(uint32_t i = 0; i < objectCount; i++) {
+		boxes.push_back(randomBox(glm::vec3(position(random), position(random), position(random))));
+		ids.push_back(bvh.insert(boxes.back()));
+	}
+
+	TimePoint start = now();
+	bvh.commit();
+	double buildMilliseconds = secondsBetween(start, now()) * 1e3;
+
+	// Nudge every object, as a frame of animation would, and remove a few
+	for(uint32_t i = 0; i < objectCount; i++) {
+		glm::vec3 offset(step(random), step(random), step(random));
+		boxes[i] = Aabb(boxes[i].minimum + offset, boxes[i].maximum + offset);
+		bvh.update(ids[i], boxes[i]);
+	}
+	std::vector<bool> removed(objectCount, false);
+	for(uint32_t i = 0; i < objectCount; i += 97) {
+		bvh.remove(ids[i]);
+		removed[i] = true;
+	}
+	start = now();
+	bvh.commit();
+	double refitMilliseconds = secondsBetween(start, now()) * 1e3;
+
+	// A few late arrivals stay pending, so queries cover both the tree and the list
+	for(uint32_t i = 0; i < objectCount / 100; i++) {
+		boxes.push_back(randomBox(glm::vec3(position(random), position(random), position(random))));
+		ids.push_back(bvh.insert(boxes.back()));
+		removed.push_back(false);
+	}
+	bvh.commit();
+
+	std::vector<uint32_t> results;
+
+	glm::vec4 planes[6];
+	extractFrustumPlanes(glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f) *
+			glm::lookAt(glm::vec3(0.0f, 0.0f, -60.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+			planes);
+	start = now();
+	bvh.queryFrustum(planes, results);
+	double frustumMilliseconds = secondsBetween(start, now()) * 1e3;
+	uint32_t visibleCount = static_cast<uint32_t>(results.size());
+
+	// The scan the tree replaces, for scale
+	uint32_t bruteVisibleCount = 0;
+	start = now();
+	for(uint32_t i = 0; i < boxes.size(); i++) {
+		if(!removed[i] && isAabbInFrustum(planes, boxes[i])) {
+			bruteVisibleCount++;
+		}
+	}
+	double bruteFrustumMilliseconds = secondsBetween(start, now()) * 1e3;
+
+	double overlapMilliseconds = 0.0;
+	for(uint32_t q = 0; q < queryCount; q++) {
+		Aabb box = randomBox(glm::vec3(position(random), position(random), position(random)));
+		results.clear();
+		start = now();
+		bvh.queryOverlap(box, results);
+		overlapMilliseconds += secondsBetween(start, now()) * 1e3;
+	}
+
+	double raycastMilliseconds = 0.0;
+	for(uint32_t q = 0; q < queryCount; q++) {
+		glm::vec3 origin(position(random), position(random), position(random));
+		glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)));
+		float distance = 0.0f;
+		start = now();
+		bvh.raycast(origin, direction, 200.0f, distance);
+		raycastMilliseconds += secondsBetween(start, now()) * 1e3;
+	}
+
+	LOG_INFO("BVH benchmark: %u objects, %u nodes, %u visible (%u by brute force)", bvh.size(),
+			bvh.getNodeCount(), visibleCount, bruteVisibleCount);
+	LOG_INFO("%24s %10s", "operation", "ms");
+	LOG_INFO("%24s %10.2f", "build", buildMilliseconds);
+	LOG_INFO("%24s %10.2f", "refit after moving all", refitMilliseconds);
+	LOG_INFO("%24s %10.3f", "frustum query", frustumMilliseconds);
+	LOG_INFO("%24s %10.3f", "frustum brute force", bruteFrustumMilliseconds);
+	LOG_INFO("%24s %10.4f", "overlap query (mean)", overlapMilliseconds / queryCount);
+	LOG_INFO("%24s %10.4f", "raycast (mean)", raycastMilliseconds / queryCount);
+}
@@ -0,0 +1,12 @@
+#ifndef BVH_BENCHMARK_H
+#define BVH_BENCHMARK_H
+
+#include <cstdint>
+
+/**
+ * Times building, refitting and querying a BoundingVolumeHierarchy over a random scene. Blocks for
+ * a few seconds. BoundingVolumeHierarchyTest checks the queries themselves.
+ */
+void runBvhBenchmark(uint32_t objectCount = 100000, uint32_t queryCount = 1000);
+
+#endif
@@ -0,0 +1,159 @@
+#include "Camera.h"
+
+#include "MathUtils.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <cmath>
+
+void Camera::setLookAt(const glm::vec3& eye, const glm::vec3& target, const glm::vec3& up) {
+	// The view's rotation is the inverse of the camera's, and a rotation's inverse is its transpose
+	glm::mat3 viewRotation(glm::lookAt(eye, target, up));
+	setPose(eye, glm::quat_cast(glm::transpose(viewRotation)));
+}
+
+void Camera::setPose(const glm::vec3& position, const glm::quat& rotation) {
+	if(position == this->position && rotation == this->rotation) {
+		return;
+	}
+	this->position = position;
+	this->rotation = rotation;
+	viewDirty = true;
+}
+
+void Camera::setPerspective(float verticalFieldOfView, float nearPlane, float farPlane) {
+	if(verticalFieldOfView == this->verticalFieldOfView && nearPlane == this->nearPlane &&
+			farPlane == this->farPlane) {
+		return;
+	}
+	this->verticalFieldOfView = verticalFieldOfView;
+	this->nearPlane = nearPlane;
+	this->farPlane = farPlane;
+	projectionDirty = true;
+}
+
+void Camera::setAspectRatio(float aspectRatio) {
+	if(aspectRatio == this->aspectRatio) {
+		return;
+	}
+	this->aspectRatio = aspectRatio;
+	projectionDirty = true;
+}
+
+void Camera::setDepthMode(DepthMode depthMode) {
+	if(depthMode == this->depthMode) {
+		return;
+	}
+	this->depthMode = depthMode;
+	projectionDirty = true;
+}
+
+void Camera::setPreRotation(uint32_t quarterTurns) {
+	quarterTurns %= 4;
+	if(quarterTurns == preRotation) {
+		return;
+	}
+	preRotation = quarterTurns;
+	projectionDirty = true;
+}
+
+bool Camera::update() {
+	if(!viewDirty && !projectionDirty) {
+		return false;
+	}
+
+	if(viewDirty) {
+		inverseView = glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation);
+		view = glm::transpose(glm::mat4_cast(rotation)) * glm::translate(glm::mat4(1.0f), -position);
+	}
+	if(projectionDirty) {
+		projection = computeProjection();
+		inverseProjection = glm::inverse(projection);
+	}
+
+	viewProjection = projection * view;
+	inverseViewProjection = inverseView * inverseProjection;
+	extractFrustumPlanes(viewProjection, frustumPlanes);
+
+	viewDirty = false;
+	projectionDirty = false;
+	version++;
+	return true;
+}
+
+uint64_t Camera::getVersion() const {
+	return version;
+}
+
+const glm::vec3& Camera::getPosition() const {
+	return position;
+}
+
+const glm::quat& Camera::getRotation() const {
+	return rotation;
+}
+
+Camera::DepthMode Camera::getDepthMode() const {
+	return depthMode;
+}
+
+bool Camera::isInfinite() const {
+	return farPlane <= 0.0f;
+}
+
+const glm::mat4& Camera::getView() const {
+	return view;
+}
+
+const glm::mat4& Camera::getProjection() const {
+	return projection;
+}
+
+const glm::mat4& Camera::getViewProjection() const {
+	return viewProjection;
+}
+
+const glm::mat4& Camera::getInverseView() const {
+	return inverseView;
+}
+
+const glm::mat4& Camera::getInverseProjection() const {
+	return inverseProjection;
+}
+
+const glm::mat4& Camera::getInverseViewProjection() const {
+	return inverseViewProjection;
+}
+
+const glm::vec4* Camera::getFrustumPlanes() const {
+	return frustumPlanes;
+}
+
+glm::mat4 Camera::computeProjection() const {
+	// Right handed, looking down -z, so clip w is -z. y is negated because Vulkan's points down.
+	float focalLength = 1.0f / std::tan(0.5f * verticalFieldOfView);
+	glm::mat4 result(0.0f);
+	result[0][0] = focalLength / aspectRatio;
+	result[1][1] = -focalLength;
+	result[2][3] = -1.0f;
+
+	if(depthMode == DepthMode::STANDARD) {
+		if(isInfinite()) {
+			result[2][2] = -1.0f;
+			result[3][2] = -nearPlane;
+		} else {
+			result[2][2] = farPlane / (nearPlane - farPlane);
+			result[3][2] = nearPlane * farPlane / (nearPlane - farPlane);
+		}
+	} else {
+		if(isInfinite()) {
+			result[2][2] = 0.0f;
+			result[3][2] = nearPlane;
+		} else {
+			result[2][2] = nearPlane / (farPlane - nearPlane);
+			result[3][2] = nearPlane * farPlane / (farPlane - nearPlane);
+		}
+	}
+
+	// Turning x and y alone leaves depth and w, and so the frustum's near and far, as they were
+	return glm::mat4(getQuarterTurn(preRotation)) * result;
+}
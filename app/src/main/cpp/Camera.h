@@ -0,0 +1,86 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#include <cstdint>
+
+/**
+ * A perspective camera producing Vulkan clip space: y pointing down and depth in [0, 1]. The view,
+ * projection, their product, the inverses and the frustum planes are cached, and update only
+ * recomputes them after a setter actually changed something. Consumers can compare getVersion
+ * with the version they last saw to skip work while the camera is still.
+ */
+class Camera {
+	public:
+		enum class DepthMode {
+			/** Near maps to 0 and far to 1. */
+			STANDARD,
+			/**
+			 * Near maps to 1 and far to 0, which evens out float depth precision with distance.
+			 * Clear depth to 0 and test with GREATER.
+			 */
+			REVERSED
+		};
+
+		void setLookAt(const glm::vec3& eye, const glm::vec3& target, const glm::vec3& up);
+		void setPose(const glm::vec3& position, const glm::quat& rotation);
+
+		/** A vertical field of view in radians. A far plane of 0 or less makes the projection infinite. */
+		void setPerspective(float verticalFieldOfView, float nearPlane, float farPlane);
+		void setAspectRatio(float aspectRatio);
+		void setDepthMode(DepthMode depthMode);
+		/**
+		 * Turns clip space by quarter turns after projecting, for a swapchain pre-rotated to the
+		 * display. The aspect ratio stays the display's, as seen on screen.
+		 */
+		void setPreRotation(uint32_t quarterTurns);
+
+		/** Recomputes the cached matrices if anything changed; returns whether it did. */
+		bool update();
+
+		/** Incremented by every update that recomputed something. */
+		uint64_t getVersion() const;
+
+		const glm::vec3& getPosition() const;
+		const glm::quat& getRotation() const;
+		DepthMode getDepthMode() const;
+		bool isInfinite() const;
+
+		const glm::mat4& getView() const;
+		const glm::mat4& getProjection() const;
+		const glm::mat4& getViewProjection() const;
+		const glm::mat4& getInverseView() const;
+		const glm::mat4& getInverseProjection() const;
+		const glm::mat4& getInverseViewProjection() const;
+
+		/** World-space planes, as given by extractFrustumPlanes. */
+		const glm::vec4* getFrustumPlanes() const;
+
+	private:
+		glm::vec3 position = glm::vec3(0.0f);
+		glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		float verticalFieldOfView = glm::radians(45.0f);
+		float nearPlane = 0.1f;
+		float farPlane = 100.0f;
+		float aspectRatio = 1.0f;
+		DepthMode depthMode = DepthMode::STANDARD;
+		uint32_t preRotation = 0;
+
+		bool viewDirty = true;
+		bool projectionDirty = true;
+		uint64_t version = 0;
+
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::mat4 viewProjection;
+		glm::mat4 inverseView;
+		glm::mat4 inverseProjection;
+		glm::mat4 inverseViewProjection;
+		glm::vec4 frustumPlanes[6];
+
+		glm::mat4 computeProjection() const;
+};
+
+#endif
@@ -8,13 +8,13 @@
 #include "AndroidLogging.h"
 #include "CollectionUtils.h"
 
-void assertSuccess(VkResult result, std::string message) {
+inline void assertSuccess(VkResult result, std::string message) {
 	if(result != VK_SUCCESS) {
 		throw std::runtime_error(message.c_str());
 	}
 }
 
-VkResult createDebugReportCallback(VkInstance instance,
+inline VkResult createDebugReportCallback(VkInstance instance,
 		const VkDebugReportCallbackCreateInfoEXT* pCreateInfo,
 		const VkAllocationCallbacks* pAllocator,
 		VkDebugReportCallbackEXT* pCallback) {
@@ -26,7 +26,7 @@ VkResult createDebugReportCallback(VkInstance instance,
 	return vkCreateDebugReportCallbackEXT(instance, pCreateInfo, pAllocator, pCallback);
 }
 
-void destroyDebugReportCallback(VkInstance instance,
+inline void destroyDebugReportCallback(VkInstance instance,
 		VkDebugReportCallbackEXT callback,
 		const VkAllocationCallbacks* pAllocator) {
 	if(vkDestroyDebugReportCallbackEXT == nullptr) {
@@ -37,7 +37,7 @@ void destroyDebugReportCallback(VkInstance instance,
 	vkDestroyDebugReportCallbackEXT(instance, callback, pAllocator);
 }
 
-std::vector<VkLayerProperties> getSupportedValidationLayers() {
+inline std::vector<VkLayerProperties> getSupportedValidationLayers() {
 	uint32_t layerCount;
 	vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
 
@@ -49,7 +49,7 @@ std::vector<VkLayerProperties> getSupportedValidationLayers() {
 	return availableLayers;
 }
 
-void logSupportedValidationLayers() {
+inline void logSupportedValidationLayers() {
 	std::vector<VkLayerProperties> layers = getSupportedValidationLayers();
 
 	LOG_DEBUG("Found %lu supported validation layers.", layers.size());
@@ -61,7 +61,7 @@ void logSupportedValidationLayers() {
 	}
 }
 
-std::vector<const char *> filterUnavailableValidationLayers(
+inline std::vector<const char *> filterUnavailableValidationLayers(
 		std::vector<const char *> requestedLayerNames) {
 	std::vector<VkLayerProperties> supportedLayers = getSupportedValidationLayers();
 	std::vector<const char *> supportedLayerNames;
@@ -84,7 +84,7 @@ std::vector<const char *> filterUnavailableValidationLayers(
 	return supportedLayerNames;
 }
 
-std::vector<VkExtensionProperties> getSupportedInstanceExtensions() {
+inline std::vector<VkExtensionProperties> getSupportedInstanceExtensions() {
 	uint32_t count = 0;
 	vkEnumerateInstanceExtensionProperties(nullptr, &count, nullptr);
 
@@ -96,7 +96,7 @@ std::vector<VkExtensionProperties> getSupportedInstanceExtensions() {
 	return extensions;
 }
 
-void logSupportedInstanceExtensions() {
+inline void logSupportedInstanceExtensions() {
 	std::vector<VkExtensionProperties> extensions = getSupportedInstanceExtensions();
 
 	LOG_DEBUG("Found %lu supported instance extensions.", extensions.size());
@@ -107,7 +107,7 @@ void logSupportedInstanceExtensions() {
 	}
 }
 
-std::vector<VkPhysicalDevice> getPhysicalDevices(VkInstance instance) {
+inline std::vector<VkPhysicalDevice> getPhysicalDevices(VkInstance instance) {
 	uint32_t count = 0;
 	vkEnumeratePhysicalDevices(instance, &count, nullptr);
 
@@ -119,7 +119,7 @@ std::vector<VkPhysicalDevice> getPhysicalDevices(VkInstance instance) {
 	return devices;
 }
 
-std::vector<VkQueueFamilyProperties> getQueueFamilyProperties(VkPhysicalDevice device) {
+inline std::vector<VkQueueFamilyProperties> getQueueFamilyProperties(VkPhysicalDevice device) {
 	uint32_t count = 0;
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
 
@@ -131,21 +131,21 @@ std::vector<VkQueueFamilyProperties> getQueueFamilyProperties(VkPhysicalDevice d
 	return queueFamilies;
 }
 
-VkPhysicalDeviceProperties getPhysicalDeviceProperties(VkPhysicalDevice device) {
+inline VkPhysicalDeviceProperties getPhysicalDeviceProperties(VkPhysicalDevice device) {
 	VkPhysicalDeviceProperties deviceProperties;
 	vkGetPhysicalDeviceProperties(device, &deviceProperties);
 
 	return deviceProperties;
 }
 
-VkPhysicalDeviceFeatures getPhysicalDeviceFeatures(VkPhysicalDevice device) {
+inline VkPhysicalDeviceFeatures getPhysicalDeviceFeatures(VkPhysicalDevice device) {
 	VkPhysicalDeviceFeatures deviceFeatures;
 	vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
 
 	return deviceFeatures;
 }
 
-std::vector<VkExtensionProperties> getPhysicalDeviceExtensionProperties(VkPhysicalDevice device) {
+inline std::vector<VkExtensionProperties> getPhysicalDeviceExtensionProperties(VkPhysicalDevice device) {
 	uint32_t count;
 	vkEnumerateDeviceExtensionProperties(device, nullptr, &count, nullptr);
 
@@ -157,7 +157,7 @@ std::vector<VkExtensionProperties> getPhysicalDeviceExtensionProperties(VkPhysic
 	return availableExtensions;
 }
 
-void logPhysicalDeviceExtensionProperties(const VkPhysicalDevice& device) {
+inline void logPhysicalDeviceExtensionProperties(const VkPhysicalDevice& device) {
 	std::vector<VkExtensionProperties> properties = getPhysicalDeviceExtensionProperties(device);
 	LOG_DEBUG("Found %lu supported physical device extensions.", properties.size());
 	for(const VkExtensionProperties& property : properties) {
@@ -167,7 +167,7 @@ void logPhysicalDeviceExtensionProperties(const VkPhysicalDevice& device) {
 	}
 }
 
-std::vector<VkSurfaceFormatKHR> getPhysicalDeviceSurfaceFormats(
+inline std::vector<VkSurfaceFormatKHR> getPhysicalDeviceSurfaceFormats(
 		const VkPhysicalDevice& device, const VkSurfaceKHR& surface) {
 	uint32_t count;
 	vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &count, nullptr);
@@ -180,7 +180,7 @@ std::vector<VkSurfaceFormatKHR> getPhysicalDeviceSurfaceFormats(
 	return formats;
 }
 
-std::vector<VkPresentModeKHR> getPhysicalDeviceSurfacePresentModes(
+inline std::vector<VkPresentModeKHR> getPhysicalDeviceSurfacePresentModes(
 		const VkPhysicalDevice& device, const VkSurfaceKHR& surface) {
 	uint32_t count;
 	vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &count, nullptr);
@@ -193,14 +193,14 @@ std::vector<VkPresentModeKHR> getPhysicalDeviceSurfacePresentModes(
 	return modes;
 }
 
-VkSurfaceCapabilitiesKHR getPhysicalDeviceSurfaceCapabilities(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface) {
+inline VkSurfaceCapabilitiesKHR getPhysicalDeviceSurfaceCapabilities(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface) {
 	VkSurfaceCapabilitiesKHR capabilities = {};
 	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &capabilities);
 
 	return capabilities;
 }
 
-bool arePhysicalDeviceExtensionSupported(VkPhysicalDevice device,
+inline bool arePhysicalDeviceExtensionSupported(VkPhysicalDevice device,
 		std::vector<const char*> requiredExtensionNames) {
 	std::vector<VkExtensionProperties> supportedDeviceExtensions =
 			getPhysicalDeviceExtensionProperties(device);
@@ -217,21 +217,41 @@ bool arePhysicalDeviceExtensionSupported(VkPhysicalDevice device,
 	return false;
 }
 
-VkBool32 isPresentationSupported(const VkPhysicalDevice& physicalDevice, unsigned int queueFamilyIndex, const VkSurfaceKHR& surface) {
+inline bool isInstanceExtensionSupported(const char* extensionName) {
+	for(const VkExtensionProperties& extension : getSupportedInstanceExtensions()) {
+		if(strcmp(extension.extensionName, extensionName) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+inline bool isPhysicalDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName) {
+	for(const VkExtensionProperties& extension : getPhysicalDeviceExtensionProperties(device)) {
+		if(strcmp(extension.extensionName, extensionName) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+inline VkBool32 isPresentationSupported(const VkPhysicalDevice& physicalDevice, unsigned int queueFamilyIndex, const VkSurfaceKHR& surface) {
 	VkBool32 presentSupport = VK_FALSE;
 	vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, queueFamilyIndex, surface, &presentSupport);
 
 	return presentSupport;
 }
 
-void getSwapchainImages(VkDevice  device, VkSwapchainKHR swapchain, std::vector<VkImage>& images) {
+inline void getSwapchainImages(VkDevice  device, VkSwapchainKHR swapchain, std::vector<VkImage>& images) {
 	uint32_t count = 0;
 	vkGetSwapchainImagesKHR(device, swapchain, &count, nullptr);
 	images.resize(count);
 	vkGetSwapchainImagesKHR(device, swapchain, &count, images.data());
 }
 
-VkShaderModule createShaderModule(const VkDevice& device, const std::vector<char>& shaderBytecode) {
+inline VkShaderModule createShaderModule(const VkDevice& device, const std::vector<char>& shaderBytecode) {
 	VkShaderModuleCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 	createInfo.codeSize = shaderBytecode.size();
@@ -243,18 +263,49 @@ VkShaderModule createShaderModule(const VkDevice& device, const std::vector<char
 	return shaderModule;
 }
 
-VkMemoryRequirements getBufferMemoryRequirements(const VkDevice& device, const VkBuffer& buffer) {
+inline VkMemoryRequirements getBufferMemoryRequirements(const VkDevice& device, const VkBuffer& buffer) {
 	VkMemoryRequirements requirements;
 	vkGetBufferMemoryRequirements(device, buffer, &requirements);
 
 	return requirements;
 }
 
-VkPhysicalDeviceMemoryProperties getPhysicalDeviceMemoryProperties(const VkPhysicalDevice& physicalDevice) {
+inline VkMemoryRequirements getImageMemoryRequirements(const VkDevice& device, const VkImage& image) {
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(device, image, &requirements);
+
+	return requirements;
+}
+
+inline VkPhysicalDeviceMemoryProperties getPhysicalDeviceMemoryProperties(const VkPhysicalDevice& physicalDevice) {
 	VkPhysicalDeviceMemoryProperties properties;
 	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &properties);
 
 	return properties;
 }
 
+inline VkFormatProperties getPhysicalDeviceFormatProperties(VkPhysicalDevice physicalDevice,
+		VkFormat format) {
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+
+	return properties;
+}
+
+/**
+ * The first candidate usable as a depth attachment with optimal tiling. Vulkan guarantees D16 and
+ * one of X8_D24 or D32_SFLOAT, so a list ending with D16_UNORM always succeeds.
+ */
+inline VkFormat pickDepthFormat(VkPhysicalDevice physicalDevice,
+		const std::vector<VkFormat>& candidates) {
+	for(VkFormat format : candidates) {
+		if(getPhysicalDeviceFormatProperties(physicalDevice, format).optimalTilingFeatures &
+				VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+			return format;
+		}
+	}
+
+	throw std::runtime_error("No supported depth format.");
+}
+
 #endif
@@ -1,6 +1,8 @@
 #ifndef COLLECTION_UTILS_H
 #define COLLECTION_UTILS_H
 
+#include <cstddef>
+#include <cstdint>
 #include <set>
 #include <vector>
 
@@ -12,4 +14,15 @@ template<typename T> std::set<T> asSet(std::vector<T> values) {
 	return asSet<T,T>(values);
 }
 
+/** FNV-1a over a run of 64-bit words. Fine for cache keys that are still compared in full. */
+inline uint64_t hashWords(const uint64_t* words, size_t count) {
+	uint64_t hash = 14695981039346656037ULL;
+	for(size_t i = 0; i < count; i++) {
+		hash ^= words[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
 #endif
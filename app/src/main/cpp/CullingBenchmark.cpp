@@ -0,0 +1,61 @@
+#include "CullingBenchmark.h"
+
+#include "AndroidLogging.h"
+#include "FrustumCuller.h"
+#include "TimeUtils.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <random>
+
+namespace {
+	/** The best of several runs, in microseconds, so a single preemption doesn't skew it. */
+	template<typename Cull> double timeBest(uint32_t iterations, Cull cull) {
+		double best = 0.0;
+		for(uint32_t i = 0; i < iterations; i++) {
+			TimePoint start = now();
+			cull();
+			double microseconds = secondsBetween(start, now()) * 1e6;
+			if(i == 0 || microseconds < best) {
+				best = microseconds;
+			}
+		}
+		return best;
+	}
+}
+
+void runCullingBenchmark(uint32_t objectCount, uint32_t iterations) {
+	// Boxes scattered through a cube around a camera that sees roughly half of them
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+	FrustumCuller culler;
+	for(uint32_t i = 0; i < objectCount; i++) {
+		glm::vec3 extents(size(random), size(random), size(random));
+		culler.add(glm::vec3(position(random), position(random), position(random)), extents,
+				glm::length(extents));
+	}
+
+	glm::mat4 viewProjection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f) *
+			glm::lookAt(glm::vec3(0.0f, 0.0f, -60.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	uint32_t scalarVisible = 0;
+	uint32_t simdVisible = 0;
+	double scalarMicroseconds = timeBest(iterations, [&]() {
+		scalarVisible = culler.cullScalar(viewProjection);
+	});
+	double simdMicroseconds = timeBest(iterations, [&]() {
+		simdVisible = culler.cull(viewProjection);
+	});
+
+	if(scalarVisible != simdVisible) {
+		LOG_WARN("Culling benchmark: scalar kept %u objects but %s kept %u.",
+				scalarVisible, FrustumCuller::getInstructionSet(), simdVisible);
+	}
+
+	LOG_INFO("Culling benchmark: %u objects, %u visible", objectCount, simdVisible);
+	LOG_INFO("%10s %10s %16s", "path", "us", "objects per us");
+	LOG_INFO("%10s %10.1f %16.1f", "scalar", scalarMicroseconds, objectCount / scalarMicroseconds);
+	LOG_INFO("%10s %10.1f %16.1f", FrustumCuller::getInstructionSet(), simdMicroseconds,
+			objectCount / simdMicroseconds);
+}
@@ -0,0 +1,13 @@
+#ifndef CULLING_BENCHMARK_H
+#define CULLING_BENCHMARK_H
+
+#include <cstdint>
+
+/**
+ * Times FrustumCuller with and without SIMD on a fixed random scene and logs how many objects
+ * each culls per microsecond. Everything runs on the calling thread, so the rates are per core.
+ * Blocks for about a second.
+ */
+void runCullingBenchmark(uint32_t objectCount = 1000000, uint32_t iterations = 20);
+
+#endif
@@ -0,0 +1,165 @@
+#include "DamageTracker.h"
+
+#include <algorithm>
+
+const uint32_t DamageTracker::MAX_RECTS;
+const uint32_t DamageTracker::HISTORY_FRAMES;
+const uint64_t DamageTracker::NEVER;
+
+namespace {
+	bool contains(const VkRect2D& outer, const VkRect2D& inner) {
+		return inner.offset.x >= outer.offset.x && inner.offset.y >= outer.offset.y &&
+				inner.offset.x + static_cast<int64_t>(inner.extent.width) <=
+						outer.offset.x + static_cast<int64_t>(outer.extent.width) &&
+				inner.offset.y + static_cast<int64_t>(inner.extent.height) <=
+						outer.offset.y + static_cast<int64_t>(outer.extent.height);
+	}
+}
+
+void DamageTracker::reset(VkExtent2D extent, uint32_t imageCount) {
+	this->extent = extent;
+	imageFrames.assign(imageCount, NEVER);
+	frame = 0;
+	addAll();
+}
+
+void DamageTracker::add(const VkRect2D& rect) {
+	if(full) {
+		return;
+	}
+
+	int64_t left = std::max<int64_t>(rect.offset.x, 0);
+	int64_t top = std::max<int64_t>(rect.offset.y, 0);
+	int64_t right = std::min<int64_t>(rect.offset.x + static_cast<int64_t>(rect.extent.width), extent.width);
+	int64_t bottom = std::min<int64_t>(rect.offset.y + static_cast<int64_t>(rect.extent.height), extent.height);
+	if(left >= right || top >= bottom) {
+		return;
+	}
+	if(left == 0 && top == 0 && right == extent.width && bottom == extent.height) {
+		addAll();
+		return;
+	}
+
+	VkRect2D clipped = {};
+	clipped.offset = {static_cast<int32_t>(left), static_cast<int32_t>(top)};
+	clipped.extent = {static_cast<uint32_t>(right - left), static_cast<uint32_t>(bottom - top)};
+	for(const VkRect2D& existing : rects) {
+		if(contains(existing, clipped)) {
+			return;
+		}
+	}
+	rects.erase(std::remove_if(rects.begin(), rects.end(),
+			[&clipped](const VkRect2D& existing) { return contains(clipped, existing); }), rects.end());
+	rects.push_back(clipped);
+
+	// Many small rects cost more to scissor and present than the pixels between them
+	if(rects.size() > MAX_RECTS) {
+		VkRect2D bounds = getBounds();
+		rects.assign(1, bounds);
+	}
+}
+
+void DamageTracker::addAll() {
+	VkRect2D all = {};
+	all.extent = extent;
+	rects.assign(1, all);
+	full = true;
+}
+
+bool DamageTracker::isEmpty() const {
+	return rects.empty();
+}
+
+bool DamageTracker::isFull() const {
+	return full;
+}
+
+const std::vector<VkRect2D>& DamageTracker::getRects() const {
+	return rects;
+}
+
+bool DamageTracker::hasContents(uint32_t imageIndex) const {
+	return imageFrames[imageIndex] != NEVER;
+}
+
+VkRect2D DamageTracker::getImageDamage(uint32_t imageIndex) const {
+	VkRect2D all = {};
+	all.extent = extent;
+	uint64_t lastFrame = imageFrames[imageIndex];
+	if(full || lastFrame == NEVER || frame - lastFrame > HISTORY_FRAMES) {
+		return all;
+	}
+
+	VkRect2D damage = getBounds();
+	for(uint64_t f = lastFrame + 1; f < frame; f++) {
+		damage = uniteRects(damage, history[f % HISTORY_FRAMES]);
+	}
+	return damage;
+}
+
+void DamageTracker::endFrame(uint32_t imageIndex) {
+	history[frame % HISTORY_FRAMES] = getBounds();
+	imageFrames[imageIndex] = frame;
+	frame++;
+	rects.clear();
+	full = false;
+}
+
+VkRect2D DamageTracker::getBounds() const {
+	VkRect2D bounds = {};
+	for(const VkRect2D& rect : rects) {
+		bounds = uniteRects(bounds, rect);
+	}
+	return bounds;
+}
+
+bool isRectEmpty(const VkRect2D& rect) {
+	return rect.extent.width == 0 || rect.extent.height == 0;
+}
+
+VkRect2D uniteRects(const VkRect2D& first, const VkRect2D& second) {
+	if(isRectEmpty(first)) {
+		return second;
+	}
+	if(isRectEmpty(second)) {
+		return first;
+	}
+
+	int64_t left = std::min(first.offset.x, second.offset.x);
+	int64_t top = std::min(first.offset.y, second.offset.y);
+	int64_t right = std::max(first.offset.x + static_cast<int64_t>(first.extent.width),
+			second.offset.x + static_cast<int64_t>(second.extent.width));
+	int64_t bottom = std::max(first.offset.y + static_cast<int64_t>(first.extent.height),
+			second.offset.y + static_cast<int64_t>(second.extent.height));
+
+	VkRect2D united = {};
+	united.offset = {static_cast<int32_t>(left), static_cast<int32_t>(top)};
+	united.extent = {static_cast<uint32_t>(right - left), static_cast<uint32_t>(bottom - top)};
+	return united;
+}
+
+VkRect2D rotateRect(const VkRect2D& rect, VkExtent2D extent, uint32_t quarterTurns) {
+	int32_t width = static_cast<int32_t>(extent.width);
+	int32_t height = static_cast<int32_t>(extent.height);
+	int32_t right = rect.offset.x + static_cast<int32_t>(rect.extent.width);
+	int32_t bottom = rect.offset.y + static_cast<int32_t>(rect.extent.height);
+
+	// Each turn takes +x toward +y, so the display's top left lands at the image's top right
+	VkRect2D rotated = rect;
+	switch(quarterTurns % 4) {
+		case 1:
+			rotated.offset = {height - bottom, rect.offset.x};
+			rotated.extent = {rect.extent.height, rect.extent.width};
+			break;
+		case 2:
+			rotated.offset = {width - right, height - bottom};
+			break;
+		case 3:
+			rotated.offset = {rect.offset.y, width - right};
+			rotated.extent = {rect.extent.height, rect.extent.width};
+			break;
+		default:
+			break;
+	}
+	return rotated;
+}
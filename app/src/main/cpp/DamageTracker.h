@@ -0,0 +1,67 @@
+#ifndef DAMAGE_TRACKER_H
+#define DAMAGE_TRACKER_H
+
+#include "vulkan_wrapper/vulkan_wrapper.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Tracks which pixels of the swapchain changed, so a frame only renders and presents those. Each
+ * frame collects the rects that differ from the frame before. A swapchain image still holds the
+ * frame it last rendered, so it has to catch up on everything that changed since then, which the
+ * last few frames' bounding boxes are kept for. Images never rendered, or too far behind, catch up
+ * on everything.
+ *
+ * Rects are in pixels of the swapchain image, clipped to its extent.
+ */
+class DamageTracker {
+	public:
+		/** Beyond this many rects, a frame's damage becomes their bounding box. */
+		static const uint32_t MAX_RECTS = 16;
+		/** Frames an image can be behind and still catch up on just what changed. */
+		static const uint32_t HISTORY_FRAMES = 8;
+
+		/** For a new swapchain, whose images hold nothing yet. Everything is damaged. */
+		void reset(VkExtent2D extent, uint32_t imageCount);
+
+		void add(const VkRect2D& rect);
+		void addAll();
+
+		bool isEmpty() const;
+		bool isFull() const;
+		/** This frame's damage, as presented. */
+		const std::vector<VkRect2D>& getRects() const;
+		/** Whether the image holds a frame at all, which it keeps even when too far behind. */
+		bool hasContents(uint32_t imageIndex) const;
+		/** What the image has to render this frame to catch up, as one rect. */
+		VkRect2D getImageDamage(uint32_t imageIndex) const;
+
+		/** The image now holds this frame, and the next one starts with nothing damaged. */
+		void endFrame(uint32_t imageIndex);
+
+	private:
+		static const uint64_t NEVER = static_cast<uint64_t>(-1);
+
+		VkExtent2D extent = {};
+		std::vector<VkRect2D> rects;
+		bool full = false;
+		uint64_t frame = 0;
+		VkRect2D history[HISTORY_FRAMES] = {};
+		std::vector<uint64_t> imageFrames;
+
+		VkRect2D getBounds() const;
+};
+
+/** Whether the rect covers no pixels. */
+bool isRectEmpty(const VkRect2D& rect);
+/** The smallest rect covering both. Empty rects cover nothing. */
+VkRect2D uniteRects(const VkRect2D& first, const VkRect2D& second);
+
+/**
+ * Turns a rect in pixels of the extent as seen on screen by quarter turns, into a swapchain image
+ * pre-rotated to match. The same with the image's extent and the remaining turns turns it back.
+ */
+VkRect2D rotateRect(const VkRect2D& rect, VkExtent2D extent, uint32_t quarterTurns);
+
+#endif
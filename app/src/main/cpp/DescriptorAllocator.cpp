@@ -0,0 +1,239 @@
+#include "DescriptorAllocator.h"
+
+#include "CapabilityUtils.h"
+
+DescriptorWriter& DescriptorWriter::bindBuffer(uint32_t binding, VkDescriptorType type,
+		VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+	Entry entry = {};
+	entry.binding = binding;
+	entry.type = type;
+	entry.bufferInfo.buffer = buffer;
+	entry.bufferInfo.offset = offset;
+	entry.bufferInfo.range = range;
+	entries.push_back(entry);
+
+	return *this;
+}
+
+DescriptorWriter& DescriptorWriter::bindImage(uint32_t binding, VkDescriptorType type,
+		VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout) {
+	Entry entry = {};
+	entry.binding = binding;
+	entry.type = type;
+	entry.imageInfo.imageView = imageView;
+	entry.imageInfo.sampler = sampler;
+	entry.imageInfo.imageLayout = imageLayout;
+	entries.push_back(entry);
+
+	return *this;
+}
+
+void DescriptorWriter::clear() {
+	entries.clear();
+}
+
+void DescriptorWriter::update(VkDevice device, VkDescriptorSet set) const {
+	std::vector<VkWriteDescriptorSet> writes(entries.size());
+	for(size_t i = 0; i < entries.size(); i++) {
+		const Entry& entry = entries[i];
+
+		VkWriteDescriptorSet& write = writes[i];
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = set;
+		write.dstBinding = entry.binding;
+		write.dstArrayElement = 0;
+		write.descriptorType = entry.type;
+		write.descriptorCount = 1;
+
+		if(entry.bufferInfo.buffer != VK_NULL_HANDLE) {
+			write.pBufferInfo = &entry.bufferInfo;
+		} else {
+			write.pImageInfo = &entry.imageInfo;
+		}
+	}
+
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void DescriptorWriter::appendKey(std::vector<uint64_t>& key) const {
+	for(const Entry& entry : entries) {
+		key.push_back(entry.binding);
+		key.push_back(entry.type);
+		key.push_back((uint64_t) entry.bufferInfo.buffer);
+		key.push_back(entry.bufferInfo.offset);
+		key.push_back(entry.bufferInfo.range);
+		key.push_back((uint64_t) entry.imageInfo.imageView);
+		key.push_back((uint64_t) entry.imageInfo.sampler);
+		key.push_back(entry.imageInfo.imageLayout);
+	}
+}
+
+bool DescriptorWriter::keyBinds(const uint64_t* key, size_t length, uint64_t handle) {
+	// Entries as appendKey writes them: the buffer third, then the image view and sampler sixth and
+	// seventh
+	const size_t entryLength = 8;
+	for(size_t entry = 0; entry + entryLength <= length; entry += entryLength) {
+		if(key[entry + 2] == handle || key[entry + 5] == handle || key[entry + 6] == handle) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void DescriptorAllocator::initialize(VkDevice device, uint32_t framesInFlight) {
+	this->device = device;
+	framePools.resize(framesInFlight);
+	retiredSets.resize(framesInFlight);
+	// Cached sets are freed one by one when forgotten, so their pools aren't shared with the frames'
+	persistentPools.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+}
+
+void DescriptorAllocator::destroy() {
+	for(PoolChain& chain : framePools) {
+		freePools.insert(freePools.end(), chain.pools.begin(), chain.pools.end());
+	}
+	freePools.insert(freePools.end(), persistentPools.pools.begin(), persistentPools.pools.end());
+
+	for(VkDescriptorPool pool : freePools) {
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	}
+
+	framePools.clear();
+	persistentPools = PoolChain();
+	freePools.clear();
+	cachedSets.clear();
+	retiredSets.clear();
+}
+
+void DescriptorAllocator::beginFrame(uint32_t frameIndex) {
+	this->frameIndex = frameIndex;
+
+	PoolChain& chain = framePools[frameIndex];
+	for(VkDescriptorPool pool : chain.pools) {
+		vkResetDescriptorPool(device, pool, 0);
+	}
+
+	// Keep the first pool with this frame, since it's almost always enough on its own
+	if(chain.pools.size() > 1) {
+		freePools.insert(freePools.end(), chain.pools.begin() + 1, chain.pools.end());
+		chain.pools.resize(1);
+	}
+	chain.current = 0;
+
+	std::vector<CachedSet>& retired = retiredSets[frameIndex];
+	for(const CachedSet& cached : retired) {
+		assertSuccess(vkFreeDescriptorSets(device, cached.pool, 1, &cached.set),
+				"Failed to free descriptor set.");
+	}
+	if(!retired.empty()) {
+		// Earlier pools may have room again
+		persistentPools.current = 0;
+		retired.clear();
+	}
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout) {
+	return allocateFrom(framePools[frameIndex], layout);
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout,
+		const DescriptorWriter& writer) {
+	VkDescriptorSet set = allocate(layout);
+	writer.update(device, set);
+
+	return set;
+}
+
+VkDescriptorSet DescriptorAllocator::getCachedSet(VkDescriptorSetLayout layout,
+		const DescriptorWriter& writer) {
+	scratchKey.clear();
+	scratchKey.push_back((uint64_t) layout);
+	writer.appendKey(scratchKey);
+
+	auto existing = cachedSets.find(scratchKey);
+	if(existing != cachedSets.end()) {
+		return existing->second.set;
+	}
+
+	VkDescriptorSet set = allocateFrom(persistentPools, layout);
+	writer.update(device, set);
+	cachedSets[scratchKey] = {set, persistentPools.pools[persistentPools.current]};
+
+	return set;
+}
+
+void DescriptorAllocator::forget(uint64_t handle) {
+	// Frames already recorded may still bind the sets, so only the lookup goes at once
+	for(auto it = cachedSets.begin(); it != cachedSets.end();) {
+		const std::vector<uint64_t>& key = it->first;
+		if(DescriptorWriter::keyBinds(key.data() + 1, key.size() - 1, handle)) {
+			retiredSets[frameIndex].push_back(it->second);
+			it = cachedSets.erase(it);
+		} else {
+			it++;
+		}
+	}
+}
+
+VkDescriptorPool DescriptorAllocator::acquirePool(VkDescriptorPoolCreateFlags flags) {
+	if(flags == 0 && !freePools.empty()) {
+		VkDescriptorPool pool = freePools.back();
+		freePools.pop_back();
+		return pool;
+	}
+
+	// Rough proportions of each descriptor type per set; a pool that runs short of one type is
+	// simply retired for the frame and a fresh one taken.
+	const VkDescriptorPoolSize poolSizes[] = {
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 * SETS_PER_POOL },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, SETS_PER_POOL },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * SETS_PER_POOL },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 * SETS_PER_POOL },
+			{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 2 * SETS_PER_POOL },
+			{ VK_DESCRIPTOR_TYPE_SAMPLER, SETS_PER_POOL },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, SETS_PER_POOL },
+			{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, SETS_PER_POOL }};
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = flags;
+	poolInfo.poolSizeCount = sizeof(poolSizes) / sizeof(poolSizes[0]);
+	poolInfo.pPoolSizes = poolSizes;
+	poolInfo.maxSets = SETS_PER_POOL;
+
+	VkDescriptorPool pool;
+	assertSuccess(vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool),
+			"Failed to create descriptor pool.");
+
+	return pool;
+}
+
+VkDescriptorSet DescriptorAllocator::allocateFrom(PoolChain& chain, VkDescriptorSetLayout layout) {
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	while(true) {
+		bool freshPool = chain.current == chain.pools.size();
+		if(freshPool) {
+			chain.pools.push_back(acquirePool(chain.flags));
+		}
+
+		allocInfo.descriptorPool = chain.pools[chain.current];
+
+		VkDescriptorSet set;
+		VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+		if(result == VK_SUCCESS) {
+			return set;
+		}
+
+		// Without VK_KHR_maintenance1 an exhausted pool may report any allocation error, so only
+		// treat the failure as fatal if even an empty pool can't satisfy the request.
+		if(freshPool) {
+			assertSuccess(result, "Failed to allocate descriptor set.");
+		}
+
+		chain.current++;
+	}
+}
@@ -0,0 +1,102 @@
+#ifndef DESCRIPTOR_ALLOCATOR_H
+#define DESCRIPTOR_ALLOCATOR_H
+
+#include "vulkan_wrapper/vulkan_wrapper.h"
+#include "CollectionUtils.h"
+
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Collects the resources to bind into a descriptor set. The same writer both updates a set and
+ * identifies it for DescriptorAllocator's cache, so the two can't drift apart.
+ */
+class DescriptorWriter {
+	public:
+		DescriptorWriter& bindBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer,
+				VkDeviceSize offset, VkDeviceSize range);
+		DescriptorWriter& bindImage(uint32_t binding, VkDescriptorType type, VkImageView imageView,
+				VkSampler sampler, VkImageLayout imageLayout);
+
+		void clear();
+		void update(VkDevice device, VkDescriptorSet set) const;
+		void appendKey(std::vector<uint64_t>& key) const;
+
+		/** Whether a key from appendKey binds the buffer, image view or sampler. */
+		static bool keyBinds(const uint64_t* key, size_t length, uint64_t handle);
+
+	private:
+		struct Entry {
+			uint32_t binding;
+			VkDescriptorType type;
+			VkDescriptorBufferInfo bufferInfo;
+			VkDescriptorImageInfo imageInfo;
+		};
+
+		std::vector<Entry> entries;
+};
+
+/**
+ * Hands out descriptor sets from growable pools. Transient sets come from pools owned by a frame
+ * in flight and are recycled wholesale by beginFrame, so per-draw sets cost a pool bump rather
+ * than an allocation. Sets whose contents never change are cached by layout and bound resources
+ * and live until destroy, or until forget is called for a resource they bind.
+ */
+class DescriptorAllocator {
+	public:
+		void initialize(VkDevice device, uint32_t framesInFlight);
+		void destroy();
+
+		/** Recycles the pools of the given frame. Call once that frame's fence has signaled. */
+		void beginFrame(uint32_t frameIndex);
+
+		/** A set that stays valid until the current frame index comes around again. */
+		VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+		VkDescriptorSet allocate(VkDescriptorSetLayout layout, const DescriptorWriter& writer);
+
+		/** A set that's written once and shared by every request for the same layout and resources. */
+		VkDescriptorSet getCachedSet(VkDescriptorSetLayout layout, const DescriptorWriter& writer);
+
+		/**
+		 * Drops the cached sets binding a buffer, image view or sampler, cast to uint64_t, before it's
+		 * destroyed and its handle value can come back for another resource. The sets are freed
+		 * once the current frame index comes around again.
+		 */
+		void forget(uint64_t handle);
+
+	private:
+		static const uint32_t SETS_PER_POOL = 256;
+
+		struct KeyHash {
+			size_t operator()(const std::vector<uint64_t>& key) const {
+				return static_cast<size_t>(hashWords(key.data(), key.size()));
+			}
+		};
+
+		struct PoolChain {
+			std::vector<VkDescriptorPool> pools;
+			size_t current = 0;
+			VkDescriptorPoolCreateFlags flags = 0;
+		};
+
+		struct CachedSet {
+			VkDescriptorSet set;
+			VkDescriptorPool pool;
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+		uint32_t frameIndex = 0;
+		std::vector<PoolChain> framePools;
+		PoolChain persistentPools;
+		std::vector<VkDescriptorPool> freePools;
+
+		std::unordered_map<std::vector<uint64_t>, CachedSet, KeyHash> cachedSets;
+		std::vector<uint64_t> scratchKey;
+		// Forgotten sets, by the frame that may last have used them
+		std::vector<std::vector<CachedSet>> retiredSets;
+
+		VkDescriptorPool acquirePool(VkDescriptorPoolCreateFlags flags);
+		VkDescriptorSet allocateFrom(PoolChain& chain, VkDescriptorSetLayout layout);
+};
+
+#endif
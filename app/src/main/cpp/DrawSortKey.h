@@ -0,0 +1,63 @@
+#ifndef DRAW_SORT_KEY_H
+#define DRAW_SORT_KEY_H
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Draws are submitted in the order of 64-bit keys, most significant field first:
+ *
+ *   opaque layers:       layer:4 | pipeline:10 | material:16 | mesh:12 | depth:22
+ *   transparent layers:  layer:4 | inverted depth:22 | pipeline:10 | material:16 | mesh:12
+ *
+ * Opaque draws group by state, then go front to back within a group so early depth testing
+ * rejects more. Transparent draws must blend back to front, so depth comes before state there.
+ */
+const uint32_t DRAW_LAYER_OPAQUE = 0;
+const uint32_t DRAW_LAYER_ALPHA_TESTED = 1;
+/** This layer and every one after it is sorted back to front. */
+const uint32_t DRAW_LAYER_TRANSPARENT = 8;
+const uint32_t DRAW_LAYER_OVERLAY = 12;
+
+const uint32_t DRAW_SORT_LAYER_BITS = 4;
+const uint32_t DRAW_SORT_PIPELINE_BITS = 10;
+const uint32_t DRAW_SORT_MATERIAL_BITS = 16;
+const uint32_t DRAW_SORT_MESH_BITS = 12;
+const uint32_t DRAW_SORT_DEPTH_BITS = 22;
+
+/**
+ * Non-negative floats order the same as their bit patterns, so the top bits of a view depth
+ * quantize it logarithmically with no range to configure: 14 bits of mantissa survive.
+ */
+inline uint64_t quantizeSortDepth(float viewDepth) {
+	float depth = viewDepth > 0.0f ? viewDepth : 0.0f;
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	return bits >> (32 - 1 - DRAW_SORT_DEPTH_BITS);
+}
+
+/** Ids wider than their fields are truncated, so keep them within range. */
+inline uint64_t makeDrawSortKey(uint32_t layer, uint32_t pipeline, uint32_t material, uint32_t mesh,
+		float viewDepth) {
+	const uint32_t stateBits = DRAW_SORT_PIPELINE_BITS + DRAW_SORT_MATERIAL_BITS + DRAW_SORT_MESH_BITS;
+	uint64_t state =
+			static_cast<uint64_t>(pipeline & ((1u << DRAW_SORT_PIPELINE_BITS) - 1)) <<
+					(DRAW_SORT_MATERIAL_BITS + DRAW_SORT_MESH_BITS) |
+			static_cast<uint64_t>(material & ((1u << DRAW_SORT_MATERIAL_BITS) - 1)) << DRAW_SORT_MESH_BITS |
+			(mesh & ((1u << DRAW_SORT_MESH_BITS) - 1));
+	uint64_t depth = quantizeSortDepth(viewDepth);
+	uint64_t key = static_cast<uint64_t>(layer & ((1u << DRAW_SORT_LAYER_BITS) - 1)) <<
+			(64 - DRAW_SORT_LAYER_BITS);
+
+	if(layer >= DRAW_LAYER_TRANSPARENT) {
+		uint64_t farthestFirst = ((1ull << DRAW_SORT_DEPTH_BITS) - 1) - depth;
+		return key | farthestFirst << stateBits | state;
+	}
+	return key | state << DRAW_SORT_DEPTH_BITS | depth;
+}
+
+inline uint32_t getDrawSortLayer(uint64_t key) {
+	return static_cast<uint32_t>(key >> (64 - DRAW_SORT_LAYER_BITS));
+}
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef ENTITY_REGISTRY_H
+#define ENTITY_REGISTRY_H
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * A handle to an entity: an index into the registry's slots and the generation of that slot, so
+ * handles to destroyed entities are told apart from whatever reuses the slot.
+ */
+struct Entity {
+	static const uint32_t NONE = static_cast<uint32_t>(-1);
+
+	uint32_t index = NONE;
+	uint32_t generation = 0;
+
+	bool operator==(const Entity& other) const {
+		return index == other.index && generation == other.generation;
+	}
+	bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+class ComponentPoolBase {
+	public:
+		virtual ~ComponentPoolBase() {}
+		virtual bool contains(Entity entity) const = 0;
+		virtual void remove(Entity entity) = 0;
+};
+
+/**
+ * A sparse set: components packed densely in one array, with a sparse array mapping entity
+ * indices to their place in it. Iterating the dense array visits every component in order with
+ * no gaps, and removal swaps the last component into the hole.
+ *
+ * Pools that hold the same entities, added and removed together, stay in the same order, so
+ * joining them is a linear walk; EntityRegistry::each checks for that before looking anything up.
+ */
+template<typename T> class ComponentPool : public ComponentPoolBase {
+	public:
+		static const uint32_t ABSENT = static_cast<uint32_t>(-1);
+
+		template<typename... Args> T& add(Entity entity, Args&&... args) {
+			assert(!contains(entity));
+			if(entity.index >= sparse.size()) {
+				sparse.resize(entity.index + 1, ABSENT);
+			}
+			sparse[entity.index] = static_cast<uint32_t>(dense.size());
+			entities.push_back(entity);
+			dense.emplace_back(std::forward<Args>(args)...);
+			return dense.back();
+		}
+
+		void remove(Entity entity) override {
+			if(!contains(entity)) {
+				return;
+			}
+
+			uint32_t slot = sparse[entity.index];
+			uint32_t last = static_cast<uint32_t>(dense.size()) - 1;
+			if(slot != last) {
+				dense[slot] = std::move(dense[last]);
+				entities[slot] = entities[last];
+				sparse[entities[slot].index] = slot;
+			}
+			dense.pop_back();
+			entities.pop_back();
+			sparse[entity.index] = ABSENT;
+		}
+
+		bool contains(Entity entity) const override {
+			return entity.index < sparse.size() && sparse[entity.index] != ABSENT &&
+					entities[sparse[entity.index]] == entity;
+		}
+
+		T& get(Entity entity) {
+			assert(contains(entity));
+			return dense[sparse[entity.index]];
+		}
+
+		const T& get(Entity entity) const {
+			assert(contains(entity));
+			return dense[sparse[entity.index]];
+		}
+
+		/**
+		 * contains and get for a walk alongside another pool, first trying the same dense position
+		 * before the sparse lookup.
+		 */
+		bool containsAt(uint32_t slot, Entity entity) const {
+			return (slot < entities.size() && entities[slot] == entity) || contains(entity);
+		}
+
+		T& getAt(uint32_t slot, Entity entity) {
+			return slot < entities.size() && entities[slot] == entity ? dense[slot] : get(entity);
+		}
+
+		uint32_t size() const { return static_cast<uint32_t>(dense.size()); }
+		T* data() { return dense.data(); }
+		const T* data() const { return dense.data(); }
+		const Entity* getEntities() const { return entities.data(); }
+
+		void reserve(uint32_t capacity) {
+			dense.reserve(capacity);
+			entities.reserve(capacity);
+		}
+
+	private:
+		std::vector<T> dense;
+		std::vector<Entity> entities;
+		std::vector<uint32_t> sparse;
+};
+
+template<typename T> const uint32_t ComponentPool<T>::ABSENT;
+
+/**
+ * Creates and destroys entities and owns a ComponentPool per component type. Component types are
+ * plain structs, numbered on first use.
+ */
+class EntityRegistry {
+	public:
+		Entity create() {
+			Entity entity;
+			if(freeIndices.empty()) {
+				entity.index = static_cast<uint32_t>(generations.size());
+				generations.push_back(0);
+			} else {
+				entity.index = freeIndices.back();
+				freeIndices.pop_back();
+			}
+			entity.generation = generations[entity.index];
+			aliveCount++;
+			return entity;
+		}
+
+		/** Removes the entity's components and frees its slot. */
+		void destroy(Entity entity) {
+			if(!isAlive(entity)) {
+				return;
+			}
+			for(const std::unique_ptr<ComponentPoolBase>& pool : pools) {
+				if(pool) {
+					pool->remove(entity);
+				}
+			}
+			generations[entity.index]++;
+			freeIndices.push_back(entity.index);
+			aliveCount--;
+		}
+
+		bool isAlive(Entity entity) const {
+			return entity.index < generations.size() && generations[entity.index] == entity.generation;
+		}
+
+		uint32_t size() const { return aliveCount; }
+
+		template<typename T, typename... Args> T& add(Entity entity, Args&&... args) {
+			assert(isAlive(entity));
+			return getPool<T>().add(entity, std::forward<Args>(args)...);
+		}
+
+		template<typename T> void remove(Entity entity) { getPool<T>().remove(entity); }
+		template<typename T> bool has(Entity entity) { return getPool<T>().contains(entity); }
+		template<typename T> T& get(Entity entity) { return getPool<T>().get(entity); }
+
+		template<typename T> ComponentPool<T>& getPool() {
+			uint32_t type = getComponentType<T>();
+			if(type >= pools.size()) {
+				pools.resize(type + 1);
+			}
+			if(!pools[type]) {
+				pools[type].reset(new ComponentPool<T>());
+			}
+			return static_cast<ComponentPool<T>&>(*pools[type]);
+		}
+
+		/**
+		 * Calls body(entity, first, others...) for every entity with all the listed components,
+		 * walking the first type's pool in order. Put the rarest component first. Every pool must
+		 * exist beforehand when this runs on several threads at once.
+		 */
+		template<typename First, typename... Others, typename Body> void each(Body body) {
+			eachInRange<First, Others...>(0, getPool<First>().size(), body);
+		}
+
+		/** The same as each, over positions [begin, end) of the first type's pool. */
+		template<typename First, typename... Others, typename Body>
+		void eachInRange(uint32_t begin, uint32_t end, Body body) {
+			eachInPools(begin, end, body, getPool<First>(), getPool<Others>()...);
+		}
+
+	private:
+		std::vector<uint32_t> generations;
+		std::vector<uint32_t> freeIndices;
+		std::vector<std::unique_ptr<ComponentPoolBase>> pools;
+		uint32_t aliveCount = 0;
+
+		static uint32_t nextComponentType() {
+			static uint32_t next = 0;
+			return next++;
+		}
+
+		template<typename T> static uint32_t getComponentType() {
+			static const uint32_t type = nextComponentType();
+			return type;
+		}
+
+		template<typename First, typename... Others, typename Body>
+		static void eachInPools(uint32_t begin, uint32_t end, Body& body, ComponentPool<First>& first,
+				ComponentPool<Others>&... others) {
+			const Entity* entities = first.getEntities();
+			First* components = first.data();
+			for(uint32_t slot = begin; slot < end; slot++) {
+				Entity entity = entities[slot];
+				if(containsAll(slot, entity, others...)) {
+					body(entity, components[slot], others.getAt(slot, entity)...);
+				}
+			}
+		}
+
+		static bool containsAll(uint32_t, Entity) {
+			return true;
+		}
+
+		template<typename T, typename... Others>
+		static bool containsAll(uint32_t slot, Entity entity, const ComponentPool<T>& pool,
+				const ComponentPool<Others>&... others) {
+			return pool.containsAt(slot, entity) && containsAll(slot, entity, others...);
+		}
+};
+
+#endif
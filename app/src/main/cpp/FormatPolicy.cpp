@@ -0,0 +1,93 @@
+#include "FormatPolicy.h"
+
+#include "AndroidLogging.h"
+#include "CapabilityUtils.h"
+#include "MemoryUtils.h"
+
+namespace {
+	// Floats count their mantissa with its implicit bit: 6 for B10G11R11's 5-bit blue
+	const std::vector<ColorFormat> COLOR_FORMATS = {
+			{VK_FORMAT_R5G6B5_UNORM_PACK16, "R5G6B5", 5, 0, false},
+			{VK_FORMAT_B5G6R5_UNORM_PACK16, "B5G6R5", 5, 0, false},
+			{VK_FORMAT_B8G8R8A8_UNORM, "B8G8R8A8", 8, 8, false},
+			{VK_FORMAT_R8G8B8A8_UNORM, "R8G8B8A8", 8, 8, false},
+			{VK_FORMAT_A2B10G10R10_UNORM_PACK32, "A2B10G10R10", 10, 2, false},
+			{VK_FORMAT_A2R10G10B10_UNORM_PACK32, "A2R10G10B10", 10, 2, false},
+			{VK_FORMAT_B10G11R11_UFLOAT_PACK32, "B10G11R11 float", 6, 0, true},
+			{VK_FORMAT_R16G16B16A16_SFLOAT, "R16G16B16A16 float", 11, 11, true}};
+
+	bool meetsRequirements(const ColorFormat& format, const ColorRequirements& requirements) {
+		return format.highDynamicRange == requirements.highDynamicRange &&
+				format.colorBits >= requirements.minimumColorBits &&
+				format.alphaBits >= requirements.minimumAlphaBits;
+	}
+
+	bool isSupported(VkPhysicalDevice physicalDevice, VkFormat format, VkFormatFeatureFlags features) {
+		VkFormatFeatureFlags supported =
+				getPhysicalDeviceFormatProperties(physicalDevice, format).optimalTilingFeatures;
+		return (supported & features) == features;
+	}
+}
+
+const std::vector<ColorFormat>& getColorFormats() {
+	return COLOR_FORMATS;
+}
+
+const char* getColorFormatName(VkFormat format) {
+	for(const ColorFormat& colorFormat : COLOR_FORMATS) {
+		if(colorFormat.format == format) {
+			return colorFormat.name;
+		}
+	}
+	return "unknown";
+}
+
+VkFormat pickColorFormat(VkPhysicalDevice physicalDevice, const ColorRequirements& requirements) {
+	VkFormat best = VK_FORMAT_UNDEFINED;
+	for(const ColorFormat& format : COLOR_FORMATS) {
+		if(!meetsRequirements(format, requirements) ||
+				!isSupported(physicalDevice, format.format, requirements.features)) {
+			continue;
+		}
+		if(best == VK_FORMAT_UNDEFINED || getTexelSize(format.format) < getTexelSize(best)) {
+			best = format.format;
+		}
+	}
+	return best;
+}
+
+VkSurfaceFormatKHR pickSurfaceFormat(VkPhysicalDevice physicalDevice,
+		const std::vector<VkSurfaceFormatKHR>& formats, const ColorRequirements& requirements) {
+	// Any format at all
+	if(formats.size() == 1 && formats[0].format == VK_FORMAT_UNDEFINED) {
+		VkFormat format = pickColorFormat(physicalDevice, requirements);
+		return {format != VK_FORMAT_UNDEFINED ? format : VK_FORMAT_B8G8R8A8_UNORM,
+				VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+	}
+
+	const VkSurfaceFormatKHR* best = nullptr;
+	for(const ColorFormat& format : COLOR_FORMATS) {
+		if(!meetsRequirements(format, requirements) ||
+				!isSupported(physicalDevice, format.format, requirements.features)) {
+			continue;
+		}
+		for(const VkSurfaceFormatKHR& offered : formats) {
+			if(offered.format == format.format && offered.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR &&
+					(best == nullptr || getTexelSize(offered.format) < getTexelSize(best->format))) {
+				best = &offered;
+			}
+		}
+	}
+
+	return best != nullptr ? *best : formats[0];
+}
+
+void logColorBandwidth(const char* target, VkFormat format, VkExtent2D extent, VkSampleCountFlagBits samples) {
+	const double megabyte = 1024.0 * 1024.0;
+	double texels = static_cast<double>(extent.width) * extent.height * samples;
+	double bytes = texels * getTexelSize(format);
+	double rgbaBytes = texels * getTexelSize(VK_FORMAT_R8G8B8A8_UNORM);
+	LOG_INFO("%s in %s at %ux%u, %ux: %u bytes per sample, %.2f MB per write, %.0f%% of 8-bit RGBA.",
+			target, getColorFormatName(format), extent.width, extent.height, static_cast<uint32_t>(samples),
+			getTexelSize(format), bytes / megabyte, bytes * 100.0 / rgbaBytes);
+}
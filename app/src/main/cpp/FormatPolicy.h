@@ -0,0 +1,53 @@
+#ifndef FORMAT_POLICY_H
+#define FORMAT_POLICY_H
+
+#include "vulkan_wrapper/vulkan_wrapper.h"
+
+#include <cstdint>
+#include <vector>
+
+/** What a color target needs of its format. */
+struct ColorRequirements {
+	/** Optimal tiling features, such as blending, sampling or storage. */
+	VkFormatFeatureFlags features = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT;
+	/** Fewer than 8 bits band visibly in gradients, which flat UI can afford. */
+	uint32_t minimumColorBits = 8;
+	uint32_t minimumAlphaBits = 0;
+	/** Values above 1, as lighting holds before tonemapping, which takes a float format. */
+	bool highDynamicRange = false;
+};
+
+struct ColorFormat {
+	VkFormat format;
+	const char* name;
+	/** The precision of the coarsest color channel: its bits, or for floats its mantissa's. */
+	uint32_t colorBits;
+	uint32_t alphaBits;
+	bool highDynamicRange;
+};
+
+/** The color formats the policy knows, narrowest first, and in order of preference among equals. */
+const std::vector<ColorFormat>& getColorFormats();
+const char* getColorFormatName(VkFormat format);
+
+/**
+ * The format with the fewest bytes per pixel that meets the requirements on this device, or
+ * VK_FORMAT_UNDEFINED if none does. Only formats of the dynamic range asked for qualify.
+ */
+VkFormat pickColorFormat(VkPhysicalDevice physicalDevice, const ColorRequirements& requirements);
+
+/**
+ * The same among the formats the surface offers in the sRGB color space. A surface that can't
+ * give any of them gets the first it offers.
+ */
+VkSurfaceFormatKHR pickSurfaceFormat(VkPhysicalDevice physicalDevice,
+		const std::vector<VkSurfaceFormatKHR>& formats, const ColorRequirements& requirements);
+
+/**
+ * Logs what writing the target once costs each frame in memory traffic, next to 8-bit RGBA, which
+ * every pass touching it and the compositor reading it pay again.
+ */
+void logColorBandwidth(const char* target, VkFormat format, VkExtent2D extent,
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
+
+#endif
@@ -0,0 +1,227 @@
+#include "FrustumCuller.h"
+
+#include "MathUtils.h"
+
+#include <cmath>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define FRUSTUM_CULLER_NEON
+#elif defined(__SSE2__) || defined(_M_X64)
+	#include <emmintrin.h>
+	#define FRUSTUM_CULLER_SSE2
+#endif
+
+namespace {
+	const uint32_t LANES = 4;
+
+#if defined(FRUSTUM_CULLER_NEON)
+	/** The frustum broadcast across four lanes, testing four objects at a time. */
+	class VectorFrustum {
+		public:
+			explicit VectorFrustum(const glm::vec4 planes[6]) : planes(planes) {}
+
+			/** A bit per object, set if it touches the frustum. */
+			uint32_t test(const float* x, const float* y, const float* z, const float* extentX,
+					const float* extentY, const float* extentZ, const float* radius) const {
+				float32x4_t cx = vld1q_f32(x);
+				float32x4_t cy = vld1q_f32(y);
+				float32x4_t cz = vld1q_f32(z);
+				float32x4_t ex = vld1q_f32(extentX);
+				float32x4_t ey = vld1q_f32(extentY);
+				float32x4_t ez = vld1q_f32(extentZ);
+				float32x4_t r = vld1q_f32(radius);
+
+				uint32x4_t inside = vdupq_n_u32(~0u);
+				for(int p = 0; p < 6; p++) {
+					const glm::vec4& plane = planes[p];
+					float32x4_t distance = vdupq_n_f32(plane.w);
+					distance = vmlaq_n_f32(distance, cx, plane.x);
+					distance = vmlaq_n_f32(distance, cy, plane.y);
+					distance = vmlaq_n_f32(distance, cz, plane.z);
+
+					float32x4_t boxRadius = vmulq_n_f32(ex, std::abs(plane.x));
+					boxRadius = vmlaq_n_f32(boxRadius, ey, std::abs(plane.y));
+					boxRadius = vmlaq_n_f32(boxRadius, ez, std::abs(plane.z));
+
+					float32x4_t reach = vaddq_f32(distance, vminq_f32(r, boxRadius));
+					inside = vandq_u32(inside, vcgeq_f32(reach, vdupq_n_f32(0.0f)));
+				}
+
+				const uint32_t laneBitValues[LANES] = {1, 2, 4, 8};
+				uint32x4_t maskBits = vandq_u32(inside, vld1q_u32(laneBitValues));
+				uint32x2_t halves = vadd_u32(vget_low_u32(maskBits), vget_high_u32(maskBits));
+				return vget_lane_u32(vpadd_u32(halves, halves), 0);
+			}
+
+		private:
+			const glm::vec4* planes;
+	};
+#elif defined(FRUSTUM_CULLER_SSE2)
+	/** The frustum broadcast across four lanes, testing four objects at a time. */
+	class VectorFrustum {
+		public:
+			explicit VectorFrustum(const glm::vec4 planes[6]) {
+				const __m128 signMask = _mm_set1_ps(-0.0f);
+				for(int p = 0; p < 6; p++) {
+					planeX[p] = _mm_set1_ps(planes[p].x);
+					planeY[p] = _mm_set1_ps(planes[p].y);
+					planeZ[p] = _mm_set1_ps(planes[p].z);
+					planeW[p] = _mm_set1_ps(planes[p].w);
+					absPlaneX[p] = _mm_andnot_ps(signMask, planeX[p]);
+					absPlaneY[p] = _mm_andnot_ps(signMask, planeY[p]);
+					absPlaneZ[p] = _mm_andnot_ps(signMask, planeZ[p]);
+				}
+			}
+
+			/** A bit per object, set if it touches the frustum. */
+			uint32_t test(const float* x, const float* y, const float* z, const float* extentX,
+					const float* extentY, const float* extentZ, const float* radius) const {
+				__m128 cx = _mm_loadu_ps(x);
+				__m128 cy = _mm_loadu_ps(y);
+				__m128 cz = _mm_loadu_ps(z);
+				__m128 ex = _mm_loadu_ps(extentX);
+				__m128 ey = _mm_loadu_ps(extentY);
+				__m128 ez = _mm_loadu_ps(extentZ);
+				__m128 r = _mm_loadu_ps(radius);
+
+				const __m128 zero = _mm_setzero_ps();
+				__m128 inside = _mm_cmpeq_ps(zero, zero);
+				for(int p = 0; p < 6; p++) {
+					__m128 distance = _mm_add_ps(
+							_mm_add_ps(_mm_mul_ps(cx, planeX[p]), _mm_mul_ps(cy, planeY[p])),
+							_mm_add_ps(_mm_mul_ps(cz, planeZ[p]), planeW[p]));
+					__m128 boxRadius = _mm_add_ps(
+							_mm_add_ps(_mm_mul_ps(ex, absPlaneX[p]), _mm_mul_ps(ey, absPlaneY[p])),
+							_mm_mul_ps(ez, absPlaneZ[p]));
+
+					__m128 reach = _mm_add_ps(distance, _mm_min_ps(r, boxRadius));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(reach, zero));
+				}
+
+				return static_cast<uint32_t>(_mm_movemask_ps(inside));
+			}
+
+		private:
+			__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+			__m128 absPlaneX[6], absPlaneY[6], absPlaneZ[6];
+	};
+#endif
+}
+
+const char* FrustumCuller::getInstructionSet() {
+#if defined(FRUSTUM_CULLER_NEON)
+	return "NEON";
+#elif defined(FRUSTUM_CULLER_SSE2)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+uint32_t FrustumCuller::add(const glm::vec3& center, const glm::vec3& extents, float radius) {
+	uint32_t index = size();
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	centerZ.push_back(center.z);
+	extentX.push_back(extents.x);
+	extentY.push_back(extents.y);
+	extentZ.push_back(extents.z);
+	this->radius.push_back(radius);
+	return index;
+}
+
+void FrustumCuller::set(uint32_t index, const glm::vec3& center, const glm::vec3& extents,
+		float radius) {
+	centerX[index] = center.x;
+	centerY[index] = center.y;
+	centerZ[index] = center.z;
+	extentX[index] = extents.x;
+	extentY[index] = extents.y;
+	extentZ[index] = extents.z;
+	this->radius[index] = radius;
+}
+
+void FrustumCuller::clear() {
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	extentX.clear();
+	extentY.clear();
+	extentZ.clear();
+	radius.clear();
+}
+
+uint32_t FrustumCuller::size() const {
+	return static_cast<uint32_t>(centerX.size());
+}
+
+const uint32_t* FrustumCuller::getVisibleIndices() const {
+	return visibleIndices.data();
+}
+
+uint32_t FrustumCuller::cullScalar(const glm::mat4& viewProjection) {
+	glm::vec4 planes[6];
+	extractFrustumPlanes(viewProjection, planes);
+	reserveVisibleIndices();
+	return cullRange(planes, 0, size(), 0);
+}
+
+uint32_t FrustumCuller::cull(const glm::mat4& viewProjection) {
+	glm::vec4 planes[6];
+	extractFrustumPlanes(viewProjection, planes);
+	reserveVisibleIndices();
+
+	uint32_t count = size();
+	uint32_t vectorEnd = 0;
+	uint32_t visibleCount = 0;
+
+#if defined(FRUSTUM_CULLER_NEON) || defined(FRUSTUM_CULLER_SSE2)
+	VectorFrustum frustum(planes);
+	uint32_t* visible = visibleIndices.data();
+	vectorEnd = count - count % LANES;
+	for(uint32_t i = 0; i < vectorEnd; i += LANES) {
+		uint32_t mask = frustum.test(&centerX[i], &centerY[i], &centerZ[i],
+				&extentX[i], &extentY[i], &extentZ[i], &radius[i]);
+
+		// Branchless compaction: every candidate is written, but only survivors advance the cursor
+		visible[visibleCount] = i;
+		visibleCount += mask & 1;
+		visible[visibleCount] = i + 1;
+		visibleCount += (mask >> 1) & 1;
+		visible[visibleCount] = i + 2;
+		visibleCount += (mask >> 2) & 1;
+		visible[visibleCount] = i + 3;
+		visibleCount += (mask >> 3) & 1;
+	}
+#endif
+
+	// The remainder, or everything without SIMD
+	return cullRange(planes, vectorEnd, count, visibleCount);
+}
+
+uint32_t FrustumCuller::cullRange(const glm::vec4 planes[6], uint32_t begin, uint32_t end,
+		uint32_t visibleCount) {
+	uint32_t* visible = visibleIndices.data();
+	for(uint32_t i = begin; i < end; i++) {
+		bool inside = true;
+		for(int p = 0; p < 6; p++) {
+			const glm::vec4& plane = planes[p];
+			float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+			float boxRadius = std::abs(plane.x) * extentX[i] + std::abs(plane.y) * extentY[i] +
+					std::abs(plane.z) * extentZ[i];
+			inside &= distance + std::min(radius[i], boxRadius) >= 0.0f;
+		}
+
+		visible[visibleCount] = i;
+		visibleCount += inside;
+	}
+	return visibleCount;
+}
+
+void FrustumCuller::reserveVisibleIndices() {
+	// The vector loop writes up to three indices past the last survivor
+	if(visibleIndices.size() < size() + LANES) {
+		visibleIndices.resize(size() + LANES);
+	}
+}
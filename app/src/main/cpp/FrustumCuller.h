@@ -0,0 +1,53 @@
+#ifndef FRUSTUM_CULLER_H
+#define FRUSTUM_CULLER_H
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Culls objects against a view frustum on the CPU. Each object has an axis-aligned box and a
+ * sphere sharing its center, kept as structure of arrays so four objects fit in one NEON or SSE
+ * register per component. An object survives a plane if either volume does, which costs a single
+ * comparison per plane: the sphere's radius can be tighter than the box's projected extent.
+ *
+ * The survivors' indices are written to a list owned by the culler, in increasing order. All
+ * storage is reused, so culling allocates nothing once the object count settles.
+ */
+class FrustumCuller {
+	public:
+		/** The SIMD instruction set cull uses on this build: "NEON", "SSE2" or "scalar". */
+		static const char* getInstructionSet();
+
+		/** The radius may be anything up to the length of extents; larger wastes the sphere test. */
+		uint32_t add(const glm::vec3& center, const glm::vec3& extents, float radius);
+		void set(uint32_t index, const glm::vec3& center, const glm::vec3& extents, float radius);
+		void clear();
+		uint32_t size() const;
+
+		/** Returns the number of visible objects, whose indices getVisibleIndices then lists. */
+		uint32_t cull(const glm::mat4& viewProjection);
+
+		/** The same as cull without SIMD, for reference and benchmarking. */
+		uint32_t cullScalar(const glm::mat4& viewProjection);
+
+		const uint32_t* getVisibleIndices() const;
+
+	private:
+		std::vector<float> centerX;
+		std::vector<float> centerY;
+		std::vector<float> centerZ;
+		std::vector<float> extentX;
+		std::vector<float> extentY;
+		std::vector<float> extentZ;
+		std::vector<float> radius;
+
+		std::vector<uint32_t> visibleIndices;
+
+		uint32_t cullRange(const glm::vec4 planes[6], uint32_t begin, uint32_t end,
+				uint32_t visibleCount);
+		void reserveVisibleIndices();
+};
+
+#endif
@@ -0,0 +1,282 @@
+#include "GpuCulling.h"
+
+#include "CapabilityUtils.h"
+#include "MathUtils.h"
+#include "MemoryUtils.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+	const uint32_t OBJECT_BINDING = 0;
+	const uint32_t MESH_BINDING = 1;
+	const uint32_t COMMAND_BINDING = 2;
+	const uint32_t COUNT_BINDING = 3;
+	const uint32_t INSTANCE_BINDING = 4;
+
+	struct CullPushConstants {
+		glm::vec4 frustumPlanes[6];
+		uint32_t objectCount;
+	};
+}
+
+static_assert(sizeof(VkDrawIndexedIndirectCommand) == 20,
+		"Draw commands must match the layout in cull.comp.");
+
+GpuCullingSupport queryGpuCullingSupport(VkPhysicalDevice physicalDevice) {
+	GpuCullingSupport support;
+
+	// Without these every survivor would need its own vkCmdDrawIndexedIndirect, or its own firstInstance
+	VkPhysicalDeviceFeatures features = getPhysicalDeviceFeatures(physicalDevice);
+	support.supported = features.multiDrawIndirect && features.drawIndirectFirstInstance;
+	if(!support.supported) {
+		return support;
+	}
+
+	support.drawIndirectCount = isPhysicalDeviceExtensionSupported(physicalDevice,
+			VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	support.maxDrawIndirectCount =
+			getPhysicalDeviceProperties(physicalDevice).limits.maxDrawIndirectCount;
+
+	return support;
+}
+
+void enableGpuCullingFeatures(const GpuCullingSupport& support, VkPhysicalDeviceFeatures& features) {
+	if(support.supported) {
+		features.multiDrawIndirect = VK_TRUE;
+		features.drawIndirectFirstInstance = VK_TRUE;
+	}
+}
+
+void GpuCulling::initialize(VkDevice device,
+		const VkPhysicalDeviceMemoryProperties& memoryProperties, const GpuCullingSupport& support,
+		DescriptorAllocator* descriptorAllocator, uint32_t framesInFlight, uint32_t initialCapacity,
+		VkPipeline pipeline, const PipelineLayoutInfo& pipelineLayout) {
+	this->device = device;
+	this->memoryProperties = memoryProperties;
+	this->support = support;
+	this->descriptorAllocator = descriptorAllocator;
+	this->pipeline = pipeline;
+	this->pipelineLayout = pipelineLayout.layout;
+	setLayout = pipelineLayout.setLayouts.at(0);
+
+	if(support.drawIndirectCount) {
+		drawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+				vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+		this->support.drawIndirectCount = drawIndexedIndirectCount != nullptr;
+	}
+
+	meshStream.initialize(device, memoryProperties, framesInFlight, sizeof(CullMesh), 1,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	objectStream.initialize(device, memoryProperties, framesInFlight, sizeof(CullObject),
+			initialCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	// Host visible, so the survivor count can be read back once the frame's fence has signaled.
+	// Coherence isn't needed for a value read once a frame, so any host visible type will do.
+	countStream.initialize(device, memoryProperties, framesInFlight, sizeof(uint32_t), 1,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+	for(uint32_t i = 0; i < framesInFlight; i++) {
+		*countStream.map<uint32_t>(i, 1) = 0;
+		countStream.flush(i);
+	}
+
+	frames.resize(framesInFlight);
+	for(FrameOutputs& frame : frames) {
+		reserveOutputs(frame, initialCapacity);
+	}
+}
+
+void GpuCulling::destroy() {
+	for(FrameOutputs& frame : frames) {
+		releaseOutputs(frame);
+	}
+	frames.clear();
+
+	meshStream.destroy();
+	objectStream.destroy();
+	countStream.destroy();
+	meshes.clear();
+	objects.clear();
+}
+
+bool GpuCulling::isSupported() const {
+	return support.supported;
+}
+
+void GpuCulling::setMeshes(const std::vector<CullMesh>& meshes) {
+	this->meshes = meshes;
+	version++;
+}
+
+void GpuCulling::setObjects(const std::vector<CullObject>& objects) {
+	this->objects = objects;
+	version++;
+}
+
+uint32_t GpuCulling::getObjectCount() const {
+	return static_cast<uint32_t>(objects.size());
+}
+
+uint32_t GpuCulling::getVisibleCount(uint32_t frameIndex) {
+	// Mapping within capacity neither moves nor clears the buffer
+	uint32_t* count = countStream.map<uint32_t>(frameIndex, 1);
+	countStream.invalidate(frameIndex);
+	return *count;
+}
+
+bool GpuCulling::countVisibleOnCpu(uint32_t frameIndex, uint32_t& visibleCount) const {
+	const FrameOutputs& frame = frames[frameIndex];
+	if(frame.version != version) {
+		return false;
+	}
+
+	glm::vec4 frustumPlanes[6];
+	extractFrustumPlanes(frame.viewProjection, frustumPlanes);
+
+	visibleCount = 0;
+	for(const CullObject& object : objects) {
+		if(isSphereInFrustum(frustumPlanes, object.boundingSphere)) {
+			visibleCount++;
+		}
+	}
+	return true;
+}
+
+void GpuCulling::cull(VkCommandBuffer commandBuffer, uint32_t frameIndex,
+		const glm::mat4& viewProjection) {
+	FrameOutputs& frame = frames[frameIndex];
+	uint32_t objectCount = getObjectCount();
+
+	if(frame.version != version) {
+		if(!meshes.empty()) {
+			memcpy(meshStream.map(frameIndex, static_cast<uint32_t>(meshes.size())), meshes.data(),
+					meshes.size() * sizeof(CullMesh));
+		}
+		if(!objects.empty()) {
+			memcpy(objectStream.map(frameIndex, objectCount), objects.data(),
+					objects.size() * sizeof(CullObject));
+		}
+		reserveOutputs(frame, objectCount);
+		frame.version = version;
+	}
+	frame.viewProjection = viewProjection;
+
+	VkBuffer countBuffer = countStream.getBuffer(frameIndex);
+	vkCmdFillBuffer(commandBuffer, countBuffer, 0, sizeof(uint32_t), 0);
+	if(!usesCountBuffer() && objectCount > 0) {
+		// Every slot past the survivors must still be a valid draw, so they become empty ones
+		vkCmdFillBuffer(commandBuffer, frame.commandBuffer, 0,
+				objectCount * sizeof(VkDrawIndexedIndirectCommand), 0);
+	}
+
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	if(objectCount > 0) {
+		writer.clear();
+		writer.bindBuffer(OBJECT_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+						objectStream.getBuffer(frameIndex), 0, VK_WHOLE_SIZE)
+				.bindBuffer(MESH_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+						meshStream.getBuffer(frameIndex), 0, VK_WHOLE_SIZE)
+				.bindBuffer(COMMAND_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+						frame.commandBuffer, 0, VK_WHOLE_SIZE)
+				.bindBuffer(COUNT_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+						countBuffer, 0, VK_WHOLE_SIZE)
+				.bindBuffer(INSTANCE_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+						frame.instanceBuffer, 0, VK_WHOLE_SIZE);
+		// The streams and outputs are recreated as they grow and their handles can be reused,
+		// so the set is written fresh each frame rather than cached by handle
+		VkDescriptorSet set = descriptorAllocator->allocate(setLayout, writer);
+
+		CullPushConstants pushConstants = {};
+		extractFrustumPlanes(viewProjection, pushConstants.frustumPlanes);
+		pushConstants.objectCount = objectCount;
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout,
+				0, 1, &set, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+				PUSH_CONSTANTS_SIZE, &pushConstants);
+		vkCmdDispatch(commandBuffer, (objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+	}
+
+	// The fence alone doesn't make the count visible to getVisibleCount, which may read it after
+	VkMemoryBarrier hostBarrier = {};
+	hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	hostBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+}
+
+VkBuffer GpuCulling::getInstanceBuffer(uint32_t frameIndex) const {
+	return frames[frameIndex].instanceBuffer;
+}
+
+VkBuffer GpuCulling::getDrawCommandBuffer(uint32_t frameIndex) const {
+	return frames[frameIndex].commandBuffer;
+}
+
+void GpuCulling::draw(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+	const FrameOutputs& frame = frames[frameIndex];
+	uint32_t objectCount = getObjectCount();
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+	if(usesCountBuffer()) {
+		drawIndexedIndirectCount(commandBuffer, frame.commandBuffer, 0,
+				countStream.getBuffer(frameIndex), 0, objectCount, stride);
+		return;
+	}
+
+	// The empty commands cost the GPU a little, but the CPU still records only a handful of calls
+	uint32_t maxDrawCount = std::max(support.maxDrawIndirectCount, 1u);
+	for(uint32_t first = 0; first < objectCount; first += maxDrawCount) {
+		vkCmdDrawIndexedIndirect(commandBuffer, frame.commandBuffer, first * stride,
+				std::min(maxDrawCount, objectCount - first), stride);
+	}
+}
+
+bool GpuCulling::usesCountBuffer() const {
+	return support.drawIndirectCount && getObjectCount() <= support.maxDrawIndirectCount;
+}
+
+void GpuCulling::reserveOutputs(FrameOutputs& frame, uint32_t capacity) {
+	if(capacity <= frame.capacity) {
+		return;
+	}
+
+	uint32_t newCapacity = std::max(frame.capacity, 1u);
+	while(newCapacity < capacity) {
+		newCapacity *= 2;
+	}
+
+	releaseOutputs(frame);
+	createBuffer(device, memoryProperties, newCapacity * sizeof(VkDrawIndexedIndirectCommand),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.commandBuffer, frame.commandMemory);
+	createBuffer(device, memoryProperties, newCapacity * INSTANCE_STRIDE,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.instanceBuffer, frame.instanceMemory);
+	frame.capacity = newCapacity;
+}
+
+void GpuCulling::releaseOutputs(FrameOutputs& frame) {
+	if(frame.commandBuffer == VK_NULL_HANDLE) {
+		return;
+	}
+
+	vkDestroyBuffer(device, frame.commandBuffer, nullptr);
+	vkFreeMemory(device, frame.commandMemory, nullptr);
+	vkDestroyBuffer(device, frame.instanceBuffer, nullptr);
+	vkFreeMemory(device, frame.instanceMemory, nullptr);
+	frame.commandBuffer = VK_NULL_HANDLE;
+	frame.instanceBuffer = VK_NULL_HANDLE;
+	frame.capacity = 0;
+}
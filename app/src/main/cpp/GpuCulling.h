@@ -0,0 +1,149 @@
+#ifndef GPU_CULLING_H
+#define GPU_CULLING_H
+
+#include "vulkan_wrapper/vulkan_wrapper.h"
+#include "DescriptorAllocator.h"
+#include "InstanceStream.h"
+#include "PipelineLayoutCache.h"
+#include "glm/glm.hpp"
+
+#include <vector>
+
+struct GpuCullingSupport {
+	bool supported = false;
+
+	/** VK_KHR_draw_indirect_count, letting the GPU decide how many draws to read. */
+	bool drawIndirectCount = false;
+	uint32_t maxDrawIndirectCount = 0;
+};
+
+/**
+ * GpuCulling needs multiDrawIndirect and drawIndirectFirstInstance; the count variant is used when
+ * the device also has VK_KHR_draw_indirect_count.
+ */
+GpuCullingSupport queryGpuCullingSupport(VkPhysicalDevice physicalDevice);
+
+/** Turns on the features GpuCulling relies on, for VkDeviceCreateInfo::pEnabledFeatures. */
+void enableGpuCullingFeatures(const GpuCullingSupport& support, VkPhysicalDeviceFeatures& features);
+
+/** Where a mesh lies in the shared vertex and index buffers. */
+struct CullMesh {
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t padding = 0;
+};
+static_assert(sizeof(CullMesh) == 16, "CullMesh must match the std430 layout in cull.comp.");
+
+struct CullObject {
+	/** Center and radius, in the space of the matrix passed to GpuCulling::cull. */
+	glm::vec4 boundingSphere;
+
+	/** Copied into the instance buffer for survivors, laid out like InstanceData. */
+	glm::vec4 positionScale;
+	uint32_t color;
+
+	/** An index into the meshes given to GpuCulling::setMeshes. */
+	uint32_t mesh;
+	uint32_t padding[2] = {};
+};
+static_assert(sizeof(CullObject) == 48, "CullObject must match the std430 layout in cull.comp.");
+
+/**
+ * Moves frustum culling and draw submission onto the GPU. The scene lives in a storage buffer
+ * that's uploaded only when it changes; each frame a compute dispatch tests every object's
+ * bounding sphere and appends a VkDrawIndexedIndirectCommand and an instance for each survivor,
+ * which a single indirect draw then consumes. Recording costs the same whatever the object count.
+ *
+ * The compute pipeline is built by the caller from cull.comp, whose single descriptor set holds
+ * the objects, meshes, draw commands, draw count and instances at bindings 0 to 4. Each frame in
+ * flight has its own copies of everything the dispatch writes.
+ */
+class GpuCulling {
+	public:
+		static const uint32_t WORKGROUP_SIZE = 64;
+
+		/** Six frustum planes followed by the object count. */
+		static const uint32_t PUSH_CONSTANTS_SIZE = 6 * sizeof(glm::vec4) + sizeof(uint32_t);
+
+		/** The bytes per instance written for survivors, matching InstanceData. */
+		static const uint32_t INSTANCE_STRIDE = sizeof(glm::vec4) + sizeof(uint32_t);
+
+		void initialize(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties,
+				const GpuCullingSupport& support, DescriptorAllocator* descriptorAllocator,
+				uint32_t framesInFlight, uint32_t initialCapacity, VkPipeline pipeline,
+				const PipelineLayoutInfo& pipelineLayout);
+		void destroy();
+
+		bool isSupported() const;
+
+		/** Replaces the meshes or objects. Each frame slot uploads the new data the next time it culls. */
+		void setMeshes(const std::vector<CullMesh>& meshes);
+		void setObjects(const std::vector<CullObject>& objects);
+		uint32_t getObjectCount() const;
+
+		/**
+		 * How many objects survived the last time this frame slot was culled. Call after its fence;
+		 * cull makes the count visible to the host by then.
+		 */
+		uint32_t getVisibleCount(uint32_t frameIndex);
+
+		/**
+		 * Recomputes the last cull of this frame slot on the CPU, for checking the shader against.
+		 * Returns false if the objects have changed since, leaving visibleCount untouched.
+		 */
+		bool countVisibleOnCpu(uint32_t frameIndex, uint32_t& visibleCount) const;
+
+		/**
+		 * Records the culling dispatch. Must be outside a render pass. The caller makes the draws and
+		 * instances visible to the indirect and vertex input stages before drawing.
+		 */
+		void cull(VkCommandBuffer commandBuffer, uint32_t frameIndex, const glm::mat4& viewProjection);
+
+		/** Bind at the instance-rate vertex binding for draw. */
+		VkBuffer getInstanceBuffer(uint32_t frameIndex) const;
+
+		/** The draws written by this frame slot's last cull. Both outputs can be copied out to be read back. */
+		VkBuffer getDrawCommandBuffer(uint32_t frameIndex) const;
+
+		/** Draws the survivors, with the mesh pipeline, vertex and index buffers already bound. */
+		void draw(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	private:
+		struct FrameOutputs {
+			VkBuffer commandBuffer = VK_NULL_HANDLE;
+			VkDeviceMemory commandMemory = VK_NULL_HANDLE;
+			VkBuffer instanceBuffer = VK_NULL_HANDLE;
+			VkDeviceMemory instanceMemory = VK_NULL_HANDLE;
+			uint32_t capacity = 0;
+
+			uint64_t version = 0;
+			glm::mat4 viewProjection;
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		GpuCullingSupport support;
+		DescriptorAllocator* descriptorAllocator = nullptr;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+		PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount = nullptr;
+
+		// The CPU copy is kept so frame slots can catch up one by one and for countVisibleOnCpu
+		std::vector<CullMesh> meshes;
+		std::vector<CullObject> objects;
+		uint64_t version = 1;
+
+		InstanceStream meshStream;
+		InstanceStream objectStream;
+		InstanceStream countStream;
+		std::vector<FrameOutputs> frames;
+		DescriptorWriter writer;
+
+		bool usesCountBuffer() const;
+		void reserveOutputs(FrameOutputs& frame, uint32_t capacity);
+		void releaseOutputs(FrameOutputs& frame);
+};
+
+#endif
@@ -0,0 +1,236 @@
+#include "GpuProfiler.h"
+
+#include "CapabilityUtils.h"
+
+#include <algorithm>
+#include <cstdio>
+
+const uint32_t GpuProfiler::WINDOW_FRAMES;
+const uint32_t GpuProfiler::FRAME_QUERIES;
+const uint32_t GpuProfiler::DROPPED;
+
+void GpuProfiler::initialize(VkDevice device, VkPhysicalDevice physicalDevice,
+		uint32_t queueFamilyIndex, uint32_t framesInFlight, uint32_t maxScopesPerFrame) {
+	this->device = device;
+	frameWindow.clear();
+	for(Scope& scope : scopes) {
+		scope.window.clear();
+	}
+
+	uint32_t validBits = getQueueFamilyProperties(physicalDevice)[queueFamilyIndex].timestampValidBits;
+	supported = validBits > 0;
+	if(!supported) {
+		LOG_WARN("Timestamps unsupported on the graphics queue, GPU times won't be reported.");
+		return;
+	}
+
+	validBitsMask = validBits >= 64 ? ~0ULL : (1ULL << validBits) - 1;
+	nanosecondsPerTick = getPhysicalDeviceProperties(physicalDevice).limits.timestampPeriod;
+	queryCapacity = FRAME_QUERIES + 2 * maxScopesPerFrame;
+
+	VkQueryPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = queryCapacity;
+
+	queryPools.resize(framesInFlight);
+	pending.assign(framesInFlight, false);
+	recordings.assign(framesInFlight, std::vector<Recording>());
+	openRecordings.assign(framesInFlight, std::vector<uint32_t>());
+	timestamps.resize(queryCapacity);
+	for(VkQueryPool& pool : queryPools) {
+		assertSuccess(vkCreateQueryPool(device, &poolInfo, nullptr, &pool),
+				"Failed to create timestamp query pool.");
+	}
+}
+
+void GpuProfiler::destroy() {
+	for(VkQueryPool pool : queryPools) {
+		vkDestroyQueryPool(device, pool, nullptr);
+	}
+	queryPools.clear();
+	pending.clear();
+	recordings.clear();
+	openRecordings.clear();
+	supported = false;
+}
+
+bool GpuProfiler::isSupported() const {
+	return supported;
+}
+
+uint32_t GpuProfiler::addScope(const std::string& name) {
+	for(uint32_t i = 0; i < scopes.size(); i++) {
+		if(scopes[i].name == name) {
+			return i;
+		}
+	}
+
+	Scope scope;
+	scope.name = name;
+	scopes.push_back(scope);
+	return static_cast<uint32_t>(scopes.size() - 1);
+}
+
+const std::string& GpuProfiler::getScopeName(uint32_t scope) const {
+	return scopes[scope].name;
+}
+
+uint32_t GpuProfiler::getScopeCount() const {
+	return static_cast<uint32_t>(scopes.size());
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+	if(!supported) {
+		return;
+	}
+
+	vkCmdResetQueryPool(commandBuffer, queryPools[frameIndex], 0, queryCapacity);
+	pending[frameIndex] = false;
+	recordings[frameIndex].clear();
+	openRecordings[frameIndex].clear();
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPools[frameIndex], 0);
+}
+
+void GpuProfiler::endFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+	if(!supported) {
+		return;
+	}
+
+	// Scopes left open end with the frame
+	while(!openRecordings[frameIndex].empty()) {
+		endScope(commandBuffer, frameIndex);
+	}
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPools[frameIndex], 1);
+	pending[frameIndex] = true;
+}
+
+void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t scope) {
+	if(!supported) {
+		return;
+	}
+
+	std::vector<Recording>& frameRecordings = recordings[frameIndex];
+	uint32_t beginQuery = FRAME_QUERIES + 2 * static_cast<uint32_t>(frameRecordings.size());
+	if(beginQuery + 2 > queryCapacity) {
+		openRecordings[frameIndex].push_back(DROPPED);
+		return;
+	}
+
+	// Starts as soon as the GPU reaches the scope, so waiting on earlier work counts toward it
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPools[frameIndex], beginQuery);
+	openRecordings[frameIndex].push_back(static_cast<uint32_t>(frameRecordings.size()));
+	frameRecordings.push_back({scope, beginQuery});
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+	if(!supported || openRecordings[frameIndex].empty()) {
+		return;
+	}
+
+	uint32_t recording = openRecordings[frameIndex].back();
+	openRecordings[frameIndex].pop_back();
+	if(recording == DROPPED) {
+		return;
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPools[frameIndex],
+			recordings[frameIndex][recording].beginQuery + 1);
+}
+
+bool GpuProfiler::collect(uint32_t frameIndex, double& frameMilliseconds) {
+	if(!supported || !pending[frameIndex]) {
+		return false;
+	}
+
+	const std::vector<Recording>& frameRecordings = recordings[frameIndex];
+	uint32_t count = FRAME_QUERIES + 2 * static_cast<uint32_t>(frameRecordings.size());
+	VkResult result = vkGetQueryPoolResults(device, queryPools[frameIndex], 0, count,
+			count * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if(result != VK_SUCCESS) {
+		return false;
+	}
+	pending[frameIndex] = false;
+
+	frameMilliseconds = getMilliseconds(0);
+	frameWindow.add(frameMilliseconds);
+
+	frameScopeMilliseconds.assign(scopes.size(), -1.0);
+	for(const Recording& recording : frameRecordings) {
+		double& milliseconds = frameScopeMilliseconds[recording.scope];
+		milliseconds = std::max(milliseconds, 0.0) + getMilliseconds(recording.beginQuery);
+	}
+	for(size_t i = 0; i < scopes.size(); i++) {
+		if(frameScopeMilliseconds[i] >= 0.0) {
+			scopes[i].window.add(frameScopeMilliseconds[i]);
+		}
+	}
+	return true;
+}
+
+double GpuProfiler::getFrameAverageMilliseconds() const {
+	return frameWindow.getAverage();
+}
+
+double GpuProfiler::getFrameMaximumMilliseconds() const {
+	return frameWindow.getMaximum();
+}
+
+double GpuProfiler::getAverageMilliseconds(uint32_t scope) const {
+	return scopes[scope].window.getAverage();
+}
+
+double GpuProfiler::getMaximumMilliseconds(uint32_t scope) const {
+	return scopes[scope].window.getMaximum();
+}
+
+void GpuProfiler::report() const {
+	if(frameWindow.samples.empty()) {
+		return;
+	}
+
+	std::string scopeReport;
+	for(const Scope& scope : scopes) {
+		if(scope.window.samples.empty()) {
+			continue;
+		}
+		char entry[96];
+		snprintf(entry, sizeof(entry), ", %s %.3f/%.3f ms", scope.name.c_str(),
+				scope.window.getAverage(), scope.window.getMaximum());
+		scopeReport += entry;
+	}
+	LOG_INFO("GPU times over the last %zu frames, average/maximum: frame %.3f/%.3f ms%s.",
+			frameWindow.samples.size(), frameWindow.getAverage(), frameWindow.getMaximum(),
+			scopeReport.c_str());
+}
+
+double GpuProfiler::getMilliseconds(uint32_t beginQuery) const {
+	uint64_t ticks = ((timestamps[beginQuery + 1] & validBitsMask) - (timestamps[beginQuery] & validBitsMask)) &
+			validBitsMask;
+	return ticks * nanosecondsPerTick / 1e6;
+}
+
+void GpuProfiler::Window::add(double milliseconds) {
+	if(samples.size() < WINDOW_FRAMES) {
+		samples.push_back(milliseconds);
+	} else {
+		sum -= samples[next];
+		samples[next] = milliseconds;
+	}
+	sum += milliseconds;
+	next = (next + 1) % WINDOW_FRAMES;
+}
+
+void GpuProfiler::Window::clear() {
+	samples.clear();
+	next = 0;
+	sum = 0.0;
+}
+
+double GpuProfiler::Window::getAverage() const {
+	return samples.empty() ? 0.0 : sum / samples.size();
+}
+
+double GpuProfiler::Window::getMaximum() const {
+	return samples.empty() ? 0.0 : *std::max_element(samples.begin(), samples.end());
+}
@@ -0,0 +1,114 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include "vulkan_wrapper/vulkan_wrapper.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * Times each frame's command buffer, and named scopes within it, on the GPU with pairs of
+ * timestamps. Every frame in flight has its own query pool, which is read back once that frame's
+ * fence has signaled, so reading never stalls. Times are kept as rolling averages and maxima over
+ * the last WINDOW_FRAMES frames that recorded them. Queues without timestamp support record and
+ * report nothing.
+ *
+ * Tiled GPUs interleave the subpasses of a render pass tile by tile, so scopes within a render
+ * pass overlap there; compare frame totals to weigh one pass layout against another.
+ */
+class GpuProfiler {
+	public:
+		static const uint32_t WINDOW_FRAMES = 120;
+
+		void initialize(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex,
+				uint32_t framesInFlight, uint32_t maxScopesPerFrame);
+		void destroy();
+
+		bool isSupported() const;
+
+		/**
+		 * The scope with this name, added if there's none yet. Scopes outlive initialize and destroy,
+		 * so adding them again while building a frame is fine.
+		 */
+		uint32_t addScope(const std::string& name);
+		const std::string& getScopeName(uint32_t scope) const;
+		uint32_t getScopeCount() const;
+
+		/** Both must be recorded outside a render pass. */
+		void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+		void endFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+		/**
+		 * Scopes nest, and end closes the innermost one. Allowed inside a render pass. A scope
+		 * recorded more than once in a frame counts the sum. Scopes past the maximum given to
+		 * initialize are dropped.
+		 */
+		void beginScope(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t scope);
+		void endScope(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+		/**
+		 * Fetches the times recorded the last time this frame slot was used into the rolling
+		 * statistics. Call after waiting on the frame's fence. Returns false if there's nothing to
+		 * report, including a recording that was already collected, as when a frame slot is waited
+		 * on again without being submitted.
+		 */
+		bool collect(uint32_t frameIndex, double& frameMilliseconds);
+
+		double getFrameAverageMilliseconds() const;
+		double getFrameMaximumMilliseconds() const;
+		/** 0 for a scope not recorded within the window. */
+		double getAverageMilliseconds(uint32_t scope) const;
+		double getMaximumMilliseconds(uint32_t scope) const;
+
+		/** Logs the frame and every scope recorded within the window. */
+		void report() const;
+
+	private:
+		/** The last WINDOW_FRAMES samples, with their sum kept as they come and go. */
+		struct Window {
+			std::vector<double> samples;
+			uint32_t next = 0;
+			double sum = 0.0;
+
+			void add(double milliseconds);
+			void clear();
+			double getAverage() const;
+			double getMaximum() const;
+		};
+
+		struct Scope {
+			std::string name;
+			Window window;
+		};
+
+		/** A scope's timestamps within a frame, at beginQuery and the query after it. */
+		struct Recording {
+			uint32_t scope;
+			uint32_t beginQuery;
+		};
+
+		static const uint32_t FRAME_QUERIES = 2;
+		static const uint32_t DROPPED = static_cast<uint32_t>(-1);
+
+		VkDevice device = VK_NULL_HANDLE;
+		bool supported = false;
+		double nanosecondsPerTick = 0.0;
+		uint64_t validBitsMask = 0;
+		uint32_t queryCapacity = 0;
+		std::vector<VkQueryPool> queryPools;
+		/** Per frame slot, whether the frame has ended and not been collected yet. */
+		std::vector<bool> pending;
+		std::vector<std::vector<Recording>> recordings;
+		/** Per frame slot, the recordings still open, or DROPPED for those past the maximum. */
+		std::vector<std::vector<uint32_t>> openRecordings;
+		std::vector<uint64_t> timestamps;
+		/** Per scope, its time in the frame being collected, or below 0 if it wasn't recorded. */
+		std::vector<double> frameScopeMilliseconds;
+
+		Window frameWindow;
+		std::vector<Scope> scopes;
+
+		double getMilliseconds(uint32_t beginQuery) const;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "InstanceStream.h"
+
+#include "CapabilityUtils.h"
+#include "MemoryUtils.h"
+
+#include <algorithm>
+
+void InstanceStream::initialize(VkDevice device,
+		const VkPhysicalDeviceMemoryProperties& memoryProperties, uint32_t framesInFlight,
+		VkDeviceSize stride, uint32_t initialCapacity, VkBufferUsageFlags usage,
+		VkMemoryPropertyFlags properties) {
+	this->device = device;
+	this->memoryProperties = memoryProperties;
+	this->stride = stride;
+	this->usage = usage;
+	this->properties = properties;
+
+	frames.resize(framesInFlight);
+	for(FrameBuffer& frame : frames) {
+		allocate(frame, initialCapacity);
+	}
+}
+
+void InstanceStream::destroy() {
+	for(FrameBuffer& frame : frames) {
+		release(frame);
+	}
+	frames.clear();
+}
+
+void* InstanceStream::map(uint32_t frameIndex, uint32_t count) {
+	FrameBuffer& frame = frames[frameIndex];
+	if(count > frame.capacity) {
+		uint32_t capacity = frame.capacity;
+		while(capacity < count) {
+			capacity *= 2;
+		}
+
+		release(frame);
+		allocate(frame, capacity);
+	}
+
+	return frame.mapped;
+}
+
+void InstanceStream::flush(uint32_t frameIndex) {
+	const FrameBuffer& frame = frames[frameIndex];
+	if(!frame.coherent) {
+		VkMappedMemoryRange range = getMappedRange(frame);
+		assertSuccess(vkFlushMappedMemoryRanges(device, 1, &range), "Failed to flush instance buffer.");
+	}
+}
+
+void InstanceStream::invalidate(uint32_t frameIndex) {
+	const FrameBuffer& frame = frames[frameIndex];
+	if(!frame.coherent) {
+		VkMappedMemoryRange range = getMappedRange(frame);
+		assertSuccess(vkInvalidateMappedMemoryRanges(device, 1, &range),
+				"Failed to invalidate instance buffer.");
+	}
+}
+
+VkBuffer InstanceStream::getBuffer(uint32_t frameIndex) const {
+	return frames[frameIndex].buffer;
+}
+
+uint32_t InstanceStream::getCapacity(uint32_t frameIndex) const {
+	return frames[frameIndex].capacity;
+}
+
+void InstanceStream::allocate(FrameBuffer& frame, uint32_t capacity) {
+	createBuffer(device, memoryProperties, stride * std::max(capacity, 1u), usage, properties,
+			frame.buffer, frame.memory);
+	// createBuffer takes the first type with the properties, which may have more than were asked for
+	uint32_t memoryTypeIndex = pickMemoryTypeIndex(memoryProperties,
+			getBufferMemoryRequirements(device, frame.buffer).memoryTypeBits, properties);
+	frame.coherent = (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags &
+			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+	assertSuccess(vkMapMemory(device, frame.memory, 0, VK_WHOLE_SIZE, 0, &frame.mapped),
+			"Failed to map instance buffer.");
+
+	frame.capacity = std::max(capacity, 1u);
+}
+
+void InstanceStream::release(FrameBuffer& frame) {
+	if(frame.buffer == VK_NULL_HANDLE) {
+		return;
+	}
+
+	vkUnmapMemory(device, frame.memory);
+	vkDestroyBuffer(device, frame.buffer, nullptr);
+	vkFreeMemory(device, frame.memory, nullptr);
+	frame = FrameBuffer();
+}
+
+VkMappedMemoryRange InstanceStream::getMappedRange(const FrameBuffer& frame) const {
+	// The whole allocation, which meets nonCoherentAtomSize without rounding
+	VkMappedMemoryRange range = {};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = frame.memory;
+	range.offset = 0;
+	range.size = VK_WHOLE_SIZE;
+	return range;
+}
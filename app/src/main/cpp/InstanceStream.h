@@ -0,0 +1,62 @@
+#ifndef INSTANCE_STREAM_H
+#define INSTANCE_STREAM_H
+
+#include "vulkan_wrapper/vulkan_wrapper.h"
+
+#include <vector>
+
+/**
+ * Vertex or index data rewritten by the CPU every frame, such as instances. Each frame in flight
+ * owns its own persistently mapped, host-coherent buffer, so filling one never waits on the GPU.
+ * A buffer that's too small is replaced with one twice the size; that's safe because map is only
+ * called for a frame whose fence has already signaled.
+ *
+ * Streams asked for memory that needn't be coherent must flush after writing and invalidate before
+ * reading what the GPU wrote; both do nothing when the memory turned out coherent anyway.
+ */
+class InstanceStream {
+	public:
+		void initialize(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties,
+				uint32_t framesInFlight, VkDeviceSize stride, uint32_t initialCapacity,
+				VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+				VkMemoryPropertyFlags properties =
+						VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		void destroy();
+
+		/** Room for count instances in the frame's buffer, valid until the frame is mapped again. */
+		void* map(uint32_t frameIndex, uint32_t count);
+
+		template<typename T> T* map(uint32_t frameIndex, uint32_t count) {
+			return static_cast<T*>(map(frameIndex, count));
+		}
+
+		void flush(uint32_t frameIndex);
+		void invalidate(uint32_t frameIndex);
+
+		VkBuffer getBuffer(uint32_t frameIndex) const;
+
+		/** Changes only when map had to replace the buffer, which also discards its contents. */
+		uint32_t getCapacity(uint32_t frameIndex) const;
+
+	private:
+		struct FrameBuffer {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			void* mapped = nullptr;
+			uint32_t capacity = 0;
+			bool coherent = true;
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		VkDeviceSize stride = 0;
+		VkBufferUsageFlags usage = 0;
+		VkMemoryPropertyFlags properties = 0;
+		std::vector<FrameBuffer> frames;
+
+		void allocate(FrameBuffer& frame, uint32_t capacity);
+		void release(FrameBuffer& frame);
+		VkMappedMemoryRange getMappedRange(const FrameBuffer& frame) const;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#include "InstancingBenchmark.h"
+
+#include "AndroidLogging.h"
+
+InstancingBenchmark::InstancingBenchmark(uint32_t maxInstances) : maxInstances(maxInstances) {
+	current.instanceCount = instanceCount;
+}
+
+bool InstancingBenchmark::isFinished() const {
+	return instanceCount > maxInstances;
+}
+
+uint32_t InstancingBenchmark::getInstanceCount() const {
+	return isFinished() ? maxInstances : instanceCount;
+}
+
+void InstancingBenchmark::addFrame(double cpuMilliseconds, double gpuMilliseconds) {
+	if(isFinished()) {
+		return;
+	}
+
+	// GPU times arrive a few frames late, so the warmup also flushes those from the previous step
+	frame++;
+	if(frame <= WARMUP_FRAMES) {
+		return;
+	}
+
+	current.cpuMilliseconds += cpuMilliseconds;
+	if(gpuMilliseconds >= 0.0) {
+		current.gpuMilliseconds += gpuMilliseconds;
+		current.gpuSamples++;
+	}
+
+	if(frame == WARMUP_FRAMES + MEASURED_FRAMES) {
+		finishStep();
+	}
+}
+
+void InstancingBenchmark::finishStep() {
+	current.cpuMilliseconds /= MEASURED_FRAMES;
+	if(current.gpuSamples > 0) {
+		current.gpuMilliseconds /= current.gpuSamples;
+	}
+	results.push_back(current);
+
+	LOG_INFO("Instancing benchmark: %u instances, CPU %.3f ms, GPU %.3f ms",
+			current.instanceCount, current.cpuMilliseconds, current.gpuMilliseconds);
+
+	instanceCount *= 10;
+	frame = 0;
+	current = {};
+	current.instanceCount = instanceCount;
+
+	if(isFinished()) {
+		logResults();
+	}
+}
+
+void InstancingBenchmark::logResults() const {
+	LOG_INFO("Instancing benchmark results (%u frames per step):", MEASURED_FRAMES);
+	LOG_INFO("%10s %10s %10s", "instances", "CPU ms", "GPU ms");
+	for(const Result& result : results) {
+		if(result.gpuSamples > 0) {
+			LOG_INFO("%10u %10.3f %10.3f", result.instanceCount, result.cpuMilliseconds,
+					result.gpuMilliseconds);
+		} else {
+			LOG_INFO("%10u %10.3f %10s", result.instanceCount, result.cpuMilliseconds, "n/a");
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#ifndef INSTANCING_BENCHMARK_H
+#define INSTANCING_BENCHMARK_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Drives the instancing benchmark scene. The instance count steps from 1 up to maxInstances by
+ * powers of ten; each step gets some frames to settle before its CPU and GPU frame times are
+ * averaged, and the results are logged once the sweep finishes. Holds no Vulkan state, so the
+ * app feeds it measured times and reads back the count to draw.
+ */
+class InstancingBenchmark {
+	public:
+		static const uint32_t WARMUP_FRAMES = 30;
+		static const uint32_t MEASURED_FRAMES = 120;
+
+		explicit InstancingBenchmark(uint32_t maxInstances = 1000000);
+
+		bool isFinished() const;
+		uint32_t getInstanceCount() const;
+
+		/** Records a frame drawn at the current count. Pass a negative GPU time if none is available. */
+		void addFrame(double cpuMilliseconds, double gpuMilliseconds);
+
+	private:
+		struct Result {
+			uint32_t instanceCount;
+			double cpuMilliseconds;
+			double gpuMilliseconds;
+			uint32_t gpuSamples;
+		};
+
+		uint32_t maxInstances;
+		uint32_t instanceCount = 1;
+		uint32_t frame = 0;
+		Result current = {};
+		std::vector<Result> results;
+
+		void finishStep();
+		void logResults() const;
+};
+
+#endif
@@ -2,9 +2,128 @@
 #define MATH_UTILS_H
 
 #include <algorithm>
+#include <cstdint>
+#include <limits>
+#include "glm/glm.hpp"
 
 template<typename T> T clamp(T value, T minimum, T maximum) {
 	return std::max(minimum, std::min(value, maximum)) ;
 }
 
+/** An axis-aligned box. Default constructed boxes are empty, ready to grow. */
+struct Aabb {
+	glm::vec3 minimum = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 maximum = glm::vec3(-std::numeric_limits<float>::max());
+
+	Aabb() {}
+	Aabb(const glm::vec3& minimum, const glm::vec3& maximum) : minimum(minimum), maximum(maximum) {}
+
+	bool isEmpty() const {
+		return minimum.x > maximum.x || minimum.y > maximum.y || minimum.z > maximum.z;
+	}
+
+	void grow(const glm::vec3& point) {
+		minimum = glm::min(minimum, point);
+		maximum = glm::max(maximum, point);
+	}
+
+	void grow(const Aabb& other) {
+		minimum = glm::min(minimum, other.minimum);
+		maximum = glm::max(maximum, other.maximum);
+	}
+
+	glm::vec3 getCenter() const { return 0.5f * (minimum + maximum); }
+	glm::vec3 getExtents() const { return 0.5f * (maximum - minimum); }
+
+	float getSurfaceArea() const {
+		if(isEmpty()) {
+			return 0.0f;
+		}
+		glm::vec3 size = maximum - minimum;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	bool overlaps(const Aabb& other) const {
+		return minimum.x <= other.maximum.x && maximum.x >= other.minimum.x &&
+				minimum.y <= other.maximum.y && maximum.y >= other.minimum.y &&
+				minimum.z <= other.maximum.z && maximum.z >= other.minimum.z;
+	}
+};
+
+/**
+ * Turns the xy plane from +x towards +y by quarter turns. Exact, where glm::rotate leaves rounding
+ * error in the zeros.
+ */
+inline glm::mat2 getQuarterTurn(uint32_t quarterTurns) {
+	const float cosines[] = {1.0f, 0.0f, -1.0f, 0.0f};
+	const float sines[] = {0.0f, 1.0f, 0.0f, -1.0f};
+	float cosine = cosines[quarterTurns % 4];
+	float sine = sines[quarterTurns % 4];
+	return glm::mat2(cosine, sine, -sine, cosine);
+}
+
+/**
+ * The six planes bounding what a view-projection matrix can see, as (normal, distance) with the
+ * normals facing inwards and normalized, so dot(normal, point) + distance is a signed distance.
+ * Ordered left, right, bottom, top, near, far, with near and far swapped under reversed Z.
+ * An infinite projection has no far plane; it comes out as (0, 0, 0, 1), which nothing is behind.
+ */
+inline void extractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]) {
+	glm::vec4 rows[4];
+	for(int i = 0; i < 4; i++) {
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i],
+				viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	planes[0] = rows[3] + rows[0];
+	planes[1] = rows[3] - rows[0];
+	planes[2] = rows[3] + rows[1];
+	planes[3] = rows[3] - rows[1];
+	// Vulkan clips depth to [0, w] whatever range the projection was built for
+	planes[4] = rows[2];
+	planes[5] = rows[3] - rows[2];
+
+	for(int i = 0; i < 6; i++) {
+		float length = glm::length(glm::vec3(planes[i]));
+		planes[i] = length > 0.0f ? planes[i] / length : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+}
+
+inline bool isAabbInFrustum(const glm::vec4 planes[6], const Aabb& box) {
+	glm::vec3 center = box.getCenter();
+	glm::vec3 extents = box.getExtents();
+	for(int i = 0; i < 6; i++) {
+		glm::vec3 normal(planes[i]);
+		if(glm::dot(normal, center) + planes[i].w < -glm::dot(glm::abs(normal), extents)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Slab test of a ray against a box, taking 1 / direction so it's computed once per ray. On a hit,
+ * entry is the distance along the ray where it enters the box, or 0 if it starts inside.
+ */
+inline bool intersectRayAabb(const glm::vec3& origin, const glm::vec3& inverseDirection,
+		const Aabb& box, float maxDistance, float& entry) {
+	glm::vec3 near = (box.minimum - origin) * inverseDirection;
+	glm::vec3 far = (box.maximum - origin) * inverseDirection;
+	glm::vec3 nearest = glm::min(near, far);
+	glm::vec3 farthest = glm::max(near, far);
+
+	entry = std::max(std::max(nearest.x, nearest.y), std::max(nearest.z, 0.0f));
+	float exit = std::min(std::min(farthest.x, farthest.y), std::min(farthest.z, maxDistance));
+	return entry <= exit;
+}
+
+inline bool isSphereInFrustum(const glm::vec4 planes[6], const glm::vec4& sphere) {
+	for(int i = 0; i < 6; i++) {
+		if(glm::dot(glm::vec3(planes[i]), glm::vec3(sphere)) + planes[i].w < -sphere.w) {
+			return false;
+		}
+	}
+	return true;
+}
+
 #endif
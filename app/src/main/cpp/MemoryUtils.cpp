@@ -0,0 +1,180 @@
+#include "MemoryUtils.h"
+
+#include "CapabilityUtils.h"
+
+bool findMemoryTypeIndex(const VkPhysicalDeviceMemoryProperties &memoryProperties,
+		uint32_t requiredMemoryTypeBits,
+		VkMemoryPropertyFlags requiredProperties,
+		uint32_t& memoryTypeIndex) {
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		if (requiredMemoryTypeBits & (1 << i) &&
+				(memoryProperties.memoryTypes[i].propertyFlags & requiredProperties) == requiredProperties) {
+			memoryTypeIndex = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint32_t pickMemoryTypeIndex(const VkPhysicalDeviceMemoryProperties &memoryProperties,
+		uint32_t requiredMemoryTypeBits,
+		VkMemoryPropertyFlags requiredProperties) {
+	uint32_t memoryTypeIndex;
+	if(!findMemoryTypeIndex(memoryProperties, requiredMemoryTypeBits, requiredProperties,
+			memoryTypeIndex)) {
+		throw std::runtime_error("Failed to find suitable memory type.");
+	}
+
+	return memoryTypeIndex;
+}
+
+void createBuffer(VkDevice device, const VkPhysicalDeviceMemoryProperties &memoryProperties,
+		VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+		VkBuffer &buffer, VkDeviceMemory &bufferMemory) {
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	assertSuccess(vkCreateBuffer(device, &bufferInfo, nullptr, &buffer),
+			"Failed to create buffer.");
+
+	VkMemoryRequirements memoryRequirements = getBufferMemoryRequirements(device, buffer);
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = pickMemoryTypeIndex(memoryProperties,
+			memoryRequirements.memoryTypeBits, properties);
+
+	assertSuccess(vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory),
+			"Failed to allocate buffer memory.");
+
+	vkBindBufferMemory(device, buffer, bufferMemory, 0);
+}
+
+VkImage createUnboundImage(VkDevice device, VkExtent2D extent, VkFormat format,
+		VkImageUsageFlags usage, VkSampleCountFlagBits samples) {
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = format;
+	imageInfo.extent.width = extent.width;
+	imageInfo.extent.height = extent.height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = samples;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = usage;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VkImage image;
+	assertSuccess(vkCreateImage(device, &imageInfo, nullptr, &image), "Failed to create image.");
+	return image;
+}
+
+static void bindImageMemory(VkDevice device, VkImage image, VkDeviceSize size,
+		uint32_t memoryTypeIndex, VkDeviceMemory& imageMemory) {
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+	assertSuccess(vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory),
+			"Failed to allocate image memory.");
+
+	vkBindImageMemory(device, image, imageMemory, 0);
+}
+
+void createImage(VkDevice device, const VkPhysicalDeviceMemoryProperties &memoryProperties,
+		VkExtent2D extent, VkFormat format, VkImageUsageFlags usage,
+		VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory,
+		VkSampleCountFlagBits samples) {
+	image = createUnboundImage(device, extent, format, usage, samples);
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, image, &memoryRequirements);
+
+	bindImageMemory(device, image, memoryRequirements.size,
+			pickMemoryTypeIndex(memoryProperties, memoryRequirements.memoryTypeBits, properties),
+			imageMemory);
+}
+
+bool createTransientAttachment(VkDevice device, const VkPhysicalDeviceMemoryProperties &memoryProperties,
+		VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkImage& image,
+		VkDeviceMemory& imageMemory, VkSampleCountFlagBits samples) {
+	image = createUnboundImage(device, extent, format,
+			usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, samples);
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, image, &memoryRequirements);
+
+	// Desktop GPUs rarely offer lazily allocated memory, so plain device memory stands in there
+	uint32_t memoryTypeIndex;
+	bool lazy = findMemoryTypeIndex(memoryProperties, memoryRequirements.memoryTypeBits,
+			VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, memoryTypeIndex);
+	if(!lazy) {
+		memoryTypeIndex = pickMemoryTypeIndex(memoryProperties, memoryRequirements.memoryTypeBits,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+
+	bindImageMemory(device, image, memoryRequirements.size, memoryTypeIndex, imageMemory);
+	return lazy;
+}
+
+VkImageAspectFlags getFormatAspects(VkFormat format) {
+	switch(format) {
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT;
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		default:
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
+
+uint32_t getTexelSize(VkFormat format) {
+	switch(format) {
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_R5G6B5_UNORM_PACK16:
+		case VK_FORMAT_B5G6R5_UNORM_PACK16:
+			return 2;
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		case VK_FORMAT_R16G16B16A16_SFLOAT:
+			return 8;
+		default:
+			return 4;
+	}
+}
+
+VkImageView createImageView(VkDevice device, VkImage image, VkFormat format,
+		VkImageAspectFlags aspectMask) {
+	VkImageViewCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	createInfo.image = image;
+	createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	createInfo.format = format;
+	createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+	createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+	createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+	createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+	createInfo.subresourceRange.aspectMask = aspectMask;
+	createInfo.subresourceRange.baseMipLevel = 0;
+	createInfo.subresourceRange.levelCount = 1;
+	createInfo.subresourceRange.baseArrayLayer = 0;
+	createInfo.subresourceRange.layerCount = 1;
+
+	VkImageView imageView;
+	assertSuccess(vkCreateImageView(device, &createInfo, nullptr, &imageView),
+			"Failed to create image view.");
+
+	return imageView;
+}
@@ -0,0 +1,49 @@
+#ifndef MEMORY_UTILS_H
+#define MEMORY_UTILS_H
+
+#include "vulkan_wrapper/vulkan_wrapper.h"
+
+/** The first type allowed by the bits with all the properties, if there is one. */
+bool findMemoryTypeIndex(const VkPhysicalDeviceMemoryProperties &memoryProperties,
+		uint32_t requiredMemoryTypeBits,
+		VkMemoryPropertyFlags requiredProperties,
+		uint32_t& memoryTypeIndex);
+
+/** As findMemoryTypeIndex, throwing when there's no such type. */
+uint32_t pickMemoryTypeIndex(const VkPhysicalDeviceMemoryProperties &memoryProperties,
+		uint32_t requiredMemoryTypeBits,
+		VkMemoryPropertyFlags requiredProperties);
+
+void createBuffer(VkDevice device, const VkPhysicalDeviceMemoryProperties &memoryProperties,
+		VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+		VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+
+/** A single-mip, single-layer 2D image with optimal tiling, with memory yet to be bound. */
+VkImage createUnboundImage(VkDevice device, VkExtent2D extent, VkFormat format,
+		VkImageUsageFlags usage, VkSampleCountFlagBits samples);
+
+/** The same, with memory of its own. */
+void createImage(VkDevice device, const VkPhysicalDeviceMemoryProperties &memoryProperties,
+		VkExtent2D extent, VkFormat format, VkImageUsageFlags usage,
+		VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory,
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
+
+/**
+ * An attachment that only lives within render passes: transient, and in lazily allocated memory
+ * where the device has it, so tilers can keep it on chip and never back it with real memory.
+ * Returns whether lazily allocated memory was used.
+ */
+bool createTransientAttachment(VkDevice device, const VkPhysicalDeviceMemoryProperties &memoryProperties,
+		VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkImage& image,
+		VkDeviceMemory& imageMemory, VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
+
+/** Depth, depth and stencil, or color. */
+VkImageAspectFlags getFormatAspects(VkFormat format);
+
+/** Bytes per texel of the swapchain and depth formats in use, for estimates; 4 for anything else. */
+uint32_t getTexelSize(VkFormat format);
+
+VkImageView createImageView(VkDevice device, VkImage image, VkFormat format,
+		VkImageAspectFlags aspectMask);
+
+#endif
@@ -0,0 +1,121 @@
+#include "PipelineLayoutCache.h"
+
+#include "CapabilityUtils.h"
+
+void PipelineLayoutCache::initialize(VkDevice device) {
+	this->device = device;
+}
+
+void PipelineLayoutCache::destroy() {
+	for(auto& entry : pipelineLayouts) {
+		vkDestroyPipelineLayout(device, entry.second.layout, nullptr);
+	}
+	pipelineLayouts.clear();
+
+	for(auto& entry : setLayouts) {
+		vkDestroyDescriptorSetLayout(device, entry.second, nullptr);
+	}
+	setLayouts.clear();
+}
+
+size_t PipelineLayoutCache::KeyHash::operator()(const std::vector<uint64_t>& key) const {
+	return static_cast<size_t>(hashWords(key.data(), key.size()));
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::getDescriptorSetLayout(
+		const std::vector<VkDescriptorSetLayoutBinding>& bindings) {
+	std::vector<uint64_t> key;
+	key.reserve(bindings.size() * 4);
+	for(const VkDescriptorSetLayoutBinding& binding : bindings) {
+		key.push_back(binding.binding);
+		key.push_back(binding.descriptorType);
+		key.push_back(binding.descriptorCount);
+		key.push_back(binding.stageFlags);
+	}
+
+	auto existing = setLayouts.find(key);
+	if(existing != setLayouts.end()) {
+		return existing->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	VkDescriptorSetLayout layout;
+	assertSuccess(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout),
+			"Failed to create descriptor set layout.");
+
+	setLayouts[key] = layout;
+	return layout;
+}
+
+PipelineLayoutInfo PipelineLayoutCache::getPipelineLayout(const ShaderReflection& reflection,
+		const std::map<uint32_t, VkDescriptorSetLayout>& setLayoutOverrides) {
+	uint32_t setCount = 0;
+	for(const ReflectedDescriptorBinding& binding : reflection.descriptorBindings) {
+		setCount = std::max(setCount, binding.set + 1);
+	}
+	for(const auto& entry : setLayoutOverrides) {
+		setCount = std::max(setCount, entry.first + 1);
+	}
+
+	std::vector<std::vector<VkDescriptorSetLayoutBinding>> bindingsBySet(setCount);
+	for(const ReflectedDescriptorBinding& reflected : reflection.descriptorBindings) {
+		if(setLayoutOverrides.count(reflected.set) != 0) {
+			continue;
+		}
+
+		if(reflected.count == 0) {
+			throw std::runtime_error("Runtime-sized descriptor array " + reflected.name +
+					" can't be bound through a reflected layout.");
+		}
+
+		VkDescriptorSetLayoutBinding binding = {};
+		binding.binding = reflected.binding;
+		binding.descriptorType = reflected.type;
+		binding.descriptorCount = reflected.count;
+		binding.stageFlags = reflected.stages;
+		bindingsBySet[reflected.set].push_back(binding);
+	}
+
+	PipelineLayoutInfo info;
+	info.pushConstantRanges = reflection.pushConstantRanges;
+	for(uint32_t set = 0; set < setCount; set++) {
+		auto override = setLayoutOverrides.find(set);
+		if(override != setLayoutOverrides.end()) {
+			info.setLayouts.push_back(override->second);
+		} else {
+			info.setLayouts.push_back(getDescriptorSetLayout(bindingsBySet[set]));
+		}
+	}
+
+	// Set layouts are already deduplicated, so their handles identify them
+	std::vector<uint64_t> key;
+	for(VkDescriptorSetLayout setLayout : info.setLayouts) {
+		key.push_back((uint64_t) setLayout);
+	}
+	for(const VkPushConstantRange& range : info.pushConstantRanges) {
+		key.push_back(range.stageFlags);
+		key.push_back(range.offset);
+		key.push_back(range.size);
+	}
+
+	auto existing = pipelineLayouts.find(key);
+	if(existing != pipelineLayouts.end()) {
+		return existing->second;
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(info.setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = info.setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(info.pushConstantRanges.size());
+	pipelineLayoutInfo.pPushConstantRanges = info.pushConstantRanges.data();
+	assertSuccess(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &info.layout),
+			"Failed to create pipeline layout.");
+
+	pipelineLayouts[key] = info;
+	return info;
+}
@@ -0,0 +1,50 @@
+#ifndef PIPELINE_LAYOUT_CACHE_H
+#define PIPELINE_LAYOUT_CACHE_H
+
+#include "vulkan_wrapper/vulkan_wrapper.h"
+#include "ShaderReflection.h"
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+struct PipelineLayoutInfo {
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+
+	/** Indexed by set number. Gaps in the shader's set numbers are filled with empty layouts. */
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	std::vector<VkPushConstantRange> pushConstantRanges;
+};
+
+/**
+ * Creates descriptor set layouts and pipeline layouts from shader reflection data, handing back
+ * the existing object whenever an identical layout has been requested before. The cache owns
+ * everything it creates; callers must not destroy the returned handles.
+ */
+class PipelineLayoutCache {
+	public:
+		void initialize(VkDevice device);
+		void destroy();
+
+		VkDescriptorSetLayout getDescriptorSetLayout(
+				const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+
+		/**
+		 * Sets listed in setLayoutOverrides take the given layout instead of one built from the
+		 * reflected bindings, for tables such as BindlessResources whose layouts carry flags and
+		 * runtime-sized arrays that reflection alone can't describe.
+		 */
+		PipelineLayoutInfo getPipelineLayout(const ShaderReflection& reflection,
+				const std::map<uint32_t, VkDescriptorSetLayout>& setLayoutOverrides = {});
+
+	private:
+		struct KeyHash {
+			size_t operator()(const std::vector<uint64_t>& key) const;
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+		std::unordered_map<std::vector<uint64_t>, VkDescriptorSetLayout, KeyHash> setLayouts;
+		std::unordered_map<std::vector<uint64_t>, PipelineLayoutInfo, KeyHash> pipelineLayouts;
+};
+
+#endif
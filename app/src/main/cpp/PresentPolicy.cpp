@@ -0,0 +1,78 @@
+#include "PresentPolicy.h"
+
+#include "AndroidLogging.h"
+
+#include <algorithm>
+
+namespace {
+	const PresentPolicy POLICIES[PRESENT_PROFILE_COUNT] = {
+			{"low latency", {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR,
+					VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR}, 1, 1, 8},
+			{"smooth", {VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR}, 1, 2, 8},
+			{"battery saver", {VK_PRESENT_MODE_FIFO_KHR}, 0, 2, 5}};
+}
+
+const PresentPolicy& getPresentPolicy(PresentProfile profile) {
+	return POLICIES[static_cast<uint32_t>(profile)];
+}
+
+uint32_t getMaxFramesInFlight() {
+	uint32_t maxFramesInFlight = 1;
+	for(const PresentPolicy& policy : POLICIES) {
+		maxFramesInFlight = std::max(maxFramesInFlight, policy.framesInFlight);
+	}
+	return maxFramesInFlight;
+}
+
+VkPresentModeKHR pickPresentMode(const PresentPolicy& policy, const std::vector<VkPresentModeKHR>& available) {
+	for(VkPresentModeKHR presentMode : policy.presentModes) {
+		if(std::find(available.begin(), available.end(), presentMode) != available.end()) {
+			return presentMode;
+		}
+	}
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+uint32_t pickImageCount(const PresentPolicy& policy, const VkSurfaceCapabilitiesKHR& capabilities) {
+	uint32_t desiredCount = capabilities.minImageCount + policy.extraImages;
+	return capabilities.maxImageCount == 0 ? // 0 means no limit
+			desiredCount :
+			std::min(desiredCount, capabilities.maxImageCount);
+}
+
+const char* getPresentModeName(VkPresentModeKHR presentMode) {
+	switch(presentMode) {
+		case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+		case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+		case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+		case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "relaxed FIFO";
+		default: return "unknown";
+	}
+}
+
+void PresentTelemetry::addFrame(PresentProfile profile, double fenceMilliseconds,
+		double acquireMilliseconds, double presentMilliseconds) {
+	Waits& profileWaits = waits[static_cast<uint32_t>(profile)];
+	profileWaits.frames++;
+	profileWaits.fenceMilliseconds += fenceMilliseconds;
+	profileWaits.acquireMilliseconds += acquireMilliseconds;
+	profileWaits.presentMilliseconds += presentMilliseconds;
+	profileWaits.worstFenceMilliseconds = std::max(profileWaits.worstFenceMilliseconds, fenceMilliseconds);
+	profileWaits.worstAcquireMilliseconds = std::max(profileWaits.worstAcquireMilliseconds, acquireMilliseconds);
+	profileWaits.worstPresentMilliseconds = std::max(profileWaits.worstPresentMilliseconds, presentMilliseconds);
+}
+
+void PresentTelemetry::report() {
+	for(uint32_t i = 0; i < PRESENT_PROFILE_COUNT; i++) {
+		const Waits& profileWaits = waits[i];
+		if(profileWaits.frames == 0) {
+			continue;
+		}
+		LOG_INFO("Present waits, %s over %u frames: fence %.3f ms (worst %.3f), acquire %.3f ms (worst %.3f), present %.3f ms (worst %.3f).",
+				POLICIES[i].name, profileWaits.frames,
+				profileWaits.fenceMilliseconds / profileWaits.frames, profileWaits.worstFenceMilliseconds,
+				profileWaits.acquireMilliseconds / profileWaits.frames, profileWaits.worstAcquireMilliseconds,
+				profileWaits.presentMilliseconds / profileWaits.frames, profileWaits.worstPresentMilliseconds);
+		waits[i] = Waits();
+	}
+}
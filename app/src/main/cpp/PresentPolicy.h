@@ -0,0 +1,66 @@
+#ifndef PRESENT_POLICY_H
+#define PRESENT_POLICY_H
+
+#include "vulkan_wrapper/vulkan_wrapper.h"
+
+#include <cstdint>
+#include <vector>
+
+enum class PresentProfile {
+	/** Shows the newest frame as soon as possible, with one frame in flight. Renders unshown frames. */
+	LOW_LATENCY,
+	/** Vsynced with a frame of slack, tearing once rather than waiting a whole refresh when late. */
+	SMOOTH,
+	/** Vsynced with the fewest images, so nothing is rendered that isn't shown. */
+	BATTERY_SAVER
+};
+
+const uint32_t PRESENT_PROFILE_COUNT = 3;
+
+/** What a profile asks of the swapchain and the frame loop. */
+struct PresentPolicy {
+	const char* name;
+	/** In order of preference. FIFO, which every device supports, ends each list. */
+	std::vector<VkPresentModeKHR> presentModes;
+	/** Images beyond the surface's minimum, as far as its maximum allows. */
+	uint32_t extraImages;
+	uint32_t framesInFlight;
+	/** The color precision the swapchain and offscreen targets keep. Below 8, 16-bit formats qualify. */
+	uint32_t minimumColorBits;
+};
+
+const PresentPolicy& getPresentPolicy(PresentProfile profile);
+/** The most frames in flight any profile uses, which per-frame resources are made for. */
+uint32_t getMaxFramesInFlight();
+
+VkPresentModeKHR pickPresentMode(const PresentPolicy& policy, const std::vector<VkPresentModeKHR>& available);
+uint32_t pickImageCount(const PresentPolicy& policy, const VkSurfaceCapabilitiesKHR& capabilities);
+const char* getPresentModeName(VkPresentModeKHR presentMode);
+
+/**
+ * Time the frame loop spends blocked, per profile: waiting for the frame's fence, for an image to
+ * render into, and in vkQueuePresentKHR.
+ */
+class PresentTelemetry {
+	public:
+		void addFrame(PresentProfile profile, double fenceMilliseconds, double acquireMilliseconds,
+				double presentMilliseconds);
+
+		/** Logs the average and worst waits of each profile used since the last report, then starts over. */
+		void report();
+
+	private:
+		struct Waits {
+			uint32_t frames;
+			double fenceMilliseconds;
+			double acquireMilliseconds;
+			double presentMilliseconds;
+			double worstFenceMilliseconds;
+			double worstAcquireMilliseconds;
+			double worstPresentMilliseconds;
+		};
+
+		Waits waits[PRESENT_PROFILE_COUNT] = {};
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include "RadixSort.h"
+
+#include <algorithm>
+
+RadixSorter::RadixSorter(ThreadPool* threadPool) : threadPool(threadPool) {}
+
+void RadixSorter::sort(std::vector<uint64_t>& keys) {
+	sortKeys(keys, nullptr);
+}
+
+void RadixSorter::sort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values) {
+	sortKeys(keys, &values);
+}
+
+void RadixSorter::sortKeys(std::vector<uint64_t>& keys, std::vector<uint32_t>* values) {
+	uint32_t count = static_cast<uint32_t>(keys.size());
+	if(count < 2) {
+		return;
+	}
+
+	uint32_t chunkCount = 1;
+	if(threadPool != nullptr) {
+		chunkCount = std::max(1u, std::min(threadPool->getThreadCount(), count / MINIMUM_CHUNK_SIZE));
+	}
+
+	// Find the bits that differ between any two keys; only those need sorting
+	uint64_t first = keys[0];
+	chunkDifferences.assign(chunkCount, 0);
+	forEachChunk(chunkCount, count, [&](uint32_t chunk, uint32_t begin, uint32_t end) {
+		uint64_t chunkDifference = 0;
+		for(uint32_t i = begin; i < end; i++) {
+			chunkDifference |= keys[i] ^ first;
+		}
+		chunkDifferences[chunk] = chunkDifference;
+	});
+	uint64_t differences = 0;
+	for(uint64_t chunkDifference : chunkDifferences) {
+		differences |= chunkDifference;
+	}
+
+	// Each digit starts at the lowest differing bit it has to cover, skipping shared bits between
+	uint32_t passShifts[64 / DIGIT_BITS + 1];
+	uint32_t passCount = 0;
+	for(uint32_t shift = 0; shift < 64 && (differences >> shift) != 0; shift += DIGIT_BITS) {
+		shift += __builtin_ctzll(differences >> shift);
+		passShifts[passCount++] = shift;
+	}
+
+	keyScratch.resize(count);
+	if(values != nullptr) {
+		valueScratch.resize(count);
+	}
+	chunkCounts.resize(chunkCount * BUCKET_COUNT);
+
+	// One thread counts every digit in a single read up front. Chunks have to be recounted each
+	// pass instead, since the previous pass moves keys between them.
+	bool countedUpFront = chunkCount == 1;
+	if(countedUpFront) {
+		passCounts.assign(passCount * BUCKET_COUNT, 0);
+		for(uint32_t i = 0; i < count; i++) {
+			uint64_t key = keys[i];
+			for(uint32_t pass = 0; pass < passCount; pass++) {
+				passCounts[pass * BUCKET_COUNT + ((key >> passShifts[pass]) & (BUCKET_COUNT - 1))]++;
+			}
+		}
+	}
+
+	for(uint32_t pass = 0; pass < passCount; pass++) {
+		uint32_t shift = passShifts[pass];
+		if(countedUpFront) {
+			std::copy(&passCounts[pass * BUCKET_COUNT], &passCounts[pass * BUCKET_COUNT] + BUCKET_COUNT,
+					chunkCounts.begin());
+		} else {
+			forEachChunk(chunkCount, count, [&](uint32_t chunk, uint32_t begin, uint32_t end) {
+				uint32_t* counts = &chunkCounts[chunk * BUCKET_COUNT];
+				std::fill(counts, counts + BUCKET_COUNT, 0);
+				for(uint32_t i = begin; i < end; i++) {
+					counts[(keys[i] >> shift) & (BUCKET_COUNT - 1)]++;
+				}
+			});
+		}
+
+		// Turn the counts into where each chunk starts writing each digit: digit major, chunk minor
+		uint32_t offset = 0;
+		for(uint32_t digit = 0; digit < BUCKET_COUNT; digit++) {
+			for(uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+				uint32_t& slot = chunkCounts[chunk * BUCKET_COUNT + digit];
+				uint32_t digitCount = slot;
+				slot = offset;
+				offset += digitCount;
+			}
+		}
+
+		forEachChunk(chunkCount, count, [&](uint32_t chunk, uint32_t begin, uint32_t end) {
+			uint32_t* offsets = &chunkCounts[chunk * BUCKET_COUNT];
+			if(values != nullptr) {
+				const uint32_t* sourceValues = values->data();
+				for(uint32_t i = begin; i < end; i++) {
+					uint32_t destination = offsets[(keys[i] >> shift) & (BUCKET_COUNT - 1)]++;
+					keyScratch[destination] = keys[i];
+					valueScratch[destination] = sourceValues[i];
+				}
+			} else {
+				for(uint32_t i = begin; i < end; i++) {
+					keyScratch[offsets[(keys[i] >> shift) & (BUCKET_COUNT - 1)]++] = keys[i];
+				}
+			}
+		});
+
+		// The scratch becomes the source of the next pass, and the caller's storage the scratch
+		keys.swap(keyScratch);
+		if(values != nullptr) {
+			values->swap(valueScratch);
+		}
+	}
+}
+
+void RadixSorter::forEachChunk(uint32_t chunkCount, uint32_t count,
+		const std::function<void(uint32_t, uint32_t, uint32_t)>& body) {
+	auto runChunks = [&](uint32_t firstChunk, uint32_t endChunk) {
+		for(uint32_t chunk = firstChunk; chunk < endChunk; chunk++) {
+			uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(count) * chunk / chunkCount);
+			uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(count) * (chunk + 1) / chunkCount);
+			body(chunk, begin, end);
+		}
+	};
+
+	if(chunkCount == 1) {
+		runChunks(0, 1);
+	} else {
+		threadPool->parallelFor(chunkCount, 1, runChunks);
+	}
+}
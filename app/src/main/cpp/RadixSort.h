@@ -0,0 +1,47 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * A stable least-significant-digit radix sort of 64-bit keys, optionally carrying a 32-bit value
+ * along with each key. A scan up front finds the bits every key shares, and each 11-bit digit
+ * starts at the lowest bit still differing, so keys with few distinct fields sort in a few passes.
+ *
+ * With a thread pool, each pass splits the keys into chunks that are counted and scattered in
+ * parallel; offsets are laid out chunk by chunk, so the result is the same as the serial sort.
+ * Scratch storage is reused between sorts.
+ */
+class RadixSorter {
+	public:
+		explicit RadixSorter(ThreadPool* threadPool = nullptr);
+
+		void sort(std::vector<uint64_t>& keys);
+
+		/** Sorts values alongside keys; both must be the same size. */
+		void sort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values);
+
+	private:
+		// 2048 counters per chunk still fit in L1 alongside the scatter's write streams
+		static const uint32_t DIGIT_BITS = 11;
+		static const uint32_t BUCKET_COUNT = 1 << DIGIT_BITS;
+
+		// Below this many keys per chunk, the threads cost more than they save
+		static const uint32_t MINIMUM_CHUNK_SIZE = 16384;
+
+		ThreadPool* threadPool;
+		std::vector<uint64_t> keyScratch;
+		std::vector<uint32_t> valueScratch;
+		std::vector<uint32_t> chunkCounts;
+		std::vector<uint64_t> chunkDifferences;
+		std::vector<uint32_t> passCounts;
+
+		void sortKeys(std::vector<uint64_t>& keys, std::vector<uint32_t>* values);
+		void forEachChunk(uint32_t chunkCount, uint32_t count,
+				const std::function<void(uint32_t, uint32_t, uint32_t)>& body);
+};
+
+#endif
@@ -0,0 +1,1289 @@
+#include "RenderGraph.h"
+
+#include "AndroidLogging.h"
+#include "CapabilityUtils.h"
+#include "MemoryUtils.h"
+#include "RenderTargetPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+const uint32_t RenderGraph::NONE;
+
+namespace {
+	struct UsageInfo {
+		VkPipelineStageFlags stages;
+		VkAccessFlags readAccess;
+		VkAccessFlags writeAccess;
+		VkImageLayout layout;
+		VkImageUsageFlags imageUsage;
+		bool attachment;
+	};
+
+	UsageInfo getUsageInfo(RenderGraphUsage usage) {
+		const VkPipelineStageFlags fragmentTests =
+				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		switch(usage) {
+			case RenderGraphUsage::COLOR_ATTACHMENT:
+				return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT,
+						VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+						VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true};
+			case RenderGraphUsage::DEPTH_ATTACHMENT:
+				return {fragmentTests, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+						VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+						VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+						VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true};
+			case RenderGraphUsage::DEPTH_READ:
+				return {fragmentTests, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, 0,
+						VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+						VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true};
+			case RenderGraphUsage::SAMPLED:
+				return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0,
+						VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false};
+			case RenderGraphUsage::INPUT_ATTACHMENT:
+				return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_INPUT_ATTACHMENT_READ_BIT, 0,
+						VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, true};
+			case RenderGraphUsage::COMPUTE_STORAGE:
+				return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+						VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false};
+			case RenderGraphUsage::INDIRECT_BUFFER:
+				return {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, 0,
+						VK_IMAGE_LAYOUT_UNDEFINED, 0, false};
+			case RenderGraphUsage::VERTEX_BUFFER:
+				return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, 0,
+						VK_IMAGE_LAYOUT_UNDEFINED, 0, false};
+			case RenderGraphUsage::TRANSFER_SOURCE:
+				return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, 0,
+						VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false};
+			case RenderGraphUsage::TRANSFER_DESTINATION:
+				return {VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+						VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, false};
+		}
+		throw std::runtime_error("Unknown render graph usage.");
+	}
+
+	const char* getLayoutName(VkImageLayout layout) {
+		switch(layout) {
+			case VK_IMAGE_LAYOUT_UNDEFINED: return "undefined";
+			case VK_IMAGE_LAYOUT_GENERAL: return "general";
+			case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return "color attachment";
+			case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return "depth attachment";
+			case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL: return "depth read";
+			case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return "shader read";
+			case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return "transfer source";
+			case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return "transfer destination";
+			case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: return "present";
+			default: return "other";
+		}
+	}
+
+	const char* getLoadOpName(VkAttachmentLoadOp loadOp) {
+		switch(loadOp) {
+			case VK_ATTACHMENT_LOAD_OP_LOAD: return "load";
+			case VK_ATTACHMENT_LOAD_OP_CLEAR: return "clear";
+			default: return "don't care";
+		}
+	}
+
+	const char* getStoreOpName(VkAttachmentStoreOp storeOp) {
+		return storeOp == VK_ATTACHMENT_STORE_OP_STORE ? "store" : "don't care";
+	}
+
+	std::string formatBarrier(const std::string& resourceName, bool image,
+			const RenderGraph::Barrier& barrier) {
+		char line[256];
+		if(image && barrier.oldLayout != barrier.newLayout) {
+			snprintf(line, sizeof(line), "%s: %s -> %s, stages 0x%x -> 0x%x, access 0x%x -> 0x%x",
+					resourceName.c_str(), getLayoutName(barrier.oldLayout), getLayoutName(barrier.newLayout),
+					barrier.sourceStages, barrier.destinationStages, barrier.sourceAccess,
+					barrier.destinationAccess);
+		} else {
+			snprintf(line, sizeof(line), "%s: stages 0x%x -> 0x%x, access 0x%x -> 0x%x",
+					resourceName.c_str(), barrier.sourceStages, barrier.destinationStages,
+					barrier.sourceAccess, barrier.destinationAccess);
+		}
+		return line;
+	}
+
+	bool overlaps(uint32_t firstA, uint32_t lastA, uint32_t firstB, uint32_t lastB) {
+		return firstA <= lastB && firstB <= lastA;
+	}
+
+	bool operator==(const VkExtent2D& a, const VkExtent2D& b) {
+		return a.width == b.width && a.height == b.height;
+	}
+}
+
+uint32_t RenderGraph::createImage(const std::string& name, VkFormat format, VkExtent2D extent,
+		VkSampleCountFlagBits samples) {
+	Resource resource;
+	resource.name = name;
+	resource.image = true;
+	resource.format = format;
+	resource.extent = extent;
+	resource.samples = samples;
+	resources.push_back(resource);
+	return static_cast<uint32_t>(resources.size() - 1);
+}
+
+uint32_t RenderGraph::importImage(const std::string& name, VkFormat format, VkExtent2D extent,
+		VkImageLayout initialLayout, VkPipelineStageFlags initialStages, VkImageLayout finalLayout) {
+	Resource resource;
+	resource.name = name;
+	resource.image = true;
+	resource.imported = true;
+	resource.output = finalLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+	resource.format = format;
+	resource.extent = extent;
+	resource.initialLayout = initialLayout;
+	resource.arrivalLayout = initialLayout;
+	resource.initialStages = initialStages;
+	resource.finalLayout = finalLayout;
+	resources.push_back(resource);
+	return static_cast<uint32_t>(resources.size() - 1);
+}
+
+uint32_t RenderGraph::importBuffer(const std::string& name, bool output) {
+	Resource resource;
+	resource.name = name;
+	resource.imported = true;
+	resource.output = output;
+	resources.push_back(resource);
+	return static_cast<uint32_t>(resources.size() - 1);
+}
+
+uint32_t RenderGraph::addPass(const std::string& name, RecordFunction record) {
+	Pass pass;
+	pass.name = name;
+	pass.record = record;
+	passes.push_back(pass);
+	return static_cast<uint32_t>(passes.size() - 1);
+}
+
+void RenderGraph::read(uint32_t pass, uint32_t resource, RenderGraphUsage usage) {
+	addAccess(pass, resource, usage, true, false);
+}
+
+void RenderGraph::write(uint32_t pass, uint32_t resource, RenderGraphUsage usage) {
+	addAccess(pass, resource, usage, false, true);
+}
+
+void RenderGraph::modify(uint32_t pass, uint32_t resource, RenderGraphUsage usage) {
+	addAccess(pass, resource, usage, true, true);
+}
+
+void RenderGraph::resolve(uint32_t pass, uint32_t source, uint32_t destination) {
+	addAccess(pass, destination, RenderGraphUsage::COLOR_ATTACHMENT, false, true);
+	for(Access& access : passes[pass].accesses) {
+		if(access.resource == destination) {
+			access.resolveSource = source;
+		}
+	}
+}
+
+void RenderGraph::setSideEffects(uint32_t pass) {
+	passes[pass].sideEffects = true;
+}
+
+void RenderGraph::setClearValue(uint32_t resource, VkClearValue value) {
+	resources[resource].cleared = true;
+	resources[resource].clearValue = value;
+}
+
+void RenderGraph::addAccess(uint32_t pass, uint32_t resource, RenderGraphUsage usage,
+		bool reads, bool writes) {
+	UsageInfo info = getUsageInfo(usage);
+	Access access = {};
+	access.resource = resource;
+	access.usage = usage;
+	access.stages = info.stages;
+	access.readAccess = reads ? info.readAccess : 0;
+	access.writeAccess = writes ? info.writeAccess : 0;
+	access.layout = resources[resource].image ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+	access.imageUsage = info.imageUsage;
+	access.attachment = info.attachment;
+	access.reads = reads;
+	access.writes = writes;
+	access.resolveSource = NONE;
+
+	// Several uses of one resource in a pass, such as indirect and vertex reads, become one access
+	for(Access& existing : passes[pass].accesses) {
+		if(existing.resource != resource) {
+			continue;
+		}
+		if(existing.layout != access.layout) {
+			throw std::runtime_error("Pass " + passes[pass].name + " needs " +
+					resources[resource].name + " in two layouts at once.");
+		}
+		existing.stages |= access.stages;
+		existing.readAccess |= access.readAccess;
+		existing.writeAccess |= access.writeAccess;
+		existing.imageUsage |= access.imageUsage;
+		existing.attachment = existing.attachment && access.attachment;
+		existing.reads = existing.reads || reads;
+		existing.writes = existing.writes || writes;
+		return;
+	}
+	passes[pass].accesses.push_back(access);
+}
+
+void RenderGraph::compile() {
+	cullPasses();
+	groupRenderPasses();
+	planLifetimes();
+	assignMemorySlots();
+	planBarriers();
+	planAttachments();
+}
+
+void RenderGraph::cullPasses() {
+	// Walking backwards, a resource is needed while some later kept pass reads what it holds now
+	std::vector<bool> needed(resources.size());
+	for(size_t i = 0; i < resources.size(); i++) {
+		needed[i] = resources[i].output;
+	}
+
+	for(size_t p = passes.size(); p-- > 0;) {
+		Pass& pass = passes[p];
+		bool kept = pass.sideEffects;
+		for(const Access& access : pass.accesses) {
+			kept = kept || (access.writes && needed[access.resource]);
+		}
+		pass.culled = !kept;
+		if(!kept) {
+			continue;
+		}
+
+		for(const Access& access : pass.accesses) {
+			if(access.writes && !access.reads) {
+				needed[access.resource] = false;
+			}
+		}
+		for(const Access& access : pass.accesses) {
+			if(access.reads) {
+				needed[access.resource] = true;
+			}
+		}
+	}
+
+	schedule.clear();
+	for(uint32_t p = 0; p < passes.size(); p++) {
+		if(!passes[p].culled) {
+			schedule.push_back(p);
+		}
+	}
+}
+
+void RenderGraph::groupRenderPasses() {
+	renderPasses.clear();
+	for(Pass& pass : passes) {
+		pass.renderPass = NONE;
+		pass.subpass = 0;
+	}
+
+	// How the render pass being grown has used each resource so far
+	std::vector<bool> written(resources.size());
+	std::vector<bool> attachmentUse(resources.size());
+	std::vector<bool> otherUse(resources.size());
+	bool open = false;
+
+	for(uint32_t p : schedule) {
+		Pass& pass = passes[p];
+		bool hasAttachments = false;
+		VkExtent2D extent = {};
+		for(const Access& access : pass.accesses) {
+			if(!access.attachment) {
+				continue;
+			}
+			const VkExtent2D& attachmentExtent = resources[access.resource].extent;
+			if(hasAttachments && !(attachmentExtent == extent)) {
+				throw std::runtime_error("Pass " + pass.name + " has attachments of different sizes.");
+			}
+			extent = attachmentExtent;
+			hasAttachments = true;
+		}
+		if(!hasAttachments) {
+			open = false;
+			continue;
+		}
+
+		// A subpass can only see what earlier ones drew at its own pixel, through attachments, and
+		// can only draw over what was drawn within the render pass
+		bool join = open && renderPasses.back().extent == extent;
+		for(const Access& access : pass.accesses) {
+			uint32_t resource = access.resource;
+			if(access.attachment) {
+				join = join && !otherUse[resource] &&
+						!(access.writes && attachmentUse[resource] && !written[resource]);
+			} else {
+				join = join && !attachmentUse[resource] &&
+						!(otherUse[resource] && (access.writes || written[resource]));
+			}
+		}
+		if(!join) {
+			renderPasses.emplace_back();
+			renderPasses.back().extent = extent;
+			std::fill(written.begin(), written.end(), false);
+			std::fill(attachmentUse.begin(), attachmentUse.end(), false);
+			std::fill(otherUse.begin(), otherUse.end(), false);
+			open = true;
+		}
+
+		RenderPass& renderPass = renderPasses.back();
+		pass.renderPass = static_cast<uint32_t>(renderPasses.size() - 1);
+		pass.subpass = static_cast<uint32_t>(renderPass.passes.size());
+		renderPass.passes.push_back(p);
+		for(const Access& access : pass.accesses) {
+			written[access.resource] = written[access.resource] || access.writes;
+			if(access.attachment) {
+				attachmentUse[access.resource] = true;
+			} else {
+				otherUse[access.resource] = true;
+			}
+		}
+	}
+}
+
+void RenderGraph::planLifetimes() {
+	for(Resource& resource : resources) {
+		resource.usage = 0;
+		resource.firstUse = NONE;
+		resource.lastUse = NONE;
+	}
+
+	std::vector<bool> attachmentOnly(resources.size(), true);
+	for(uint32_t position = 0; position < schedule.size(); position++) {
+		for(const Access& access : passes[schedule[position]].accesses) {
+			Resource& resource = resources[access.resource];
+			resource.usage |= access.imageUsage;
+			if(resource.firstUse == NONE) {
+				resource.firstUse = position;
+			}
+			resource.lastUse = position;
+			attachmentOnly[access.resource] = attachmentOnly[access.resource] && access.attachment;
+		}
+	}
+
+	for(size_t i = 0; i < resources.size(); i++) {
+		Resource& resource = resources[i];
+		if(!resource.image) {
+			continue;
+		}
+		if(resource.imported) {
+			// Only to estimate attachment traffic with
+			resource.size = static_cast<VkDeviceSize>(resource.extent.width) * resource.extent.height *
+					getTexelSize(resource.format);
+			continue;
+		}
+
+		// Attachments within one render pass can live in tile memory and never need backing
+		resource.lazy = resource.firstUse != NONE && attachmentOnly[i] &&
+				passes[schedule[resource.firstUse]].renderPass != NONE &&
+				passes[schedule[resource.firstUse]].renderPass == passes[schedule[resource.lastUse]].renderPass;
+		if(resource.handle == VK_NULL_HANDLE) {
+			resource.size = static_cast<VkDeviceSize>(resource.extent.width) * resource.extent.height *
+					getTexelSize(resource.format) * resource.samples;
+			resource.alignment = 1;
+			resource.memoryTypeBits = ~0u;
+		}
+	}
+}
+
+void RenderGraph::assignMemorySlots() {
+	slots.clear();
+
+	std::vector<uint32_t> candidates;
+	for(uint32_t i = 0; i < resources.size(); i++) {
+		Resource& resource = resources[i];
+		resource.slot = NONE;
+		if(resource.image && !resource.imported && !resource.lazy && !resource.pooled &&
+				resource.firstUse != NONE) {
+			candidates.push_back(i);
+		}
+	}
+
+	// Largest first, each into the first slot free for its whole lifetime
+	std::stable_sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) {
+		return resources[a].size > resources[b].size;
+	});
+	for(uint32_t candidate : candidates) {
+		Resource& resource = resources[candidate];
+		for(uint32_t s = 0; s < slots.size() && resource.slot == NONE; s++) {
+			MemorySlot& slot = slots[s];
+			if(!(slot.memoryTypeBits & resource.memoryTypeBits)) {
+				continue;
+			}
+			bool free = true;
+			for(uint32_t resident : slot.residents) {
+				free = free && !overlaps(resource.firstUse, resource.lastUse,
+						resources[resident].firstUse, resources[resident].lastUse);
+			}
+			if(free) {
+				resource.slot = s;
+			}
+		}
+		if(resource.slot == NONE) {
+			resource.slot = static_cast<uint32_t>(slots.size());
+			slots.emplace_back();
+		}
+
+		MemorySlot& slot = slots[resource.slot];
+		slot.size = std::max(slot.size, resource.size);
+		slot.alignment = std::max(slot.alignment, resource.alignment);
+		slot.memoryTypeBits &= resource.memoryTypeBits;
+		slot.residents.push_back(candidate);
+	}
+
+	for(MemorySlot& slot : slots) {
+		std::sort(slot.residents.begin(), slot.residents.end(), [this](uint32_t a, uint32_t b) {
+			return resources[a].firstUse < resources[b].firstUse;
+		});
+	}
+}
+
+bool RenderGraph::applyAccess(State& state, const Access& access, bool image, Barrier& barrier) {
+	barrier.resource = access.resource;
+	barrier.oldLayout = state.layout;
+	barrier.newLayout = image ? access.layout : state.layout;
+	barrier.destinationStages = access.stages;
+	barrier.destinationAccess = access.readAccess | access.writeAccess;
+
+	bool transition = image && access.layout != state.layout;
+	if(access.writes || transition) {
+		// Writes and transitions wait for every earlier access; only earlier writes need flushing
+		VkPipelineStageFlags sourceStages = state.writeStages | state.readStages;
+		bool needed = sourceStages != 0 || transition;
+		barrier.sourceStages = sourceStages != 0 ? sourceStages :
+				static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		barrier.sourceAccess = state.writeAccess;
+
+		state.layout = barrier.newLayout;
+		state.writeStages = access.stages;
+		state.writeAccess = access.writeAccess;
+		state.readStages = access.writes ? 0 : access.stages;
+		state.visibleStages = access.stages;
+		state.visibleAccess = barrier.destinationAccess;
+		return needed;
+	}
+
+	// Reads only wait for the last write, and only in stages that haven't already
+	state.readStages |= access.stages;
+	if(state.writeStages == 0 || ((access.stages & ~state.visibleStages) == 0 &&
+			(access.readAccess & ~state.visibleAccess) == 0)) {
+		return false;
+	}
+	barrier.sourceStages = state.writeStages;
+	barrier.sourceAccess = state.writeAccess;
+	state.visibleStages |= access.stages;
+	state.visibleAccess |= access.readAccess;
+	return true;
+}
+
+void RenderGraph::planBarriers() {
+	// Where each resource stands after a frame, which the next frame has to wait for
+	std::vector<State> exitStates(resources.size());
+	for(uint32_t p : schedule) {
+		for(const Access& access : passes[p].accesses) {
+			Barrier ignored;
+			applyAccess(exitStates[access.resource], access, resources[access.resource].image, ignored);
+		}
+	}
+
+	std::vector<State> states(resources.size());
+	for(uint32_t i = 0; i < resources.size(); i++) {
+		const Resource& resource = resources[i];
+		State& state = states[i];
+		if(resource.imported) {
+			state.layout = resource.initialLayout;
+			state.writeStages = resource.initialStages;
+			continue;
+		}
+
+		// The contents are discarded, but the memory's previous user must be done with it: the
+		// resident before in the same slot, or the last one from the frame before
+		uint32_t previous = i;
+		if(resource.slot != NONE) {
+			const std::vector<uint32_t>& residents = slots[resource.slot].residents;
+			size_t index = std::find(residents.begin(), residents.end(), i) - residents.begin();
+			previous = residents[(index + residents.size() - 1) % residents.size()];
+		}
+		const State& previousExit = exitStates[previous];
+		state.writeStages = previousExit.writeStages | previousExit.readStages;
+		state.writeAccess = previousExit.writeAccess;
+	}
+
+	for(Pass& pass : passes) {
+		pass.barriers.clear();
+	}
+	for(RenderPass& renderPass : renderPasses) {
+		renderPass.dependencies.clear();
+	}
+
+	// Within a render pass, the subpasses that used each resource since it was last written. Waits
+	// on them are subpass dependencies; waits on anything earlier go before the render pass begins.
+	std::vector<std::vector<uint32_t>> subpassUsers(resources.size());
+	uint32_t currentRenderPass = NONE;
+	for(uint32_t p : schedule) {
+		Pass& pass = passes[p];
+		if(pass.renderPass != currentRenderPass || pass.renderPass == NONE) {
+			for(std::vector<uint32_t>& users : subpassUsers) {
+				users.clear();
+			}
+			currentRenderPass = pass.renderPass;
+		}
+
+		for(const Access& access : pass.accesses) {
+			std::vector<uint32_t>& users = subpassUsers[access.resource];
+			Barrier barrier;
+			if(applyAccess(states[access.resource], access, resources[access.resource].image, barrier)) {
+				if(access.attachment && !users.empty()) {
+					addDependency(renderPasses[pass.renderPass], users, pass.subpass, barrier);
+				} else {
+					pass.barriers.push_back(barrier);
+				}
+			}
+			if(pass.renderPass != NONE) {
+				if(access.writes) {
+					users.clear();
+				}
+				users.push_back(pass.subpass);
+			}
+		}
+	}
+
+	finalBarriers.clear();
+	for(uint32_t i = 0; i < resources.size(); i++) {
+		const Resource& resource = resources[i];
+		const State& state = states[i];
+		if(!resource.image || !resource.output || state.layout == resource.finalLayout) {
+			continue;
+		}
+
+		Barrier barrier = {};
+		barrier.resource = i;
+		barrier.sourceStages = state.writeStages | state.readStages;
+		if(barrier.sourceStages == 0) {
+			barrier.sourceStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		}
+		barrier.sourceAccess = state.writeAccess;
+		barrier.destinationStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		barrier.destinationAccess = 0;
+		barrier.oldLayout = state.layout;
+		barrier.newLayout = resource.finalLayout;
+		finalBarriers.push_back(barrier);
+	}
+}
+
+void RenderGraph::addDependency(RenderPass& renderPass, const std::vector<uint32_t>& sourceSubpasses,
+		uint32_t destinationSubpass, const Barrier& barrier) {
+	for(uint32_t source : sourceSubpasses) {
+		VkSubpassDependency* dependency = nullptr;
+		for(VkSubpassDependency& existing : renderPass.dependencies) {
+			if(existing.srcSubpass == source && existing.dstSubpass == destinationSubpass) {
+				dependency = &existing;
+			}
+		}
+		if(dependency == nullptr) {
+			renderPass.dependencies.emplace_back();
+			dependency = &renderPass.dependencies.back();
+			*dependency = {};
+			dependency->srcSubpass = source;
+			dependency->dstSubpass = destinationSubpass;
+			// Attachments only ever depend on the same pixel
+			dependency->dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+		}
+		dependency->srcStageMask |= barrier.sourceStages;
+		dependency->dstStageMask |= barrier.destinationStages;
+		dependency->srcAccessMask |= barrier.sourceAccess;
+		dependency->dstAccessMask |= barrier.destinationAccess;
+	}
+}
+
+void RenderGraph::planAttachments() {
+	unmergedTraffic = 0;
+	for(uint32_t position = 0; position < schedule.size(); position++) {
+		const Pass& pass = passes[schedule[position]];
+		if(pass.renderPass == NONE) {
+			continue;
+		}
+
+		for(const Attachment& attachment : planAttachments(position, position)) {
+			unmergedTraffic += attachment.loadedBytes + attachment.storedBytes;
+		}
+		RenderPass& renderPass = renderPasses[pass.renderPass];
+		if(pass.subpass + 1 == renderPass.passes.size()) {
+			renderPass.attachments = planAttachments(position - pass.subpass, position);
+		}
+	}
+}
+
+std::vector<RenderGraph::Attachment> RenderGraph::planAttachments(uint32_t firstPosition,
+		uint32_t lastPosition) const {
+	std::vector<Attachment> attachments;
+	std::vector<const Access*> firstAccesses;
+	for(uint32_t position = firstPosition; position <= lastPosition; position++) {
+		for(const Access& access : passes[schedule[position]].accesses) {
+			if(!access.attachment) {
+				continue;
+			}
+			auto found = std::find_if(attachments.begin(), attachments.end(),
+					[&access](const Attachment& attachment) { return attachment.resource == access.resource; });
+			if(found == attachments.end()) {
+				Attachment attachment = {};
+				attachment.resource = access.resource;
+				attachment.initialLayout = access.layout;
+				attachments.push_back(attachment);
+				firstAccesses.push_back(&access);
+				found = attachments.end() - 1;
+			}
+			found->finalLayout = access.layout;
+		}
+	}
+
+	for(size_t i = 0; i < attachments.size(); i++) {
+		Attachment& attachment = attachments[i];
+		const Access& firstAccess = *firstAccesses[i];
+		const Resource& resource = resources[attachment.resource];
+
+		bool earlierContents = resource.imported && resource.initialLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+		bool laterReads = resource.output;
+		for(uint32_t position = 0; position < schedule.size(); position++) {
+			for(const Access& access : passes[schedule[position]].accesses) {
+				if(access.resource == attachment.resource) {
+					earlierContents = earlierContents || (position < firstPosition && access.writes);
+					laterReads = laterReads || (position > lastPosition && access.reads);
+				}
+			}
+		}
+
+		// Resolves overwrite every pixel, so they never need the old contents
+		bool resolved = firstAccess.resolveSource != NONE;
+		if(!resolved && firstAccess.reads && earlierContents) {
+			attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		} else if(!resolved && resource.cleared) {
+			attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		} else {
+			attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		}
+		attachment.storeOp = laterReads ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+		attachment.loadedBytes = attachment.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? resource.size : 0;
+		attachment.storedBytes = attachment.storeOp == VK_ATTACHMENT_STORE_OP_STORE ? resource.size : 0;
+	}
+	return attachments;
+}
+
+void RenderGraph::realize(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties,
+		RenderTargetPool* pool) {
+	this->device = device;
+	this->pool = pool;
+
+	// Images that would have memory to themselves anyway can just as well come from the pool
+	for(Resource& resource : resources) {
+		resource.pooled = pool != nullptr && (resource.lazy ||
+				(resource.slot != NONE && slots[resource.slot].residents.size() == 1));
+	}
+
+	for(Resource& resource : resources) {
+		if(!resource.image || resource.imported || resource.firstUse == NONE) {
+			continue;
+		}
+
+		if(resource.pooled) {
+			RenderTargetDescription description = {};
+			description.format = resource.format;
+			description.extent = resource.extent;
+			description.samples = resource.samples;
+			description.usage = resource.usage;
+			if(resource.lazy) {
+				description.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+			}
+			RenderTarget target = pool->acquire(description);
+			resource.handle = target.image;
+			resource.view = target.view;
+			resource.memory = target.memory;
+			resource.size = target.size;
+			resource.lazilyAllocated = target.lazilyAllocated;
+		} else if(resource.lazy) {
+			resource.lazilyAllocated = createTransientAttachment(device, memoryProperties, resource.extent,
+					resource.format, resource.usage, resource.handle, resource.memory, resource.samples);
+			resource.size = getImageMemoryRequirements(device, resource.handle).size;
+		} else {
+			resource.handle = createUnboundImage(device, resource.extent, resource.format, resource.usage,
+					resource.samples);
+			VkMemoryRequirements requirements = getImageMemoryRequirements(device, resource.handle);
+			resource.size = requirements.size;
+			resource.alignment = requirements.alignment;
+			resource.memoryTypeBits = requirements.memoryTypeBits;
+		}
+	}
+
+	// The estimates compile planned with give way to the real requirements
+	assignMemorySlots();
+	planBarriers();
+	planAttachments();
+
+	for(MemorySlot& slot : slots) {
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = slot.size;
+		allocInfo.memoryTypeIndex = pickMemoryTypeIndex(memoryProperties, slot.memoryTypeBits,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		assertSuccess(vkAllocateMemory(device, &allocInfo, nullptr, &slot.memory),
+				"Failed to allocate render graph memory.");
+
+		for(uint32_t resident : slot.residents) {
+			vkBindImageMemory(device, resources[resident].handle, slot.memory, 0);
+		}
+	}
+
+	for(Resource& resource : resources) {
+		if(resource.handle != VK_NULL_HANDLE && !resource.imported && !resource.pooled) {
+			resource.view = createImageView(device, resource.handle, resource.format,
+					getFormatAspects(resource.format));
+		}
+	}
+
+	for(RenderPass& renderPass : renderPasses) {
+		createRenderPass(renderPass);
+	}
+}
+
+void RenderGraph::createRenderPass(RenderPass& renderPass) {
+	std::vector<uint32_t> attachmentIndices(resources.size(), VK_ATTACHMENT_UNUSED);
+	std::vector<VkAttachmentDescription> descriptions;
+	renderPass.clearValues.clear();
+	for(const Attachment& attachment : renderPass.attachments) {
+		const Resource& resource = resources[attachment.resource];
+		attachmentIndices[attachment.resource] = static_cast<uint32_t>(descriptions.size());
+
+		VkAttachmentDescription description = {};
+		description.format = resource.format;
+		description.samples = resource.samples;
+		description.loadOp = attachment.loadOp;
+		description.storeOp = attachment.storeOp;
+		description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		description.initialLayout = attachment.initialLayout;
+		description.finalLayout = attachment.finalLayout;
+		descriptions.push_back(description);
+		renderPass.clearValues.push_back(resource.clearValue);
+	}
+
+	struct SubpassAttachments {
+		std::vector<VkAttachmentReference> colors;
+		std::vector<VkAttachmentReference> resolves;
+		std::vector<VkAttachmentReference> inputs;
+		VkAttachmentReference depth = {VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED};
+		std::vector<uint32_t> preserves;
+	};
+	std::vector<SubpassAttachments> references(renderPass.passes.size());
+	std::vector<uint32_t> firstSubpasses(descriptions.size(), NONE);
+	std::vector<uint32_t> lastSubpasses(descriptions.size(), NONE);
+
+	// Color attachments and input attachments are numbered in the order the pass declared them
+	for(uint32_t s = 0; s < renderPass.passes.size(); s++) {
+		const Pass& pass = passes[renderPass.passes[s]];
+		SubpassAttachments& subpassAttachments = references[s];
+		std::vector<uint32_t> colorResources;
+		for(const Access& access : pass.accesses) {
+			if(!access.attachment) {
+				continue;
+			}
+			uint32_t index = attachmentIndices[access.resource];
+			if(firstSubpasses[index] == NONE) {
+				firstSubpasses[index] = s;
+			}
+			lastSubpasses[index] = s;
+			if(access.resolveSource != NONE) {
+				continue;
+			}
+
+			VkAttachmentReference reference = {index, access.layout};
+			switch(access.usage) {
+				case RenderGraphUsage::COLOR_ATTACHMENT:
+					subpassAttachments.colors.push_back(reference);
+					colorResources.push_back(access.resource);
+					break;
+				case RenderGraphUsage::DEPTH_ATTACHMENT:
+				case RenderGraphUsage::DEPTH_READ:
+					subpassAttachments.depth = reference;
+					break;
+				default:
+					subpassAttachments.inputs.push_back(reference);
+					break;
+			}
+		}
+
+		for(const Access& access : pass.accesses) {
+			if(access.resolveSource == NONE) {
+				continue;
+			}
+			auto source = std::find(colorResources.begin(), colorResources.end(), access.resolveSource);
+			if(source == colorResources.end()) {
+				throw std::runtime_error("Pass " + pass.name + " resolves " +
+						resources[access.resolveSource].name + ", which isn't one of its color attachments.");
+			}
+			if(subpassAttachments.resolves.empty()) {
+				subpassAttachments.resolves.assign(subpassAttachments.colors.size(),
+						{VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED});
+			}
+			subpassAttachments.resolves[source - colorResources.begin()] =
+					{attachmentIndices[access.resource], access.layout};
+		}
+	}
+
+	// Subpasses between two uses of an attachment that don't touch it have to keep it intact
+	for(uint32_t index = 0; index < descriptions.size(); index++) {
+		for(uint32_t s = firstSubpasses[index] + 1; s < lastSubpasses[index]; s++) {
+			const std::vector<Access>& accesses = passes[renderPass.passes[s]].accesses;
+			bool used = std::any_of(accesses.begin(), accesses.end(), [&](const Access& access) {
+				return access.attachment && attachmentIndices[access.resource] == index;
+			});
+			if(!used) {
+				references[s].preserves.push_back(index);
+			}
+		}
+	}
+
+	std::vector<VkSubpassDescription> subpasses(renderPass.passes.size());
+	for(size_t s = 0; s < subpasses.size(); s++) {
+		const SubpassAttachments& subpassAttachments = references[s];
+		VkSubpassDescription& subpass = subpasses[s];
+		subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.inputAttachmentCount = static_cast<uint32_t>(subpassAttachments.inputs.size());
+		subpass.pInputAttachments = subpassAttachments.inputs.data();
+		subpass.colorAttachmentCount = static_cast<uint32_t>(subpassAttachments.colors.size());
+		subpass.pColorAttachments = subpassAttachments.colors.data();
+		subpass.pResolveAttachments = subpassAttachments.resolves.empty() ?
+				nullptr : subpassAttachments.resolves.data();
+		subpass.pDepthStencilAttachment = subpassAttachments.depth.attachment != VK_ATTACHMENT_UNUSED ?
+				&subpassAttachments.depth : nullptr;
+		subpass.preserveAttachmentCount = static_cast<uint32_t>(subpassAttachments.preserves.size());
+		subpass.pPreserveAttachments = subpassAttachments.preserves.data();
+	}
+
+	// Nothing outside needs a dependency: the graph's barriers order the render pass as a whole,
+	// and attachments start and end in the layouts their first and last subpasses use
+	VkRenderPassCreateInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = static_cast<uint32_t>(descriptions.size());
+	renderPassInfo.pAttachments = descriptions.data();
+	renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+	renderPassInfo.pSubpasses = subpasses.data();
+	renderPassInfo.dependencyCount = static_cast<uint32_t>(renderPass.dependencies.size());
+	renderPassInfo.pDependencies = renderPass.dependencies.data();
+
+	assertSuccess(vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass.handle),
+			"Failed to create render graph render pass.");
+	vkGetRenderAreaGranularity(device, renderPass.handle, &renderPass.granularity);
+	renderPass.renderArea = {};
+	renderPass.renderArea.extent = renderPass.extent;
+}
+
+VkFramebuffer RenderGraph::getFramebuffer(RenderPass& renderPass) {
+	std::vector<VkImageView> views;
+	for(const Attachment& attachment : renderPass.attachments) {
+		views.push_back(resources[attachment.resource].view);
+	}
+	auto found = renderPass.framebuffers.find(views);
+	if(found != renderPass.framebuffers.end()) {
+		return found->second;
+	}
+
+	VkFramebufferCreateInfo framebufferInfo = {};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = renderPass.handle;
+	framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+	framebufferInfo.pAttachments = views.data();
+	framebufferInfo.width = renderPass.extent.width;
+	framebufferInfo.height = renderPass.extent.height;
+	framebufferInfo.layers = 1;
+
+	VkFramebuffer framebuffer;
+	assertSuccess(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer),
+			"Failed to create render graph framebuffer.");
+	renderPass.framebuffers[views] = framebuffer;
+	return framebuffer;
+}
+
+void RenderGraph::destroy() {
+	if(device != VK_NULL_HANDLE) {
+		for(Resource& resource : resources) {
+			if(resource.imported) {
+				continue;
+			}
+			if(resource.pooled) {
+				if(resource.handle != VK_NULL_HANDLE) {
+					pool->release(resource.handle);
+				}
+				continue;
+			}
+			if(resource.view != VK_NULL_HANDLE) {
+				vkDestroyImageView(device, resource.view, nullptr);
+			}
+			if(resource.handle != VK_NULL_HANDLE) {
+				vkDestroyImage(device, resource.handle, nullptr);
+			}
+			if(resource.memory != VK_NULL_HANDLE) {
+				vkFreeMemory(device, resource.memory, nullptr);
+			}
+		}
+		for(MemorySlot& slot : slots) {
+			if(slot.memory != VK_NULL_HANDLE) {
+				vkFreeMemory(device, slot.memory, nullptr);
+			}
+		}
+		for(RenderPass& renderPass : renderPasses) {
+			for(auto& framebuffer : renderPass.framebuffers) {
+				vkDestroyFramebuffer(device, framebuffer.second, nullptr);
+			}
+			if(renderPass.handle != VK_NULL_HANDLE) {
+				vkDestroyRenderPass(device, renderPass.handle, nullptr);
+			}
+		}
+	}
+
+	device = VK_NULL_HANDLE;
+	pool = nullptr;
+	passes.clear();
+	resources.clear();
+	schedule.clear();
+	slots.clear();
+	renderPasses.clear();
+	finalBarriers.clear();
+}
+
+void RenderGraph::setImportedImage(uint32_t resource, VkImage image, VkImageView view) {
+	resources[resource].handle = image;
+	resources[resource].view = view;
+}
+
+void RenderGraph::setImportedLayout(uint32_t resource, VkImageLayout layout) {
+	resources[resource].arrivalLayout = layout;
+}
+
+void RenderGraph::setRenderArea(uint32_t pass, const VkRect2D& area) {
+	if(passes[pass].renderPass == NONE) {
+		return;
+	}
+
+	// Out to the granularity on each side, which may make it reach past the extent
+	RenderPass& renderPass = renderPasses[passes[pass].renderPass];
+	int64_t width = renderPass.granularity.width > 0 ? renderPass.granularity.width : 1;
+	int64_t height = renderPass.granularity.height > 0 ? renderPass.granularity.height : 1;
+	int64_t left = std::max<int64_t>(area.offset.x, 0) / width * width;
+	int64_t top = std::max<int64_t>(area.offset.y, 0) / height * height;
+	int64_t right = (area.offset.x + static_cast<int64_t>(area.extent.width) + width - 1) / width * width;
+	int64_t bottom = (area.offset.y + static_cast<int64_t>(area.extent.height) + height - 1) / height * height;
+	right = std::max(left, std::min<int64_t>(right, renderPass.extent.width));
+	bottom = std::max(top, std::min<int64_t>(bottom, renderPass.extent.height));
+
+	renderPass.renderArea.offset = {static_cast<int32_t>(left), static_cast<int32_t>(top)};
+	renderPass.renderArea.extent = {static_cast<uint32_t>(right - left), static_cast<uint32_t>(bottom - top)};
+}
+
+VkRect2D RenderGraph::getRenderArea(uint32_t pass) const {
+	if(passes[pass].renderPass == NONE) {
+		return VkRect2D{};
+	}
+	return renderPasses[passes[pass].renderPass].renderArea;
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer) {
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	std::vector<bool> transitioned(resources.size(), false);
+
+	auto recordBarriers = [&](const std::vector<Barrier>& barriers) {
+		if(barriers.empty()) {
+			return;
+		}
+
+		VkPipelineStageFlags sourceStages = 0;
+		VkPipelineStageFlags destinationStages = 0;
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		bool buffers = false;
+		imageBarriers.clear();
+
+		for(const Barrier& barrier : barriers) {
+			sourceStages |= barrier.sourceStages;
+			destinationStages |= barrier.destinationStages;
+
+			const Resource& resource = resources[barrier.resource];
+			if(!resource.image) {
+				memoryBarrier.srcAccessMask |= barrier.sourceAccess;
+				memoryBarrier.dstAccessMask |= barrier.destinationAccess;
+				buffers = true;
+				continue;
+			}
+
+			VkImageMemoryBarrier imageBarrier = {};
+			imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			imageBarrier.srcAccessMask = barrier.sourceAccess;
+			imageBarrier.dstAccessMask = barrier.destinationAccess;
+			imageBarrier.oldLayout = barrier.oldLayout;
+			if(resource.imported && !transitioned[barrier.resource]) {
+				imageBarrier.oldLayout = resource.arrivalLayout;
+			}
+			transitioned[barrier.resource] = true;
+			imageBarrier.newLayout = barrier.newLayout;
+			imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.image = resource.handle;
+			imageBarrier.subresourceRange.aspectMask = getFormatAspects(resource.format);
+			imageBarrier.subresourceRange.levelCount = 1;
+			imageBarrier.subresourceRange.layerCount = 1;
+			imageBarriers.push_back(imageBarrier);
+		}
+
+		vkCmdPipelineBarrier(commandBuffer, sourceStages, destinationStages, 0,
+				buffers ? 1 : 0, buffers ? &memoryBarrier : nullptr, 0, nullptr,
+				static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+	};
+
+	std::vector<Barrier> renderPassBarriers;
+	for(uint32_t p : schedule) {
+		const Pass& pass = passes[p];
+		if(pass.renderPass == NONE) {
+			recordBarriers(pass.barriers);
+		} else if(pass.subpass == 0) {
+			RenderPass& renderPass = renderPasses[pass.renderPass];
+
+			// Whatever the subpasses wait on from outside has to happen before the render pass
+			renderPassBarriers.clear();
+			for(uint32_t subpassPass : renderPass.passes) {
+				const std::vector<Barrier>& barriers = passes[subpassPass].barriers;
+				renderPassBarriers.insert(renderPassBarriers.end(), barriers.begin(), barriers.end());
+			}
+			recordBarriers(renderPassBarriers);
+
+			VkRenderPassBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			beginInfo.renderPass = renderPass.handle;
+			beginInfo.framebuffer = getFramebuffer(renderPass);
+			beginInfo.renderArea = renderPass.renderArea;
+			beginInfo.clearValueCount = static_cast<uint32_t>(renderPass.clearValues.size());
+			beginInfo.pClearValues = renderPass.clearValues.data();
+			vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		} else {
+			vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+		}
+
+		if(pass.record) {
+			pass.record(commandBuffer);
+		}
+		if(pass.renderPass != NONE && pass.subpass + 1 == renderPasses[pass.renderPass].passes.size()) {
+			vkCmdEndRenderPass(commandBuffer);
+		}
+	}
+	recordBarriers(finalBarriers);
+}
+
+const std::vector<uint32_t>& RenderGraph::getSchedule() const {
+	return schedule;
+}
+
+bool RenderGraph::isCulled(uint32_t pass) const {
+	return passes[pass].culled;
+}
+
+const std::vector<RenderGraph::Barrier>& RenderGraph::getBarriers(uint32_t pass) const {
+	return passes[pass].barriers;
+}
+
+const std::vector<RenderGraph::Barrier>& RenderGraph::getFinalBarriers() const {
+	return finalBarriers;
+}
+
+VkRenderPass RenderGraph::getRenderPass(uint32_t pass) const {
+	uint32_t renderPass = passes[pass].renderPass;
+	return renderPass != NONE ? renderPasses[renderPass].handle : VK_NULL_HANDLE;
+}
+
+uint32_t RenderGraph::getSubpass(uint32_t pass) const {
+	return passes[pass].subpass;
+}
+
+const std::vector<RenderGraph::Attachment>& RenderGraph::getAttachments(uint32_t pass) const {
+	static const std::vector<Attachment> none;
+	uint32_t renderPass = passes[pass].renderPass;
+	return renderPass != NONE ? renderPasses[renderPass].attachments : none;
+}
+
+VkDeviceSize RenderGraph::getAttachmentTraffic() const {
+	VkDeviceSize bytes = 0;
+	for(const RenderPass& renderPass : renderPasses) {
+		for(const Attachment& attachment : renderPass.attachments) {
+			bytes += attachment.loadedBytes + attachment.storedBytes;
+		}
+	}
+	return bytes;
+}
+
+VkDeviceSize RenderGraph::getUnmergedAttachmentTraffic() const {
+	return unmergedTraffic;
+}
+
+bool RenderGraph::isLazy(uint32_t resource) const {
+	return resources[resource].lazy;
+}
+
+uint32_t RenderGraph::getMemorySlot(uint32_t resource) const {
+	return resources[resource].slot;
+}
+
+VkDeviceSize RenderGraph::getUnaliasedBytes() const {
+	VkDeviceSize bytes = 0;
+	for(const MemorySlot& slot : slots) {
+		for(uint32_t resident : slot.residents) {
+			bytes += resources[resident].size;
+		}
+	}
+	return bytes;
+}
+
+VkDeviceSize RenderGraph::getAliasedBytes() const {
+	VkDeviceSize bytes = 0;
+	for(const MemorySlot& slot : slots) {
+		bytes += slot.size;
+	}
+	return bytes;
+}
+
+VkDeviceSize RenderGraph::getLazyBytes() const {
+	VkDeviceSize bytes = 0;
+	for(const Resource& resource : resources) {
+		if(resource.lazy) {
+			bytes += resource.size;
+		}
+	}
+	return bytes;
+}
+
+VkDeviceSize RenderGraph::getCommittedLazyBytes() const {
+	VkDeviceSize bytes = 0;
+	for(const Resource& resource : resources) {
+		if(!resource.lazy || resource.memory == VK_NULL_HANDLE) {
+			continue;
+		}
+		if(resource.lazilyAllocated) {
+			VkDeviceSize committed = 0;
+			vkGetDeviceMemoryCommitment(device, resource.memory, &committed);
+			bytes += committed;
+		} else {
+			bytes += resource.size;
+		}
+	}
+	return bytes;
+}
+
+bool RenderGraph::hasLazilyAllocatedMemory() const {
+	for(const Resource& resource : resources) {
+		if(resource.lazy && resource.memory != VK_NULL_HANDLE && !resource.lazilyAllocated) {
+			return false;
+		}
+	}
+	return true;
+}
+
+VkImage RenderGraph::getImage(uint32_t resource) const {
+	return resources[resource].handle;
+}
+
+VkImageView RenderGraph::getImageView(uint32_t resource) const {
+	return resources[resource].view;
+}
+
+std::vector<std::string> RenderGraph::describe() const {
+	std::vector<std::string> lines;
+	char line[256];
+	const double megabyte = 1024.0 * 1024.0;
+
+	snprintf(line, sizeof(line), "Render graph: %zu of %zu passes scheduled, in %zu render passes.",
+			schedule.size(), passes.size(), renderPasses.size());
+	lines.push_back(line);
+	for(const Pass& pass : passes) {
+		if(pass.culled) {
+			lines.push_back("  culled " + pass.name);
+			continue;
+		}
+
+		if(pass.renderPass != NONE && pass.subpass == 0) {
+			const RenderPass& renderPass = renderPasses[pass.renderPass];
+			snprintf(line, sizeof(line), "  render pass %u, %ux%u:", pass.renderPass,
+					renderPass.extent.width, renderPass.extent.height);
+			lines.push_back(line);
+			for(const Attachment& attachment : renderPass.attachments) {
+				snprintf(line, sizeof(line), "    %s: %s, %s, %.2f MB in, %.2f MB out",
+						resources[attachment.resource].name.c_str(), getLoadOpName(attachment.loadOp),
+						getStoreOpName(attachment.storeOp), attachment.loadedBytes / megabyte,
+						attachment.storedBytes / megabyte);
+				lines.push_back(line);
+			}
+		}
+
+		if(pass.renderPass != NONE) {
+			snprintf(line, sizeof(line), "  %s, subpass %u", pass.name.c_str(), pass.subpass);
+			lines.push_back(line);
+		} else {
+			lines.push_back("  " + pass.name);
+		}
+		for(const Barrier& barrier : pass.barriers) {
+			const Resource& resource = resources[barrier.resource];
+			lines.push_back("    wait " + formatBarrier(resource.name, resource.image, barrier));
+		}
+		if(pass.renderPass == NONE) {
+			continue;
+		}
+		for(const VkSubpassDependency& dependency : renderPasses[pass.renderPass].dependencies) {
+			if(dependency.dstSubpass == pass.subpass) {
+				snprintf(line, sizeof(line), "    after subpass %u: stages 0x%x -> 0x%x, access 0x%x -> 0x%x",
+						dependency.srcSubpass, dependency.srcStageMask, dependency.dstStageMask,
+						dependency.srcAccessMask, dependency.dstAccessMask);
+				lines.push_back(line);
+			}
+		}
+	}
+	for(const Barrier& barrier : finalBarriers) {
+		lines.push_back("  finally " + formatBarrier(resources[barrier.resource].name, true, barrier));
+	}
+
+	for(size_t s = 0; s < slots.size(); s++) {
+		std::string residents;
+		for(uint32_t resident : slots[s].residents) {
+			residents += (residents.empty() ? "" : ", ") + resources[resident].name;
+		}
+		snprintf(line, sizeof(line), "  memory %zu, %.2f MB: %s", s, slots[s].size / megabyte,
+				residents.c_str());
+		lines.push_back(line);
+	}
+	for(const Resource& resource : resources) {
+		if(resource.lazy || resource.pooled) {
+			snprintf(line, sizeof(line), "  %s %s, %.2f MB", resource.lazy ? "lazy" : "pooled",
+					resource.name.c_str(), resource.size / megabyte);
+			lines.push_back(line);
+		}
+	}
+
+	VkDeviceSize unaliased = getUnaliasedBytes();
+	VkDeviceSize aliased = getAliasedBytes();
+	snprintf(line, sizeof(line),
+			"Transient images: %.2f MB aliased into %.2f MB, saving %.2f MB; %.2f MB more lazily allocated.",
+			unaliased / megabyte, aliased / megabyte, (unaliased - aliased) / megabyte,
+			getLazyBytes() / megabyte);
+	lines.push_back(line);
+	snprintf(line, sizeof(line),
+			"Attachment traffic: %.2f MB per frame, against %.2f MB with a render pass per pass.",
+			getAttachmentTraffic() / megabyte, getUnmergedAttachmentTraffic() / megabyte);
+	lines.push_back(line);
+	return lines;
+}
+
+void RenderGraph::logSchedule() const {
+	for(const std::string& line : describe()) {
+		LOG_INFO("%s", line.c_str());
+	}
+}
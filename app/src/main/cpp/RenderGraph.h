@@ -0,0 +1,323 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include "vulkan_wrapper/vulkan_wrapper.h"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+class RenderTargetPool;
+
+/** How a pass touches a resource, which fixes the pipeline stages, access and image layout. */
+enum class RenderGraphUsage {
+	COLOR_ATTACHMENT,
+	DEPTH_ATTACHMENT,
+	/** Depth tested against without writing. */
+	DEPTH_READ,
+	/** Sampled in a fragment shader. */
+	SAMPLED,
+	/** Read in a fragment shader at the pixel being shaded, from tile memory within a render pass. */
+	INPUT_ATTACHMENT,
+	COMPUTE_STORAGE,
+	INDIRECT_BUFFER,
+	VERTEX_BUFFER,
+	TRANSFER_SOURCE,
+	TRANSFER_DESTINATION
+};
+
+/**
+ * A frame as passes that declare which images and buffers they read and write. compile works out
+ * the rest on the CPU alone, so it can be checked without a device:
+ *
+ * - Passes whose results nothing needs are culled. Results are needed when they reach an output
+ *   import, or come from a pass with side effects.
+ * - Consecutive passes with attachments of one size become subpasses of one render pass, as long
+ *   as each only touches what the earlier ones drew through attachments, so intermediates stay in
+ *   tile memory. Each attachment is loaded only if it holds earlier contents the render pass reads,
+ *   and stored only if something after it reads them.
+ * - Every remaining pass gets the fewest barriers and layout transitions that order it after the
+ *   accesses it depends on, batched into one vkCmdPipelineBarrier before its render pass. Within a
+ *   render pass they become subpass dependencies. Reads after reads need nothing.
+ * - Graph-owned images used only as attachments within one render pass never need real memory, so
+ *   they're lazily allocated. Other graph-owned images whose lifetimes don't overlap share memory.
+ *   Given a pool, images that don't share memory come from it and go back to it on destroy, so
+ *   rebuilding the graph reuses them.
+ *
+ * realize then creates the graph-owned images and render passes, whose pipelines are built against
+ * getRenderPass and getSubpass, and execute records a frame. The graph is static: build it again,
+ * after destroy, when the frame's structure changes.
+ */
+class RenderGraph {
+	public:
+		static const uint32_t NONE = static_cast<uint32_t>(-1);
+
+		typedef std::function<void(VkCommandBuffer)> RecordFunction;
+
+		/** A transition of one resource. Buffers are synchronized with global memory barriers. */
+		struct Barrier {
+			uint32_t resource;
+			VkPipelineStageFlags sourceStages;
+			VkPipelineStageFlags destinationStages;
+			VkAccessFlags sourceAccess;
+			VkAccessFlags destinationAccess;
+			VkImageLayout oldLayout;
+			VkImageLayout newLayout;
+		};
+
+		/** How a render pass treats one of its attachments, and the memory traffic that costs. */
+		struct Attachment {
+			uint32_t resource;
+			VkAttachmentLoadOp loadOp;
+			VkAttachmentStoreOp storeOp;
+			VkImageLayout initialLayout;
+			VkImageLayout finalLayout;
+			/** Bytes read from and written to memory per frame. */
+			VkDeviceSize loadedBytes;
+			VkDeviceSize storedBytes;
+		};
+
+		/** An image the graph owns, whose contents don't outlive the frame. */
+		uint32_t createImage(const std::string& name, VkFormat format, VkExtent2D extent,
+				VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
+
+		/**
+		 * An image owned elsewhere, bound with setImportedImage before each execute. It arrives in
+		 * the initial layout, ready for use once the initial stages have run, such as those a
+		 * swapchain acquire semaphore waits at. A final layout other than undefined makes it an
+		 * output, left in that layout at the end of the frame.
+		 */
+		uint32_t importImage(const std::string& name, VkFormat format, VkExtent2D extent,
+				VkImageLayout initialLayout, VkPipelineStageFlags initialStages,
+				VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+		/** A buffer owned elsewhere. Outputs keep the passes that write them. */
+		uint32_t importBuffer(const std::string& name, bool output = false);
+
+		/**
+		 * Passes with attachments record within a render pass. Their color and input attachments
+		 * are numbered in the order they're declared.
+		 */
+		uint32_t addPass(const std::string& name, RecordFunction record);
+
+		/** The pass uses earlier contents. */
+		void read(uint32_t pass, uint32_t resource, RenderGraphUsage usage);
+		/** The pass replaces the contents without looking at them. */
+		void write(uint32_t pass, uint32_t resource, RenderGraphUsage usage);
+		/** The pass reads and writes. */
+		void modify(uint32_t pass, uint32_t resource, RenderGraphUsage usage);
+		/** The color attachment source is resolved into destination at the end of the pass. */
+		void resolve(uint32_t pass, uint32_t source, uint32_t destination);
+		/** The pass runs even when nothing in the graph reads what it writes. */
+		void setSideEffects(uint32_t pass);
+
+		/** Render passes that would otherwise discard what the image held clear it to this instead. */
+		void setClearValue(uint32_t resource, VkClearValue value);
+
+		void compile();
+
+		/**
+		 * Creates the graph-owned images, sharing memory as compile planned, and the render passes,
+		 * after compiling.
+		 */
+		void realize(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties,
+				RenderTargetPool* pool = nullptr);
+
+		/** Frees what realize created and forgets every pass and resource. */
+		void destroy();
+
+		/** The view is only needed for images used as attachments. */
+		void setImportedImage(uint32_t resource, VkImage image, VkImageView view = VK_NULL_HANDLE);
+		/**
+		 * The layout an imported image arrives in for the frames executed after, when it isn't the
+		 * one it was imported with, such as undefined for a swapchain image not yet presented.
+		 * Only the first transition changes, so the render passes stay as they are.
+		 */
+		void setImportedLayout(uint32_t resource, VkImageLayout layout);
+
+		/**
+		 * Limits the render pass a pass records in to an area of its extent for the frames executed
+		 * after, leaving its attachments untouched outside it. Clears, loads and stores only cover
+		 * the area too. It's widened to the device's render area granularity, and realize sets it to
+		 * the whole extent.
+		 */
+		void setRenderArea(uint32_t pass, const VkRect2D& area);
+		/** Where the pass's render pass renders, to scissor its draws by. Empty without one. */
+		VkRect2D getRenderArea(uint32_t pass) const;
+
+		/**
+		 * Records the scheduled passes, each after its barriers and within its render pass, then the
+		 * final transitions.
+		 */
+		void execute(VkCommandBuffer commandBuffer);
+
+		/** Passes that survived culling, in recording order. */
+		const std::vector<uint32_t>& getSchedule() const;
+		bool isCulled(uint32_t pass) const;
+		/** Before the pass, or before its render pass begins. */
+		const std::vector<Barrier>& getBarriers(uint32_t pass) const;
+		/** Transitions to the output layouts, after the last pass. */
+		const std::vector<Barrier>& getFinalBarriers() const;
+
+		/** The render pass a pass records in, or VK_NULL_HANDLE if it has no attachments. */
+		VkRenderPass getRenderPass(uint32_t pass) const;
+		uint32_t getSubpass(uint32_t pass) const;
+		/** The attachments of the render pass a pass records in. */
+		const std::vector<Attachment>& getAttachments(uint32_t pass) const;
+		/**
+		 * Attachment bytes loaded and stored per frame, and what they would be if every pass had a
+		 * render pass of its own.
+		 */
+		VkDeviceSize getAttachmentTraffic() const;
+		VkDeviceSize getUnmergedAttachmentTraffic() const;
+
+		/** Graph-owned images that need lazily allocated memory only. */
+		bool isLazy(uint32_t resource) const;
+		/** Where an aliased image lives, or NONE if it's lazy or imported. */
+		uint32_t getMemorySlot(uint32_t resource) const;
+
+		/** Memory for aliased images if each had its own, and with aliasing. */
+		VkDeviceSize getUnaliasedBytes() const;
+		VkDeviceSize getAliasedBytes() const;
+		/** The sizes of lazy images, and how much of them is backed by real memory after realize. */
+		VkDeviceSize getLazyBytes() const;
+		VkDeviceSize getCommittedLazyBytes() const;
+		/** Whether lazy images actually got lazily allocated memory, which some devices lack. */
+		bool hasLazilyAllocatedMemory() const;
+
+		VkImage getImage(uint32_t resource) const;
+		VkImageView getImageView(uint32_t resource) const;
+
+		/** The schedule, culled passes, render passes, barriers and memory plan, one line each. */
+		std::vector<std::string> describe() const;
+		void logSchedule() const;
+
+	private:
+		struct Access {
+			uint32_t resource;
+			RenderGraphUsage usage;
+			VkPipelineStageFlags stages;
+			VkAccessFlags readAccess;
+			VkAccessFlags writeAccess;
+			VkImageLayout layout;
+			VkImageUsageFlags imageUsage;
+			bool attachment;
+			bool reads;
+			bool writes;
+			/** The color attachment this one receives the resolve of. */
+			uint32_t resolveSource;
+		};
+
+		struct Pass {
+			std::string name;
+			RecordFunction record;
+			std::vector<Access> accesses;
+			bool sideEffects = false;
+			bool culled = false;
+			uint32_t renderPass = NONE;
+			uint32_t subpass = 0;
+			std::vector<Barrier> barriers;
+		};
+
+		struct Resource {
+			std::string name;
+			bool image = false;
+			bool imported = false;
+			bool output = false;
+			VkFormat format = VK_FORMAT_UNDEFINED;
+			VkExtent2D extent = {};
+			VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+			VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags initialStages = 0;
+			VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			/** The layout the image actually arrives in this frame. */
+			VkImageLayout arrivalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			bool cleared = false;
+			VkClearValue clearValue = {};
+
+			// Planned by compile, over positions in the schedule
+			VkImageUsageFlags usage = 0;
+			uint32_t firstUse = NONE;
+			uint32_t lastUse = NONE;
+			bool lazy = false;
+			uint32_t slot = NONE;
+			/** Borrowed from the pool by realize. */
+			bool pooled = false;
+			VkDeviceSize size = 0;
+			VkDeviceSize alignment = 1;
+			uint32_t memoryTypeBits = ~0u;
+
+			// Created by realize
+			VkImage handle = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			bool lazilyAllocated = false;
+		};
+
+		/** Memory shared by images used one after another. */
+		struct MemorySlot {
+			VkDeviceSize size = 0;
+			VkDeviceSize alignment = 1;
+			uint32_t memoryTypeBits = ~0u;
+			/** In order of first use. */
+			std::vector<uint32_t> residents;
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+		};
+
+		/** Consecutive passes recorded as the subpasses of one render pass. */
+		struct RenderPass {
+			/** One per subpass. */
+			std::vector<uint32_t> passes;
+			VkExtent2D extent = {};
+			std::vector<Attachment> attachments;
+			std::vector<VkSubpassDependency> dependencies;
+
+			// Created by realize
+			VkRenderPass handle = VK_NULL_HANDLE;
+			std::vector<VkClearValue> clearValues;
+			VkExtent2D granularity = {1, 1};
+			VkRect2D renderArea = {};
+			/** By attachment views, since imported images change from frame to frame. */
+			std::map<std::vector<VkImageView>, VkFramebuffer> framebuffers;
+		};
+
+		/** What a resource needs to wait on before its next access. */
+		struct State {
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags writeStages = 0;
+			VkAccessFlags writeAccess = 0;
+			VkPipelineStageFlags readStages = 0;
+			/** What has already waited for the last write. */
+			VkPipelineStageFlags visibleStages = 0;
+			VkAccessFlags visibleAccess = 0;
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+		RenderTargetPool* pool = nullptr;
+		std::vector<Pass> passes;
+		std::vector<Resource> resources;
+		std::vector<uint32_t> schedule;
+		std::vector<MemorySlot> slots;
+		std::vector<RenderPass> renderPasses;
+		std::vector<Barrier> finalBarriers;
+		VkDeviceSize unmergedTraffic = 0;
+
+		void addAccess(uint32_t pass, uint32_t resource, RenderGraphUsage usage, bool reads, bool writes);
+		void cullPasses();
+		void groupRenderPasses();
+		void planLifetimes();
+		void assignMemorySlots();
+		void planBarriers();
+		void planAttachments();
+		/** Load and store operations for the attachments used between two schedule positions. */
+		std::vector<Attachment> planAttachments(uint32_t firstPosition, uint32_t lastPosition) const;
+		void createRenderPass(RenderPass& renderPass);
+		VkFramebuffer getFramebuffer(RenderPass& renderPass);
+		static bool applyAccess(State& state, const Access& access, bool image, Barrier& barrier);
+		static void addDependency(RenderPass& renderPass, const std::vector<uint32_t>& sourceSubpasses,
+				uint32_t destinationSubpass, const Barrier& barrier);
+};
+
+#endif
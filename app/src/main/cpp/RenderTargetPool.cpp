@@ -0,0 +1,128 @@
+#include "RenderTargetPool.h"
+
+#include "CapabilityUtils.h"
+#include "MemoryUtils.h"
+
+#include <stdexcept>
+
+namespace {
+	bool matches(const RenderTargetDescription& a, const RenderTargetDescription& b) {
+		return a.format == b.format && a.extent.width == b.extent.width &&
+				a.extent.height == b.extent.height && a.samples == b.samples && a.usage == b.usage;
+	}
+}
+
+void RenderTargetPool::initialize(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties,
+		uint32_t evictionFrames) {
+	this->device = device;
+	this->memoryProperties = memoryProperties;
+	this->evictionFrames = evictionFrames;
+}
+
+void RenderTargetPool::destroy() {
+	for(Entry& entry : entries) {
+		destroyTarget(entry.target);
+	}
+	entries.clear();
+	device = VK_NULL_HANDLE;
+}
+
+void RenderTargetPool::beginFrame() {
+	for(size_t i = 0; i < entries.size();) {
+		Entry& entry = entries[i];
+		if(entry.inUse || ++entry.idleFrames < evictionFrames) {
+			i++;
+			continue;
+		}
+
+		destroyTarget(entry.target);
+		entries[i] = entries.back();
+		entries.pop_back();
+		evictionCount++;
+	}
+}
+
+RenderTarget RenderTargetPool::acquire(const RenderTargetDescription& description) {
+	for(Entry& entry : entries) {
+		if(!entry.inUse && matches(entry.description, description)) {
+			entry.inUse = true;
+			reuseCount++;
+			return entry.target;
+		}
+	}
+
+	Entry entry = {};
+	entry.description = description;
+	entry.target = createTarget(description);
+	entry.inUse = true;
+	entries.push_back(entry);
+	creationCount++;
+	return entry.target;
+}
+
+void RenderTargetPool::release(VkImage image) {
+	for(Entry& entry : entries) {
+		if(entry.target.image == image) {
+			entry.inUse = false;
+			entry.idleFrames = 0;
+			return;
+		}
+	}
+	throw std::runtime_error("Released a render target the pool doesn't own.");
+}
+
+RenderTarget RenderTargetPool::createTarget(const RenderTargetDescription& description) {
+	RenderTarget target;
+	if(description.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) {
+		target.lazilyAllocated = createTransientAttachment(device, memoryProperties, description.extent,
+				description.format, description.usage, target.image, target.memory, description.samples);
+	} else {
+		createImage(device, memoryProperties, description.extent, description.format, description.usage,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, target.image, target.memory, description.samples);
+	}
+	target.size = getImageMemoryRequirements(device, target.image).size;
+	target.view = createImageView(device, target.image, description.format,
+			getFormatAspects(description.format));
+	return target;
+}
+
+void RenderTargetPool::destroyTarget(RenderTarget& target) {
+	vkDestroyImageView(device, target.view, nullptr);
+	vkDestroyImage(device, target.image, nullptr);
+	vkFreeMemory(device, target.memory, nullptr);
+	target = RenderTarget();
+}
+
+VkDeviceSize RenderTargetPool::getPooledBytes() const {
+	VkDeviceSize bytes = 0;
+	for(const Entry& entry : entries) {
+		bytes += entry.target.size;
+	}
+	return bytes;
+}
+
+VkDeviceSize RenderTargetPool::getIdleBytes() const {
+	VkDeviceSize bytes = 0;
+	for(const Entry& entry : entries) {
+		if(!entry.inUse) {
+			bytes += entry.target.size;
+		}
+	}
+	return bytes;
+}
+
+uint32_t RenderTargetPool::getTargetCount() const {
+	return static_cast<uint32_t>(entries.size());
+}
+
+uint32_t RenderTargetPool::getReuseCount() const {
+	return reuseCount;
+}
+
+uint32_t RenderTargetPool::getCreationCount() const {
+	return creationCount;
+}
+
+uint32_t RenderTargetPool::getEvictionCount() const {
+	return evictionCount;
+}
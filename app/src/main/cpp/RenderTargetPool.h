@@ -0,0 +1,79 @@
+#ifndef RENDER_TARGET_POOL_H
+#define RENDER_TARGET_POOL_H
+
+#include "vulkan_wrapper/vulkan_wrapper.h"
+
+#include <cstdint>
+#include <vector>
+
+/** What a render target is made for. Targets are only interchangeable when all of it matches. */
+struct RenderTargetDescription {
+	VkFormat format;
+	VkExtent2D extent;
+	VkSampleCountFlagBits samples;
+	/** With VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, the memory is lazily allocated where possible. */
+	VkImageUsageFlags usage;
+};
+
+/** A single-mip 2D image with memory of its own and a view of every aspect. */
+struct RenderTarget {
+	VkImage image = VK_NULL_HANDLE;
+	VkImageView view = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize size = 0;
+	bool lazilyAllocated = false;
+};
+
+/**
+ * Caches render targets, so targets that come and go, such as those of a frame graph rebuilt for
+ * another resolution, reuse images rather than creating them again. Released targets wait for a
+ * request with the same description, and are destroyed once they've waited the eviction age.
+ *
+ * A released target can be handed out again straight away, so the GPU has to be done with it by
+ * then, or the next user's first barrier has to wait for its last use. The eviction age has to
+ * be longer than there are frames in flight.
+ */
+class RenderTargetPool {
+	public:
+		void initialize(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties,
+				uint32_t evictionFrames);
+		void destroy();
+
+		/** Ages the released targets, evicting those unused for the eviction age. Once per frame. */
+		void beginFrame();
+
+		RenderTarget acquire(const RenderTargetDescription& description);
+		void release(VkImage image);
+
+		/** Memory held by every target, lazily allocated memory included as reserved. */
+		VkDeviceSize getPooledBytes() const;
+		/** Memory held by released targets waiting to be reused. */
+		VkDeviceSize getIdleBytes() const;
+		uint32_t getTargetCount() const;
+		/** Requests served from the pool, requests that created a target, and targets evicted. */
+		uint32_t getReuseCount() const;
+		uint32_t getCreationCount() const;
+		uint32_t getEvictionCount() const;
+
+	private:
+		struct Entry {
+			RenderTargetDescription description;
+			RenderTarget target;
+			bool inUse;
+			/** Frames since release. */
+			uint32_t idleFrames;
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+		VkPhysicalDeviceMemoryProperties memoryProperties = {};
+		uint32_t evictionFrames = 0;
+		std::vector<Entry> entries;
+		uint32_t reuseCount = 0;
+		uint32_t creationCount = 0;
+		uint32_t evictionCount = 0;
+
+		RenderTarget createTarget(const RenderTargetDescription& description);
+		void destroyTarget(RenderTarget& target);
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include "ResolutionController.h"
+
+#include <algorithm>
+#include <cmath>
+
+ResolutionController::ResolutionController(const ResolutionSettings& settings) : settings(settings) {
+	reset();
+}
+
+void ResolutionController::reset() {
+	scale = settings.maxScale;
+	averageMilliseconds = 0.0;
+	averaged = false;
+	framesToSettle = 0;
+}
+
+bool ResolutionController::update(double gpuMilliseconds) {
+	if(framesToSettle > 0) {
+		framesToSettle--;
+		return false;
+	}
+
+	if(averaged) {
+		averageMilliseconds += settings.smoothing * (gpuMilliseconds - averageMilliseconds);
+	} else {
+		averageMilliseconds = gpuMilliseconds;
+		averaged = true;
+	}
+	if(averageMilliseconds <= 0.0) {
+		return false;
+	}
+
+	float next = scale;
+	if(averageMilliseconds > settings.budgetMilliseconds) {
+		float fitting = scale * static_cast<float>(std::sqrt(settings.budgetMilliseconds / averageMilliseconds));
+		next = std::min(quantize(fitting), quantize(scale - settings.step));
+	} else {
+		float roomy = scale * static_cast<float>(
+				std::sqrt(settings.budgetMilliseconds * settings.headroom / averageMilliseconds));
+		if(roomy >= scale + settings.step) {
+			next = quantize(scale + settings.step);
+		}
+	}
+	next = std::max(settings.minScale, std::min(settings.maxScale, next));
+	if(std::fabs(next - scale) < settings.step * 0.5f) {
+		return false;
+	}
+
+	// Carried over to the new scale, so the first frames after settling aren't judged on stale ones
+	averageMilliseconds *= (next * next) / (scale * scale);
+	scale = next;
+	framesToSettle = settings.settleFrames;
+	return true;
+}
+
+float ResolutionController::getScale() const {
+	return scale;
+}
+
+double ResolutionController::getAverageMilliseconds() const {
+	return averageMilliseconds;
+}
+
+const ResolutionSettings& ResolutionController::getSettings() const {
+	return settings;
+}
+
+// Rounds down, with a little slack for values a step sum left just short of a whole step
+float ResolutionController::quantize(float value) const {
+	return std::floor(value / settings.step + 0.001f) * settings.step;
+}
+
+ResolutionTraceSummary replayResolutionTrace(ResolutionController& controller,
+		const std::vector<ResolutionTraceFrame>& trace, std::vector<float>* scales) {
+	ResolutionTraceSummary summary = {};
+	summary.frames = static_cast<uint32_t>(trace.size());
+	summary.minimumScale = controller.getScale();
+
+	double scaleSum = 0.0;
+	for(const ResolutionTraceFrame& frame : trace) {
+		float scale = controller.getScale();
+		double milliseconds = frame.gpuMilliseconds * (scale * scale) / (frame.scale * frame.scale);
+		if(milliseconds > controller.getSettings().budgetMilliseconds) {
+			summary.framesOverBudget++;
+		}
+		scaleSum += scale;
+		summary.minimumScale = std::min(summary.minimumScale, scale);
+		if(scales != nullptr) {
+			scales->push_back(scale);
+		}
+
+		if(controller.update(milliseconds)) {
+			summary.scaleChanges++;
+		}
+	}
+
+	summary.averageScale = trace.empty() ?
+			controller.getScale() : static_cast<float>(scaleSum / trace.size());
+	return summary;
+}
@@ -0,0 +1,75 @@
+#ifndef RESOLUTION_CONTROLLER_H
+#define RESOLUTION_CONTROLLER_H
+
+#include <cstdint>
+#include <vector>
+
+struct ResolutionSettings {
+	float minScale = 0.5f;
+	float maxScale = 1.0f;
+	/** Scales are whole steps, so small corrections don't rebuild the frame graph. */
+	float step = 0.05f;
+	double budgetMilliseconds = 14.0;
+	/** Scaling up waits until frames would still fit this fraction of the budget afterwards. */
+	double headroom = 0.85;
+	/** How much each frame moves the running average. */
+	double smoothing = 0.1;
+	/** Frames ignored after a change, while those rendered at the old scale drain. */
+	uint32_t settleFrames = 30;
+};
+
+/**
+ * Picks the scene's resolution scale, per axis, from GPU frame times. Frame time is taken to grow
+ * with the pixel count, so the scale that fits the budget is the current one times the square root
+ * of budget over the average. Over budget, it drops there at once; under budget with headroom to
+ * spare, it climbs one step at a time.
+ *
+ * Knows nothing of Vulkan, so recorded frame times can be replayed through it without a GPU.
+ */
+class ResolutionController {
+	public:
+		explicit ResolutionController(const ResolutionSettings& settings = ResolutionSettings());
+
+		/** Back to the largest scale, forgetting every frame so far. */
+		void reset();
+
+		/** Takes the GPU time of one frame, and returns whether the scale changed. */
+		bool update(double gpuMilliseconds);
+
+		float getScale() const;
+		double getAverageMilliseconds() const;
+		const ResolutionSettings& getSettings() const;
+
+	private:
+		ResolutionSettings settings;
+		float scale;
+		double averageMilliseconds;
+		bool averaged;
+		uint32_t framesToSettle;
+
+		float quantize(float value) const;
+};
+
+/** One recorded frame: the scale it rendered at and the GPU time it took. */
+struct ResolutionTraceFrame {
+	float scale;
+	double gpuMilliseconds;
+};
+
+struct ResolutionTraceSummary {
+	uint32_t frames;
+	uint32_t framesOverBudget;
+	uint32_t scaleChanges;
+	float averageScale;
+	float minimumScale;
+};
+
+/**
+ * Feeds a recorded trace through the controller, as if each frame had rendered at the scale the
+ * controller had chosen by then, with its time scaled by the pixel count. The scale of each frame
+ * goes into scales when given.
+ */
+ResolutionTraceSummary replayResolutionTrace(ResolutionController& controller,
+		const std::vector<ResolutionTraceFrame>& trace, std::vector<float>* scales = nullptr);
+
+#endif
@@ -0,0 +1,129 @@
+#include "Scene.h"
+
+#include <algorithm>
+#include <cmath>
+
+Scene::Scene(ThreadPool& threadPool) : threadPool(threadPool) {
+	registry.getPool<Transform>();
+	registry.getPool<Bounds>();
+	registry.getPool<MeshRef>();
+	registry.getPool<MaterialRef>();
+}
+
+uint32_t Scene::addMesh(const Aabb& localBounds) {
+	meshBounds.push_back(localBounds);
+	return static_cast<uint32_t>(meshBounds.size() - 1);
+}
+
+Entity Scene::createRenderable(const Transform& transform, uint32_t mesh, uint32_t material,
+		Unorm4x8 color) {
+	Entity entity = registry.create();
+	registry.add<Transform>(entity, transform);
+	registry.add<Bounds>(entity, computeBounds(transform, mesh));
+	registry.add<MeshRef>(entity, MeshRef{mesh});
+	registry.add<MaterialRef>(entity, MaterialRef{material, color});
+	return entity;
+}
+
+void Scene::destroy(Entity entity) {
+	registry.destroy(entity);
+}
+
+void Scene::clear() {
+	registry = EntityRegistry();
+	registry.getPool<Transform>();
+	registry.getPool<Bounds>();
+	registry.getPool<MeshRef>();
+	registry.getPool<MaterialRef>();
+}
+
+uint32_t Scene::getRenderableCount() {
+	return registry.getPool<MeshRef>().size();
+}
+
+EntityRegistry& Scene::getRegistry() {
+	return registry;
+}
+
+void Scene::updateBounds() {
+	parallelEach<Transform, MeshRef, Bounds>(BATCH_SIZE,
+			[this](Entity, const Transform& transform, const MeshRef& meshRef, Bounds& bounds) {
+				bounds = computeBounds(transform, meshRef.mesh);
+			});
+}
+
+Bounds Scene::computeBounds(const Transform& transform, uint32_t mesh) const {
+	const Aabb& local = meshBounds[mesh];
+	Bounds bounds;
+	bounds.center = transform.position + transform.scale * local.getCenter();
+	bounds.extents = transform.scale * local.getExtents();
+	bounds.radius = glm::length(bounds.extents);
+	return bounds;
+}
+
+uint32_t Scene::collectDrawPackets(const glm::vec4 planes[6], std::vector<DrawPacket>& packets) {
+	ComponentPool<Bounds>& boundsPool = registry.getPool<Bounds>();
+	uint32_t count = boundsPool.size();
+	uint32_t batchCount = (count + BATCH_SIZE - 1) / BATCH_SIZE;
+	visible.resize(count);
+	batchOffsets.resize(batchCount + 1);
+
+	// First mark and count the survivors of each batch, then write them out at their final offsets
+	const Bounds* allBounds = boundsPool.data();
+	threadPool.parallelFor(batchCount, 1, [&](uint32_t firstBatch, uint32_t endBatch) {
+		for(uint32_t batch = firstBatch; batch < endBatch; batch++) {
+			uint32_t begin = batch * BATCH_SIZE;
+			uint32_t end = std::min(begin + BATCH_SIZE, count);
+			uint32_t batchVisible = 0;
+			for(uint32_t i = begin; i < end; i++) {
+				const Bounds& bounds = allBounds[i];
+				bool inside = true;
+				for(int p = 0; p < 6; p++) {
+					const glm::vec4& plane = planes[p];
+					float distance = glm::dot(glm::vec3(plane), bounds.center) + plane.w;
+					float boxRadius = glm::dot(glm::abs(glm::vec3(plane)), bounds.extents);
+					inside &= distance + std::min(bounds.radius, boxRadius) >= 0.0f;
+				}
+				visible[i] = inside;
+				batchVisible += inside;
+			}
+			batchOffsets[batch + 1] = batchVisible;
+		}
+	});
+
+	batchOffsets[0] = 0;
+	for(uint32_t batch = 0; batch < batchCount; batch++) {
+		batchOffsets[batch + 1] += batchOffsets[batch];
+	}
+	uint32_t visibleCount = batchOffsets[batchCount];
+	if(packets.size() < visibleCount) {
+		packets.resize(visibleCount);
+	}
+
+	const Entity* entities = boundsPool.getEntities();
+	ComponentPool<Transform>& transforms = registry.getPool<Transform>();
+	ComponentPool<MeshRef>& meshes = registry.getPool<MeshRef>();
+	ComponentPool<MaterialRef>& materials = registry.getPool<MaterialRef>();
+	threadPool.parallelFor(batchCount, 1, [&](uint32_t firstBatch, uint32_t endBatch) {
+		for(uint32_t batch = firstBatch; batch < endBatch; batch++) {
+			uint32_t begin = batch * BATCH_SIZE;
+			uint32_t end = std::min(begin + BATCH_SIZE, count);
+			DrawPacket* packet = packets.data() + batchOffsets[batch];
+			for(uint32_t i = begin; i < end; i++) {
+				if(!visible[i]) {
+					continue;
+				}
+				Entity entity = entities[i];
+				const Transform& transform = transforms.getAt(i, entity);
+				const MaterialRef& material = materials.getAt(i, entity);
+				packet->positionScale = glm::vec4(transform.position, transform.scale);
+				packet->color = material.color;
+				packet->mesh = meshes.getAt(i, entity).mesh;
+				packet->material = material.material;
+				packet++;
+			}
+		}
+	});
+
+	return visibleCount;
+}
@@ -0,0 +1,106 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "EntityRegistry.h"
+#include "MathUtils.h"
+#include "ThreadPool.h"
+#include "VertexLayout.h"
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+/** World-space placement with a uniform scale, as instances are drawn. */
+struct Transform {
+	glm::vec3 position;
+	float scale = 1.0f;
+};
+
+/**
+ * World-space bounds derived from the transform and the mesh's local box: a box and a sphere
+ * sharing its center, culled the same way as FrustumCuller.
+ */
+struct Bounds {
+	glm::vec3 center;
+	float radius;
+	glm::vec3 extents;
+};
+
+struct MeshRef {
+	uint32_t mesh;
+};
+
+struct MaterialRef {
+	uint32_t material;
+	Unorm4x8 color;
+};
+
+/** Everything the renderer needs to draw one visible renderable. */
+struct DrawPacket {
+	glm::vec4 positionScale;
+	Unorm4x8 color;
+	uint32_t mesh;
+	uint32_t material;
+};
+
+/**
+ * The renderable world, stored as components in an EntityRegistry. Renderables carry a Transform,
+ * Bounds, MeshRef and MaterialRef, created and destroyed together so their pools stay in step and
+ * systems walk them linearly. Systems run across the thread pool with parallelEach.
+ */
+class Scene {
+	public:
+		explicit Scene(ThreadPool& threadPool);
+
+		/** Registers a mesh by its local bounds; the returned id goes in MeshRef. */
+		uint32_t addMesh(const Aabb& localBounds);
+
+		Entity createRenderable(const Transform& transform, uint32_t mesh, uint32_t material,
+				Unorm4x8 color);
+		void destroy(Entity entity);
+
+		/** Destroys every entity, keeping the meshes. */
+		void clear();
+
+		uint32_t getRenderableCount();
+		EntityRegistry& getRegistry();
+
+		/**
+		 * Calls body(entity, first, others...) for every entity with the listed components, split
+		 * across the thread pool. The body must only touch the components it's given.
+		 */
+		template<typename First, typename... Others, typename Body>
+		void parallelEach(uint32_t minimumBatch, Body body) {
+			// Pools are created up front; the workers only look them up
+			(void) std::initializer_list<int>{(registry.getPool<Others>(), 0)...};
+			threadPool.parallelFor(registry.getPool<First>().size(), minimumBatch,
+					[&](uint32_t begin, uint32_t end) {
+						registry.eachInRange<First, Others...>(begin, end, body);
+					});
+		}
+
+		/** Recomputes Bounds from each renderable's Transform and mesh. */
+		void updateBounds();
+
+		/**
+		 * Culls renderables against the frustum, given as by extractFrustumPlanes, and writes a
+		 * packet per survivor in storage order. Returns the number written; packets only grows.
+		 */
+		uint32_t collectDrawPackets(const glm::vec4 planes[6], std::vector<DrawPacket>& packets);
+
+	private:
+		static const uint32_t BATCH_SIZE = 4096;
+
+		ThreadPool& threadPool;
+		EntityRegistry registry;
+		std::vector<Aabb> meshBounds;
+
+		// Culling scratch, reused every frame
+		std::vector<uint8_t> visible;
+		std::vector<uint32_t> batchOffsets;
+
+		Bounds computeBounds(const Transform& transform, uint32_t mesh) const;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "SceneBenchmark.h"
+
+#include "AndroidLogging.h"
+#include "Benchmarks.h"
+#include "Scene.h"
+#include "TimeUtils.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <random>
+#include <vector>
+
+namespace {
+	// Iterating the whole scene should leave most of a 60 Hz frame for everything else
+	const double FRAME_MILLISECONDS = 1000.0 / 60.0;
+	const double TARGET_FRAME_FRACTION = 0.25;
+
+	/** A component only the benchmark uses, to show systems beyond the renderer's own. */
+	struct Velocity {
+		glm::vec3 value;
+	};
+
+	/** The best times of each system, and of a whole frame, in milliseconds. */
+	struct SceneTimes {
+		double move = 0.0;
+		double bounds = 0.0;
+		double drawPackets = 0.0;
+		double frame = 0.0;
+		uint32_t visibleCount = 0;
+	};
+
+	void keepBest(double& best, double milliseconds, uint32_t frame) {
+		if(frame == 0 || milliseconds < best) {
+			best = milliseconds;
+		}
+	}
+
+	SceneTimes timeScene(uint32_t threadCount, uint32_t entityCount, uint32_t frames) {
+		ThreadPool threadPool(threadCount - 1);
+		Scene scene(threadPool);
+		uint32_t mesh = scene.addMesh(Aabb(glm::vec3(-0.5f), glm::vec3(0.5f)));
+
+		// The same random cube as the culling benchmark, with everything drifting slowly
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+		std::uniform_real_distribution<float> size(0.1f, 2.0f);
+		std::uniform_real_distribution<float> speed(-1.0f, 1.0f);
+
+		EntityRegistry& registry = scene.getRegistry();
+		for(uint32_t i = 0; i < entityCount; i++) {
+			Transform transform;
+			transform.position = glm::vec3(position(random), position(random), position(random));
+			transform.scale = size(random);
+			Entity entity = scene.createRenderable(transform, mesh, 0, Unorm4x8(1.0f, 1.0f, 1.0f));
+			registry.add<Velocity>(entity, Velocity{glm::vec3(speed(random), speed(random), speed(random))});
+		}
+
+		glm::vec4 planes[6];
+		extractFrustumPlanes(glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f) *
+				glm::lookAt(glm::vec3(0.0f, 0.0f, -60.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+				planes);
+
+		std::vector<DrawPacket> packets;
+		const float deltaSeconds = 1.0f / 60.0f;
+		SceneTimes times;
+		for(uint32_t frame = 0; frame < frames; frame++) {
+			TimePoint start = now();
+			scene.parallelEach<Velocity, Transform>(4096,
+					[deltaSeconds](Entity, const Velocity& velocity, Transform& transform) {
+						transform.position += velocity.value * deltaSeconds;
+					});
+			TimePoint moved = now();
+			scene.updateBounds();
+			TimePoint bounded = now();
+			times.visibleCount = scene.collectDrawPackets(planes, packets);
+			TimePoint culled = now();
+
+			keepBest(times.move, secondsBetween(start, moved) * 1e3, frame);
+			keepBest(times.bounds, secondsBetween(moved, bounded) * 1e3, frame);
+			keepBest(times.drawPackets, secondsBetween(bounded, culled) * 1e3, frame);
+			keepBest(times.frame, secondsBetween(start, culled) * 1e3, frame);
+		}
+
+		return times;
+	}
+}
+
+void runSceneBenchmark(uint32_t entityCount, uint32_t frames) {
+	std::vector<uint32_t> threadCounts = getBenchmarkThreadCounts();
+	std::vector<SceneTimes> times;
+	for(uint32_t threadCount : threadCounts) {
+		times.push_back(timeScene(threadCount, entityCount, frames));
+	}
+
+	double targetMilliseconds = FRAME_MILLISECONDS * TARGET_FRAME_FRACTION;
+	LOG_INFO("Scene benchmark: %u entities, %u visible, target %.2f ms", entityCount,
+			times.back().visibleCount, targetMilliseconds);
+	LOG_INFO("%8s %10s %10s %13s %10s %11s", "threads", "move ms", "bounds ms", "packets ms",
+			"frame ms", "% of 60 Hz");
+	for(size_t i = 0; i < times.size(); i++) {
+		LOG_INFO("%8u %10.2f %10.2f %13.2f %10.2f %10.0f%%", threadCounts[i], times[i].move,
+				times[i].bounds, times[i].drawPackets, times[i].frame,
+				100.0 * times[i].frame / FRAME_MILLISECONDS);
+	}
+
+	if(times.back().frame > targetMilliseconds) {
+		LOG_WARN("Scene benchmark: %.2f ms with every thread (%u) misses the %.2f ms target.",
+				times.back().frame, threadCounts.back(), targetMilliseconds);
+	}
+}
@@ -0,0 +1,14 @@
+#ifndef SCENE_BENCHMARK_H
+#define SCENE_BENCHMARK_H
+
+#include <cstdint>
+
+/**
+ * Times a frame's worth of Scene work over many entities: a system moving every transform,
+ * refreshing bounds, and culling into draw packets. Runs once per thread count from
+ * getBenchmarkThreadCounts, logging the best frame of several and warning when even every thread
+ * together takes more than a quarter of a 60 Hz frame. Blocks for a few seconds.
+ */
+void runSceneBenchmark(uint32_t entityCount = 1000000, uint32_t frames = 20);
+
+#endif
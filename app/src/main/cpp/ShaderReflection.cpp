@@ -0,0 +1,564 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+	const uint32_t SPIRV_MAGIC = 0x07230203;
+	const size_t SPIRV_HEADER_WORDS = 5;
+
+	enum Op {
+		OP_NAME = 5,
+		OP_ENTRY_POINT = 15,
+		OP_TYPE_BOOL = 20,
+		OP_TYPE_INT = 21,
+		OP_TYPE_FLOAT = 22,
+		OP_TYPE_VECTOR = 23,
+		OP_TYPE_MATRIX = 24,
+		OP_TYPE_IMAGE = 25,
+		OP_TYPE_SAMPLER = 26,
+		OP_TYPE_SAMPLED_IMAGE = 27,
+		OP_TYPE_ARRAY = 28,
+		OP_TYPE_RUNTIME_ARRAY = 29,
+		OP_TYPE_STRUCT = 30,
+		OP_TYPE_POINTER = 32,
+		OP_CONSTANT = 43,
+		OP_SPEC_CONSTANT_TRUE = 48,
+		OP_SPEC_CONSTANT_FALSE = 49,
+		OP_SPEC_CONSTANT = 50,
+		OP_VARIABLE = 59,
+		OP_DECORATE = 71,
+		OP_MEMBER_DECORATE = 72
+	};
+
+	enum Decoration {
+		DECORATION_SPEC_ID = 1,
+		DECORATION_BLOCK = 2,
+		DECORATION_BUFFER_BLOCK = 3,
+		DECORATION_ARRAY_STRIDE = 6,
+		DECORATION_MATRIX_STRIDE = 7,
+		DECORATION_BUILT_IN = 11,
+		DECORATION_LOCATION = 30,
+		DECORATION_BINDING = 33,
+		DECORATION_DESCRIPTOR_SET = 34,
+		DECORATION_OFFSET = 35
+	};
+
+	enum StorageClass {
+		STORAGE_CLASS_UNIFORM_CONSTANT = 0,
+		STORAGE_CLASS_INPUT = 1,
+		STORAGE_CLASS_UNIFORM = 2,
+		STORAGE_CLASS_PUSH_CONSTANT = 9,
+		STORAGE_CLASS_STORAGE_BUFFER = 12
+	};
+
+	const uint32_t IMAGE_DIM_BUFFER = 5;
+	const uint32_t IMAGE_DIM_SUBPASS_DATA = 6;
+	const uint32_t UNSET = static_cast<uint32_t>(-1);
+
+	struct Type {
+		uint32_t op = 0;
+		std::vector<uint32_t> operands;
+	};
+
+	struct Decorations {
+		uint32_t set = UNSET;
+		uint32_t binding = UNSET;
+		uint32_t location = UNSET;
+		uint32_t specId = UNSET;
+		uint32_t offset = UNSET;
+		uint32_t arrayStride = 0;
+		uint32_t matrixStride = 0;
+		bool block = false;
+		bool bufferBlock = false;
+		bool builtIn = false;
+	};
+
+	struct Variable {
+		uint32_t id;
+		uint32_t pointerType;
+		uint32_t storageClass;
+	};
+
+	struct SpecializationConstant {
+		uint32_t id;
+		uint32_t type;
+		uint32_t defaultValue;
+	};
+
+	class Module {
+		public:
+			std::unordered_map<uint32_t, Type> types;
+			std::unordered_map<uint32_t, uint32_t> constants;
+			std::unordered_map<uint32_t, std::string> names;
+			std::unordered_map<uint32_t, Decorations> decorations;
+			std::map<std::pair<uint32_t, uint32_t>, Decorations> memberDecorations;
+			std::vector<Variable> variables;
+			std::vector<SpecializationConstant> specializationConstants;
+			uint32_t executionModel = UNSET;
+			std::string entryPoint;
+
+			const Type& getType(uint32_t id) const {
+				auto type = types.find(id);
+				if(type == types.end()) {
+					throw std::runtime_error("SPIR-V references an undeclared type.");
+				}
+
+				return type->second;
+			}
+
+			Decorations getDecorations(uint32_t id) const {
+				auto found = decorations.find(id);
+				return found == decorations.end() ? Decorations() : found->second;
+			}
+
+			Decorations getMemberDecorations(uint32_t structId, uint32_t member) const {
+				auto found = memberDecorations.find(std::make_pair(structId, member));
+				return found == memberDecorations.end() ? Decorations() : found->second;
+			}
+
+			std::string getName(uint32_t id) const {
+				auto found = names.find(id);
+				return found == names.end() ? std::string() : found->second;
+			}
+
+			/** Strips any number of array levels, accumulating their element counts. */
+			uint32_t unwrapArrays(uint32_t typeId, uint32_t& count) const {
+				count = 1;
+				const Type* type = &getType(typeId);
+				while(type->op == OP_TYPE_ARRAY || type->op == OP_TYPE_RUNTIME_ARRAY) {
+					if(type->op == OP_TYPE_RUNTIME_ARRAY) {
+						count = 0;
+					} else {
+						auto length = constants.find(type->operands[1]);
+						count *= length == constants.end() ? 1 : length->second;
+					}
+
+					typeId = type->operands[0];
+					type = &getType(typeId);
+				}
+
+				return typeId;
+			}
+
+			/** Size in bytes of a type laid out with explicit offsets and strides. */
+			uint32_t sizeOf(uint32_t typeId, uint32_t matrixStride = 0) const {
+				const Type& type = getType(typeId);
+				switch(type.op) {
+					case OP_TYPE_BOOL:
+						return 4;
+					case OP_TYPE_INT:
+					case OP_TYPE_FLOAT:
+						return type.operands[0] / 8;
+					case OP_TYPE_VECTOR:
+						return sizeOf(type.operands[0]) * type.operands[1];
+					case OP_TYPE_MATRIX:
+						return matrixStride > 0 ?
+								matrixStride * type.operands[1] :
+								sizeOf(type.operands[0]) * type.operands[1];
+					case OP_TYPE_ARRAY: {
+						auto length = constants.find(type.operands[1]);
+						uint32_t stride = getDecorations(typeId).arrayStride;
+						if(stride == 0) {
+							stride = sizeOf(type.operands[0], matrixStride);
+						}
+
+						return stride * (length == constants.end() ? 1 : length->second);
+					}
+					case OP_TYPE_RUNTIME_ARRAY:
+						return 0;
+					case OP_TYPE_STRUCT: {
+						uint32_t size = 0;
+						for(uint32_t member = 0; member < type.operands.size(); member++) {
+							Decorations memberDecorations = getMemberDecorations(typeId, member);
+							uint32_t offset = memberDecorations.offset == UNSET ? size : memberDecorations.offset;
+							size = std::max(size, offset +
+									sizeOf(type.operands[member], memberDecorations.matrixStride));
+						}
+
+						return size;
+					}
+					default:
+						return 0;
+				}
+			}
+
+			/** The lowest explicit member offset of a block, which is where its push constant range starts. */
+			uint32_t firstMemberOffset(uint32_t structId) const {
+				const Type& type = getType(structId);
+				uint32_t offset = UNSET;
+				for(uint32_t member = 0; member < type.operands.size(); member++) {
+					offset = std::min(offset, getMemberDecorations(structId, member).offset);
+				}
+
+				return offset == UNSET ? 0 : offset;
+			}
+	};
+
+	std::string readString(const uint32_t* words, size_t wordCount) {
+		const char* characters = reinterpret_cast<const char*>(words);
+		return std::string(characters, strnlen(characters, wordCount * sizeof(uint32_t)));
+	}
+
+	void applyDecoration(Decorations& decorations, uint32_t decoration, const uint32_t* literals,
+			size_t literalCount) {
+		uint32_t literal = literalCount > 0 ? literals[0] : 0;
+		switch(decoration) {
+			case DECORATION_SPEC_ID: decorations.specId = literal; break;
+			case DECORATION_BLOCK: decorations.block = true; break;
+			case DECORATION_BUFFER_BLOCK: decorations.bufferBlock = true; break;
+			case DECORATION_ARRAY_STRIDE: decorations.arrayStride = literal; break;
+			case DECORATION_MATRIX_STRIDE: decorations.matrixStride = literal; break;
+			case DECORATION_BUILT_IN: decorations.builtIn = true; break;
+			case DECORATION_LOCATION: decorations.location = literal; break;
+			case DECORATION_BINDING: decorations.binding = literal; break;
+			case DECORATION_DESCRIPTOR_SET: decorations.set = literal; break;
+			case DECORATION_OFFSET: decorations.offset = literal; break;
+			default: break;
+		}
+	}
+
+	Module parseModule(const std::vector<char>& bytecode) {
+		if(bytecode.size() % sizeof(uint32_t) != 0 ||
+				bytecode.size() < SPIRV_HEADER_WORDS * sizeof(uint32_t)) {
+			throw std::runtime_error("SPIR-V bytecode is truncated.");
+		}
+
+		// The asset buffer carries no alignment guarantee, so copy it into words first
+		std::vector<uint32_t> words(bytecode.size() / sizeof(uint32_t));
+		memcpy(words.data(), bytecode.data(), bytecode.size());
+		if(words[0] != SPIRV_MAGIC) {
+			throw std::runtime_error("Bytecode is not SPIR-V.");
+		}
+
+		Module module;
+		size_t position = SPIRV_HEADER_WORDS;
+		while(position < words.size()) {
+			uint32_t wordCount = words[position] >> 16;
+			uint32_t opcode = words[position] & 0xFFFF;
+			if(wordCount == 0 || position + wordCount > words.size()) {
+				throw std::runtime_error("SPIR-V instruction runs past the end of the module.");
+			}
+
+			const uint32_t* operands = &words[position + 1];
+			size_t operandCount = wordCount - 1;
+
+			switch(opcode) {
+				case OP_NAME:
+					module.names[operands[0]] = readString(operands + 1, operandCount - 1);
+					break;
+				case OP_ENTRY_POINT:
+					if(module.executionModel == UNSET) {
+						module.executionModel = operands[0];
+						module.entryPoint = readString(operands + 2, operandCount - 2);
+					}
+					break;
+				case OP_TYPE_BOOL:
+				case OP_TYPE_INT:
+				case OP_TYPE_FLOAT:
+				case OP_TYPE_VECTOR:
+				case OP_TYPE_MATRIX:
+				case OP_TYPE_IMAGE:
+				case OP_TYPE_SAMPLER:
+				case OP_TYPE_SAMPLED_IMAGE:
+				case OP_TYPE_ARRAY:
+				case OP_TYPE_RUNTIME_ARRAY:
+				case OP_TYPE_STRUCT:
+				case OP_TYPE_POINTER: {
+					Type& type = module.types[operands[0]];
+					type.op = opcode;
+					type.operands.assign(operands + 1, operands + operandCount);
+					break;
+				}
+				case OP_CONSTANT:
+					module.constants[operands[1]] = operands[2];
+					break;
+				case OP_SPEC_CONSTANT_TRUE:
+				case OP_SPEC_CONSTANT_FALSE:
+				case OP_SPEC_CONSTANT: {
+					SpecializationConstant constant = {};
+					constant.type = operands[0];
+					constant.id = operands[1];
+					constant.defaultValue = opcode == OP_SPEC_CONSTANT ? operands[2] :
+							opcode == OP_SPEC_CONSTANT_TRUE ? 1 : 0;
+					module.specializationConstants.push_back(constant);
+					module.constants[constant.id] = constant.defaultValue;
+					break;
+				}
+				case OP_VARIABLE:
+					module.variables.push_back({operands[1], operands[0], operands[2]});
+					break;
+				case OP_DECORATE:
+					applyDecoration(module.decorations[operands[0]], operands[1], operands + 2,
+							operandCount - 2);
+					break;
+				case OP_MEMBER_DECORATE:
+					applyDecoration(module.memberDecorations[std::make_pair(operands[0], operands[1])],
+							operands[2], operands + 3, operandCount - 3);
+					break;
+				default:
+					break;
+			}
+
+			position += wordCount;
+		}
+
+		if(module.executionModel == UNSET) {
+			throw std::runtime_error("SPIR-V module has no entry point.");
+		}
+
+		return module;
+	}
+
+	VkShaderStageFlagBits toShaderStage(uint32_t executionModel) {
+		switch(executionModel) {
+			case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+			case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+			case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+			case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+			case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+			case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+			default: throw std::runtime_error("Unsupported SPIR-V execution model.");
+		}
+	}
+
+	bool toDescriptorType(const Module& module, uint32_t storageClass, uint32_t typeId,
+			VkDescriptorType& descriptorType) {
+		const Type& type = module.getType(typeId);
+
+		if(storageClass == STORAGE_CLASS_STORAGE_BUFFER) {
+			descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			return true;
+		}
+
+		if(storageClass == STORAGE_CLASS_UNIFORM && type.op == OP_TYPE_STRUCT) {
+			descriptorType = module.getDecorations(typeId).bufferBlock ?
+					VK_DESCRIPTOR_TYPE_STORAGE_BUFFER :
+					VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			return true;
+		}
+
+		if(storageClass != STORAGE_CLASS_UNIFORM_CONSTANT) {
+			return false;
+		}
+
+		switch(type.op) {
+			case OP_TYPE_SAMPLER:
+				descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+				return true;
+			case OP_TYPE_SAMPLED_IMAGE:
+				descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+				return true;
+			case OP_TYPE_IMAGE: {
+				uint32_t dimension = type.operands[1];
+				bool storage = type.operands[5] == 2;
+				if(dimension == IMAGE_DIM_SUBPASS_DATA) {
+					descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+				} else if(dimension == IMAGE_DIM_BUFFER) {
+					descriptorType = storage ?
+							VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER :
+							VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+				} else {
+					descriptorType = storage ?
+							VK_DESCRIPTOR_TYPE_STORAGE_IMAGE :
+							VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+				}
+				return true;
+			}
+			default:
+				return false;
+		}
+	}
+
+	VkFormat toVertexFormat(const Module& module, uint32_t typeId) {
+		const Type& type = module.getType(typeId);
+		uint32_t componentCount = 1;
+		const Type* componentType = &type;
+		if(type.op == OP_TYPE_VECTOR) {
+			componentCount = type.operands[1];
+			componentType = &module.getType(type.operands[0]);
+		}
+
+		if(componentType->operands.empty() || componentType->operands[0] != 32) {
+			return VK_FORMAT_UNDEFINED;
+		}
+
+		static const VkFormat FLOAT_FORMATS[] = {
+				VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT,
+				VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		static const VkFormat SINT_FORMATS[] = {
+				VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT,
+				VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+		static const VkFormat UINT_FORMATS[] = {
+				VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT,
+				VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+		if(componentCount < 1 || componentCount > 4) {
+			return VK_FORMAT_UNDEFINED;
+		} else if(componentType->op == OP_TYPE_FLOAT) {
+			return FLOAT_FORMATS[componentCount - 1];
+		} else if(componentType->op == OP_TYPE_INT) {
+			return componentType->operands[1] ?
+					SINT_FORMATS[componentCount - 1] :
+					UINT_FORMATS[componentCount - 1];
+		}
+
+		return VK_FORMAT_UNDEFINED;
+	}
+}
+
+const ReflectedInput* ShaderReflection::findInput(uint32_t location) const {
+	for(const ReflectedInput& input : inputs) {
+		if(input.location == location) {
+			return &input;
+		}
+	}
+
+	return nullptr;
+}
+
+ShaderReflection reflectShader(const std::vector<char>& bytecode) {
+	Module module = parseModule(bytecode);
+
+	ShaderReflection reflection;
+	VkShaderStageFlagBits stage = toShaderStage(module.executionModel);
+	reflection.stages = stage;
+	reflection.entryPoint = module.entryPoint;
+
+	for(const Variable& variable : module.variables) {
+		const Type& pointer = module.getType(variable.pointerType);
+		if(pointer.op != OP_TYPE_POINTER) {
+			continue;
+		}
+
+		uint32_t count;
+		uint32_t typeId = module.unwrapArrays(pointer.operands[1], count);
+		Decorations decorations = module.getDecorations(variable.id);
+
+		if(variable.storageClass == STORAGE_CLASS_PUSH_CONSTANT) {
+			VkPushConstantRange range = {};
+			range.stageFlags = stage;
+			range.offset = module.firstMemberOffset(typeId);
+			range.size = module.sizeOf(typeId) - range.offset;
+			reflection.pushConstantRanges.push_back(range);
+		} else if(variable.storageClass == STORAGE_CLASS_INPUT) {
+			if(decorations.location != UNSET && !decorations.builtIn) {
+				ReflectedInput input = {};
+				input.location = decorations.location;
+				input.format = toVertexFormat(module, typeId);
+				input.name = module.getName(variable.id);
+				reflection.inputs.push_back(input);
+			}
+		} else {
+			ReflectedDescriptorBinding binding = {};
+			if(!toDescriptorType(module, variable.storageClass, typeId, binding.type)) {
+				continue;
+			}
+
+			binding.set = decorations.set == UNSET ? 0 : decorations.set;
+			binding.binding = decorations.binding == UNSET ? 0 : decorations.binding;
+			binding.count = count;
+			binding.stages = stage;
+			binding.name = module.getName(variable.id);
+			if(binding.name.empty()) {
+				binding.name = module.getName(typeId);
+			}
+			reflection.descriptorBindings.push_back(binding);
+		}
+	}
+
+	for(const SpecializationConstant& constant : module.specializationConstants) {
+		Decorations decorations = module.getDecorations(constant.id);
+		if(decorations.specId == UNSET) {
+			continue;
+		}
+
+		ReflectedSpecializationConstant reflected = {};
+		reflected.constantId = decorations.specId;
+		reflected.size = module.sizeOf(constant.type);
+		reflected.defaultValue = constant.defaultValue;
+		reflected.name = module.getName(constant.id);
+		reflection.specializationConstants.push_back(reflected);
+	}
+
+	std::sort(reflection.descriptorBindings.begin(), reflection.descriptorBindings.end(),
+			[](const ReflectedDescriptorBinding& a, const ReflectedDescriptorBinding& b) {
+				return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+			});
+	std::sort(reflection.inputs.begin(), reflection.inputs.end(),
+			[](const ReflectedInput& a, const ReflectedInput& b) {
+				return a.location < b.location;
+			});
+
+	return reflection;
+}
+
+ShaderReflection mergeShaderReflections(const std::vector<ShaderReflection>& reflections) {
+	ShaderReflection merged;
+
+	for(const ShaderReflection& reflection : reflections) {
+		merged.stages |= reflection.stages;
+
+		if(reflection.stages & VK_SHADER_STAGE_VERTEX_BIT) {
+			merged.inputs = reflection.inputs;
+		}
+
+		for(const ReflectedDescriptorBinding& binding : reflection.descriptorBindings) {
+			auto existing = std::find_if(merged.descriptorBindings.begin(), merged.descriptorBindings.end(),
+					[&binding](const ReflectedDescriptorBinding& candidate) {
+						return candidate.set == binding.set && candidate.binding == binding.binding;
+					});
+
+			if(existing == merged.descriptorBindings.end()) {
+				merged.descriptorBindings.push_back(binding);
+			} else if(existing->type != binding.type) {
+				throw std::runtime_error("Shader stages disagree on the type of descriptor " +
+						std::to_string(binding.set) + "." + std::to_string(binding.binding) + ".");
+			} else {
+				existing->stages |= binding.stages;
+				existing->count = std::max(existing->count, binding.count);
+			}
+		}
+
+		for(const VkPushConstantRange& range : reflection.pushConstantRanges) {
+			if(merged.pushConstantRanges.empty()) {
+				merged.pushConstantRanges.push_back(range);
+			} else {
+				VkPushConstantRange& combined = merged.pushConstantRanges[0];
+				uint32_t end = std::max(combined.offset + combined.size, range.offset + range.size);
+				combined.offset = std::min(combined.offset, range.offset);
+				combined.size = end - combined.offset;
+				combined.stageFlags |= range.stageFlags;
+			}
+		}
+
+		for(const ReflectedSpecializationConstant& constant : reflection.specializationConstants) {
+			merged.specializationConstants.push_back(constant);
+		}
+	}
+
+	std::sort(merged.descriptorBindings.begin(), merged.descriptorBindings.end(),
+			[](const ReflectedDescriptorBinding& a, const ReflectedDescriptorBinding& b) {
+				return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+			});
+
+	return merged;
+}
+
+void assertVertexInputsProvided(const ShaderReflection& reflection,
+		const VkVertexInputAttributeDescription* attributes, size_t attributeCount) {
+	for(const ReflectedInput& input : reflection.inputs) {
+		bool provided = false;
+		for(size_t i = 0; i < attributeCount; i++) {
+			provided |= attributes[i].location == input.location;
+		}
+
+		if(!provided) {
+			throw std::runtime_error("No vertex attribute provides shader input " + input.name +
+					" at location " + std::to_string(input.location) + ".");
+		}
+	}
+}
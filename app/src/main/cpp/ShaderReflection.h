@@ -0,0 +1,66 @@
+#ifndef SHADER_REFLECTION_H
+#define SHADER_REFLECTION_H
+
+#include "vulkan_wrapper/vulkan_wrapper.h"
+
+#include <string>
+#include <vector>
+
+struct ReflectedDescriptorBinding {
+	uint32_t set;
+	uint32_t binding;
+	VkDescriptorType type;
+
+	/** 0 for a runtime-sized array, which needs descriptor indexing to be bound. */
+	uint32_t count;
+	VkShaderStageFlags stages;
+	std::string name;
+};
+
+struct ReflectedInput {
+	uint32_t location;
+	VkFormat format;
+	std::string name;
+};
+
+struct ReflectedSpecializationConstant {
+	uint32_t constantId;
+	uint32_t size;
+	uint32_t defaultValue;
+	std::string name;
+};
+
+struct ShaderReflection {
+	VkShaderStageFlags stages = 0;
+	std::string entryPoint;
+	std::vector<ReflectedDescriptorBinding> descriptorBindings;
+	std::vector<VkPushConstantRange> pushConstantRanges;
+
+	/** Stage inputs decorated with a location. For a vertex shader these are its vertex attributes. */
+	std::vector<ReflectedInput> inputs;
+	std::vector<ReflectedSpecializationConstant> specializationConstants;
+
+	const ReflectedInput* findInput(uint32_t location) const;
+};
+
+/**
+ * Extracts the resource interface of a SPIR-V module, as returned by readAsset. Only the first
+ * entry point is considered. Throws std::runtime_error if the bytecode isn't valid SPIR-V.
+ */
+ShaderReflection reflectShader(const std::vector<char>& bytecode);
+
+/**
+ * Combines the reflections of every stage in a pipeline: bindings shared between stages are
+ * merged with their stage flags OR'd together, and push constant ranges collapse into a single
+ * range visible to all stages that declared one.
+ */
+ShaderReflection mergeShaderReflections(const std::vector<ShaderReflection>& reflections);
+
+/**
+ * Throws std::runtime_error if the reflected shader reads an input location that none of the
+ * given vertex attributes supply, which would otherwise fail only under validation.
+ */
+void assertVertexInputsProvided(const ShaderReflection& reflection,
+		const VkVertexInputAttributeDescription* attributes, size_t attributeCount);
+
+#endif
@@ -0,0 +1,113 @@
+#include "SortBenchmark.h"
+
+#include "AndroidLogging.h"
+#include "Benchmarks.h"
+#include "DrawSortKey.h"
+#include "RadixSort.h"
+#include "TimeUtils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+namespace {
+	// Well under a millisecond, leaving the frame room for recording the sorted draws
+	const double TARGET_MILLISECONDS = 0.5;
+
+	/** Sorts a fresh copy of the keys each run, returning the best time in milliseconds. */
+	template<typename Sort> double timeBest(uint32_t iterations, const std::vector<uint64_t>& keys,
+			const std::vector<uint32_t>& values, std::vector<uint64_t>& sortedKeys,
+			std::vector<uint32_t>& sortedValues, Sort sort) {
+		double best = 0.0;
+		for(uint32_t i = 0; i < iterations; i++) {
+			sortedKeys = keys;
+			sortedValues = values;
+			TimePoint start = now();
+			sort();
+			double milliseconds = secondsBetween(start, now()) * 1e3;
+			if(i == 0 || milliseconds < best) {
+				best = milliseconds;
+			}
+		}
+		return best;
+	}
+}
+
+void runSortBenchmark(uint32_t keyCount, uint32_t iterations) {
+	// A plausible frame: a few pipelines, tens of materials and meshes, depths out to 100 units,
+	// and a tenth of the draws transparent
+	std::mt19937 random(1);
+	std::uniform_int_distribution<uint32_t> pipeline(0, 3);
+	std::uniform_int_distribution<uint32_t> material(0, 63);
+	std::uniform_int_distribution<uint32_t> mesh(0, 31);
+	std::uniform_real_distribution<float> depth(0.1f, 100.0f);
+	std::uniform_int_distribution<uint32_t> percent(0, 99);
+
+	std::vector<uint64_t> keys(keyCount);
+	std::vector<uint32_t> values(keyCount);
+	for(uint32_t i = 0; i < keyCount; i++) {
+		uint32_t layer = percent(random) < 10 ? DRAW_LAYER_TRANSPARENT : DRAW_LAYER_OPAQUE;
+		keys[i] = makeDrawSortKey(layer, pipeline(random), material(random), mesh(random), depth(random));
+		values[i] = i;
+	}
+
+	RadixSorter serialSorter;
+
+	std::vector<uint64_t> referenceKeys;
+	std::vector<uint32_t> referenceValues;
+	std::vector<std::pair<uint64_t, uint32_t>> pairs(keyCount);
+	double standardMilliseconds = timeBest(iterations, keys, values, referenceKeys, referenceValues,
+			[&]() {
+				for(uint32_t i = 0; i < keyCount; i++) {
+					pairs[i] = std::make_pair(referenceKeys[i], referenceValues[i]);
+				}
+				std::stable_sort(pairs.begin(), pairs.end(),
+						[](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) {
+							return a.first < b.first;
+						});
+				for(uint32_t i = 0; i < keyCount; i++) {
+					referenceKeys[i] = pairs[i].first;
+					referenceValues[i] = pairs[i].second;
+				}
+			});
+
+	std::vector<uint64_t> sortedKeys;
+	std::vector<uint32_t> sortedValues;
+	double serialMilliseconds = timeBest(iterations, keys, values, sortedKeys, sortedValues, [&]() {
+		serialSorter.sort(sortedKeys, sortedValues);
+	});
+	if(sortedKeys != referenceKeys || sortedValues != referenceValues) {
+		LOG_WARN("Sort benchmark: serial radix sort disagrees with std::stable_sort.");
+	}
+
+	LOG_INFO("Sort benchmark: %u keys with values, target %.2f ms", keyCount, TARGET_MILLISECONDS);
+	LOG_INFO("%24s %10s", "sort", "ms");
+	LOG_INFO("%24s %10.3f", "std::stable_sort", standardMilliseconds);
+	LOG_INFO("%24s %10.3f", "radix, 1 thread", serialMilliseconds);
+
+	double bestMilliseconds = serialMilliseconds;
+	for(uint32_t threadCount : getBenchmarkThreadCounts()) {
+		if(threadCount == 1) {
+			continue;
+		}
+
+		ThreadPool threadPool(threadCount - 1);
+		RadixSorter parallelSorter(&threadPool);
+		double parallelMilliseconds = timeBest(iterations, keys, values, sortedKeys, sortedValues, [&]() {
+			parallelSorter.sort(sortedKeys, sortedValues);
+		});
+		if(sortedKeys != referenceKeys || sortedValues != referenceValues) {
+			LOG_WARN("Sort benchmark: radix sort on %u threads disagrees with std::stable_sort.", threadCount);
+		}
+
+		char label[32];
+		snprintf(label, sizeof(label), "radix, %u threads", threadCount);
+		LOG_INFO("%24s %10.3f", label, parallelMilliseconds);
+		bestMilliseconds = std::min(bestMilliseconds, parallelMilliseconds);
+	}
+
+	if(bestMilliseconds > TARGET_MILLISECONDS) {
+		LOG_WARN("Sort benchmark: the fastest radix sort, %.3f ms, misses the %.2f ms target.",
+				bestMilliseconds, TARGET_MILLISECONDS);
+	}
+}
@@ -0,0 +1,13 @@
+#ifndef SORT_BENCHMARK_H
+#define SORT_BENCHMARK_H
+
+#include <cstdint>
+
+/**
+ * Times RadixSorter on draw sort keys against std::stable_sort, serially and on each thread count
+ * from getBenchmarkThreadCounts, and checks they all agree. Logs the best of several runs in
+ * milliseconds, warning when even the fastest misses half a millisecond.
+ */
+void runSortBenchmark(uint32_t keyCount = 100000, uint32_t iterations = 20);
+
+#endif
@@ -0,0 +1,223 @@
+#include "SpriteBatcher.h"
+
+#include "MathUtils.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void SpriteBatcher::initialize(VkDevice device,
+		const VkPhysicalDeviceMemoryProperties& memoryProperties, uint32_t framesInFlight,
+		uint32_t initialCapacity, BindlessResources* resources) {
+	this->resources = resources;
+
+	vertexStream.initialize(device, memoryProperties, framesInFlight, 4 * sizeof(SpriteVertex),
+			initialCapacity);
+	indexStream.initialize(device, memoryProperties, framesInFlight, 6 * sizeof(uint32_t),
+			initialCapacity, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+	indexedQuads.assign(framesInFlight, 0);
+
+	sprites.reserve(initialCapacity);
+	sortKeys.reserve(initialCapacity);
+}
+
+void SpriteBatcher::destroy() {
+	vertexStream.destroy();
+	indexStream.destroy();
+	indexedQuads.clear();
+	pipelines.clear();
+	sprites.clear();
+	sortKeys.clear();
+}
+
+uint8_t SpriteBatcher::addPipeline(VkPipeline pipeline) {
+	if(pipelines.size() > UINT8_MAX) {
+		throw std::runtime_error("Too many sprite pipelines.");
+	}
+
+	pipelines.push_back(pipeline);
+	return static_cast<uint8_t>(pipelines.size() - 1);
+}
+
+void SpriteBatcher::clearPipelines() {
+	pipelines.clear();
+}
+
+void SpriteBatcher::begin(uint32_t frameIndex) {
+	this->frameIndex = frameIndex;
+	previousSprites.swap(sprites);
+	sprites.clear();
+}
+
+void SpriteBatcher::draw(const Sprite& sprite) {
+	if(sprites.size() >= (1u << SEQUENCE_BITS) || sprite.texture >= (1u << TEXTURE_BITS)) {
+		throw std::runtime_error("Sprite can't be represented in a sort key.");
+	}
+
+	sprites.push_back(sprite);
+}
+
+void SpriteBatcher::flush(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout,
+		VkShaderStageFlags pushConstantStages, VkExtent2D extent, uint32_t quarterTurns) {
+	drawCount = 0;
+	uint32_t spriteCount = static_cast<uint32_t>(sprites.size());
+	if(spriteCount == 0) {
+		return;
+	}
+
+	// The sequence number in the low bits keeps the sort stable and leads back to the sprite
+	sortKeys.clear();
+	for(uint32_t i = 0; i < spriteCount; i++) {
+		const Sprite& sprite = sprites[i];
+		sortKeys.push_back(static_cast<uint64_t>(sprite.layer) << 56 |
+				static_cast<uint64_t>(sprite.pipeline) << 48 |
+				static_cast<uint64_t>(sprite.texture) << SEQUENCE_BITS |
+				i);
+	}
+	sorter.sort(sortKeys);
+
+	const uint64_t sequenceMask = (1u << SEQUENCE_BITS) - 1;
+	SpriteVertex* vertices = vertexStream.map<SpriteVertex>(frameIndex, spriteCount);
+	for(uint32_t i = 0; i < spriteCount; i++) {
+		writeQuad(sprites[sortKeys[i] & sequenceMask], vertices + 4 * i);
+	}
+	writeIndices(spriteCount);
+
+	VkBuffer vertexBuffer = vertexStream.getBuffer(frameIndex);
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, indexStream.getBuffer(frameIndex), 0, VK_INDEX_TYPE_UINT32);
+
+	// Maps pixels from the top left onto clip space, then turns that as the swapchain is turned
+	glm::mat2 turn = getQuarterTurn(quarterTurns);
+	glm::mat2 linear = turn * glm::mat2(2.0f / extent.width, 0.0f, 0.0f, 2.0f / extent.height);
+	glm::vec2 origin = turn * glm::vec2(-1.0f, -1.0f);
+	float transform[6] = {
+			linear[0][0], linear[0][1], linear[1][0], linear[1][1],
+			origin.x, origin.y};
+	vkCmdPushConstants(commandBuffer, pipelineLayout, pushConstantStages, 0, sizeof(transform),
+			transform);
+	resources->bindFrame(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, TEXTURE_SET);
+
+	// Runs only break on pipeline and texture, so equal neighbours in different layers still merge
+	auto batchOf = [](uint64_t key) {
+		return static_cast<uint32_t>(key >> SEQUENCE_BITS);
+	};
+
+	int boundPipeline = -1;
+	uint32_t boundTexture = BindlessResources::NONE;
+	uint32_t runStart = 0;
+	for(uint32_t i = 1; i <= spriteCount; i++) {
+		if(i < spriteCount && batchOf(sortKeys[i]) == batchOf(sortKeys[runStart])) {
+			continue;
+		}
+
+		const Sprite& first = sprites[sortKeys[runStart] & sequenceMask];
+		if(first.pipeline != boundPipeline) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+					pipelines[first.pipeline]);
+			boundPipeline = first.pipeline;
+		}
+		if(first.texture != boundTexture) {
+			if(resources->isBindless()) {
+				vkCmdPushConstants(commandBuffer, pipelineLayout, pushConstantStages,
+						sizeof(transform), sizeof(first.texture), &first.texture);
+			}
+			resources->bindMaterial(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+					TEXTURE_SET, first.texture, BindlessResources::NONE);
+			boundTexture = first.texture;
+		}
+
+		vkCmdDrawIndexed(commandBuffer, 6 * (i - runStart), 1, 6 * runStart, 0, 0);
+		drawCount++;
+		runStart = i;
+	}
+}
+
+void SpriteBatcher::collectDamage(std::vector<VkRect2D>& rects) const {
+	size_t count = std::max(sprites.size(), previousSprites.size());
+	for(size_t i = 0; i < count; i++) {
+		bool current = i < sprites.size();
+		bool previous = i < previousSprites.size();
+		if(current && previous && isSameSprite(sprites[i], previousSprites[i])) {
+			continue;
+		}
+		if(current) {
+			rects.push_back(getBounds(sprites[i]));
+		}
+		if(previous) {
+			rects.push_back(getBounds(previousSprites[i]));
+		}
+	}
+}
+
+uint32_t SpriteBatcher::getSpriteCount() const {
+	return static_cast<uint32_t>(sprites.size());
+}
+
+uint32_t SpriteBatcher::getDrawCount() const {
+	return drawCount;
+}
+
+void SpriteBatcher::writeIndices(uint32_t quadCount) {
+	uint32_t previousCapacity = indexStream.getCapacity(frameIndex);
+	uint32_t* indices = indexStream.map<uint32_t>(frameIndex, quadCount);
+
+	// Replacing the buffer lost its contents; otherwise the existing pattern is still valid
+	uint32_t capacity = indexStream.getCapacity(frameIndex);
+	if(capacity != previousCapacity) {
+		indexedQuads[frameIndex] = 0;
+	}
+
+	for(uint32_t quad = indexedQuads[frameIndex]; quad < capacity; quad++) {
+		uint32_t* quadIndices = indices + 6 * quad;
+		uint32_t base = 4 * quad;
+		quadIndices[0] = base;
+		quadIndices[1] = base + 1;
+		quadIndices[2] = base + 2;
+		quadIndices[3] = base + 2;
+		quadIndices[4] = base + 3;
+		quadIndices[5] = base;
+	}
+	indexedQuads[frameIndex] = capacity;
+}
+
+void SpriteBatcher::writeQuad(const Sprite& sprite, SpriteVertex* vertices) {
+	glm::vec2 minimum = sprite.position;
+	glm::vec2 maximum = sprite.position + sprite.size;
+	Unorm4x8 color(sprite.color);
+
+	vertices[0].position = minimum;
+	vertices[0].uv = Half2(sprite.uvRect.x, sprite.uvRect.y);
+	vertices[0].color = color;
+
+	vertices[1].position = glm::vec2(maximum.x, minimum.y);
+	vertices[1].uv = Half2(sprite.uvRect.z, sprite.uvRect.y);
+	vertices[1].color = color;
+
+	vertices[2].position = maximum;
+	vertices[2].uv = Half2(sprite.uvRect.z, sprite.uvRect.w);
+	vertices[2].color = color;
+
+	vertices[3].position = glm::vec2(minimum.x, maximum.y);
+	vertices[3].uv = Half2(sprite.uvRect.x, sprite.uvRect.w);
+	vertices[3].color = color;
+}
+
+bool SpriteBatcher::isSameSprite(const Sprite& first, const Sprite& second) {
+	return first.position == second.position && first.size == second.size &&
+			first.uvRect == second.uvRect && first.color == second.color &&
+			first.texture == second.texture && first.pipeline == second.pipeline &&
+			first.layer == second.layer;
+}
+
+// A pixel wider on each side, for filtering and rasterization rounding at the edges
+VkRect2D SpriteBatcher::getBounds(const Sprite& sprite) {
+	glm::vec2 corner = sprite.position + sprite.size;
+	glm::vec2 low = glm::floor(glm::min(sprite.position, corner)) - 1.0f;
+	glm::vec2 high = glm::ceil(glm::max(sprite.position, corner)) + 1.0f;
+
+	VkRect2D bounds = {};
+	bounds.offset = {static_cast<int32_t>(low.x), static_cast<int32_t>(low.y)};
+	bounds.extent = {static_cast<uint32_t>(high.x - low.x), static_cast<uint32_t>(high.y - low.y)};
+	return bounds;
+}
@@ -0,0 +1,112 @@
+#ifndef SPRITE_BATCHER_H
+#define SPRITE_BATCHER_H
+
+#include "vulkan_wrapper/vulkan_wrapper.h"
+#include "VertexLayout.h"
+#include "InstanceStream.h"
+#include "BindlessResources.h"
+#include "RadixSort.h"
+
+#include <vector>
+
+/** 16 bytes per corner: pixel position, half float texture coordinates and 8-bit color. */
+struct SpriteVertex {
+	glm::vec2 position;
+	Half2 uv;
+	Unorm4x8 color;
+
+	typedef VertexLayout<
+			VertexAttribute<0, glm::vec2>,
+			VertexAttribute<1, Half2>,
+			VertexAttribute<2, Unorm4x8>> Layout;
+};
+ASSERT_VERTEX_LAYOUT(SpriteVertex);
+ASSERT_VERTEX_ATTRIBUTE_OFFSET(SpriteVertex, position, 0);
+ASSERT_VERTEX_ATTRIBUTE_OFFSET(SpriteVertex, uv, 1);
+ASSERT_VERTEX_ATTRIBUTE_OFFSET(SpriteVertex, color, 2);
+
+struct Sprite {
+	/** Top left corner and size, in pixels from the top left of the render area. */
+	glm::vec2 position;
+	glm::vec2 size;
+	glm::vec4 uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	glm::vec4 color = glm::vec4(1.0f);
+
+	/** An image index from BindlessResources. */
+	uint32_t texture = 0;
+
+	/** An index returned by SpriteBatcher::addPipeline. */
+	uint8_t pipeline = 0;
+
+	/** Layers are drawn in increasing order. Within a layer, sprites are reordered to batch. */
+	uint8_t layer = 0;
+};
+
+/**
+ * Collects sprites over a frame and draws them in as few calls as possible. Sprites are sorted by
+ * layer, pipeline and texture, keeping submission order among equals, then written into the
+ * frame's vertex buffer so each run sharing a pipeline and texture becomes one indexed draw.
+ * Quad indices never change, so each frame's index buffer is only rewritten when it grows.
+ *
+ * Sprite pipelines use the layout in sprite.vert: a pixel-to-clip transform, a mat2 and then an
+ * offset, at push constant offset 0, the texture index at offset 24 when bindless, and
+ * BindlessResources at set 0. All storage is reused between frames, so once the high-water mark
+ * is reached nothing is allocated.
+ */
+class SpriteBatcher {
+	public:
+		static const uint32_t TEXTURE_SET = 0;
+
+		void initialize(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties,
+				uint32_t framesInFlight, uint32_t initialCapacity, BindlessResources* resources);
+		void destroy();
+
+		/** Pipelines must be re-added whenever they're recreated, after clearPipelines. */
+		uint8_t addPipeline(VkPipeline pipeline);
+		void clearPipelines();
+
+		void begin(uint32_t frameIndex);
+		void draw(const Sprite& sprite);
+
+		/**
+		 * Records the frame's sprites into a render pass that's already begun. Sprites are placed
+		 * in pixels of the extent as seen on screen, and turned by quarter turns to match a
+		 * pre-rotated swapchain.
+		 */
+		void flush(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout,
+				VkShaderStageFlags pushConstantStages, VkExtent2D extent, uint32_t quarterTurns = 0);
+
+		/**
+		 * Appends where this frame's sprites differ from the last frame's, in pixels of the extent
+		 * as seen on screen: the old and new bounds of every sprite that changed, appeared or went
+		 * away, compared in submission order.
+		 */
+		void collectDamage(std::vector<VkRect2D>& rects) const;
+
+		uint32_t getSpriteCount() const;
+		uint32_t getDrawCount() const;
+
+	private:
+		static const uint32_t SEQUENCE_BITS = 24;
+		static const uint32_t TEXTURE_BITS = 24;
+
+		BindlessResources* resources = nullptr;
+		InstanceStream vertexStream;
+		InstanceStream indexStream;
+		std::vector<uint32_t> indexedQuads;
+		std::vector<VkPipeline> pipelines;
+
+		uint32_t frameIndex = 0;
+		std::vector<Sprite> sprites;
+		std::vector<Sprite> previousSprites;
+		std::vector<uint64_t> sortKeys;
+		RadixSorter sorter;
+		uint32_t drawCount = 0;
+
+		void writeIndices(uint32_t quadCount);
+		static void writeQuad(const Sprite& sprite, SpriteVertex* vertices);
+		static bool isSameSprite(const Sprite& first, const Sprite& second);
+		static VkRect2D getBounds(const Sprite& sprite);
+};
+
+#endif
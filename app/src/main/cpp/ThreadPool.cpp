@@ -0,0 +1,92 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+uint32_t ThreadPool::getDefaultWorkerCount() {
+	uint32_t hardwareThreads = std::thread::hardware_concurrency();
+	return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+ThreadPool::ThreadPool(uint32_t workerCount) : nextIndex(0) {
+	for(uint32_t i = 0; i < workerCount; i++) {
+		workers.emplace_back(&ThreadPool::runWorker, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+	for(std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+uint32_t ThreadPool::getThreadCount() const {
+	return static_cast<uint32_t>(workers.size()) + 1;
+}
+
+void ThreadPool::parallelFor(uint32_t count, uint32_t minimumBatch,
+		const std::function<void(uint32_t, uint32_t)>& body) {
+	if(count == 0) {
+		return;
+	}
+
+	// A few batches per thread evens out threads that start late or run slower cores
+	uint32_t threadCount = getThreadCount();
+	uint32_t batchSize = std::max(std::max(minimumBatch, 1u), (count + threadCount * 4 - 1) / (threadCount * 4));
+	if(workers.empty() || batchSize >= count) {
+		body(0, count);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->body = &body;
+		this->count = count;
+		this->batchSize = batchSize;
+		nextIndex.store(0, std::memory_order_relaxed);
+		busyWorkers = static_cast<uint32_t>(workers.size());
+		generation++;
+	}
+	workAvailable.notify_all();
+
+	runBatches();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	workFinished.wait(lock, [this]() { return busyWorkers == 0; });
+	this->body = nullptr;
+}
+
+void ThreadPool::runWorker() {
+	uint64_t seenGeneration = 0;
+	while(true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workAvailable.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+			if(stopping) {
+				return;
+			}
+			seenGeneration = generation;
+		}
+
+		runBatches();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if(--busyWorkers == 0) {
+			workFinished.notify_one();
+		}
+	}
+}
+
+void ThreadPool::runBatches() {
+	while(true) {
+		uint32_t begin = nextIndex.fetch_add(batchSize, std::memory_order_relaxed);
+		if(begin >= count) {
+			return;
+		}
+		(*body)(begin, std::min(begin + batchSize, count));
+	}
+}
@@ -0,0 +1,57 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Persistent worker threads for splitting loops over large arrays. parallelFor blocks until the
+ * whole range is done, with the calling thread working alongside the pool, so it can be used from
+ * the frame loop like an ordinary loop. One parallelFor runs at a time.
+ */
+class ThreadPool {
+	public:
+		/** Workers besides the calling thread; by default one fewer than the hardware threads. */
+		explicit ThreadPool(uint32_t workerCount = getDefaultWorkerCount());
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		static uint32_t getDefaultWorkerCount();
+
+		/** The number of threads a parallelFor can run on, counting the caller. */
+		uint32_t getThreadCount() const;
+
+		/**
+		 * Calls body(begin, end) over disjoint ranges covering [0, count). Ranges hold at least
+		 * minimumBatch items, so small loops stay on the calling thread.
+		 */
+		void parallelFor(uint32_t count, uint32_t minimumBatch,
+				const std::function<void(uint32_t, uint32_t)>& body);
+
+	private:
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable workAvailable;
+		std::condition_variable workFinished;
+		bool stopping = false;
+
+		// The current loop, guarded by mutex except for the atomics
+		const std::function<void(uint32_t, uint32_t)>* body = nullptr;
+		uint32_t count = 0;
+		uint32_t batchSize = 0;
+		uint64_t generation = 0;
+		uint32_t busyWorkers = 0;
+		std::atomic<uint32_t> nextIndex;
+
+		void runWorker();
+		void runBatches();
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include "TransformBenchmark.h"
+
+#include "AndroidLogging.h"
+#include "TimeUtils.h"
+#include "TransformHierarchy.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <random>
+
+namespace {
+	const uint32_t ROOT_COUNT = 100;
+
+	/** The world matrix rebuilt from scratch by walking up to the root. */
+	glm::mat4 computeReferenceWorld(const TransformHierarchy& hierarchy, uint32_t node) {
+		glm::mat4 world(1.0f);
+		for(uint32_t current = node; current != TransformHierarchy::NONE;
+				current = hierarchy.getParent(current)) {
+			glm::mat4 local = glm::translate(glm::mat4(1.0f), hierarchy.getPosition(current)) *
+					glm::mat4_cast(hierarchy.getRotation(current)) *
+					glm::scale(glm::mat4(1.0f), hierarchy.getScale(current));
+			world = local * world;
+		}
+		return world;
+	}
+}
+
+void runTransformBenchmark(uint32_t nodeCount, uint32_t iterations) {
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> angle(0.0f, glm::radians(360.0f));
+
+	// Every node past the roots hangs off a random earlier one, giving trees a few dozen deep
+	TransformHierarchy hierarchy;
+	std::vector<uint32_t> nodes;
+	for(uint32_t i = 0; i < nodeCount; i++) {
+		uint32_t parent = i < ROOT_COUNT ? TransformHierarchy::NONE :
+				nodes[std::uniform_int_distribution<uint32_t>(0, i - 1)(random)];
+		uint32_t node = hierarchy.create(parent);
+		hierarchy.setLocal(node, glm::vec3(offset(random), offset(random), offset(random)),
+				glm::angleAxis(angle(random), glm::normalize(glm::vec3(offset(random), offset(random), 1.0f))),
+				glm::vec3(0.99f));
+		nodes.push_back(node);
+	}
+	hierarchy.update();
+
+	const float fractions[] = {0.01f, 0.1f, 1.0f};
+	double milliseconds[3];
+	uint32_t updated[3];
+	for(int f = 0; f < 3; f++) {
+		uint32_t changeCount = static_cast<uint32_t>(nodeCount * fractions[f]);
+		for(uint32_t i = 0; i < iterations; i++) {
+			std::shuffle(nodes.begin(), nodes.end(), random);
+			for(uint32_t n = 0; n < changeCount; n++) {
+				hierarchy.setRotation(nodes[n], glm::angleAxis(angle(random), glm::vec3(0.0f, 0.0f, 1.0f)));
+			}
+
+			TimePoint start = now();
+			uint32_t count = hierarchy.update();
+			double elapsed = secondsBetween(start, now()) * 1e3;
+			if(i == 0 || elapsed < milliseconds[f]) {
+				milliseconds[f] = elapsed;
+				updated[f] = count;
+			}
+		}
+	}
+
+	double allMilliseconds = 0.0;
+	for(uint32_t i = 0; i < iterations; i++) {
+		TimePoint start = now();
+		hierarchy.updateAll();
+		double elapsed = secondsBetween(start, now()) * 1e3;
+		if(i == 0 || elapsed < allMilliseconds) {
+			allMilliseconds = elapsed;
+		}
+	}
+
+	float maximumError = 0.0f;
+	for(uint32_t n = 0; n < nodeCount; n += 97) {
+		glm::mat4 expected = computeReferenceWorld(hierarchy, nodes[n]);
+		const glm::mat4& actual = hierarchy.getWorld(nodes[n]);
+		for(int c = 0; c < 4; c++) {
+			glm::vec4 difference = glm::abs(expected[c] - actual[c]);
+			maximumError = std::max(maximumError, std::max(std::max(difference.x, difference.y),
+					std::max(difference.z, difference.w)));
+		}
+	}
+	if(maximumError > 1e-3f) {
+		LOG_WARN("Transform benchmark: world matrices differ from glm by up to %f.", maximumError);
+	}
+
+	LOG_INFO("Transform benchmark: %u nodes, %s", nodeCount, TransformHierarchy::getInstructionSet());
+	LOG_INFO("%10s %10s %10s", "changed", "updated", "ms");
+	for(int f = 0; f < 3; f++) {
+		LOG_INFO("%9.0f%% %10u %10.3f", fractions[f] * 100.0f, updated[f], milliseconds[f]);
+	}
+	LOG_INFO("%10s %10u %10.3f", "all", nodeCount, allMilliseconds);
+}
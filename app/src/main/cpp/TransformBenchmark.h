@@ -0,0 +1,13 @@
+#ifndef TRANSFORM_BENCHMARK_H
+#define TRANSFORM_BENCHMARK_H
+
+#include <cstdint>
+
+/**
+ * Times TransformHierarchy::update on a random tree with 1%, 10% and 100% of nodes changed each
+ * time, against recomputing everything, and checks the results against plain glm. Blocks for
+ * about a second.
+ */
+void runTransformBenchmark(uint32_t nodeCount = 100000, uint32_t iterations = 20);
+
+#endif
@@ -0,0 +1,328 @@
+#include "TransformHierarchy.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define TRANSFORM_HIERARCHY_NEON
+#elif defined(__SSE2__) || defined(_M_X64)
+	#include <emmintrin.h>
+	#define TRANSFORM_HIERARCHY_SSE2
+#endif
+
+const uint32_t TransformHierarchy::NONE;
+
+namespace {
+	/**
+	 * parent * local, where local is affine so its bottom row is (0, 0, 0, 1). Each result column is
+	 * a sum of parent columns weighted by the local column, four floats at a time.
+	 */
+	inline void multiplyAffine(const glm::mat4& parent, const glm::mat4& local, glm::mat4& result) {
+		const float* p = &parent[0][0];
+		const float* l = &local[0][0];
+		float* r = &result[0][0];
+
+#if defined(TRANSFORM_HIERARCHY_NEON)
+		float32x4_t p0 = vld1q_f32(p);
+		float32x4_t p1 = vld1q_f32(p + 4);
+		float32x4_t p2 = vld1q_f32(p + 8);
+		float32x4_t p3 = vld1q_f32(p + 12);
+		for(int c = 0; c < 3; c++) {
+			float32x4_t column = vmulq_n_f32(p0, l[4 * c]);
+			column = vmlaq_n_f32(column, p1, l[4 * c + 1]);
+			column = vmlaq_n_f32(column, p2, l[4 * c + 2]);
+			vst1q_f32(r + 4 * c, column);
+		}
+		float32x4_t translation = vmlaq_n_f32(p3, p0, l[12]);
+		translation = vmlaq_n_f32(translation, p1, l[13]);
+		translation = vmlaq_n_f32(translation, p2, l[14]);
+		vst1q_f32(r + 12, translation);
+#elif defined(TRANSFORM_HIERARCHY_SSE2)
+		__m128 p0 = _mm_loadu_ps(p);
+		__m128 p1 = _mm_loadu_ps(p + 4);
+		__m128 p2 = _mm_loadu_ps(p + 8);
+		__m128 p3 = _mm_loadu_ps(p + 12);
+		for(int c = 0; c < 3; c++) {
+			__m128 column = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(p0, _mm_set1_ps(l[4 * c])), _mm_mul_ps(p1, _mm_set1_ps(l[4 * c + 1]))),
+					_mm_mul_ps(p2, _mm_set1_ps(l[4 * c + 2])));
+			_mm_storeu_ps(r + 4 * c, column);
+		}
+		__m128 translation = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(p0, _mm_set1_ps(l[12])), _mm_mul_ps(p1, _mm_set1_ps(l[13]))),
+				_mm_add_ps(_mm_mul_ps(p2, _mm_set1_ps(l[14])), p3));
+		_mm_storeu_ps(r + 12, translation);
+#else
+		result = parent * local;
+		(void) p;
+		(void) l;
+		(void) r;
+#endif
+	}
+}
+
+const char* TransformHierarchy::getInstructionSet() {
+#if defined(TRANSFORM_HIERARCHY_NEON)
+	return "NEON";
+#elif defined(TRANSFORM_HIERARCHY_SSE2)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+uint32_t TransformHierarchy::create(uint32_t parent) {
+	uint32_t node;
+	if(freeHandles.empty()) {
+		node = static_cast<uint32_t>(links.size());
+		links.emplace_back();
+	} else {
+		node = freeHandles.back();
+		freeHandles.pop_back();
+		links[node] = Links();
+	}
+	links[node].alive = true;
+	aliveCount++;
+
+	// New nodes go at the end, after their parents, until the next reorder moves them into place
+	uint32_t slot = static_cast<uint32_t>(handles.size());
+	links[node].slot = slot;
+	positions.push_back(glm::vec3(0.0f));
+	rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+	scales.push_back(glm::vec3(1.0f));
+	worlds.push_back(glm::mat4(1.0f));
+	parentSlots.push_back(parent == NONE ? NONE : links[parent].slot);
+	subtreeSizes.push_back(1);
+	dirty.push_back(1);
+	handles.push_back(node);
+
+	link(node, parent);
+	reorderNeeded = true;
+	return node;
+}
+
+void TransformHierarchy::destroy(uint32_t node) {
+	unlink(node);
+
+	std::vector<uint32_t> stack = {node};
+	while(!stack.empty()) {
+		uint32_t current = stack.back();
+		stack.pop_back();
+		for(uint32_t child = links[current].firstChild; child != NONE; child = links[child].nextSibling) {
+			stack.push_back(child);
+		}
+		links[current].alive = false;
+		freeHandles.push_back(current);
+		aliveCount--;
+	}
+
+	reorderNeeded = true;
+}
+
+void TransformHierarchy::setParent(uint32_t node, uint32_t parent) {
+	for(uint32_t ancestor = parent; ancestor != NONE; ancestor = links[ancestor].parent) {
+		if(ancestor == node) {
+			throw std::runtime_error("A transform can't be parented under itself.");
+		}
+	}
+
+	unlink(node);
+	link(node, parent);
+	markDirty(node);
+	reorderNeeded = true;
+}
+
+uint32_t TransformHierarchy::getParent(uint32_t node) const {
+	return links[node].parent;
+}
+
+void TransformHierarchy::setLocal(uint32_t node, const glm::vec3& position,
+		const glm::quat& rotation, const glm::vec3& scale) {
+	uint32_t slot = links[node].slot;
+	positions[slot] = position;
+	rotations[slot] = rotation;
+	scales[slot] = scale;
+	dirty[slot] = 1;
+}
+
+void TransformHierarchy::setPosition(uint32_t node, const glm::vec3& position) {
+	positions[links[node].slot] = position;
+	markDirty(node);
+}
+
+void TransformHierarchy::setRotation(uint32_t node, const glm::quat& rotation) {
+	rotations[links[node].slot] = rotation;
+	markDirty(node);
+}
+
+void TransformHierarchy::setScale(uint32_t node, const glm::vec3& scale) {
+	scales[links[node].slot] = scale;
+	markDirty(node);
+}
+
+const glm::vec3& TransformHierarchy::getPosition(uint32_t node) const {
+	return positions[links[node].slot];
+}
+
+const glm::quat& TransformHierarchy::getRotation(uint32_t node) const {
+	return rotations[links[node].slot];
+}
+
+const glm::vec3& TransformHierarchy::getScale(uint32_t node) const {
+	return scales[links[node].slot];
+}
+
+const glm::mat4& TransformHierarchy::getWorld(uint32_t node) const {
+	return worlds[links[node].slot];
+}
+
+uint32_t TransformHierarchy::update() {
+	if(reorderNeeded) {
+		reorder();
+	}
+
+	// A dirty node takes its whole subtree with it, so the sweep then jumps past the subtree
+	uint32_t count = static_cast<uint32_t>(handles.size());
+	uint32_t updated = 0;
+	uint32_t slot = 0;
+	while(slot < count) {
+		if(dirty[slot]) {
+			uint32_t end = slot + subtreeSizes[slot];
+			updateRange(slot, end);
+			updated += end - slot;
+			slot = end;
+		} else {
+			slot++;
+		}
+	}
+	return updated;
+}
+
+void TransformHierarchy::updateAll() {
+	if(reorderNeeded) {
+		reorder();
+	}
+	updateRange(0, static_cast<uint32_t>(handles.size()));
+}
+
+uint32_t TransformHierarchy::size() const {
+	return aliveCount;
+}
+
+void TransformHierarchy::link(uint32_t node, uint32_t parent) {
+	Links& nodeLinks = links[node];
+	nodeLinks.parent = parent;
+	nodeLinks.previousSibling = NONE;
+
+	uint32_t& first = parent == NONE ? firstRoot : links[parent].firstChild;
+	nodeLinks.nextSibling = first;
+	if(first != NONE) {
+		links[first].previousSibling = node;
+	}
+	first = node;
+}
+
+void TransformHierarchy::unlink(uint32_t node) {
+	Links& nodeLinks = links[node];
+	if(nodeLinks.previousSibling != NONE) {
+		links[nodeLinks.previousSibling].nextSibling = nodeLinks.nextSibling;
+	} else if(nodeLinks.parent != NONE) {
+		links[nodeLinks.parent].firstChild = nodeLinks.nextSibling;
+	} else {
+		firstRoot = nodeLinks.nextSibling;
+	}
+
+	if(nodeLinks.nextSibling != NONE) {
+		links[nodeLinks.nextSibling].previousSibling = nodeLinks.previousSibling;
+	}
+
+	nodeLinks.parent = NONE;
+	nodeLinks.nextSibling = NONE;
+	nodeLinks.previousSibling = NONE;
+}
+
+void TransformHierarchy::markDirty(uint32_t node) {
+	dirty[links[node].slot] = 1;
+}
+
+void TransformHierarchy::reorder() {
+	std::vector<glm::vec3> newPositions;
+	std::vector<glm::quat> newRotations;
+	std::vector<glm::vec3> newScales;
+	std::vector<glm::mat4> newWorlds;
+	std::vector<uint8_t> newDirty;
+	std::vector<uint32_t> newHandles;
+	newPositions.reserve(aliveCount);
+	newRotations.reserve(aliveCount);
+	newScales.reserve(aliveCount);
+	newWorlds.reserve(aliveCount);
+	newDirty.reserve(aliveCount);
+	newHandles.reserve(aliveCount);
+	parentSlots.resize(aliveCount);
+	subtreeSizes.assign(aliveCount, 1);
+
+	// Depth first from a stack: a node's subtree is finished before anything beneath it on the stack
+	std::vector<uint32_t> stack;
+	for(uint32_t root = firstRoot; root != NONE; root = links[root].nextSibling) {
+		stack.push_back(root);
+	}
+	while(!stack.empty()) {
+		uint32_t node = stack.back();
+		stack.pop_back();
+
+		uint32_t oldSlot = links[node].slot;
+		uint32_t slot = static_cast<uint32_t>(newHandles.size());
+		newPositions.push_back(positions[oldSlot]);
+		newRotations.push_back(rotations[oldSlot]);
+		newScales.push_back(scales[oldSlot]);
+		newWorlds.push_back(worlds[oldSlot]);
+		newDirty.push_back(dirty[oldSlot]);
+		newHandles.push_back(node);
+		links[node].slot = slot;
+
+		uint32_t parent = links[node].parent;
+		parentSlots[slot] = parent == NONE ? NONE : links[parent].slot;
+
+		for(uint32_t child = links[node].firstChild; child != NONE; child = links[child].nextSibling) {
+			stack.push_back(child);
+		}
+	}
+
+	// Parents come first, so one backwards pass totals every subtree
+	for(uint32_t slot = aliveCount; slot-- > 0;) {
+		if(parentSlots[slot] != NONE) {
+			subtreeSizes[parentSlots[slot]] += subtreeSizes[slot];
+		}
+	}
+
+	positions.swap(newPositions);
+	rotations.swap(newRotations);
+	scales.swap(newScales);
+	worlds.swap(newWorlds);
+	dirty.swap(newDirty);
+	handles.swap(newHandles);
+	reorderNeeded = false;
+}
+
+void TransformHierarchy::updateRange(uint32_t begin, uint32_t end) {
+	memset(&dirty[begin], 0, end - begin);
+
+	for(uint32_t slot = begin; slot < end; slot++) {
+		glm::mat3 rotation = glm::mat3_cast(rotations[slot]);
+		const glm::vec3& scale = scales[slot];
+		glm::mat4 local(
+				glm::vec4(rotation[0] * scale.x, 0.0f),
+				glm::vec4(rotation[1] * scale.y, 0.0f),
+				glm::vec4(rotation[2] * scale.z, 0.0f),
+				glm::vec4(positions[slot], 1.0f));
+
+		// Parents precede their children, so a parent's world matrix is always current here
+		uint32_t parent = parentSlots[slot];
+		if(parent == NONE) {
+			worlds[slot] = local;
+		} else {
+			multiplyAffine(worlds[parent], local, worlds[slot]);
+		}
+	}
+}
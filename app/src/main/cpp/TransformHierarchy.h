@@ -0,0 +1,90 @@
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Parent/child transforms, each a local translation, rotation and scale, resolved into world
+ * matrices by update. Nodes are addressed by handles that stay valid until destroyed.
+ *
+ * Each attribute has its own array, ordered depth first so every subtree is a contiguous run
+ * after its root. update sweeps the dirty flags and recomputes only the runs under changed nodes,
+ * parents before children, multiplying by the parent's world matrix with NEON or SSE. Structural
+ * changes reorder the arrays once, at the next update.
+ */
+class TransformHierarchy {
+	public:
+		static const uint32_t NONE = static_cast<uint32_t>(-1);
+
+		/** The SIMD instruction set update uses on this build: "NEON", "SSE2" or "scalar". */
+		static const char* getInstructionSet();
+
+		/** Creates an identity node under the parent, or a root. */
+		uint32_t create(uint32_t parent = NONE);
+
+		/** Destroys the node and everything under it. */
+		void destroy(uint32_t node);
+
+		void setParent(uint32_t node, uint32_t parent);
+		uint32_t getParent(uint32_t node) const;
+
+		void setLocal(uint32_t node, const glm::vec3& position, const glm::quat& rotation,
+				const glm::vec3& scale);
+		void setPosition(uint32_t node, const glm::vec3& position);
+		void setRotation(uint32_t node, const glm::quat& rotation);
+		void setScale(uint32_t node, const glm::vec3& scale);
+
+		const glm::vec3& getPosition(uint32_t node) const;
+		const glm::quat& getRotation(uint32_t node) const;
+		const glm::vec3& getScale(uint32_t node) const;
+
+		/** The world matrix as of the last update. */
+		const glm::mat4& getWorld(uint32_t node) const;
+
+		/** Recomputes the world matrices of changed nodes and their descendants; returns how many. */
+		uint32_t update();
+
+		/** Recomputes every world matrix, for reference and benchmarking. */
+		void updateAll();
+
+		uint32_t size() const;
+
+	private:
+		/** Per handle: the links between nodes, which only change structurally. */
+		struct Links {
+			uint32_t parent = NONE;
+			uint32_t firstChild = NONE;
+			uint32_t nextSibling = NONE;
+			uint32_t previousSibling = NONE;
+			uint32_t slot = NONE;
+			bool alive = false;
+		};
+
+		std::vector<Links> links;
+		std::vector<uint32_t> freeHandles;
+		uint32_t firstRoot = NONE;
+		uint32_t aliveCount = 0;
+		bool reorderNeeded = false;
+
+		// Per slot, in depth-first order
+		std::vector<glm::vec3> positions;
+		std::vector<glm::quat> rotations;
+		std::vector<glm::vec3> scales;
+		std::vector<glm::mat4> worlds;
+		std::vector<uint32_t> parentSlots;
+		std::vector<uint32_t> subtreeSizes;
+		std::vector<uint8_t> dirty;
+		std::vector<uint32_t> handles;
+
+		void link(uint32_t node, uint32_t parent);
+		void unlink(uint32_t node);
+		void markDirty(uint32_t node);
+		void reorder();
+		void updateRange(uint32_t begin, uint32_t end);
+};
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include "vulkan_wrapper/vulkan_wrapper.h"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "glm/glm.hpp"
+#include "glm/gtc/packing.hpp"
+
+/**
+ * Maps a C++ attribute type to the VkFormat the vertex fetch unit should decode it as. Every type
+ * used in a VertexLayout needs a specialization, so an attribute without a matching format fails to
+ * compile rather than being silently misread by the GPU.
+ */
+template<typename T> struct VertexFormat;
+
+#define DECLARE_VERTEX_FORMAT(type, vkFormat) \
+	template<> struct VertexFormat<type> { \
+		static constexpr VkFormat value = vkFormat; \
+	};
+
+DECLARE_VERTEX_FORMAT(float, VK_FORMAT_R32_SFLOAT)
+DECLARE_VERTEX_FORMAT(glm::vec2, VK_FORMAT_R32G32_SFLOAT)
+DECLARE_VERTEX_FORMAT(glm::vec3, VK_FORMAT_R32G32B32_SFLOAT)
+DECLARE_VERTEX_FORMAT(glm::vec4, VK_FORMAT_R32G32B32A32_SFLOAT)
+
+/** Two half floats, fetched as VK_FORMAT_R16G16_SFLOAT. Good for positions and texture coordinates
+ * within a few thousand units of the origin. */
+struct Half2 {
+	uint32_t packed;
+
+	Half2() : packed(0) {}
+	Half2(float x, float y) : packed(glm::packHalf2x16(glm::vec2(x, y))) {}
+	Half2(const glm::vec2& value) : packed(glm::packHalf2x16(value)) {}
+
+	glm::vec2 unpack() const { return glm::unpackHalf2x16(packed); }
+};
+DECLARE_VERTEX_FORMAT(Half2, VK_FORMAT_R16G16_SFLOAT)
+
+/** Four half floats, fetched as VK_FORMAT_R16G16B16A16_SFLOAT. */
+struct Half4 {
+	uint64_t packed;
+
+	Half4() : packed(0) {}
+	Half4(float x, float y, float z, float w) : packed(glm::packHalf4x16(glm::vec4(x, y, z, w))) {}
+	Half4(const glm::vec4& value) : packed(glm::packHalf4x16(value)) {}
+
+	glm::vec4 unpack() const { return glm::unpackHalf4x16(packed); }
+};
+DECLARE_VERTEX_FORMAT(Half4, VK_FORMAT_R16G16B16A16_SFLOAT)
+
+/** An 8-bit-per-channel color, fetched as VK_FORMAT_R8G8B8A8_UNORM. The shader sees floats in
+ * [0, 1] and may declare the input as a vec3 if it doesn't need alpha. */
+struct Unorm4x8 {
+	uint32_t packed;
+
+	Unorm4x8() : packed(0) {}
+	Unorm4x8(float r, float g, float b, float a = 1.0f) :
+			packed(glm::packUnorm4x8(glm::vec4(r, g, b, a))) {}
+	Unorm4x8(const glm::vec3& color) : packed(glm::packUnorm4x8(glm::vec4(color, 1.0f))) {}
+	Unorm4x8(const glm::vec4& color) : packed(glm::packUnorm4x8(color)) {}
+
+	glm::vec4 unpack() const { return glm::unpackUnorm4x8(packed); }
+};
+DECLARE_VERTEX_FORMAT(Unorm4x8, VK_FORMAT_R8G8B8A8_UNORM)
+
+/** A 10-bit-per-channel color with 2 bits of alpha, fetched as
+ * VK_FORMAT_A2B10G10R10_UNORM_PACK32. */
+struct Unorm1010102 {
+	uint32_t packed;
+
+	Unorm1010102() : packed(0) {}
+	Unorm1010102(float r, float g, float b, float a = 1.0f) :
+			packed(glm::packUnorm3x10_1x2(glm::vec4(r, g, b, a))) {}
+	Unorm1010102(const glm::vec4& value) : packed(glm::packUnorm3x10_1x2(value)) {}
+
+	glm::vec4 unpack() const { return glm::unpackUnorm3x10_1x2(packed); }
+};
+DECLARE_VERTEX_FORMAT(Unorm1010102, VK_FORMAT_A2B10G10R10_UNORM_PACK32)
+
+/** A signed 10-bit-per-channel vector, fetched as VK_FORMAT_A2B10G10R10_SNORM_PACK32. Suited to
+ * tangents, where w can carry the bitangent sign. */
+struct Snorm1010102 {
+	uint32_t packed;
+
+	Snorm1010102() : packed(0) {}
+	Snorm1010102(const glm::vec3& value, float w = 1.0f) :
+			packed(glm::packSnorm3x10_1x2(glm::vec4(value, w))) {}
+
+	glm::vec4 unpack() const { return glm::unpackSnorm3x10_1x2(packed); }
+};
+DECLARE_VERTEX_FORMAT(Snorm1010102, VK_FORMAT_A2B10G10R10_SNORM_PACK32)
+
+/**
+ * A unit vector folded onto an octahedron and stored as two 16-bit signed normalized values,
+ * fetched as VK_FORMAT_R16G16_SNORM. The shader receives the encoded vec2 and unfolds it with:
+ *
+ *     vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+ *     if(n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * sign(n.xy);
+ *     n = normalize(n);
+ */
+struct OctahedralNormal {
+	uint32_t packed;
+
+	OctahedralNormal() : packed(0) {}
+	OctahedralNormal(const glm::vec3& normal) : packed(glm::packSnorm2x16(encode(normal))) {}
+
+	glm::vec3 unpack() const {
+		glm::vec2 encoded = glm::unpackSnorm2x16(packed);
+		glm::vec3 normal(encoded, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+		if(normal.z < 0.0f) {
+			glm::vec2 folded = (1.0f - glm::abs(glm::vec2(normal.y, normal.x))) * signNotZero(encoded);
+			normal.x = folded.x;
+			normal.y = folded.y;
+		}
+
+		return glm::normalize(normal);
+	}
+
+	private:
+		static glm::vec2 signNotZero(const glm::vec2& value) {
+			return glm::vec2(value.x >= 0.0f ? 1.0f : -1.0f, value.y >= 0.0f ? 1.0f : -1.0f);
+		}
+
+		static glm::vec2 encode(const glm::vec3& normal) {
+			glm::vec2 projected = glm::vec2(normal.x, normal.y) /
+					(std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+			if(normal.z < 0.0f) {
+				projected = (1.0f - glm::abs(glm::vec2(projected.y, projected.x))) * signNotZero(projected);
+			}
+
+			return projected;
+		}
+};
+DECLARE_VERTEX_FORMAT(OctahedralNormal, VK_FORMAT_R16G16_SNORM)
+
+#undef DECLARE_VERTEX_FORMAT
+
+/** Binds a shader input location to the C++ type stored for it. */
+template<uint32_t Location, typename T> struct VertexAttribute {
+	static constexpr uint32_t location = Location;
+	static constexpr VkFormat format = VertexFormat<T>::value;
+	static constexpr uint32_t size = sizeof(T);
+
+	typedef T Type;
+};
+
+/**
+ * Describes a tightly packed vertex whose members appear in the same order as the given
+ * attributes. Offsets, stride and formats are all computed at compile time. Pair every layout with
+ * ASSERT_VERTEX_LAYOUT (below) so a reordered or resized member is caught by the compiler instead of
+ * by a garbled mesh.
+ */
+template<typename... Attributes> struct VertexLayout {
+	static constexpr size_t attributeCount = sizeof...(Attributes);
+
+	template<size_t Index> static constexpr uint32_t offsetOf() {
+		return sumSizes<Index>(std::array<uint32_t, attributeCount>{{ Attributes::size... }});
+	}
+
+	static constexpr uint32_t stride() {
+		return sumSizes<attributeCount>(std::array<uint32_t, attributeCount>{{ Attributes::size... }});
+	}
+
+	static VkVertexInputBindingDescription getBindingDescription(uint32_t binding = 0,
+			VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX) {
+		VkVertexInputBindingDescription bindingDescription = {};
+		bindingDescription.binding = binding;
+		bindingDescription.stride = stride();
+		bindingDescription.inputRate = inputRate;
+
+		return bindingDescription;
+	}
+
+	static std::array<VkVertexInputAttributeDescription, attributeCount> getAttributeDescriptions(
+			uint32_t binding = 0) {
+		const uint32_t locations[] = { Attributes::location... };
+		const VkFormat formats[] = { Attributes::format... };
+		const uint32_t sizes[] = { Attributes::size... };
+
+		std::array<VkVertexInputAttributeDescription, attributeCount> attributeDescriptions = {};
+		uint32_t offset = 0;
+		for(size_t i = 0; i < attributeCount; i++) {
+			attributeDescriptions[i].binding = binding;
+			attributeDescriptions[i].location = locations[i];
+			attributeDescriptions[i].format = formats[i];
+			attributeDescriptions[i].offset = offset;
+
+			offset += sizes[i];
+		}
+
+		return attributeDescriptions;
+	}
+
+	private:
+		template<size_t Count> static constexpr uint32_t sumSizes(
+				const std::array<uint32_t, attributeCount>& sizes, size_t index = 0) {
+			return index >= Count ? 0 : sizes[index] + sumSizes<Count>(sizes, index + 1);
+		}
+};
+
+/** Fails compilation if Vertex has padding or members that don't line up with its Layout. */
+#define ASSERT_VERTEX_LAYOUT(Vertex) \
+	static_assert(std::is_standard_layout<Vertex>::value, #Vertex " must be standard layout."); \
+	static_assert(sizeof(Vertex) == Vertex::Layout::stride(), \
+			#Vertex " has padding or members missing from its layout.")
+
+/** Fails compilation if member isn't at the offset the layout computed for the attribute at index. */
+#define ASSERT_VERTEX_ATTRIBUTE_OFFSET(Vertex, member, index) \
+	static_assert(offsetof(Vertex, member) == Vertex::Layout::offsetOf<index>(), \
+			#Vertex "::" #member " is out of order with its layout.")
+
+#endif
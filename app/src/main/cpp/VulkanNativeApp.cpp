@@ -4,9 +4,20 @@
 #include "CapabilityUtils.h"
 #include "MathUtils.h"
 #include "AssetUtils.h"
+#include "ShaderReflection.h"
+#include "MemoryUtils.h"
+#ifdef BENCHMARKS
+#include "Benchmarks.h"
+#endif
 #include <system_error>
+#include <string>
+#include <cstdio>
 #include <set>
 #include <limits>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include <thread>
 
 const std::vector<const char*> INSTANCE_EXTENSION_NAMES = {
 		VK_KHR_SURFACE_EXTENSION_NAME,
@@ -16,6 +27,10 @@ const std::vector<const char*> INSTANCE_EXTENSION_NAMES = {
 const std::vector<const char*> REQUIRED_DEVICE_EXTENSION_NAMES = {
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
+// Upper bounds for the bindless table; the device limits may lower them further
+const uint32_t BINDLESS_IMAGE_CAPACITY = 4096;
+const uint32_t BINDLESS_STORAGE_BUFFER_CAPACITY = 1024;
+
 // At the time of writing, these five layers make up the VK_LAYER_LUNARG_standard_validation
 // meta-layer. According to presentation slides from LunarG, that isn't available in the Android
 // implementation, so this lists them out manuals.
@@ -33,11 +48,144 @@ const std::vector<Vertex> vertices = {
 		{{-0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}}};
 const std::vector<uint16_t> vertexIndices = { 0, 1, 2, 2, 3, 0 };
 
-struct UniformBufferObject {
-    glm::mat4 model;
-    glm::mat4 view;
-    glm::mat4 projection;
+const uint32_t VERTEX_BINDING = 0;
+const uint32_t INSTANCE_BINDING = 1;
+const uint32_t INITIAL_INSTANCE_CAPACITY = 1024;
+const uint32_t INITIAL_SPRITE_CAPACITY = 1024;
+
+// The fewest visible instances worth handing to another thread when copying them out
+const uint32_t INSTANCE_COPY_BATCH = 16384;
+
+// Every scene material draws with the one graphics pipeline for now
+const uint32_t SCENE_PIPELINE = 0;
+
+// Debug builds compare the culling shader with the CPU this often, in frames
+const uint32_t CULLING_VALIDATION_INTERVAL = 120;
+
+// Depth is never stored, so precision matters more than size; float suits reversed depth best
+const std::vector<VkFormat> DEPTH_FORMAT_CANDIDATES = {
+		VK_FORMAT_D32_SFLOAT,
+		VK_FORMAT_X8_D24_UNORM_PACK32,
+		VK_FORMAT_D24_UNORM_S8_UINT,
+		VK_FORMAT_D16_UNORM};
+
+// With a prepass, depth is laid down alone first and the scene shades only what survives
+#ifdef DEPTH_PREPASS
+const bool DEPTH_PREPASS_ENABLED = true;
+#else
+const bool DEPTH_PREPASS_ENABLED = false;
+#endif
+
+// With a tonemap pass, the scene renders into an intermediate the pass reads back in tile memory
+#ifdef TONEMAP_PASS
+const bool TONEMAP_PASS_ENABLED = true;
+#else
+const bool TONEMAP_PASS_ENABLED = false;
+#endif
+
+// With dynamic resolution, the scene renders offscreen at a scale GPU frame times steer, and the
+// upscale pass draws it into the swapchain with sprites on top at native resolution
+#ifdef DYNAMIC_RESOLUTION
+const bool DYNAMIC_RESOLUTION_ENABLED = true;
+#else
+const bool DYNAMIC_RESOLUTION_ENABLED = false;
+#endif
+
+// A 60 Hz frame, less some slack for timing noise and the compositor
+const double DYNAMIC_RESOLUTION_BUDGET_MILLISECONDS = 14.0;
+const float DYNAMIC_RESOLUTION_MIN_SCALE = 0.5f;
+const float DYNAMIC_RESOLUTION_MAX_SCALE = 1.0f;
+
+// With incremental present, each frame renders only the pixels that changed since the swapchain
+// image last held a frame, and presents the rects that changed since the last frame
+#ifdef INCREMENTAL_PRESENT
+const bool INCREMENTAL_PRESENT_ENABLED = true;
+#else
+const bool INCREMENTAL_PRESENT_ENABLED = false;
+#endif
+
+// How long the frame loop sleeps when nothing changed, instead of presenting the same image again
+const uint32_t IDLE_FRAME_MILLISECONDS = 16;
+
+// Tilers resolve in tile memory, where 4x costs little beyond the extra fragment work
+const uint32_t DEFAULT_SAMPLE_COUNT = 4;
+const std::vector<VkSampleCountFlagBits> SELECTABLE_SAMPLE_COUNTS = {
+		VK_SAMPLE_COUNT_4_BIT,
+		VK_SAMPLE_COUNT_2_BIT,
+		VK_SAMPLE_COUNT_1_BIT};
+
+// Switch settings at runtime, for comparing them on one device without rebuilding:
+// "adb shell input keyevent KEYCODE_M" steps MSAA down and wraps around, KEYCODE_P cycles present profiles
+const int32_t SAMPLE_COUNT_KEY = AKEYCODE_M;
+const int32_t PRESENT_PROFILE_KEY = AKEYCODE_P;
+
+// Timestamp queries per frame slot cover this many scopes, one per pass with room to spare
+const uint32_t MAX_PROFILED_SCOPES = 8;
+
+// Debug builds log GPU times per pass, and the frame loop's waits, this often in frames
+const uint32_t PASS_TIMING_REPORT_INTERVAL = 600;
+
+// Vsynced, with a frame in flight to absorb hitches and an image to spare
+const PresentProfile DEFAULT_PRESENT_PROFILE = PresentProfile::SMOOTH;
+
+// Three seconds at 60 Hz: long enough for targets to survive a resolution change and back
+const uint32_t RENDER_TARGET_EVICTION_FRAMES = 180;
+
+#ifdef BENCHMARKS
+const std::vector<glm::vec4> BENCHMARK_SPRITE_COLORS = {
+		{1.0f, 0.3f, 0.3f, 0.5f},
+		{0.3f, 1.0f, 0.3f, 0.5f},
+		{0.3f, 0.3f, 1.0f, 0.5f},
+		{1.0f, 1.0f, 0.3f, 0.5f}};
+#endif
+
+std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() {
+	auto vertexAttributes = Vertex::Layout::getAttributeDescriptions(VERTEX_BINDING);
+	auto instanceAttributes = InstanceData::Layout::getAttributeDescriptions(INSTANCE_BINDING);
+
+	std::vector<VkVertexInputAttributeDescription> attributes(
+			vertexAttributes.begin(), vertexAttributes.end());
+	attributes.insert(attributes.end(), instanceAttributes.begin(), instanceAttributes.end());
+	return attributes;
+}
+
+/**
+ * Per-draw data pushed straight into the command buffer, so transform-only objects need no uniform
+ * buffer writes or descriptor sets. 128 bytes is the smallest maxPushConstantsSize allowed.
+ */
+struct DrawPushConstants {
+	glm::mat4 modelViewProjection;
 };
+static_assert(sizeof(DrawPushConstants) <= 128, "Push constants may not fit on every device.");
+
+// The pixel-to-clip matrix and offset, then the texture index when bindless
+const uint32_t SPRITE_PUSH_CONSTANTS_SIZE = 6 * sizeof(float) + sizeof(uint32_t);
+
+VkCompareOp getDepthCompareOp(Camera::DepthMode depthMode) {
+	return depthMode == Camera::DepthMode::REVERSED ? VK_COMPARE_OP_GREATER : VK_COMPARE_OP_LESS;
+}
+
+float getDepthClearValue(Camera::DepthMode depthMode) {
+	return depthMode == Camera::DepthMode::REVERSED ? 0.0f : 1.0f;
+}
+
+VkExtent2D scaleExtent(VkExtent2D extent, float scale) {
+	VkExtent2D scaled;
+	scaled.width = std::max(1u, static_cast<uint32_t>(std::lround(extent.width * scale)));
+	scaled.height = std::max(1u, static_cast<uint32_t>(std::lround(extent.height * scale)));
+	return scaled;
+}
+
+// Pipelines that draw at the scene's scaled resolution leave the viewport to the command buffer
+// The scissor is the render area, outside which the render pass has to leave pixels alone
+void setViewportAndScissor(VkCommandBuffer commandBuffer, VkExtent2D extent, const VkRect2D& scissor) {
+	VkViewport viewport = {};
+	viewport.width = (float) extent.width;
+	viewport.height = (float) extent.height;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
 
 bool isDebugBuild() {
 	bool debug = false;
@@ -48,10 +196,44 @@ bool isDebugBuild() {
 	return debug;
 }
 
-VulkanNativeApp::VulkanNativeApp(android_app* app) : BaseNativeApp(app), debug(isDebugBuild()) {
+VulkanNativeApp::VulkanNativeApp(android_app* app) : BaseNativeApp(app), debug(isDebugBuild()),
+		scene(threadPool), drawSorter(&threadPool) {
 	InitVulkan();
+	requestedSampleCount = DEFAULT_SAMPLE_COUNT;
+	presentProfile = DEFAULT_PRESENT_PROFILE;
+	requestedPresentProfile = DEFAULT_PRESENT_PROFILE;
+
+	ResolutionSettings resolutionSettings;
+	resolutionSettings.budgetMilliseconds = DYNAMIC_RESOLUTION_BUDGET_MILLISECONDS;
+	resolutionSettings.minScale = DYNAMIC_RESOLUTION_MIN_SCALE;
+	resolutionSettings.maxScale = DYNAMIC_RESOLUTION_MAX_SCALE;
+	resolutionController = ResolutionController(resolutionSettings);
+
+	Aabb quadBounds;
+	for(const Vertex& vertex : vertices) {
+		quadBounds.grow(glm::vec3(vertex.position.unpack(), 0.0f));
+	}
+	quadMesh = scene.addMesh(quadBounds);
+
+	// Scene mesh ids index this table, shared by CPU draws and the culling shader
+	CullMesh quad = {};
+	quad.indexCount = static_cast<uint32_t>(vertexIndices.size());
+	sceneMeshes.push_back(quad);
+
+	modelTransform = transforms.create();
+
+	camera.setLookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	camera.setPerspective(glm::radians(45.0f), 0.1f, 10.0f);
+	camera.setDepthMode(Camera::DepthMode::REVERSED);
+
+#ifdef BENCHMARKS
+	benchmarks.reset(new Benchmarks());
+#endif
 }
 
+// Defined here, where the benchmarks' type is complete
+VulkanNativeApp::~VulkanNativeApp() {}
+
 void VulkanNativeApp::onWindowInitialized() {
 	initializeDisplay();
 }
@@ -74,16 +256,30 @@ void VulkanNativeApp::initializeDisplay() {
 	surface = createSurface(instance);
 
 	deviceInfo = pickPhysicalDevice(surface);
+	if(INCREMENTAL_PRESENT_ENABLED && !deviceInfo.incrementalPresent) {
+		LOG_INFO("Incremental present isn't supported, so only rendering is limited to what changed.");
+	}
 
 	swapchainDetails = {};
-	swapchainDetails.format = pickFormat(deviceInfo.surfaceFormats);
-	swapchainDetails.presentMode = pickPresentMode(deviceInfo.presentModes);
-	surfaceCapabilities = getPhysicalDeviceSurfaceCapabilities(
-			deviceInfo.physicalDevice, deviceInfo.surface);
-	swapchainDetails.swapExtent = pickExtent(surfaceCapabilities);
-	swapchainDetails.imageCount = pickImageCount(surfaceCapabilities);
+	pickColorFormats();
+	updateSurfaceDetails();
+	const PresentPolicy& presentPolicy = getPresentPolicy(presentProfile);
+	swapchainDetails.presentMode = pickPresentMode(presentPolicy, deviceInfo.presentModes);
+	swapchainDetails.imageCount = pickImageCount(presentPolicy, surfaceCapabilities);
+	framesInFlight = presentPolicy.framesInFlight;
+	frameNumber = 0;
+	depthFormat = pickDepthFormat(deviceInfo.physicalDevice, DEPTH_FORMAT_CANDIDATES);
+	VkPhysicalDeviceLimits limits = getPhysicalDeviceProperties(deviceInfo.physicalDevice).limits;
+	supportedSampleCounts = limits.framebufferColorSampleCounts & limits.framebufferDepthSampleCounts;
+	sampleCount = pickSampleCount(requestedSampleCount);
 
 	createLogicalDevice(deviceInfo, device);
+	pipelineLayoutCache.initialize(device);
+	descriptorAllocator.initialize(device, MAX_FRAMES_IN_FLIGHT);
+	renderTargetPool.initialize(device, getPhysicalDeviceMemoryProperties(deviceInfo.physicalDevice),
+			RENDER_TARGET_EVICTION_FRAMES);
+	bindlessResources.initialize(device, deviceInfo.descriptorIndexing, &descriptorAllocator,
+			MAX_FRAMES_IN_FLIGHT, BINDLESS_IMAGE_CAPACITY, BINDLESS_STORAGE_BUFFER_CAPACITY);
 	vkGetDeviceQueue(device, deviceInfo.queueFamilyIndex, 0, &graphicsQueue);
 	vkGetDeviceQueue(device, deviceInfo.presentationFamilyIndex, 0, &presentQueue);
 
@@ -95,23 +291,53 @@ void VulkanNativeApp::initializeDisplay() {
 			surfaceCapabilities);
 
 	createImageViews(swapchainDetails);
-	createRenderPass(swapchainDetails);
-	createDescriptorSetLayout();
-	createGraphicsPipeline(swapchainDetails);
-	createFramebuffers(swapchainDetails);
+	damageTracker.reset(swapchainDetails.swapExtent, static_cast<uint32_t>(swapchainImages.size()));
+	buildFrameGraph(swapchainDetails);
+	createPipelineLayout();
+	createGraphicsPipeline();
+	createSpritePipelineLayout();
+	createSpritePipelines(swapchainDetails);
+	if(TONEMAP_PASS_ENABLED) {
+		createFullscreenPipelineLayout("shaders/tonemap.frag.spv", tonemapPipelineLayout, tonemapSetLayout);
+		tonemapPipeline = createFullscreenPipeline("shaders/tonemap.frag.spv", tonemapPipelineLayout,
+				tonemapPass);
+	}
+	if(DYNAMIC_RESOLUTION_ENABLED) {
+		createFullscreenPipelineLayout("shaders/upscale.frag.spv", upscalePipelineLayout, upscaleSetLayout);
+		upscalePipeline = createFullscreenPipeline("shaders/upscale.frag.spv", upscalePipelineLayout,
+				upscalePass);
+	}
 	createCommandPool(deviceInfo);
 
 	VkPhysicalDeviceMemoryProperties memoryProperties =
 			getPhysicalDeviceMemoryProperties(deviceInfo.physicalDevice);
 	createVertexBuffer(memoryProperties);
 	createIndexBuffer(memoryProperties);
-	createUniformBuffers(memoryProperties);
-	createDescriptorPool();
-	createDescriptorSet();
+	instanceStream.initialize(device, memoryProperties, MAX_FRAMES_IN_FLIGHT,
+			sizeof(InstanceData), INITIAL_INSTANCE_CAPACITY);
+	initializeGpuCulling(memoryProperties);
+	gpuProfiler.initialize(device, deviceInfo.physicalDevice, deviceInfo.queueFamilyIndex,
+			MAX_FRAMES_IN_FLIGHT, MAX_PROFILED_SCOPES);
+	spriteBatcher.initialize(device, memoryProperties, MAX_FRAMES_IN_FLIGHT,
+			INITIAL_SPRITE_CAPACITY, &bindlessResources);
+
+	// Texture 0, which sprites use unless told otherwise, is plain white
+	createTextureSampler();
+	createSolidTexture(memoryProperties, glm::vec4(1.0f));
+#ifdef BENCHMARKS
+	benchmarkTextures.clear();
+	for(const glm::vec4& color : BENCHMARK_SPRITE_COLORS) {
+		benchmarkTextures.push_back(createSolidTexture(memoryProperties, color));
+	}
+#endif
 
-	createCommandBuffers(swapchainDetails);
+	createCommandBuffers();
 	createSynchronizationStructures();
 
+#ifdef BENCHMARKS
+	benchmarks->runStartupBenchmarks();
+#endif
+
 	setInitialized(true);
 }
 
@@ -121,15 +347,14 @@ void VulkanNativeApp::deinitializeDisplay() {
 	vkDeviceWaitIdle(device);
 
 	cleanupSwapchain();
+	vkDestroySwapchainKHR(device, swapchain, nullptr);
+	swapchain = VK_NULL_HANDLE;
+	renderTargetPool.destroy();
 
-	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
-
-	for (size_t i = 0; i < swapchainImages.size(); i++) {
-		vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-		vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
-	}
+	bindlessResources.destroy();
+	descriptorAllocator.destroy();
 
-	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+	pipelineLayoutCache.destroy();
 
 	vkDestroyBuffer(device, indexBuffer, nullptr);
 	vkFreeMemory(device, indexBufferMemory, nullptr);
@@ -137,6 +362,23 @@ void VulkanNativeApp::deinitializeDisplay() {
 	vkDestroyBuffer(device, vertexBuffer, nullptr);
 	vkFreeMemory(device, vertexBufferMemory, nullptr);
 
+	instanceStream.destroy();
+	gpuCulling.destroy();
+	if(cullPipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(device, cullPipeline, nullptr);
+		cullPipeline = VK_NULL_HANDLE;
+	}
+	gpuProfiler.destroy();
+	spriteBatcher.destroy();
+
+	for(const Texture& texture : textures) {
+		vkDestroyImageView(device, texture.view, nullptr);
+		vkDestroyImage(device, texture.image, nullptr);
+		vkFreeMemory(device, texture.memory, nullptr);
+	}
+	textures.clear();
+	vkDestroySampler(device, textureSampler, nullptr);
+
 	for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 		vkDestroySemaphore(device, renderCompletionSemaphores[i], nullptr);
 		vkDestroySemaphore(device, imageAvailabilitySemaphores[i], nullptr);
@@ -174,8 +416,16 @@ VkInstanceCreateInfo VulkanNativeApp::createInstanceCreationInfo(VkApplicationIn
 	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	createInfo.pApplicationInfo = &applicationInfo;
 
-	createInfo.enabledExtensionCount = (uint32_t) INSTANCE_EXTENSION_NAMES.size();
-	createInfo.ppEnabledExtensionNames = INSTANCE_EXTENSION_NAMES.data();
+	// Needed to query descriptor indexing support; devices without it fall back to classic binding
+	instanceExtensionNames = INSTANCE_EXTENSION_NAMES;
+	physicalDeviceProperties2Enabled = isInstanceExtensionSupported(
+			VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	if(physicalDeviceProperties2Enabled) {
+		instanceExtensionNames.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	}
+
+	createInfo.enabledExtensionCount = (uint32_t) instanceExtensionNames.size();
+	createInfo.ppEnabledExtensionNames = instanceExtensionNames.data();
 
 	if(debug) {
 		createInfo.enabledLayerCount = (uint32_t) VALIDATION_LAYER_NAMES.size();
@@ -252,6 +502,11 @@ const DeviceInfo VulkanNativeApp::pickPhysicalDevice(const VkSurfaceKHR& surface
 
 			if(info.isComplete()) {
 				info.physicalDevice = physicalDevice;
+				info.descriptorIndexing = queryDescriptorIndexingSupport(
+						instance, physicalDevice, physicalDeviceProperties2Enabled);
+				info.gpuCulling = queryGpuCullingSupport(physicalDevice);
+				info.incrementalPresent = INCREMENTAL_PRESENT_ENABLED && arePhysicalDeviceExtensionSupported(
+						physicalDevice, {VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME});
 				return info;
 			}
 		}
@@ -289,8 +544,29 @@ void VulkanNativeApp::createLogicalDevice(const DeviceInfo &deviceInfo, VkDevice
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreationInfos.size());
 	createInfo.pQueueCreateInfos = queueCreationInfos.data();
 
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(REQUIRED_DEVICE_EXTENSION_NAMES.size());
-	createInfo.ppEnabledExtensionNames = REQUIRED_DEVICE_EXTENSION_NAMES.data();
+	deviceExtensionNames = REQUIRED_DEVICE_EXTENSION_NAMES;
+
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures =
+			getRequiredDescriptorIndexingFeatures(deviceInfo.descriptorIndexing);
+	if(deviceInfo.descriptorIndexing.supported) {
+		deviceExtensionNames.insert(deviceExtensionNames.end(),
+				DESCRIPTOR_INDEXING_DEVICE_EXTENSION_NAMES.begin(),
+				DESCRIPTOR_INDEXING_DEVICE_EXTENSION_NAMES.end());
+		createInfo.pNext = &descriptorIndexingFeatures;
+	}
+
+	VkPhysicalDeviceFeatures enabledFeatures = {};
+	enableGpuCullingFeatures(deviceInfo.gpuCulling, enabledFeatures);
+	if(deviceInfo.gpuCulling.drawIndirectCount) {
+		deviceExtensionNames.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	}
+	if(deviceInfo.incrementalPresent) {
+		deviceExtensionNames.push_back(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+	}
+	createInfo.pEnabledFeatures = &enabledFeatures;
+
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensionNames.size());
+	createInfo.ppEnabledExtensionNames = deviceExtensionNames.data();
 
 	if(debug) {
 		createInfo.enabledLayerCount = (uint32_t) VALIDATION_LAYER_NAMES.size();
@@ -332,53 +608,85 @@ void VulkanNativeApp::registerDebugReportCallback(VkInstance &instance,
 	assertSuccess(reportCallbackCreationResult, "Failed to debug create report callback.");
 }
 
-VkSurfaceFormatKHR VulkanNativeApp::pickFormat(const std::vector<VkSurfaceFormatKHR>& formats) {
-	if(formats.size() == 1 && formats[0].format == VK_FORMAT_UNDEFINED) {
-		return {VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+// The narrowest formats the present profile's precision allows, since every pass writing a target
+// and the compositor reading the swapchain pay for each byte. Returns whether any changed.
+bool VulkanNativeApp::pickColorFormats() {
+	const PresentPolicy& policy = getPresentPolicy(presentProfile);
+	VkPhysicalDevice physicalDevice = deviceInfo.physicalDevice;
+	VkSurfaceFormatKHR previousFormat = swapchainDetails.format;
+	VkFormat previousSceneColorFormat = sceneColorFormat;
+	VkFormat previousScaledColorFormat = scaledColorFormat;
+
+	// Sprites blend into it
+	ColorRequirements swapchainRequirements;
+	swapchainRequirements.features = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT |
+			VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BLEND_BIT;
+	swapchainRequirements.minimumColorBits = policy.minimumColorBits;
+	swapchainDetails.format = pickSurfaceFormat(physicalDevice, deviceInfo.surfaceFormats, swapchainRequirements);
+
+	// Vulkan requires RGBA8 and 16-bit float to support all of this, so neither pick can fail
+	// unless the policy asks for more than those give
+	ColorRequirements scaledRequirements;
+	scaledRequirements.features = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT |
+			VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	scaledRequirements.minimumColorBits = policy.minimumColorBits;
+	scaledColorFormat = DYNAMIC_RESOLUTION_ENABLED ?
+			pickColorFormat(physicalDevice, scaledRequirements) : VK_FORMAT_UNDEFINED;
+
+	ColorRequirements sceneRequirements;
+	sceneRequirements.highDynamicRange = true;
+	sceneRequirements.minimumColorBits = std::min<uint32_t>(policy.minimumColorBits, 6);
+	sceneColorFormat = TONEMAP_PASS_ENABLED ?
+			pickColorFormat(physicalDevice, sceneRequirements) : VK_FORMAT_UNDEFINED;
+
+	if(DYNAMIC_RESOLUTION_ENABLED && scaledColorFormat == VK_FORMAT_UNDEFINED) {
+		throw std::runtime_error("No supported format for the scaled scene.");
 	}
-
-	for(const VkSurfaceFormatKHR & format : formats) {
-		if (format.format == VK_FORMAT_B8G8R8A8_UNORM &&
-				format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
-			return format;
-		}
+	if(TONEMAP_PASS_ENABLED && sceneColorFormat == VK_FORMAT_UNDEFINED) {
+		throw std::runtime_error("No supported format for the scene's lighting.");
 	}
 
-	return formats[0]; // "Okay, I give up. Let's give this a try."
+	return swapchainDetails.format.format != previousFormat.format ||
+			swapchainDetails.format.colorSpace != previousFormat.colorSpace ||
+			sceneColorFormat != previousSceneColorFormat || scaledColorFormat != previousScaledColorFormat;
 }
 
-VkPresentModeKHR VulkanNativeApp::pickPresentMode(const std::vector<VkPresentModeKHR>& presentModes) {
-	VkPresentModeKHR bestMode = VK_PRESENT_MODE_FIFO_KHR;
-
-	for (const VkPresentModeKHR& presentMode : presentModes) {
-		if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-			return presentMode;
-		} else if (presentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-			bestMode = presentMode;
-		}
+// Rendering pre-rotated to the display's current orientation spares the compositor a full-screen
+// rotation pass of its own. Mirroring isn't rendered, so it's left to the compositor where it can.
+VkSurfaceTransformFlagBitsKHR VulkanNativeApp::pickTransform(const VkSurfaceCapabilitiesKHR& capabilities) {
+	const VkSurfaceTransformFlagsKHR rotations = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR |
+			VK_SURFACE_TRANSFORM_ROTATE_90_BIT_KHR | VK_SURFACE_TRANSFORM_ROTATE_180_BIT_KHR |
+			VK_SURFACE_TRANSFORM_ROTATE_270_BIT_KHR;
+	if(!(capabilities.currentTransform & rotations) &&
+			(capabilities.supportedTransforms & VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR)) {
+		return VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
 	}
-
-	return bestMode;
+	return capabilities.currentTransform;
 }
 
-VkExtent2D VulkanNativeApp::pickExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
+// Android reports the extent in the current orientation, so quarter turns swap it back
+VkExtent2D VulkanNativeApp::pickExtent(const VkSurfaceCapabilitiesKHR& capabilities,
+		VkSurfaceTransformFlagBitsKHR transform) {
+	VkExtent2D extent = capabilities.currentExtent;
 	if (capabilities.currentExtent.width == std::numeric_limits<uint32_t>::max()) {
-		uint32_t width = clamp((uint32_t) ANativeWindow_getWidth(getApplication()->window),
-				capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
-		uint32_t height = clamp((uint32_t) ANativeWindow_getHeight(getApplication()->window),
-				capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+		extent.width = (uint32_t) ANativeWindow_getWidth(getApplication()->window);
+		extent.height = (uint32_t) ANativeWindow_getHeight(getApplication()->window);
+	}
 
-		return {width, height};
-	} else {
-		return capabilities.currentExtent;
+	if(transform == VK_SURFACE_TRANSFORM_ROTATE_90_BIT_KHR ||
+			transform == VK_SURFACE_TRANSFORM_ROTATE_270_BIT_KHR) {
+		std::swap(extent.width, extent.height);
 	}
+	extent.width = clamp(extent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+	extent.height = clamp(extent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+	return extent;
 }
 
-uint32_t VulkanNativeApp::pickImageCount(VkSurfaceCapabilitiesKHR capabilities) {
-	uint32_t desiredCount = capabilities.minImageCount + 1;
-	return capabilities.maxImageCount == 0 ? // 0 means no limit
-			desiredCount :
-			std::min(desiredCount, capabilities.maxImageCount);
+// Rotating the device changes both, and the next swapchain has to match them
+void VulkanNativeApp::updateSurfaceDetails() {
+	surfaceCapabilities = getPhysicalDeviceSurfaceCapabilities(deviceInfo.physicalDevice, deviceInfo.surface);
+	swapchainDetails.transform = pickTransform(surfaceCapabilities);
+	swapchainDetails.swapExtent = pickExtent(surfaceCapabilities, swapchainDetails.transform);
 }
 
 void VulkanNativeApp::createSwapchain(
@@ -411,21 +719,28 @@ void VulkanNativeApp::createSwapchain(
 		createInfo.pQueueFamilyIndices = indices;
 	}
 
-	createInfo.preTransform = capabilities.currentTransform;
+	createInfo.preTransform = swapChainSupportDetails.transform;
 	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_INHERIT_BIT_KHR;
 	createInfo.presentMode = swapChainSupportDetails.presentMode;
 	createInfo.clipped = VK_TRUE;
 
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	// The old swapchain's last image stays on screen until the new one presents, so switching
+	// present modes or image counts doesn't blank the display
+	createInfo.oldSwapchain = swapchain;
 
-	VkResult result = vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapchain);
+	VkSwapchainKHR newSwapchain;
+	VkResult result = vkCreateSwapchainKHR(device, &createInfo, nullptr, &newSwapchain);
 	assertSuccess(result, "Failed to create swap chain.");
+	if(swapchain != VK_NULL_HANDLE) {
+		vkDestroySwapchainKHR(device, swapchain, nullptr);
+	}
+	swapchain = newSwapchain;
 
 	getSwapchainImages(device, swapchain, swapchainImages);
 }
 
 void VulkanNativeApp::beforeMainLoop() {
-	initializationTime = lastFrameTime = now();
+	initializationTime = now();
 }
 
 void VulkanNativeApp::handleMainLoop() {
@@ -462,7 +777,7 @@ void VulkanNativeApp::createImageViews(const SwapChainSupportDetails& swapChainS
 	}
 }
 
-void VulkanNativeApp::createGraphicsPipeline(SwapChainSupportDetails swapChainDetails) {
+void VulkanNativeApp::createGraphicsPipeline() {
 	std::vector<char> vertexShaderBytecode = readAsset(
 			getAssetManager(), "shaders/shader_base.vert.spv");
 	VkShaderModule vertexShaderModule = createShaderModule(device, vertexShaderBytecode);
@@ -485,13 +800,16 @@ void VulkanNativeApp::createGraphicsPipeline(SwapChainSupportDetails swapChainDe
 
 	VkPipelineShaderStageCreateInfo shaderStages[] = {vertexShaderStageInfo, fragmentShaderStageInfo};
 
-	auto bindingDescription = Vertex::getBindingDescription();
-	auto attributeDescriptions = Vertex::getAttributeDescriptions();
+	VkVertexInputBindingDescription bindingDescriptions[] = {
+			Vertex::Layout::getBindingDescription(VERTEX_BINDING),
+			InstanceData::Layout::getBindingDescription(INSTANCE_BINDING,
+					VK_VERTEX_INPUT_RATE_INSTANCE)};
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions = getAttributeDescriptions();
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.vertexBindingDescriptionCount = 2;
 	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions;
 	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
@@ -499,24 +817,17 @@ void VulkanNativeApp::createGraphicsPipeline(SwapChainSupportDetails swapChainDe
 	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 	inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-	VkViewport viewport = {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float) swapChainDetails.swapExtent.width;
-	viewport.height = (float)swapChainDetails.swapExtent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor = {};
-	scissor.offset = {0, 0};
-	scissor.extent = swapChainDetails.swapExtent;
-
+	// Set while recording, so a new scene resolution needs a new frame graph but no new pipelines
 	VkPipelineViewportStateCreateInfo viewportState = {};
 	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
 	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;
+
+	const VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
 
 	VkPipelineRasterizationStateCreateInfo rasterizer = {};
 	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -531,12 +842,22 @@ void VulkanNativeApp::createGraphicsPipeline(SwapChainSupportDetails swapChainDe
 	VkPipelineMultisampleStateCreateInfo multisampling = {};
 	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
 	multisampling.sampleShadingEnable = VK_FALSE;
-	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampling.rasterizationSamples = sampleCount;
 
 	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
 	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 	colorBlendAttachment.blendEnable = VK_FALSE;
 
+	// After a prepass, depth is final and only the nearest surface of each pixel passes
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = DEPTH_PREPASS_ENABLED ? VK_FALSE : VK_TRUE;
+	depthStencil.depthCompareOp = DEPTH_PREPASS_ENABLED ?
+			VK_COMPARE_OP_EQUAL : getDepthCompareOp(camera.getDepthMode());
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
 	VkPipelineColorBlendStateCreateInfo colorBlending = {};
 	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 	colorBlending.logicOpEnable = VK_FALSE;
@@ -548,13 +869,6 @@ void VulkanNativeApp::createGraphicsPipeline(SwapChainSupportDetails swapChainDe
 	colorBlending.blendConstants[2] = 0.0f; // Optional
 	colorBlending.blendConstants[3] = 0.0f; // Optional
 
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-	assertSuccess(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout),
-			"Failed to create pipeline layout.");
-
 	VkGraphicsPipelineCreateInfo pipelineInfo = {};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 	pipelineInfo.stageCount = 2;
@@ -565,76 +879,471 @@ void VulkanNativeApp::createGraphicsPipeline(SwapChainSupportDetails swapChainDe
 	pipelineInfo.pViewportState = &viewportState;
 	pipelineInfo.pRasterizationState = &rasterizer;
 	pipelineInfo.pMultisampleState = &multisampling;
-	pipelineInfo.pDepthStencilState = nullptr; // Optional
+	pipelineInfo.pDepthStencilState = &depthStencil;
 	pipelineInfo.pColorBlendState = &colorBlending;
-	pipelineInfo.pDynamicState = nullptr; // Optional
+	pipelineInfo.pDynamicState = &dynamicState;
 	pipelineInfo.layout = pipelineLayout;
-	pipelineInfo.renderPass = renderPass;
-	pipelineInfo.subpass = 0;
+	pipelineInfo.renderPass = frameGraph.getRenderPass(scenePass);
+	pipelineInfo.subpass = frameGraph.getSubpass(scenePass);
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
 	pipelineInfo.basePipelineIndex = -1; // Optional
 
 	assertSuccess(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline),
 			"failed to create graphics pipeline!");
+	scenePipelines = {graphicsPipeline};
+
+	if(DEPTH_PREPASS_ENABLED) {
+		// The same vertex shader, so positions match bit for bit, with no fragment shader or color
+		depthStencil.depthWriteEnable = VK_TRUE;
+		depthStencil.depthCompareOp = getDepthCompareOp(camera.getDepthMode());
+		colorBlending.attachmentCount = 0;
+		pipelineInfo.stageCount = 1;
+		pipelineInfo.renderPass = frameGraph.getRenderPass(depthPrepassPass);
+		pipelineInfo.subpass = frameGraph.getSubpass(depthPrepassPass);
+
+		assertSuccess(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
+				&depthPrepassPipeline), "Failed to create depth prepass pipeline.");
+		depthPrepassPipelines = {depthPrepassPipeline};
+	}
 
 	vkDestroyShaderModule(device, fragmentShaderModule, nullptr);
 	vkDestroyShaderModule(device, vertexShaderModule, nullptr);
 }
 
-void VulkanNativeApp::createFramebuffers(const SwapChainSupportDetails &swapChainSupportDetails) {
-	swapchainFramebuffers.resize(swapchainImageViews.size());
+void VulkanNativeApp::createSpritePipelineLayout() {
+	ShaderReflection reflection = mergeShaderReflections({
+			reflectShader(readAsset(getAssetManager(), "shaders/sprite.vert.spv")),
+			reflectShader(readAsset(getAssetManager(), getSpriteFragmentShaderName()))});
+
+	auto attributeDescriptions = SpriteVertex::Layout::getAttributeDescriptions();
+	assertVertexInputsProvided(reflection, attributeDescriptions.data(), attributeDescriptions.size());
+	assertPushConstantsFit(reflection, SPRITE_PUSH_CONSTANTS_SIZE);
+
+	PipelineLayoutInfo layoutInfo = pipelineLayoutCache.getPipelineLayout(reflection,
+			{{SpriteBatcher::TEXTURE_SET, bindlessResources.getSetLayout()}});
+	spritePipelineLayout = layoutInfo.layout;
+	spritePushConstantStages = layoutInfo.pushConstantRanges.empty() ?
+			0 : layoutInfo.pushConstantRanges[0].stageFlags;
+}
+
+const char* VulkanNativeApp::getSpriteFragmentShaderName() const {
+	return bindlessResources.isBindless() ?
+			"shaders/sprite.frag.spv" : "shaders/sprite_classic.frag.spv";
+}
+
+void VulkanNativeApp::createSpritePipelines(SwapChainSupportDetails swapChainDetails) {
+	VkShaderModule vertexShaderModule = createShaderModule(device,
+			readAsset(getAssetManager(), "shaders/sprite.vert.spv"));
+	VkShaderModule fragmentShaderModule = createShaderModule(device,
+			readAsset(getAssetManager(), getSpriteFragmentShaderName()));
+
+	VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = vertexShaderModule;
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = fragmentShaderModule;
+	shaderStages[1].pName = "main";
+
+	auto bindingDescription = SpriteVertex::Layout::getBindingDescription();
+	auto attributeDescriptions = SpriteVertex::Layout::getAttributeDescriptions();
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	// Sprites keep the viewport and scissor of the pass they're flushed in, set while recording
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
 
-	for (size_t i = 0; i < swapchainImageViews.size(); i++) {
-		VkImageView attachments[] = { swapchainImageViews[i] };
+	const VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
 
-		VkFramebufferCreateInfo framebufferInfo = {};
-		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferInfo.renderPass = renderPass;
-		framebufferInfo.attachmentCount = 1;
-		framebufferInfo.pAttachments = attachments;
-		framebufferInfo.width = swapChainSupportDetails.swapExtent.width;
-		framebufferInfo.height = swapChainSupportDetails.swapExtent.height;
-		framebufferInfo.layers = 1;
+	// Sprites can be mirrored with a negative size, so neither winding is culled
+	VkPipelineRasterizationStateCreateInfo rasterizer = {};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_NONE;
+	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	// Drawn after tonemapping or upscaling when either pass runs, into its single sampled target
+	VkPipelineMultisampleStateCreateInfo multisampling = {};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples = TONEMAP_PASS_ENABLED || DYNAMIC_RESOLUTION_ENABLED ?
+			VK_SAMPLE_COUNT_1_BIT : sampleCount;
 
-		assertSuccess(vkCreateFramebuffer(device, &framebufferInfo, nullptr,
-				&swapchainFramebuffers[i]), "Failed to create framebuffer");
+	// Sprites overlay the scene, so depth is neither tested nor written
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_ALWAYS;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_TRUE;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending = {};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = spritePipelineLayout;
+	pipelineInfo.renderPass = frameGraph.getRenderPass(spritePass);
+	pipelineInfo.subpass = frameGraph.getSubpass(spritePass);
+	pipelineInfo.basePipelineIndex = -1;
+
+	// Alpha blended, then additive
+	const VkBlendFactor destinationFactors[] = {
+			VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+			VK_BLEND_FACTOR_ONE};
+	for(VkBlendFactor destinationFactor : destinationFactors) {
+		colorBlendAttachment.dstColorBlendFactor = destinationFactor;
+
+		VkPipeline pipeline;
+		assertSuccess(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline),
+				"Failed to create sprite pipeline.");
+		spritePipelines.push_back(pipeline);
+		spriteBatcher.addPipeline(pipeline);
 	}
+
+	vkDestroyShaderModule(device, fragmentShaderModule, nullptr);
+	vkDestroyShaderModule(device, vertexShaderModule, nullptr);
 }
 
-void VulkanNativeApp::createCommandPool(const DeviceInfo &deviceInfo) {
-	VkCommandPoolCreateInfo poolInfo = {};
-	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	poolInfo.queueFamilyIndex = deviceInfo.queueFamilyIndex;
-	poolInfo.flags = 0; // Optional
+void VulkanNativeApp::createFullscreenPipelineLayout(const char* fragmentShaderName,
+		VkPipelineLayout& layout, VkDescriptorSetLayout& setLayout) {
+	ShaderReflection reflection = mergeShaderReflections({
+			reflectShader(readAsset(getAssetManager(), "shaders/fullscreen.vert.spv")),
+			reflectShader(readAsset(getAssetManager(), fragmentShaderName))});
 
-	assertSuccess(vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool),
-			"Failed to create command pool.");
+	PipelineLayoutInfo layoutInfo = pipelineLayoutCache.getPipelineLayout(reflection);
+	layout = layoutInfo.layout;
+	setLayout = layoutInfo.setLayouts[0];
 }
 
-void VulkanNativeApp::createBuffer(const VkPhysicalDeviceMemoryProperties &memoryProperties,
-		VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
-		VkBuffer &buffer, VkDeviceMemory &bufferMemory) {
-	VkBufferCreateInfo bufferInfo = {};
-	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferInfo.size = size;
-	bufferInfo.usage = usage;
-	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+VkPipeline VulkanNativeApp::createFullscreenPipeline(const char* fragmentShaderName, VkPipelineLayout layout,
+		uint32_t pass) {
+	VkShaderModule vertexShaderModule = createShaderModule(device,
+			readAsset(getAssetManager(), "shaders/fullscreen.vert.spv"));
+	VkShaderModule fragmentShaderModule = createShaderModule(device,
+			readAsset(getAssetManager(), fragmentShaderName));
+
+	VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = vertexShaderModule;
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = fragmentShaderModule;
+	shaderStages[1].pName = "main";
+
+	// A single triangle covering the screen, generated from the vertex index
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	// The pass's extent, which may be the scene's scaled one, is set while recording
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	const VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
 
-	assertSuccess(vkCreateBuffer(device, &bufferInfo, nullptr, &buffer),
-			"Failed to create buffer.");
+	VkPipelineRasterizationStateCreateInfo rasterizer = {};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = VK_CULL_MODE_NONE;
 
-	VkMemoryRequirements memoryRequirements = getBufferMemoryRequirements(device, buffer);
+	VkPipelineMultisampleStateCreateInfo multisampling = {};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memoryRequirements.size;
-	allocInfo.memoryTypeIndex = pickMemoryTypeIndex(memoryProperties,
-			memoryRequirements.memoryTypeBits, properties);
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 
-	assertSuccess(vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory),
-			"Failed to allocate buffer memory.");
+	VkPipelineColorBlendStateCreateInfo colorBlending = {};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
 
-	vkBindBufferMemory(device, buffer, bufferMemory, 0);
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = layout;
+	pipelineInfo.renderPass = frameGraph.getRenderPass(pass);
+	pipelineInfo.subpass = frameGraph.getSubpass(pass);
+	pipelineInfo.basePipelineIndex = -1;
+
+	VkPipeline pipeline;
+	assertSuccess(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline),
+			"Failed to create fullscreen pipeline.");
+
+	vkDestroyShaderModule(device, fragmentShaderModule, nullptr);
+	vkDestroyShaderModule(device, vertexShaderModule, nullptr);
+	return pipeline;
+}
+
+void VulkanNativeApp::buildFrameGraph(const SwapChainSupportDetails &swapChainSupportDetails) {
+	VkExtent2D extent = swapChainSupportDetails.swapExtent;
+	sceneExtent = DYNAMIC_RESOLUTION_ENABLED ? scaleExtent(extent, resolutionController.getScale()) : extent;
+	VkFormat colorFormat = swapChainSupportDetails.format.format;
+	VkClearValue colorClearValue = {};
+	colorClearValue.color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+	VkClearValue depthClearValue = {};
+	depthClearValue.depthStencil = {getDepthClearValue(camera.getDepthMode()), 0};
+
+	// The acquire semaphore is waited on at color output, so the first transition waits there too.
+	// Only rendering what changed needs the image's last frame, as it was presented.
+	swapchainTarget = frameGraph.importImage("swapchain", colorFormat, extent,
+			INCREMENTAL_PRESENT_ENABLED ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	depthTarget = frameGraph.createImage("depth", depthFormat, sceneExtent, sampleCount);
+	frameGraph.setClearValue(depthTarget, depthClearValue);
+
+	uint32_t culledDraws = RenderGraph::NONE;
+	if(deviceInfo.gpuCulling.supported) {
+		culledDraws = frameGraph.importBuffer("culled draws");
+		uint32_t cullingPass = frameGraph.addPass("culling", profilePass("culling",
+				[this](VkCommandBuffer commandBuffer) {
+			gpuCulling.cull(commandBuffer, static_cast<uint32_t>(frameNumber), modelViewProjection);
+		}));
+		frameGraph.write(cullingPass, culledDraws, RenderGraphUsage::COMPUTE_STORAGE);
+	}
+
+	depthPrepassPass = RenderGraph::NONE;
+	if(DEPTH_PREPASS_ENABLED) {
+		depthPrepassPass = frameGraph.addPass("depth prepass", profilePass("depth prepass",
+				[this](VkCommandBuffer commandBuffer) {
+			recordDepthPrepass(commandBuffer);
+		}));
+		if(culledDraws != RenderGraph::NONE) {
+			frameGraph.read(depthPrepassPass, culledDraws, RenderGraphUsage::INDIRECT_BUFFER);
+			frameGraph.read(depthPrepassPass, culledDraws, RenderGraphUsage::VERTEX_BUFFER);
+		}
+		frameGraph.write(depthPrepassPass, depthTarget, RenderGraphUsage::DEPTH_ATTACHMENT);
+	}
+
+	scenePass = frameGraph.addPass("scene", profilePass("scene",
+			[this](VkCommandBuffer commandBuffer) {
+		recordScenePass(commandBuffer);
+	}));
+	if(culledDraws != RenderGraph::NONE) {
+		frameGraph.read(scenePass, culledDraws, RenderGraphUsage::INDIRECT_BUFFER);
+		frameGraph.read(scenePass, culledDraws, RenderGraphUsage::VERTEX_BUFFER);
+	}
+	if(DEPTH_PREPASS_ENABLED) {
+		frameGraph.read(scenePass, depthTarget, RenderGraphUsage::DEPTH_READ);
+	} else {
+		frameGraph.write(scenePass, depthTarget, RenderGraphUsage::DEPTH_ATTACHMENT);
+	}
+
+	// The finished scene goes straight to the swapchain unless it's drawn at a scale of its own.
+	// The scene's resolved color is that, unless it's tonemapped first.
+	scaledColorTarget = DYNAMIC_RESOLUTION_ENABLED ?
+			frameGraph.createImage("scaled color", scaledColorFormat, sceneExtent) : RenderGraph::NONE;
+	uint32_t finishedColorTarget = DYNAMIC_RESOLUTION_ENABLED ? scaledColorTarget : swapchainTarget;
+	VkFormat finishedColorFormat = DYNAMIC_RESOLUTION_ENABLED ? scaledColorFormat : colorFormat;
+	sceneColorTarget = TONEMAP_PASS_ENABLED ?
+			frameGraph.createImage("scene color", sceneColorFormat, sceneExtent) : finishedColorTarget;
+	colorTarget = RenderGraph::NONE;
+	if(sampleCount != VK_SAMPLE_COUNT_1_BIT) {
+		// Resolving takes matching formats
+		colorTarget = frameGraph.createImage("multisampled color",
+				TONEMAP_PASS_ENABLED ? sceneColorFormat : finishedColorFormat, sceneExtent, sampleCount);
+		frameGraph.setClearValue(colorTarget, colorClearValue);
+		frameGraph.write(scenePass, colorTarget, RenderGraphUsage::COLOR_ATTACHMENT);
+		frameGraph.resolve(scenePass, colorTarget, sceneColorTarget);
+	} else {
+		frameGraph.setClearValue(sceneColorTarget, colorClearValue);
+		frameGraph.write(scenePass, sceneColorTarget, RenderGraphUsage::COLOR_ATTACHMENT);
+	}
+	spritePass = scenePass;
+
+	tonemapPass = RenderGraph::NONE;
+	if(TONEMAP_PASS_ENABLED) {
+		tonemapPass = frameGraph.addPass("tonemap", profilePass("tonemap",
+				[this](VkCommandBuffer commandBuffer) {
+			recordTonemapPass(commandBuffer);
+		}));
+		frameGraph.read(tonemapPass, sceneColorTarget, RenderGraphUsage::INPUT_ATTACHMENT);
+		frameGraph.write(tonemapPass, finishedColorTarget, RenderGraphUsage::COLOR_ATTACHMENT);
+		spritePass = tonemapPass;
+	}
+
+	// Covers every pixel of the swapchain, which is never loaded, then sprites draw at native resolution
+	upscalePass = RenderGraph::NONE;
+	if(DYNAMIC_RESOLUTION_ENABLED) {
+		upscalePass = frameGraph.addPass("upscale", profilePass("upscale",
+				[this](VkCommandBuffer commandBuffer) {
+			recordUpscalePass(commandBuffer);
+		}));
+		frameGraph.read(upscalePass, scaledColorTarget, RenderGraphUsage::SAMPLED);
+		frameGraph.write(upscalePass, swapchainTarget, RenderGraphUsage::COLOR_ATTACHMENT);
+		spritePass = upscalePass;
+	}
+
+	frameGraph.compile();
+	frameGraph.realize(device, getPhysicalDeviceMemoryProperties(deviceInfo.physicalDevice),
+			&renderTargetPool);
+	frameGraph.logSchedule();
+
+	reportRenderTargetFootprint();
+}
+
+RenderGraph::RecordFunction VulkanNativeApp::profilePass(const char* name, RenderGraph::RecordFunction record) {
+	uint32_t scope = gpuProfiler.addScope(name);
+	return [this, scope, record](VkCommandBuffer commandBuffer) {
+		gpuProfiler.beginScope(commandBuffer, static_cast<uint32_t>(frameNumber), scope);
+		record(commandBuffer);
+		gpuProfiler.endScope(commandBuffer, static_cast<uint32_t>(frameNumber));
+	};
+}
+
+VkSampleCountFlagBits VulkanNativeApp::pickSampleCount(uint32_t requested) const {
+	for(VkSampleCountFlagBits count : SELECTABLE_SAMPLE_COUNTS) {
+		if(count <= requested && (supportedSampleCounts & count)) {
+			return count;
+		}
+	}
+	return VK_SAMPLE_COUNT_1_BIT;
+}
+
+void VulkanNativeApp::setSampleCount(uint32_t samples) {
+	requestedSampleCount = samples;
+	if(initialized && pickSampleCount(samples) != sampleCount) {
+		sampleCountChanged = true;
+	}
+}
+
+void VulkanNativeApp::onKeyDown(int32_t keyCode) {
+	if(!initialized) {
+		return;
+	}
+
+	if(keyCode == SAMPLE_COUNT_KEY) {
+		VkSampleCountFlagBits current = pickSampleCount(requestedSampleCount);
+		VkSampleCountFlagBits next = pickSampleCount(SELECTABLE_SAMPLE_COUNTS.front());
+		for(VkSampleCountFlagBits count : SELECTABLE_SAMPLE_COUNTS) {
+			if(count < current && (supportedSampleCounts & count)) {
+				next = count;
+				break;
+			}
+		}
+		LOG_INFO("Switching to %ux MSAA.", static_cast<uint32_t>(next));
+		setSampleCount(next);
+	} else if(keyCode == PRESENT_PROFILE_KEY) {
+		PresentProfile next = static_cast<PresentProfile>(
+				(static_cast<uint32_t>(requestedPresentProfile) + 1) % PRESENT_PROFILE_COUNT);
+		LOG_INFO("Switching to the %s present profile.", getPresentPolicy(next).name);
+		setPresentProfile(next);
+	}
+}
+
+void VulkanNativeApp::reportRenderTargetFootprint() {
+	VkExtent2D extent = sceneExtent;
+	double pixels = static_cast<double>(extent.width) * extent.height;
+	VkFormat resolvedFormat = TONEMAP_PASS_ENABLED ? sceneColorFormat :
+			DYNAMIC_RESOLUTION_ENABLED ? scaledColorFormat : swapchainDetails.format.format;
+	double colorBytes = pixels * getTexelSize(resolvedFormat);
+	double depthBytes = pixels * getTexelSize(depthFormat);
+	const double megabyte = 1024.0 * 1024.0;
+
+	// What each setting would reserve if every attachment were backed by real memory
+	for(auto count = SELECTABLE_SAMPLE_COUNTS.rbegin(); count != SELECTABLE_SAMPLE_COUNTS.rend(); ++count) {
+		if(!(supportedSampleCounts & *count)) {
+			continue;
+		}
+		uint32_t samples = static_cast<uint32_t>(*count);
+		double multisampledColor = samples > 1 ? colorBytes * samples : 0.0;
+		LOG_INFO("%ux at %ux%u: %.1f MB color, %.1f MB depth, resolving into a %.1f MB image%s",
+				samples, extent.width, extent.height, multisampledColor / megabyte,
+				depthBytes * samples / megabyte, colorBytes / megabyte,
+				*count == sampleCount ? " (current)" : "");
+	}
+
+	logColorBandwidth("Swapchain", swapchainDetails.format.format, swapchainDetails.swapExtent);
+	if(TONEMAP_PASS_ENABLED) {
+		logColorBandwidth("Scene color", sceneColorFormat, extent);
+	}
+	if(DYNAMIC_RESOLUTION_ENABLED) {
+		logColorBandwidth("Scaled color", scaledColorFormat, extent);
+	}
+	if(sampleCount != VK_SAMPLE_COUNT_1_BIT) {
+		logColorBandwidth("Multisampled color", resolvedFormat, extent, sampleCount);
+	}
+
+	VkDeviceSize allocated = frameGraph.getLazyBytes();
+	if(frameGraph.hasLazilyAllocatedMemory()) {
+		LOG_INFO("Transient attachments allocated lazily: %.1f MB reserved, %.1f MB committed.",
+				allocated / megabyte, frameGraph.getCommittedLazyBytes() / megabyte);
+	} else {
+		LOG_INFO("No lazily allocated memory, transient attachments take %.1f MB of device memory.",
+				allocated / megabyte);
+	}
+
+	LOG_INFO("Render target pool: %u targets in %.1f MB, %.1f MB of it idle; %u reused, %u created, %u evicted.",
+			renderTargetPool.getTargetCount(), renderTargetPool.getPooledBytes() / megabyte,
+			renderTargetPool.getIdleBytes() / megabyte, renderTargetPool.getReuseCount(),
+			renderTargetPool.getCreationCount(), renderTargetPool.getEvictionCount());
+}
+
+void VulkanNativeApp::createCommandPool(const DeviceInfo &deviceInfo) {
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = deviceInfo.queueFamilyIndex;
+	// Command buffers are re-recorded every frame
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	assertSuccess(vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool),
+			"Failed to create command pool.");
 }
 
 void VulkanNativeApp::createVertexBuffer(const VkPhysicalDeviceMemoryProperties &memoryProperties) {
@@ -642,7 +1351,7 @@ void VulkanNativeApp::createVertexBuffer(const VkPhysicalDeviceMemoryProperties
 
 	VkBuffer stagingBuffer;
 	VkDeviceMemory stagingBufferMemory;
-	createBuffer(memoryProperties, bufferSize,
+	createBuffer(device, memoryProperties, bufferSize,
 			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 			stagingBuffer, stagingBufferMemory);
@@ -652,7 +1361,7 @@ void VulkanNativeApp::createVertexBuffer(const VkPhysicalDeviceMemoryProperties
 	memcpy(data, vertices.data(), (size_t) bufferSize);
 	vkUnmapMemory(device, stagingBufferMemory);
 
-	createBuffer(memoryProperties, bufferSize,
+	createBuffer(device, memoryProperties, bufferSize,
 			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			vertexBuffer, vertexBufferMemory);
@@ -668,7 +1377,7 @@ void VulkanNativeApp::createIndexBuffer(const VkPhysicalDeviceMemoryProperties &
 
 	VkBuffer stagingBuffer;
 	VkDeviceMemory stagingBufferMemory;
-	createBuffer(memoryProperties, bufferSize,
+	createBuffer(device, memoryProperties, bufferSize,
 			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 			stagingBuffer, stagingBufferMemory);
@@ -678,7 +1387,7 @@ void VulkanNativeApp::createIndexBuffer(const VkPhysicalDeviceMemoryProperties &
 	memcpy(data, vertexIndices.data(), (size_t) bufferSize);
 	vkUnmapMemory(device, stagingBufferMemory);
 
-	createBuffer(memoryProperties, bufferSize,
+	createBuffer(device, memoryProperties, bufferSize,
 			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			indexBuffer, indexBufferMemory);
@@ -689,69 +1398,7 @@ void VulkanNativeApp::createIndexBuffer(const VkPhysicalDeviceMemoryProperties &
 	vkFreeMemory(device, stagingBufferMemory, nullptr);
 }
 
-void VulkanNativeApp::createUniformBuffers(const VkPhysicalDeviceMemoryProperties& memoryProperties) {
-	VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-
-	uniformBuffers.resize(swapchainImages.size());
-	uniformBuffersMemory.resize(swapchainImages.size());
-
-	for (size_t i = 0; i < swapchainImages.size(); i++) {
-		createBuffer(memoryProperties,
-				bufferSize,
-				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-				uniformBuffers[i],
-				uniformBuffersMemory[i]);
-	}
-}
-
-void VulkanNativeApp::createDescriptorPool() {
-	VkDescriptorPoolSize poolSize = {};
-	poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSize.descriptorCount = static_cast<uint32_t>(swapchainImages.size());
-
-	VkDescriptorPoolCreateInfo poolInfo = {};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.poolSizeCount = 1;
-	poolInfo.pPoolSizes = &poolSize;
-	poolInfo.maxSets = static_cast<uint32_t>(swapchainImages.size());
-
-	assertSuccess(vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool),
-			"Failed to create descriptor pool.");
-}
-
-void VulkanNativeApp::createDescriptorSet() {
-	std::vector<VkDescriptorSetLayout> layouts(swapchainImages.size(), descriptorSetLayout);
-	VkDescriptorSetAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(swapchainImages.size());
-	allocInfo.pSetLayouts = layouts.data();
-
-	descriptorSets.resize(swapchainImages.size());
-	assertSuccess(vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()),
-			"Failed to allocate descriptor sets.");
-
-	for (size_t i = 0; i < swapchainImages.size(); i++) {
-		VkDescriptorBufferInfo bufferInfo = {};
-		bufferInfo.buffer = uniformBuffers[i];
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(UniformBufferObject);
-
-		VkWriteDescriptorSet descriptorWrite = {};
-		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrite.dstSet = descriptorSets[i];
-		descriptorWrite.dstBinding = 0;
-		descriptorWrite.dstArrayElement = 0;
-		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrite.descriptorCount = 1;
-		descriptorWrite.pBufferInfo = &bufferInfo;
-
-		vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
-	}
-}
-
-void VulkanNativeApp::copyBuffer(VkBuffer sourceBuffer, VkBuffer destinationBuffer, VkDeviceSize size) {
+VkCommandBuffer VulkanNativeApp::beginOneTimeCommands() {
 	VkCommandBufferAllocateInfo allocInfo = {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -767,10 +1414,10 @@ void VulkanNativeApp::copyBuffer(VkBuffer sourceBuffer, VkBuffer destinationBuff
 
 	vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
-	VkBufferCopy copyRegion = {};
-	copyRegion.size = size;
-	vkCmdCopyBuffer(commandBuffer, sourceBuffer, destinationBuffer, 1, &copyRegion);
+	return commandBuffer;
+}
 
+void VulkanNativeApp::endOneTimeCommands(VkCommandBuffer commandBuffer) {
 	vkEndCommandBuffer(commandBuffer);
 
 	VkSubmitInfo submitInfo = {};
@@ -784,8 +1431,99 @@ void VulkanNativeApp::copyBuffer(VkBuffer sourceBuffer, VkBuffer destinationBuff
 	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
 
-void VulkanNativeApp::createCommandBuffers(const SwapChainSupportDetails &swapChainSupportDetails) {
-	commandBuffers.resize(swapchainFramebuffers.size());
+void VulkanNativeApp::copyBuffer(VkBuffer sourceBuffer, VkBuffer destinationBuffer, VkDeviceSize size) {
+	VkCommandBuffer commandBuffer = beginOneTimeCommands();
+
+	VkBufferCopy copyRegion = {};
+	copyRegion.size = size;
+	vkCmdCopyBuffer(commandBuffer, sourceBuffer, destinationBuffer, 1, &copyRegion);
+
+	endOneTimeCommands(commandBuffer);
+}
+
+void VulkanNativeApp::createTextureSampler() {
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.maxLod = 0.0f;
+
+	assertSuccess(vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler),
+			"Failed to create texture sampler.");
+}
+
+uint32_t VulkanNativeApp::createSolidTexture(const VkPhysicalDeviceMemoryProperties &memoryProperties,
+		const glm::vec4& color) {
+	Unorm4x8 texel(color);
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	createBuffer(device, memoryProperties, sizeof(texel),
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			stagingBuffer, stagingBufferMemory);
+
+	void* data;
+	vkMapMemory(device, stagingBufferMemory, 0, sizeof(texel), 0, &data);
+	memcpy(data, &texel, sizeof(texel));
+	vkUnmapMemory(device, stagingBufferMemory);
+
+	Texture texture = {};
+	createImage(device, memoryProperties, {1, 1}, VK_FORMAT_R8G8B8A8_UNORM,
+			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture.image, texture.memory);
+
+	VkCommandBuffer commandBuffer = beginOneTimeCommands();
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = texture.image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region = {};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = {1, 1, 1};
+	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, texture.image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	endOneTimeCommands(commandBuffer);
+
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	vkFreeMemory(device, stagingBufferMemory, nullptr);
+
+	texture.view = createImageView(device, texture.image, VK_FORMAT_R8G8B8A8_UNORM,
+			VK_IMAGE_ASPECT_COLOR_BIT);
+	texture.index = bindlessResources.addImage(texture.view, textureSampler,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	textures.push_back(texture);
+
+	return texture.index;
+}
+
+void VulkanNativeApp::createCommandBuffers() {
+	commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
 	VkCommandBufferAllocateInfo allocInfo = {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -795,41 +1533,118 @@ void VulkanNativeApp::createCommandBuffers(const SwapChainSupportDetails &swapCh
 
 	assertSuccess(vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()),
 			"Failed to allocate command buffers.");
+}
+
+void VulkanNativeApp::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+	vkResetCommandBuffer(commandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-	for (size_t i = 0; i < commandBuffers.size(); i++) {
-		VkCommandBufferBeginInfo beginInfo = {};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-		beginInfo.pInheritanceInfo = nullptr; // Optional
+	assertSuccess(vkBeginCommandBuffer(commandBuffer, &beginInfo),
+			"Failed to begin recording command buffer!");
 
-		assertSuccess(vkBeginCommandBuffer(commandBuffers[i], &beginInfo),
-				"Failed to begin recording command buffer!");
+	gpuProfiler.beginFrame(commandBuffer, static_cast<uint32_t>(frameNumber));
 
-		VkRenderPassBeginInfo renderPassInfo = {};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = renderPass;
-		renderPassInfo.framebuffer = swapchainFramebuffers[i];
-		renderPassInfo.renderArea.offset = {0, 0};
-		renderPassInfo.renderArea.extent = swapChainSupportDetails.swapExtent;
+	frameGraph.setImportedImage(swapchainTarget, swapchainImages[imageIndex], swapchainImageViews[imageIndex]);
+	if(INCREMENTAL_PRESENT_ENABLED) {
+		// Images the swapchain hasn't handed out before hold nothing to keep
+		frameGraph.setImportedLayout(swapchainTarget, damageTracker.hasContents(imageIndex) ?
+				VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_UNDEFINED);
+		frameGraph.setRenderArea(spritePass, damageTracker.getImageDamage(imageIndex));
+	}
+	frameGraph.execute(commandBuffer);
 
-		VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
-		renderPassInfo.clearValueCount = 1;
-		renderPassInfo.pClearValues = &clearColor;
+	gpuProfiler.endFrame(commandBuffer, static_cast<uint32_t>(frameNumber));
 
-		vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+	assertSuccess(vkEndCommandBuffer(commandBuffer), "Failed to record command buffer.");
+}
 
-			VkBuffer vertexBuffers[] = {vertexBuffer};
-			VkDeviceSize offsets[] = {0};
-			vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
-			vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+void VulkanNativeApp::bindSceneGeometry(VkCommandBuffer commandBuffer, uint32_t pass) {
+	VkBuffer instanceBuffer = gpuCulling.isSupported() ?
+			gpuCulling.getInstanceBuffer(frameNumber) : instanceStream.getBuffer(frameNumber);
+	VkBuffer vertexBuffers[] = {vertexBuffer, instanceBuffer};
+	VkDeviceSize offsets[] = {0, 0};
+	vkCmdBindVertexBuffers(commandBuffer, VERTEX_BINDING, 2, vertexBuffers, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+	setViewportAndScissor(commandBuffer, sceneExtent, frameGraph.getRenderArea(pass));
+
+	DrawPushConstants pushConstants = {};
+	pushConstants.modelViewProjection = modelViewProjection;
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+			0, sizeof(pushConstants), &pushConstants);
+}
 
-			vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
+void VulkanNativeApp::recordDepthPrepass(VkCommandBuffer commandBuffer) {
+	bindSceneGeometry(commandBuffer, depthPrepassPass);
+	recordSceneDraws(commandBuffer, depthPrepassPipelines);
+}
 
-			vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(vertexIndices.size()), 1, 0, 0, 0);
-		vkCmdEndRenderPass(commandBuffers[i]);
+void VulkanNativeApp::recordScenePass(VkCommandBuffer commandBuffer) {
+	bindSceneGeometry(commandBuffer, scenePass);
+	recordSceneDraws(commandBuffer, scenePipelines);
 
-		assertSuccess(vkEndCommandBuffer(commandBuffers[i]), "Failed to record command buffer.");
+	if(spritePass == scenePass) {
+		spriteBatcher.flush(commandBuffer, spritePipelineLayout, spritePushConstantStages,
+				swapchainDetails.getDisplayExtent(), swapchainDetails.getQuarterTurns());
+	}
+}
+
+void VulkanNativeApp::recordTonemapPass(VkCommandBuffer commandBuffer) {
+	DescriptorWriter writer;
+	writer.bindImage(0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, frameGraph.getImageView(sceneColorTarget),
+			VK_NULL_HANDLE, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	VkDescriptorSet set = descriptorAllocator.allocate(tonemapSetLayout, writer);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, tonemapPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, tonemapPipelineLayout,
+			0, 1, &set, 0, nullptr);
+	setViewportAndScissor(commandBuffer, sceneExtent, frameGraph.getRenderArea(tonemapPass));
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+
+	if(spritePass == tonemapPass) {
+		spriteBatcher.flush(commandBuffer, spritePipelineLayout, spritePushConstantStages,
+				swapchainDetails.getDisplayExtent(), swapchainDetails.getQuarterTurns());
+	}
+}
+
+void VulkanNativeApp::recordUpscalePass(VkCommandBuffer commandBuffer) {
+	// Bilinear, with edges clamped so the border doesn't blend with the opposite side
+	DescriptorWriter writer;
+	writer.bindImage(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameGraph.getImageView(scaledColorTarget),
+			textureSampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	VkDescriptorSet set = descriptorAllocator.allocate(upscaleSetLayout, writer);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, upscalePipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, upscalePipelineLayout,
+			0, 1, &set, 0, nullptr);
+	setViewportAndScissor(commandBuffer, swapchainDetails.swapExtent, frameGraph.getRenderArea(upscalePass));
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+
+	spriteBatcher.flush(commandBuffer, spritePipelineLayout, spritePushConstantStages,
+			swapchainDetails.getDisplayExtent(), swapchainDetails.getQuarterTurns());
+}
+
+void VulkanNativeApp::recordSceneDraws(VkCommandBuffer commandBuffer,
+		const std::vector<VkPipeline>& pipelines) {
+	if(gpuCulling.isSupported()) {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[SCENE_PIPELINE]);
+		gpuCulling.draw(commandBuffer, static_cast<uint32_t>(frameNumber));
+		return;
+	}
+
+	// Runs arrive sorted by state, so binds are only needed where it changes
+	uint32_t boundPipeline = std::numeric_limits<uint32_t>::max();
+	for(const DrawRun& run : drawRuns) {
+		if(run.pipeline != boundPipeline) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[run.pipeline]);
+			boundPipeline = run.pipeline;
+		}
+
+		const CullMesh& mesh = sceneMeshes[run.mesh];
+		vkCmdDrawIndexed(commandBuffer, mesh.indexCount, run.instanceCount, mesh.firstIndex,
+				mesh.vertexOffset, run.firstInstance);
 	}
 }
 
@@ -855,91 +1670,312 @@ void VulkanNativeApp::createSynchronizationStructures() {
 	}
 }
 
-void VulkanNativeApp::createRenderPass(SwapChainSupportDetails swapchainDetails) {
-	colorAttachment = {};
-	colorAttachment.format = swapchainDetails.format.format;
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	VkAttachmentReference colorAttachmentReference = {};
-	colorAttachmentReference.attachment = 0;
-	colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpass = {};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	// An array. Location 0 in fragment shader is a reference to this!
-	subpass.pColorAttachments = &colorAttachmentReference;
-
-	VkSubpassDependency dependency = {};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-	VkRenderPassCreateInfo renderPassInfo = {};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = 1;
-	renderPassInfo.pAttachments = &colorAttachment;
-	renderPassInfo.subpassCount = 1;
-	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
-
-	assertSuccess(vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass),
-			"Failed to create render pass.");
-}
-
-void VulkanNativeApp::createDescriptorSetLayout() {
-    VkDescriptorSetLayoutBinding uboLayoutBinding = {};
-    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    uboLayoutBinding.binding = 0;
-    uboLayoutBinding.descriptorCount = 1; // Just one buffer object in what is potentially an array of them
-    uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
-	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
-	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo.bindingCount = 1;
-	layoutInfo.pBindings = &uboLayoutBinding;
-
-	assertSuccess(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout),
-			"Failed to create descriptor set layout.");
-}
-
-void VulkanNativeApp::updateUniformBuffer(uint32_t imageIndex, TimePoint frameTime) {
+void VulkanNativeApp::createPipelineLayout() {
+	ShaderReflection reflection = mergeShaderReflections({
+			reflectShader(readAsset(getAssetManager(), "shaders/shader_base.vert.spv")),
+			reflectShader(readAsset(getAssetManager(), "shaders/shader_base.frag.spv"))});
+
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions = getAttributeDescriptions();
+	assertVertexInputsProvided(reflection, attributeDescriptions.data(), attributeDescriptions.size());
+
+	assertPushConstantsFit(reflection, sizeof(DrawPushConstants));
+
+	PipelineLayoutInfo layoutInfo = pipelineLayoutCache.getPipelineLayout(reflection);
+	pipelineLayout = layoutInfo.layout;
+}
+
+void VulkanNativeApp::assertPushConstantsFit(const ShaderReflection& reflection, uint32_t size) {
+	uint32_t maxPushConstantsSize =
+			getPhysicalDeviceProperties(deviceInfo.physicalDevice).limits.maxPushConstantsSize;
+	for(const VkPushConstantRange& range : reflection.pushConstantRanges) {
+		if(range.offset + range.size > maxPushConstantsSize) {
+			throw std::runtime_error("Shader push constants exceed the device's " +
+					std::to_string(maxPushConstantsSize) + " byte limit.");
+		}
+		if(range.offset + range.size > size) {
+			throw std::runtime_error("Shader push constants don't match what the app pushes.");
+		}
+	}
+}
+
+void VulkanNativeApp::updateViewProjection(TimePoint frameTime) {
+	VkExtent2D displayExtent = swapchainDetails.getDisplayExtent();
+	camera.setAspectRatio(displayExtent.width / (float) displayExtent.height);
+	camera.setPreRotation(swapchainDetails.getQuarterTurns());
+	bool cameraChanged = camera.update();
+
+	// The instanced quad spins about its center
 	float secondsSinceStart = secondsBetween(initializationTime, frameTime);
+	transforms.setRotation(modelTransform, glm::angleAxis(secondsSinceStart * glm::radians(90.0f),
+			glm::vec3(0.0f, 0.0f, 1.0f)));
+	bool modelChanged = transforms.update() > 0;
+
+	viewChanged = cameraChanged || modelChanged;
+	if(viewChanged) {
+		modelViewProjection = camera.getViewProjection() * transforms.getWorld(modelTransform);
+	}
+}
 
-	UniformBufferObject ubo = {};
-	ubo.model = glm::rotate(glm::mat4(1.0f),
-			secondsSinceStart * glm::radians(90.0f),
-			glm::vec3(0.0f, 0.0f, 1.0f));
-	ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f),
-			glm::vec3(0.0f, 0.0f, 0.0f),
-			glm::vec3(0.0f, 0.0f, 1.0f));
-	ubo.projection = glm::perspective(glm::radians(45.0f),
-			swapchainDetails.swapExtent.width / (float) swapchainDetails.swapExtent.height,
-			0.1f, 10.0f);
-	ubo.projection[1][1] *= -1; // Workaround for GLM being left-handed
+void VulkanNativeApp::initializeGpuCulling(const VkPhysicalDeviceMemoryProperties &memoryProperties) {
+	if(!deviceInfo.gpuCulling.supported) {
+		LOG_INFO("Indirect draw features unavailable, culling and drawing instances on the CPU.");
+		return;
+	}
 
-	void* data;
-	vkMapMemory(device, uniformBuffersMemory[imageIndex], 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(device, uniformBuffersMemory[imageIndex]);
+	std::vector<char> bytecode = readAsset(getAssetManager(), "shaders/cull.comp.spv");
+	ShaderReflection reflection = reflectShader(bytecode);
+	assertPushConstantsFit(reflection, GpuCulling::PUSH_CONSTANTS_SIZE);
+	PipelineLayoutInfo layoutInfo = pipelineLayoutCache.getPipelineLayout(reflection);
+
+	VkShaderModule shaderModule = createShaderModule(device, bytecode);
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = layoutInfo.layout;
+	pipelineInfo.basePipelineIndex = -1;
+
+	assertSuccess(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
+			&cullPipeline), "Failed to create culling pipeline.");
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+
+	gpuCulling.initialize(device, memoryProperties, deviceInfo.gpuCulling, &descriptorAllocator,
+			MAX_FRAMES_IN_FLIGHT, INITIAL_INSTANCE_CAPACITY, cullPipeline, layoutInfo);
+
+	gpuCulling.setMeshes(sceneMeshes);
+}
+
+void VulkanNativeApp::updateInstances(uint32_t count) {
+	bool rebuilt = count != scene.getRenderableCount();
+	if(rebuilt) {
+		buildInstanceGrid(count);
+	}
+
+	// The GPU culls the uploaded grid itself
+	if(gpuCulling.isSupported()) {
+		return;
+	}
+
+	// While nothing moves the last cull and sort still stand, leaving only the copy into this
+	// frame's buffer
+	if(rebuilt || viewChanged) {
+		glm::vec4 planes[6];
+		extractFrustumPlanes(modelViewProjection, planes);
+		drawPacketCount = scene.collectDrawPackets(planes, drawPackets);
+		sortDrawPackets();
+	}
+
+	InstanceData* instances = instanceStream.map<InstanceData>(
+			static_cast<uint32_t>(frameNumber), drawPacketCount);
+	threadPool.parallelFor(drawPacketCount, INSTANCE_COPY_BATCH, [&](uint32_t begin, uint32_t end) {
+		for(uint32_t i = begin; i < end; i++) {
+			const DrawPacket& packet = drawPackets[drawOrder[i]];
+			instances[i].positionScale = packet.positionScale;
+			instances[i].color = packet.color;
+		}
+	});
+}
+
+void VulkanNativeApp::sortDrawPackets() {
+	drawSortKeys.resize(drawPacketCount);
+	drawOrder.resize(drawPacketCount);
+
+	// Clip w is the distance in front of the camera
+	glm::vec4 depthRow(modelViewProjection[0][3], modelViewProjection[1][3],
+			modelViewProjection[2][3], modelViewProjection[3][3]);
+	threadPool.parallelFor(drawPacketCount, INSTANCE_COPY_BATCH, [&](uint32_t begin, uint32_t end) {
+		for(uint32_t i = begin; i < end; i++) {
+			const DrawPacket& packet = drawPackets[i];
+			float depth = glm::dot(depthRow, glm::vec4(glm::vec3(packet.positionScale), 1.0f));
+			drawSortKeys[i] = makeDrawSortKey(DRAW_LAYER_OPAQUE, SCENE_PIPELINE, packet.material,
+					packet.mesh, depth);
+			drawOrder[i] = i;
+		}
+	});
+	drawSorter.sort(drawSortKeys, drawOrder);
+
+	// Sorting put equal state side by side, so each run of it becomes one instanced draw
+	drawRuns.clear();
+	for(uint32_t i = 0; i < drawPacketCount; i++) {
+		const DrawPacket& packet = drawPackets[drawOrder[i]];
+		if(!drawRuns.empty()) {
+			DrawRun& last = drawRuns.back();
+			if(last.pipeline == SCENE_PIPELINE && last.material == packet.material &&
+					last.mesh == packet.mesh) {
+				last.instanceCount++;
+				continue;
+			}
+		}
+
+		DrawRun run = {};
+		run.pipeline = SCENE_PIPELINE;
+		run.material = packet.material;
+		run.mesh = packet.mesh;
+		run.firstInstance = i;
+		run.instanceCount = 1;
+		drawRuns.push_back(run);
+	}
+}
+
+void VulkanNativeApp::buildInstanceGrid(uint32_t count) {
+	scene.clear();
+
+	// A square grid filling the quad's original footprint, so any count stays on screen
+	uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+	float spacing = 2.0f / side;
+	float scale = std::min(1.0f, spacing * 0.8f);
+	for(uint32_t i = 0; i < count; i++) {
+		Transform transform;
+		transform.position = glm::vec3(-1.0f + spacing * (i % side + 0.5f),
+				-1.0f + spacing * (i / side + 0.5f), 0.0f);
+		transform.scale = scale;
+		scene.createRenderable(transform, quadMesh, 0, Unorm4x8(1.0f, 1.0f, 1.0f));
+	}
+
+	sceneBounds = Aabb();
+	scene.getRegistry().each<Bounds>([this](Entity, const Bounds& bounds) {
+		sceneBounds.grow(Aabb(bounds.center - bounds.extents, bounds.center + bounds.extents));
+	});
+	damageTracker.addAll();
+
+	if(!gpuCulling.isSupported()) {
+		return;
+	}
+
+	std::vector<CullObject> objects;
+	objects.reserve(count);
+	scene.getRegistry().each<MeshRef, Bounds, Transform, MaterialRef>(
+			[&](Entity, const MeshRef& mesh, const Bounds& bounds, const Transform& transform,
+					const MaterialRef& material) {
+				CullObject object = {};
+				object.boundingSphere = glm::vec4(bounds.center, bounds.radius);
+				object.positionScale = glm::vec4(transform.position, transform.scale);
+				object.color = material.color.packed;
+				object.mesh = mesh.mesh;
+				objects.push_back(object);
+			});
+	gpuCulling.setObjects(objects);
+}
+
+void VulkanNativeApp::validateGpuCulling() {
+	uint32_t frameIndex = static_cast<uint32_t>(frameNumber);
+	uint32_t expected;
+	if(!gpuCulling.countVisibleOnCpu(frameIndex, expected)) {
+		return;
+	}
+
+	uint32_t visible = gpuCulling.getVisibleCount(frameIndex);
+	if(visible != expected) {
+		LOG_WARN("GPU culling kept %u of %u objects where the CPU keeps %u.",
+				visible, gpuCulling.getObjectCount(), expected);
+	}
+}
+
+// Where the scene falls on the swapchain image. The projection already turns it with the display.
+VkRect2D VulkanNativeApp::projectSceneBounds() const {
+	if(sceneBounds.isEmpty()) {
+		return VkRect2D{};
+	}
+
+	VkExtent2D extent = swapchainDetails.swapExtent;
+	VkRect2D all = {};
+	all.extent = extent;
+
+	glm::vec2 low(std::numeric_limits<float>::max());
+	glm::vec2 high(-std::numeric_limits<float>::max());
+	for(uint32_t corner = 0; corner < 8; corner++) {
+		glm::vec3 point((corner & 1) ? sceneBounds.maximum.x : sceneBounds.minimum.x,
+				(corner & 2) ? sceneBounds.maximum.y : sceneBounds.minimum.y,
+				(corner & 4) ? sceneBounds.maximum.z : sceneBounds.minimum.z);
+		glm::vec4 clip = modelViewProjection * glm::vec4(point, 1.0f);
+		// Behind the eye the projection wraps around, so anything could be covered
+		if(clip.w <= 0.0f) {
+			return all;
+		}
+		glm::vec2 normalized = glm::vec2(clip) / clip.w;
+		low = glm::min(low, normalized);
+		high = glm::max(high, normalized);
+	}
+
+	// A pixel wider on each side, for rasterization rounding and multisampling at the edges
+	glm::vec2 size(extent.width, extent.height);
+	low = glm::clamp(glm::floor((low * 0.5f + 0.5f) * size) - 1.0f, glm::vec2(0.0f), size);
+	high = glm::clamp(glm::ceil((high * 0.5f + 0.5f) * size) + 1.0f, glm::vec2(0.0f), size);
+
+	VkRect2D rect = {};
+	rect.offset = {static_cast<int32_t>(low.x), static_cast<int32_t>(low.y)};
+	rect.extent = {static_cast<uint32_t>(high.x - low.x), static_cast<uint32_t>(high.y - low.y)};
+	return rect;
+}
+
+// Everything is redrawn each frame, just scissored, so only what moved needs marking: sprites
+// that changed, and the scene where it was and where it is whenever the view moved
+void VulkanNativeApp::collectDamage() {
+	spriteDamage.clear();
+	spriteBatcher.collectDamage(spriteDamage);
+	VkExtent2D displayExtent = swapchainDetails.getDisplayExtent();
+	uint32_t quarterTurns = swapchainDetails.getQuarterTurns();
+	for(const VkRect2D& rect : spriteDamage) {
+		damageTracker.add(rotateRect(rect, displayExtent, quarterTurns));
+	}
+
+	if(viewChanged) {
+		VkRect2D rect = projectSceneBounds();
+		damageTracker.add(sceneRect);
+		damageTracker.add(rect);
+		sceneRect = rect;
+	}
 }
 
 void VulkanNativeApp::drawFrame() {
 	std::chrono::steady_clock::time_point frameTime = now();
 
+	TimePoint fenceStart = now();
 	vkWaitForFences(device, 1, &inFlightFences[frameNumber], VK_TRUE, std::numeric_limits<uint64_t>::max());
+	double fenceMilliseconds = secondsBetween(fenceStart, now()) * 1000.0;
+	descriptorAllocator.beginFrame(static_cast<uint32_t>(frameNumber));
+	bindlessResources.beginFrame(frameCount);
+	renderTargetPool.beginFrame();
+
+	double gpuMilliseconds = -1.0;
+	if(gpuProfiler.collect(static_cast<uint32_t>(frameNumber), gpuMilliseconds)) {
+		if(DYNAMIC_RESOLUTION_ENABLED && resolutionController.update(gpuMilliseconds)) {
+			resizeScene();
+		}
+	}
+	if(debug && gpuCulling.isSupported() && frameCount % CULLING_VALIDATION_INTERVAL == 0) {
+		validateGpuCulling();
+	}
+
+	// The frame's CPU work comes before the acquire, so a frame where nothing changed can be skipped
+	// without holding a swapchain image
+	TimePoint cpuStart = now();
+
+	spriteBatcher.begin(static_cast<uint32_t>(frameNumber));
+	uint32_t instanceCount = 1;
+#ifdef BENCHMARKS
+	const Benchmarks::FrameSetup& benchmarkSetup = benchmarks->getFrameSetup();
+	submitBenchmarkSprites(frameTime, benchmarkSetup.spriteCount);
+	instanceCount = benchmarkSetup.instanceCount;
+#endif
+
+	updateViewProjection(frameTime);
+	updateInstances(instanceCount);
+
+	if(INCREMENTAL_PRESENT_ENABLED) {
+		collectDamage();
+		if(damageTracker.isEmpty() && !framebufferResized && !sampleCountChanged && !presentProfileChanged) {
+			idleFrames++;
+			std::this_thread::sleep_for(std::chrono::milliseconds(IDLE_FRAME_MILLISECONDS));
+			return;
+		}
+	}
 
 	uint32_t imageIndex;
+	TimePoint acquireStart = now();
 	VkResult imageAcquisitionResult = vkAcquireNextImageKHR(device, swapchain, std::numeric_limits<uint64_t>::max(),
 			imageAvailabilitySemaphores[frameNumber], VK_NULL_HANDLE, &imageIndex);
 	if(imageAcquisitionResult == VK_ERROR_OUT_OF_DATE_KHR) {
@@ -948,8 +1984,9 @@ void VulkanNativeApp::drawFrame() {
 	} else if (imageAcquisitionResult != VK_SUCCESS && imageAcquisitionResult != VK_SUBOPTIMAL_KHR) {
 		throw std::runtime_error("Failed to acquire swapchain image.");
 	}
+	double acquireMilliseconds = secondsBetween(acquireStart, now()) * 1000.0;
 
-	updateUniformBuffer(imageIndex, frameTime);
+	recordCommandBuffer(commandBuffers[frameNumber], imageIndex);
 
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -961,7 +1998,7 @@ void VulkanNativeApp::drawFrame() {
 	submitInfo.pWaitDstStageMask = waitStages;
 
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+	submitInfo.pCommandBuffers = &commandBuffers[frameNumber];
 
 	VkSemaphore signalSemaphores[] = {renderCompletionSemaphores[frameNumber]};
 	submitInfo.signalSemaphoreCount = 1;
@@ -971,6 +2008,11 @@ void VulkanNativeApp::drawFrame() {
 	assertSuccess(vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[frameNumber]),
 			"Failed to submit draw command buffer.");
 
+	cpuFrameMilliseconds = secondsBetween(cpuStart, now()) * 1000.0 - acquireMilliseconds;
+#ifdef BENCHMARKS
+	benchmarks->addFrame(cpuFrameMilliseconds, gpuMilliseconds, spriteBatcher.getDrawCount());
+#endif
+
 	VkPresentInfoKHR presentInfo = {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -983,17 +2025,72 @@ void VulkanNativeApp::drawFrame() {
 
 	presentInfo.pImageIndices = &imageIndex;
 
+	// Given before the swapchain's transform, as seen on screen
+	VkPresentRegionKHR presentRegion = {};
+	VkPresentRegionsKHR presentRegions = {};
+	if(deviceInfo.incrementalPresent && !damageTracker.isFull()) {
+		presentRects.clear();
+		uint32_t quarterTurns = swapchainDetails.getQuarterTurns();
+		for(const VkRect2D& rect : damageTracker.getRects()) {
+			VkRect2D displayRect = rotateRect(rect, swapchainDetails.swapExtent, (4 - quarterTurns) % 4);
+			VkRectLayerKHR presentRect = {};
+			presentRect.offset = displayRect.offset;
+			presentRect.extent = displayRect.extent;
+			presentRects.push_back(presentRect);
+		}
+		presentRegion.rectangleCount = static_cast<uint32_t>(presentRects.size());
+		presentRegion.pRectangles = presentRects.data();
+
+		presentRegions.sType = VK_STRUCTURE_TYPE_PRESENT_REGIONS_KHR;
+		presentRegions.swapchainCount = 1;
+		presentRegions.pRegions = &presentRegion;
+		presentInfo.pNext = &presentRegions;
+	}
+	if(debug && INCREMENTAL_PRESENT_ENABLED) {
+		VkRect2D damage = frameGraph.getRenderArea(spritePass);
+		damagedShare += (double) damage.extent.width * damage.extent.height /
+				((double) swapchainDetails.swapExtent.width * swapchainDetails.swapExtent.height);
+		damagedFrames++;
+	}
+	damageTracker.endFrame(imageIndex);
+
+	TimePoint presentStart = now();
 	VkResult presentationResult = vkQueuePresentKHR(presentQueue, &presentInfo);
-	if(presentationResult == VK_ERROR_OUT_OF_DATE_KHR || presentationResult == VK_SUBOPTIMAL_KHR || framebufferResized) {
+	presentTelemetry.addFrame(presentProfile, fenceMilliseconds, acquireMilliseconds,
+			secondsBetween(presentStart, now()) * 1000.0);
+	if(presentationResult == VK_ERROR_OUT_OF_DATE_KHR || presentationResult == VK_SUBOPTIMAL_KHR ||
+			framebufferResized || sampleCountChanged) {
 		framebufferResized = false;
+		sampleCountChanged = false;
 		recreateSwapchain();
 	} else if(presentationResult != VK_SUCCESS) {
 		throw std::runtime_error("Failed to present swapchain image.");
 	}
 
-	frameNumber = (frameNumber + 1) % MAX_FRAMES_IN_FLIGHT;
+	frameNumber = (frameNumber + 1) % framesInFlight;
+	frameCount++;
+	if(presentProfileChanged) {
+		applyPresentProfile();
+	}
+	if(debug && frameCount % PASS_TIMING_REPORT_INTERVAL == 0) {
+		gpuProfiler.report();
+		presentTelemetry.report();
+		if(INCREMENTAL_PRESENT_ENABLED) {
+			reportDamage();
+		}
+	}
+}
+
+void VulkanNativeApp::reportDamage() {
+	if(damagedFrames == 0) {
+		return;
+	}
 
-	lastFrameTime = frameTime;
+	LOG_INFO("Damage over %u frames: %.1f%% of the swapchain rendered on average, %u idle frames skipped.",
+			damagedFrames, damagedShare * 100.0 / damagedFrames, idleFrames);
+	damagedShare = 0.0;
+	damagedFrames = 0;
+	idleFrames = 0;
 }
 
 void VulkanNativeApp::recreateSwapchain() {
@@ -1001,47 +2098,123 @@ void VulkanNativeApp::recreateSwapchain() {
 
 	cleanupSwapchain();
 
+	updateSurfaceDetails();
 	createSwapchain(swapchain, device, swapchainDetails, deviceInfo, surfaceCapabilities);
 	createImageViews(swapchainDetails);
-	createRenderPass(swapchainDetails);
-	createGraphicsPipeline(swapchainDetails);
-	createFramebuffers(swapchainDetails);
-	createCommandBuffers(swapchainDetails);
+	damageTracker.reset(swapchainDetails.swapExtent, static_cast<uint32_t>(swapchainImages.size()));
+	sampleCount = pickSampleCount(requestedSampleCount);
+	buildFrameGraph(swapchainDetails);
+	createGraphicsPipeline();
+	createSpritePipelines(swapchainDetails);
+	if(TONEMAP_PASS_ENABLED) {
+		tonemapPipeline = createFullscreenPipeline("shaders/tonemap.frag.spv", tonemapPipelineLayout,
+				tonemapPass);
+	}
+	if(DYNAMIC_RESOLUTION_ENABLED) {
+		upscalePipeline = createFullscreenPipeline("shaders/upscale.frag.spv", upscalePipelineLayout,
+				upscalePass);
+	}
 }
 
-void VulkanNativeApp::cleanupSwapchain() {
-	for (auto framebuffer : swapchainFramebuffers) {
-		vkDestroyFramebuffer(device, framebuffer, nullptr);
+void VulkanNativeApp::resizeScene() {
+	LOG_INFO("Scene resolution scaled to %.0f%% for %.2f ms GPU frames.",
+			resolutionController.getScale() * 100.0f, resolutionController.getAverageMilliseconds());
+
+	// Frames in flight still use the old targets. The pipelines set their viewport while
+	// recording, and the render passes keep their formats and structure, so they stay compatible
+	// and only the graph is built again; the pool keeps recent sizes for scaling back.
+	vkDeviceWaitIdle(device);
+	frameGraph.destroy();
+	buildFrameGraph(swapchainDetails);
+	damageTracker.addAll();
+}
+
+void VulkanNativeApp::setPresentProfile(PresentProfile profile) {
+	requestedPresentProfile = profile;
+	if(initialized && profile != presentProfile) {
+		presentProfileChanged = true;
+	}
+}
+
+void VulkanNativeApp::applyPresentProfile() {
+	presentProfileChanged = false;
+	presentTelemetry.report();
+	presentProfile = requestedPresentProfile;
+	const PresentPolicy& policy = getPresentPolicy(presentProfile);
+
+	// Only the ring of per-frame resources changes. Every slot is waited on before it's used, and
+	// a later fence covers the frames submitted before it, so slots left out need nothing.
+	framesInFlight = policy.framesInFlight;
+	frameNumber %= framesInFlight;
+
+	VkPresentModeKHR presentMode = pickPresentMode(policy, deviceInfo.presentModes);
+	uint32_t imageCount = pickImageCount(policy, surfaceCapabilities);
+	bool formatsChanged = pickColorFormats();
+	if(presentMode != swapchainDetails.presentMode || imageCount != swapchainDetails.imageCount ||
+			formatsChanged) {
+		swapchainDetails.presentMode = presentMode;
+		swapchainDetails.imageCount = imageCount;
+		recreateSwapchain();
 	}
 
-	vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+	LOG_INFO("Present profile %s: %s with %u images in %s, %lu frames in flight.", policy.name,
+			getPresentModeName(presentMode), imageCount, getColorFormatName(swapchainDetails.format.format),
+			framesInFlight);
+}
+
+void VulkanNativeApp::cleanupSwapchain() {
+	frameGraph.destroy();
 
 	vkDestroyPipeline(device, graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-	vkDestroyRenderPass(device, renderPass, nullptr);
+	if(depthPrepassPipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(device, depthPrepassPipeline, nullptr);
+		depthPrepassPipeline = VK_NULL_HANDLE;
+	}
+	for(VkPipeline pipeline : spritePipelines) {
+		vkDestroyPipeline(device, pipeline, nullptr);
+	}
+	spritePipelines.clear();
+	spriteBatcher.clearPipelines();
+	if(tonemapPipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(device, tonemapPipeline, nullptr);
+		tonemapPipeline = VK_NULL_HANDLE;
+	}
+	if(upscalePipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(device, upscalePipeline, nullptr);
+		upscalePipeline = VK_NULL_HANDLE;
+	}
 
 	for(const VkImageView& view : swapchainImageViews) {
 		vkDestroyImageView(device, view, nullptr);
 	}
+}
 
-	vkDestroySwapchainKHR(device, swapchain, nullptr);
-
+#ifdef BENCHMARKS
+void VulkanNativeApp::submitBenchmarkSprites(TimePoint frameTime, uint32_t count) {
+	float seconds = secondsBetween(initializationTime, frameTime);
+	float width = swapchainDetails.getDisplayExtent().width;
+	float height = swapchainDetails.getDisplayExtent().height;
+
+	// A fixed pseudo-random scatter drifting over time, spread over every texture and pipeline
+	uint32_t random = 12345;
+	Sprite sprite;
+	sprite.size = glm::vec2(16.0f, 16.0f);
+	for(uint32_t i = 0; i < count; i++) {
+		random = random * 1664525u + 1013904223u;
+		float x = (random >> 8) / float(1 << 24);
+		random = random * 1664525u + 1013904223u;
+		float y = (random >> 8) / float(1 << 24);
+
+		sprite.position = glm::vec2(
+				std::fmod(x * width + seconds * 40.0f, width),
+				std::fmod(y * height + seconds * 25.0f, height));
+		sprite.texture = benchmarkTextures[i % benchmarkTextures.size()];
+		sprite.pipeline = static_cast<uint8_t>(i % spritePipelines.size());
+		spriteBatcher.draw(sprite);
+	}
 }
+#endif
 
 void VulkanNativeApp::onWindowResized() {
 	framebufferResized = true;
 }
-
-uint32_t VulkanNativeApp::pickMemoryTypeIndex(
-		const VkPhysicalDeviceMemoryProperties &memoryProperties,
-		uint32_t requiredMemoryTypeBits,
-		VkMemoryPropertyFlags requiredProperties) {
-	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
-		if (requiredMemoryTypeBits & (1 << i) &&
-				(memoryProperties.memoryTypes[i].propertyFlags & requiredProperties) == requiredProperties) {
-			return i;
-		}
-	}
-
-	throw std::runtime_error("Failed to find suitable memory type.");
-}
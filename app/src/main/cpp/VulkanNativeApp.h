@@ -6,6 +6,26 @@
 #include "BaseNativeApp.h"
 #include "vulkan_wrapper/vulkan_wrapper.h"
 #include "TimeUtils.h"
+#include "VertexLayout.h"
+#include "PipelineLayoutCache.h"
+#include "DescriptorAllocator.h"
+#include "BindlessResources.h"
+#include "InstanceStream.h"
+#include "GpuProfiler.h"
+#include "SpriteBatcher.h"
+#include "GpuCulling.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+#include "TransformHierarchy.h"
+#include "Camera.h"
+#include "RadixSort.h"
+#include "DrawSortKey.h"
+#include "RenderGraph.h"
+#include "RenderTargetPool.h"
+#include "ResolutionController.h"
+#include "PresentPolicy.h"
+#include "DamageTracker.h"
+#include "FormatPolicy.h"
 
 #include <vector>
 #include <array>
@@ -14,34 +34,56 @@
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
+/**
+ * 8 bytes per vertex: half float position and 8-bit color. The shader still declares a vec2 and a
+ * vec3; the fetch unit widens both.
+ */
 struct Vertex {
-	glm::vec2 position;
-	glm::vec3 color;
+	Half2 position;
+	Unorm4x8 color;
 
-	static VkVertexInputBindingDescription getBindingDescription() {
-		VkVertexInputBindingDescription bindingDescription = {};
-		bindingDescription.binding = 0;
-		bindingDescription.stride = sizeof(Vertex);
-		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-		return bindingDescription;
-	}
-
-	static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions() {
-		std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions = {};
-
-		attributeDescriptions[0].binding = 0;
-		attributeDescriptions[0].location = 0;
-		attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[0].offset = (uint32_t) offsetof(Vertex, position);
+	typedef VertexLayout<
+			VertexAttribute<0, Half2>,
+			VertexAttribute<1, Unorm4x8>> Layout;
+};
+ASSERT_VERTEX_LAYOUT(Vertex);
+ASSERT_VERTEX_ATTRIBUTE_OFFSET(Vertex, position, 0);
+ASSERT_VERTEX_ATTRIBUTE_OFFSET(Vertex, color, 1);
+
+/**
+ * Streamed per instance: a world-space offset with a uniform scale in w, and a tint multiplied
+ * into the vertex color.
+ */
+struct InstanceData {
+	glm::vec4 positionScale;
+	Unorm4x8 color;
+
+	typedef VertexLayout<
+			VertexAttribute<2, glm::vec4>,
+			VertexAttribute<3, Unorm4x8>> Layout;
+};
+ASSERT_VERTEX_LAYOUT(InstanceData);
+ASSERT_VERTEX_ATTRIBUTE_OFFSET(InstanceData, positionScale, 0);
+ASSERT_VERTEX_ATTRIBUTE_OFFSET(InstanceData, color, 1);
+static_assert(sizeof(InstanceData) == GpuCulling::INSTANCE_STRIDE,
+		"GpuCulling writes instances in the InstanceData layout.");
+
+/** Consecutive sorted instances sharing pipeline, material and mesh, drawn with one call. */
+struct DrawRun {
+	uint32_t pipeline;
+	uint32_t material;
+	uint32_t mesh;
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+};
 
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = (uint32_t) offsetof(Vertex, color);
+struct Texture {
+	VkImage image;
+	VkDeviceMemory memory;
+	VkImageView view;
 
-		return attributeDescriptions;
-	}
+	/** Where the texture lives in BindlessResources. */
+	uint32_t index;
 };
 
 struct DeviceInfo {
@@ -53,6 +95,10 @@ struct DeviceInfo {
 	unsigned int presentationFamilyIndex = NONE;
 	std::vector<VkSurfaceFormatKHR> surfaceFormats;
 	std::vector<VkPresentModeKHR> presentModes;
+	DescriptorIndexingSupport descriptorIndexing;
+	GpuCullingSupport gpuCulling;
+	/** Whether presents can carry the rects that changed, when damage tracking asks for it. */
+	bool incrementalPresent = false;
 
 	bool isComplete() {
 		return queueFamilyIndex != NONE && presentationFamilyIndex != NONE;
@@ -62,13 +108,44 @@ struct DeviceInfo {
 struct SwapChainSupportDetails {
 	VkSurfaceFormatKHR format;
 	VkPresentModeKHR presentMode;
+	/** In the display's natural orientation, which the swapchain is pre-rotated from. */
 	VkExtent2D swapExtent;
+	VkSurfaceTransformFlagBitsKHR transform;
 	uint32_t imageCount;
+
+	uint32_t getQuarterTurns() const {
+		switch(transform) {
+			case VK_SURFACE_TRANSFORM_ROTATE_90_BIT_KHR: return 1;
+			case VK_SURFACE_TRANSFORM_ROTATE_180_BIT_KHR: return 2;
+			case VK_SURFACE_TRANSFORM_ROTATE_270_BIT_KHR: return 3;
+			default: return 0;
+		}
+	}
+
+	/** The extent as seen on screen, which is what the camera's aspect ratio and sprites go by. */
+	VkExtent2D getDisplayExtent() const {
+		return getQuarterTurns() % 2 == 0 ? swapExtent : VkExtent2D{swapExtent.height, swapExtent.width};
+	}
 };
 
+class Benchmarks;
+
 class VulkanNativeApp : public BaseNativeApp {
 	public:
 		VulkanNativeApp(android_app* app);
+		~VulkanNativeApp();
+
+		/**
+		 * Selects 1, 2 or 4x MSAA, applied from the next frame. Counts the device can't render are
+		 * lowered to the nearest one it can.
+		 */
+		void setSampleCount(uint32_t samples);
+
+		/**
+		 * Switches the present mode, swapchain image count and frames in flight to the profile's,
+		 * from the next frame. The old swapchain hands over to the new one, so nothing blanks.
+		 */
+		void setPresentProfile(PresentProfile profile);
 	protected:
 		void initializeDisplay();
 		void deinitializeDisplay();
@@ -78,52 +155,136 @@ class VulkanNativeApp : public BaseNativeApp {
 		void onWindowResized() override;
 		void beforeMainLoop() override;
 		void handleMainLoop() override;
+		void onKeyDown(int32_t keyCode) override;
 
 		virtual void onReportingEvent(const char *message);
 
 	private:
 		const bool debug;
-		const u_long MAX_FRAMES_IN_FLIGHT = 2;
+		/** Per-frame resources are made for the profile that wants the most; each uses as many as it wants. */
+		const u_long MAX_FRAMES_IN_FLIGHT = getMaxFramesInFlight();
 
 		VkInstance instance = {};
+		std::vector<const char*> instanceExtensionNames;
+		bool physicalDeviceProperties2Enabled = false;
 		VkDebugReportCallbackEXT reportCallback = {};
 		VkSurfaceKHR surface;
 		VkDevice device = {};
+		std::vector<const char*> deviceExtensionNames;
 		VkQueue graphicsQueue;
 		VkQueue presentQueue;
-		VkSwapchainKHR swapchain;
+		VkSwapchainKHR swapchain = VK_NULL_HANDLE;
 		SwapChainSupportDetails swapchainDetails;
 		DeviceInfo deviceInfo;
 		VkSurfaceCapabilitiesKHR surfaceCapabilities;
 		std::vector<VkImage> swapchainImages;
 		std::vector<VkImageView> swapchainImageViews;
-		VkRenderPass renderPass;
-		VkDescriptorSetLayout descriptorSetLayout;
+		PipelineLayoutCache pipelineLayoutCache;
 		VkPipelineLayout pipelineLayout;
 		VkPipeline graphicsPipeline;
-		std::vector<VkFramebuffer> swapchainFramebuffers;
+		VkPipeline depthPrepassPipeline = VK_NULL_HANDLE;
+		VkFormat depthFormat;
+		VkSampleCountFlags supportedSampleCounts = VK_SAMPLE_COUNT_1_BIT;
+		uint32_t requestedSampleCount;
+		VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT;
+		bool sampleCountChanged = false;
+		RenderGraph frameGraph;
+		RenderTargetPool renderTargetPool;
+		uint32_t swapchainTarget = RenderGraph::NONE;
+		uint32_t depthTarget = RenderGraph::NONE;
+		/** The multisampled color target, only while sampleCount is above 1. */
+		uint32_t colorTarget = RenderGraph::NONE;
+		/** Where the scene's color ends up: the swapchain, the tonemap pass's input, or scaledColorTarget. */
+		uint32_t sceneColorTarget = RenderGraph::NONE;
+		/** The finished scene at its scaled resolution, only with dynamic resolution. */
+		uint32_t scaledColorTarget = RenderGraph::NONE;
+		uint32_t depthPrepassPass = RenderGraph::NONE;
+		uint32_t scenePass = RenderGraph::NONE;
+		uint32_t tonemapPass = RenderGraph::NONE;
+		uint32_t upscalePass = RenderGraph::NONE;
+		/** The last pass to draw into the swapchain image, which sprites overlay. */
+		uint32_t spritePass = RenderGraph::NONE;
+		VkPipelineLayout tonemapPipelineLayout = VK_NULL_HANDLE;
+		VkDescriptorSetLayout tonemapSetLayout = VK_NULL_HANDLE;
+		VkPipeline tonemapPipeline = VK_NULL_HANDLE;
+		VkPipelineLayout upscalePipelineLayout = VK_NULL_HANDLE;
+		VkDescriptorSetLayout upscaleSetLayout = VK_NULL_HANDLE;
+		VkPipeline upscalePipeline = VK_NULL_HANDLE;
+		/** Lighting before tonemapping, only with the tonemap pass. */
+		VkFormat sceneColorFormat = VK_FORMAT_UNDEFINED;
+		/** The finished scene before upscaling, only with dynamic resolution. */
+		VkFormat scaledColorFormat = VK_FORMAT_UNDEFINED;
+		ResolutionController resolutionController;
+		/** What the scene renders at: the swapchain extent, scaled with dynamic resolution. */
+		VkExtent2D sceneExtent = {};
 		VkBuffer vertexBuffer;
 		VkDeviceMemory vertexBufferMemory;
 		VkBuffer indexBuffer;
 		VkDeviceMemory indexBufferMemory;
-		std::vector<VkBuffer> uniformBuffers;
-		std::vector<VkDeviceMemory> uniformBuffersMemory;
+		InstanceStream instanceStream;
+		ThreadPool threadPool;
+		Scene scene;
+		uint32_t quadMesh;
+		std::vector<CullMesh> sceneMeshes;
+		std::vector<VkPipeline> scenePipelines;
+		/** Parallel to scenePipelines: each one's depth-only counterpart, when prepassing. */
+		std::vector<VkPipeline> depthPrepassPipelines;
+		std::vector<DrawPacket> drawPackets;
+		uint32_t drawPacketCount = 0;
+		RadixSorter drawSorter;
+		std::vector<uint64_t> drawSortKeys;
+		std::vector<uint32_t> drawOrder;
+		std::vector<DrawRun> drawRuns;
+		TransformHierarchy transforms;
+		uint32_t modelTransform;
+		GpuCulling gpuCulling;
+		VkPipeline cullPipeline = VK_NULL_HANDLE;
+		GpuProfiler gpuProfiler;
+		double cpuFrameMilliseconds = 0.0;
+		VkSampler textureSampler;
+		std::vector<Texture> textures;
+		SpriteBatcher spriteBatcher;
+		VkPipelineLayout spritePipelineLayout;
+		VkShaderStageFlags spritePushConstantStages = 0;
+		std::vector<VkPipeline> spritePipelines;
+#ifdef BENCHMARKS
+		std::unique_ptr<Benchmarks> benchmarks;
+		std::vector<uint32_t> benchmarkTextures;
+#endif
 		VkCommandPool commandPool;
 		std::vector<VkCommandBuffer> commandBuffers;
-		VkDescriptorPool descriptorPool;
-		std::vector<VkDescriptorSet> descriptorSets;
+		DescriptorAllocator descriptorAllocator;
+		BindlessResources bindlessResources;
 
 		std::vector<VkSemaphore> imageAvailabilitySemaphores;
 		std::vector<VkSemaphore> renderCompletionSemaphores;
 		std::vector<VkFence> inFlightFences;
 		u_long frameNumber = 0;
+		u_long frameCount = 0;
+		u_long framesInFlight = MAX_FRAMES_IN_FLIGHT;
+		PresentProfile presentProfile;
+		PresentProfile requestedPresentProfile;
+		bool presentProfileChanged = false;
+		PresentTelemetry presentTelemetry;
+		DamageTracker damageTracker;
+		/** The scene's bounds in model space, and where they fell on the swapchain image last frame. */
+		Aabb sceneBounds;
+		VkRect2D sceneRect = {};
+		std::vector<VkRect2D> spriteDamage;
+		std::vector<VkRectLayerKHR> presentRects;
+		/** The share of swapchain pixels rendered, summed since the last report, and frames skipped. */
+		double damagedShare = 0.0;
+		uint32_t damagedFrames = 0;
+		uint32_t idleFrames = 0;
 
 		bool framebufferResized = false;
 
 		TimePoint initializationTime;
-		TimePoint lastFrameTime;
+		Camera camera;
+		glm::mat4 modelViewProjection;
+		/** Whether modelViewProjection changed this frame. */
+		bool viewChanged = true;
 
-		VkAttachmentDescription colorAttachment;
 		bool initialized = false;
 
 		void setInitialized(bool initialized);
@@ -143,17 +304,18 @@ class VulkanNativeApp : public BaseNativeApp {
 
 		VkSurfaceKHR createSurface(VkInstance& instance);
 
-		VkSurfaceFormatKHR pickFormat(const std::vector<VkSurfaceFormatKHR>& formats);
+		bool pickColorFormats();
 
 		static VKAPI_ATTR VkBool32 VKAPI_CALL delegateReportCallback( VkDebugReportFlagsEXT flags,
 				VkDebugReportObjectTypeEXT objectType, uint64_t object, size_t location,
 				int32_t code, const char* layerPrefix, const char* message, void* userData);
 
-		VkPresentModeKHR pickPresentMode(const std::vector<VkPresentModeKHR> &presentModes);
+		VkSurfaceTransformFlagBitsKHR pickTransform(const VkSurfaceCapabilitiesKHR &capabilities);
 
-		VkExtent2D pickExtent(const VkSurfaceCapabilitiesKHR &capabilities);
+		VkExtent2D pickExtent(const VkSurfaceCapabilitiesKHR &capabilities,
+				VkSurfaceTransformFlagBitsKHR transform);
 
-		uint32_t pickImageCount(VkSurfaceCapabilitiesKHR capabilities);
+		void updateSurfaceDetails();
 
 		void createSwapchain(
 				VkSwapchainKHR& swapchain,
@@ -164,32 +326,60 @@ class VulkanNativeApp : public BaseNativeApp {
 
 		void createImageViews(const SwapChainSupportDetails& swapChainSupportDetails);
 
-		void createRenderPass(SwapChainSupportDetails swapchainDetails);
-		void createDescriptorSetLayout();
-		void createGraphicsPipeline(SwapChainSupportDetails swapChainDetails);
-		void createFramebuffers(const SwapChainSupportDetails &swapChainSupportDetails);
+		void createPipelineLayout();
+		void assertPushConstantsFit(const ShaderReflection& reflection, uint32_t size);
+		void createSpritePipelineLayout();
+		const char* getSpriteFragmentShaderName() const;
+		void createSpritePipelines(SwapChainSupportDetails swapChainDetails);
+		void createTextureSampler();
+		uint32_t createSolidTexture(const VkPhysicalDeviceMemoryProperties &memoryProperties,
+				const glm::vec4& color);
+		void createGraphicsPipeline();
+		void createFullscreenPipelineLayout(const char* fragmentShaderName, VkPipelineLayout& layout,
+				VkDescriptorSetLayout& setLayout);
+		VkPipeline createFullscreenPipeline(const char* fragmentShaderName, VkPipelineLayout layout,
+				uint32_t pass);
+		void buildFrameGraph(const SwapChainSupportDetails &swapChainSupportDetails);
+		/** Wraps a pass's recording in a GPU profiler scope of the same name. */
+		RenderGraph::RecordFunction profilePass(const char* name, RenderGraph::RecordFunction record);
+		void resizeScene();
+		VkSampleCountFlagBits pickSampleCount(uint32_t requested) const;
+		void reportRenderTargetFootprint();
 		void createCommandPool(const DeviceInfo &deviceInfo);
-		void createCommandBuffers(const SwapChainSupportDetails &swapChainSupportDetails);
+		void createCommandBuffers();
+		void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+		void bindSceneGeometry(VkCommandBuffer commandBuffer, uint32_t pass);
+		void recordDepthPrepass(VkCommandBuffer commandBuffer);
+		void recordScenePass(VkCommandBuffer commandBuffer);
+		void recordTonemapPass(VkCommandBuffer commandBuffer);
+		void recordUpscalePass(VkCommandBuffer commandBuffer);
+		void recordSceneDraws(VkCommandBuffer commandBuffer, const std::vector<VkPipeline>& pipelines);
 		void createSynchronizationStructures();
 
-		void updateUniformBuffer(uint32_t index, TimePoint frameTime);
+		void updateViewProjection(TimePoint frameTime);
+		void initializeGpuCulling(const VkPhysicalDeviceMemoryProperties &memoryProperties);
+		void updateInstances(uint32_t count);
+		void sortDrawPackets();
+		void buildInstanceGrid(uint32_t count);
+		void validateGpuCulling();
+		VkRect2D projectSceneBounds() const;
+		void collectDamage();
+		void reportDamage();
 		void drawFrame();
 
 		void cleanupSwapchain();
 		void recreateSwapchain();
+		void applyPresentProfile();
 
-		void createBuffer(const VkPhysicalDeviceMemoryProperties &memoryProperties,
-				VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
-				VkBuffer& buffer, VkDeviceMemory& bufferMemory);
 		void createVertexBuffer(const VkPhysicalDeviceMemoryProperties &memoryProperties);
 		void createIndexBuffer(const VkPhysicalDeviceMemoryProperties &memoryProperties);
-		void createUniformBuffers(const VkPhysicalDeviceMemoryProperties &memoryProperties);
-		void createDescriptorPool();
-		void createDescriptorSet();
+		VkCommandBuffer beginOneTimeCommands();
+		void endOneTimeCommands(VkCommandBuffer commandBuffer);
 		void copyBuffer(VkBuffer sourceBuffer, VkBuffer destinationBuffer, VkDeviceSize size);
-		uint32_t pickMemoryTypeIndex(const VkPhysicalDeviceMemoryProperties &memoryProperties,
-				uint32_t requiredMemoryTypeBits,
-				VkMemoryPropertyFlags requiredProperties);
+
+#ifdef BENCHMARKS
+		void submitBenchmarkSprites(TimePoint frameTime, uint32_t count);
+#endif
 };
 
 #endif
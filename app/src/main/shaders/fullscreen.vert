@@ -0,0 +1,15 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+out gl_PerVertex {
+	vec4 gl_Position;
+};
+
+layout(location = 0) out vec2 fragUv;
+
+// One triangle that covers the screen: vertices at (-1, -1), (3, -1) and (-1, 3)
+void main() {
+	vec2 position = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+	fragUv = position;
+	gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
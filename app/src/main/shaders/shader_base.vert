@@ -1,14 +1,15 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
-    mat4 view;
-    mat4 projection;
-} ubo;
+// The view-projection is folded in on the CPU once per frame, so each draw pushes one matrix
+layout(push_constant) uniform PushConstants {
+    mat4 modelViewProjection;
+} push;
 
 layout(location = 0) in vec2 inPosition;
 layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec4 inInstancePositionScale;
+layout(location = 3) in vec4 inInstanceColor;
 
 layout(location = 0) out vec3 fragColor;
 
@@ -16,7 +17,11 @@ out gl_PerVertex {
 	vec4 gl_Position;
 };
 
+// The depth prepass runs this shader too, and the main pass tests for exactly equal depth
+invariant gl_Position;
+
 void main() {
-	gl_Position = ubo.projection * ubo.view * ubo.model * vec4(inPosition, 0.0, 1.0);
-	fragColor = inColor;
+	vec3 position = vec3(inPosition * inInstancePositionScale.w, 0.0) + inInstancePositionScale.xyz;
+	gl_Position = push.modelViewProjection * vec4(position, 1.0);
+	fragColor = inColor * inInstanceColor.rgb;
 }
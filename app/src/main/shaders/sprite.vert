@@ -0,0 +1,26 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Maps pixel positions onto clip space: transform * position + offset. The transform scales and
+// turns with the swapchain's pre-rotation.
+layout(push_constant) uniform PushConstants {
+    mat2 transform;
+    vec2 offset;
+} push;
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inUv;
+layout(location = 2) in vec4 inColor;
+
+layout(location = 0) out vec2 fragUv;
+layout(location = 1) out vec4 fragColor;
+
+out gl_PerVertex {
+	vec4 gl_Position;
+};
+
+void main() {
+	gl_Position = vec4(push.transform * inPosition + push.offset, 0.0, 1.0);
+	fragUv = inUv;
+	fragColor = inColor;
+}
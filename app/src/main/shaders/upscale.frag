@@ -0,0 +1,13 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// The scene at its scaled resolution, filtered bilinearly up to the swapchain's
+layout(set = 0, binding = 0) uniform sampler2D sceneColor;
+
+layout(location = 0) in vec2 fragUv;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = vec4(texture(sceneColor, fragUv).rgb, 1.0);
+}
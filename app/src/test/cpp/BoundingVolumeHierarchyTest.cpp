@@ -0,0 +1,251 @@
+#include "BoundingVolumeHierarchy.h"
+#include "TestUtils.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+	const uint32_t QUERIES_PER_CHECK = 200;
+	const float MAX_RAY_DISTANCE = 200.0f;
+
+	/** A random scene kept alongside the tree, answering every query by brute force. */
+	struct Scene {
+		std::mt19937 random;
+		std::uniform_real_distribution<float> position{-50.0f, 50.0f};
+		std::uniform_real_distribution<float> size{0.1f, 2.0f};
+		std::uniform_real_distribution<float> unit{-1.0f, 1.0f};
+
+		BoundingVolumeHierarchy bvh;
+		std::map<uint32_t, Aabb> boxes;
+
+		explicit Scene(uint32_t seed) : random(seed) {}
+
+		Aabb randomBox() {
+			glm::vec3 center(position(random), position(random), position(random));
+			glm::vec3 extents(size(random), size(random), size(random));
+			return Aabb(center - extents, center + extents);
+		}
+
+		/** An id picked uniformly from those in the scene. */
+		uint32_t randomId() {
+			auto it = boxes.begin();
+			std::advance(it, std::uniform_int_distribution<size_t>(0, boxes.size() - 1)(random));
+			return it->first;
+		}
+
+		void insert(uint32_t count) {
+			for(uint32_t i = 0; i < count; i++) {
+				Aabb box = randomBox();
+				uint32_t id = bvh.insert(box);
+				CHECK(boxes.find(id) == boxes.end());
+				boxes[id] = box;
+			}
+		}
+
+		void remove(uint32_t count) {
+			for(uint32_t i = 0; i < count && !boxes.empty(); i++) {
+				uint32_t id = randomId();
+				bvh.remove(id);
+				boxes.erase(id);
+			}
+		}
+
+		/** Moves every object by up to maxStep along each axis. */
+		void moveAll(float maxStep) {
+			std::uniform_real_distribution<float> step(-maxStep, maxStep);
+			for(auto& entry : boxes) {
+				glm::vec3 offset(step(random), step(random), step(random));
+				entry.second = Aabb(entry.second.minimum + offset, entry.second.maximum + offset);
+				bvh.update(entry.first, entry.second);
+			}
+		}
+	};
+
+	/** Fails naming the first id in only one of the lists, rather than printing both whole. */
+	void checkSameIds(std::vector<uint32_t> expected, std::vector<uint32_t> actual, const char* query) {
+		std::sort(expected.begin(), expected.end());
+		std::sort(actual.begin(), actual.end());
+		if(expected == actual) {
+			return;
+		}
+
+		auto difference = std::mismatch(expected.begin(), expected.end(), actual.begin(), actual.end());
+		bool missing = difference.first != expected.end() &&
+				(difference.second == actual.end() || *difference.first < *difference.second);
+		uint32_t id = missing ? *difference.first : *difference.second;
+		test::fail(__FILE__, __LINE__, std::string(query) + " returned " + std::to_string(actual.size()) +
+				" ids, expected " + std::to_string(expected.size()) + "; " +
+				(missing ? "missing " : "unexpected ") + std::to_string(id));
+	}
+
+	void checkFrustum(Scene& scene, const glm::mat4& viewProjection) {
+		glm::vec4 planes[6];
+		extractFrustumPlanes(viewProjection, planes);
+
+		std::vector<uint32_t> results;
+		scene.bvh.queryFrustum(planes, results);
+		std::vector<uint32_t> expected;
+		for(const auto& entry : scene.boxes) {
+			if(isAabbInFrustum(planes, entry.second)) {
+				expected.push_back(entry.first);
+			}
+		}
+		checkSameIds(expected, results, "frustum query");
+	}
+
+	void checkOverlap(Scene& scene, const Aabb& box) {
+		std::vector<uint32_t> results;
+		scene.bvh.queryOverlap(box, results);
+		std::vector<uint32_t> expected;
+		for(const auto& entry : scene.boxes) {
+			if(box.overlaps(entry.second)) {
+				expected.push_back(entry.first);
+			}
+		}
+		checkSameIds(expected, results, "overlap query");
+	}
+
+	void checkRaycast(Scene& scene, const glm::vec3& origin, const glm::vec3& direction) {
+		float distance = 0.0f;
+		uint32_t hit = scene.bvh.raycast(origin, direction, MAX_RAY_DISTANCE, distance);
+
+		float nearest = MAX_RAY_DISTANCE;
+		bool anyHit = false;
+		float entry;
+		for(const auto& box : scene.boxes) {
+			if(intersectRayAabb(origin, 1.0f / direction, box.second, nearest, entry)) {
+				nearest = entry;
+				anyHit = true;
+			}
+		}
+
+		// Boxes entered at the same distance may come back in any order, so compare distances
+		CHECK_EQUAL(anyHit, hit != BoundingVolumeHierarchy::NONE);
+		if(anyHit && hit != BoundingVolumeHierarchy::NONE) {
+			CHECK_EQUAL(nearest, distance);
+			CHECK(scene.boxes.find(hit) != scene.boxes.end());
+		}
+	}
+
+	/** Commits, then checks the tree against brute force with queries of every kind. */
+	void checkScene(Scene& scene) {
+		scene.bvh.commit();
+		CHECK_EQUAL(static_cast<uint32_t>(scene.boxes.size()), scene.bvh.size());
+		for(const auto& entry : scene.boxes) {
+			const Aabb& bounds = scene.bvh.getBounds(entry.first);
+			CHECK(bounds.minimum == entry.second.minimum && bounds.maximum == entry.second.maximum);
+		}
+
+		checkFrustum(scene, glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f) *
+				glm::lookAt(glm::vec3(0.0f, 0.0f, -60.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+		checkFrustum(scene, glm::perspective(glm::radians(30.0f), 1.0f, 1.0f, 40.0f) *
+				glm::lookAt(glm::vec3(10.0f, 5.0f, 0.0f), glm::vec3(-20.0f, 0.0f, 15.0f),
+						glm::vec3(0.0f, 1.0f, 0.0f)));
+
+		// One mismatch is as telling as a hundred, so stop there rather than flood the log
+		int failuresBefore = test::getFailureCount();
+		for(uint32_t q = 0; q < QUERIES_PER_CHECK && test::getFailureCount() == failuresBefore; q++) {
+			checkOverlap(scene, scene.randomBox());
+
+			glm::vec3 origin(scene.position(scene.random), scene.position(scene.random),
+					scene.position(scene.random));
+			glm::vec3 direction = glm::normalize(glm::vec3(scene.unit(scene.random),
+					scene.unit(scene.random), scene.unit(scene.random)));
+			checkRaycast(scene, origin, direction);
+		}
+	}
+
+	void testEmpty() {
+		Scene scene(1);
+		checkScene(scene);
+
+		std::vector<uint32_t> results;
+		scene.bvh.queryOverlap(Aabb(glm::vec3(-100.0f), glm::vec3(100.0f)), results);
+		CHECK(results.empty());
+		float distance;
+		CHECK_EQUAL(BoundingVolumeHierarchy::NONE,
+				scene.bvh.raycast(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 100.0f, distance));
+	}
+
+	void testBuild() {
+		Scene scene(2);
+		scene.insert(5000);
+		checkScene(scene);
+		CHECK(scene.bvh.getNodeCount() > 1);
+	}
+
+	void testRandomChanges() {
+		Scene scene(3);
+		scene.insert(2000);
+		checkScene(scene);
+
+		// Small moves refit in place, a few inserts stay pending, and larger batches force rebuilds
+		for(uint32_t round = 0; round < 20; round++) {
+			scene.moveAll(round % 5 == 4 ? 20.0f : 0.5f);
+			scene.remove(round % 3 == 0 ? 300 : 20);
+			scene.insert(round % 4 == 0 ? 400 : 30);
+			checkScene(scene);
+		}
+	}
+
+	void testRemoveEverything() {
+		Scene scene(4);
+		scene.insert(500);
+		checkScene(scene);
+
+		scene.remove(500);
+		checkScene(scene);
+		CHECK_EQUAL(0u, scene.bvh.size());
+
+		// Freed ids come back, and the tree works as new
+		scene.insert(300);
+		checkScene(scene);
+	}
+
+	void testExplicitBuildAndRefit() {
+		Scene scene(5);
+		scene.insert(1000);
+		scene.bvh.build();
+		checkScene(scene);
+
+		scene.moveAll(1.0f);
+		scene.bvh.refit();
+		checkScene(scene);
+
+		scene.bvh.clear();
+		scene.boxes.clear();
+		checkScene(scene);
+	}
+
+	void testRaycastMaxDistance() {
+		BoundingVolumeHierarchy bvh;
+		uint32_t near = bvh.insert(Aabb(glm::vec3(9.0f, -1.0f, -1.0f), glm::vec3(11.0f, 1.0f, 1.0f)));
+		uint32_t far = bvh.insert(Aabb(glm::vec3(29.0f, -1.0f, -1.0f), glm::vec3(31.0f, 1.0f, 1.0f)));
+		bvh.commit();
+
+		float distance = 0.0f;
+		glm::vec3 direction(1.0f, 0.0f, 0.0f);
+		CHECK_EQUAL(near, bvh.raycast(glm::vec3(0.0f), direction, 100.0f, distance));
+		CHECK_EQUAL(9.0f, distance);
+		CHECK_EQUAL(BoundingVolumeHierarchy::NONE, bvh.raycast(glm::vec3(0.0f), direction, 5.0f, distance));
+
+		bvh.remove(near);
+		bvh.commit();
+		CHECK_EQUAL(far, bvh.raycast(glm::vec3(0.0f), direction, 100.0f, distance));
+		CHECK_EQUAL(29.0f, distance);
+	}
+}
+
+int main() {
+	RUN_TEST(testEmpty);
+	RUN_TEST(testBuild);
+	RUN_TEST(testRandomChanges);
+	RUN_TEST(testRemoveEverything);
+	RUN_TEST(testExplicitBuildAndRefit);
+	RUN_TEST(testRaycastMaxDistance);
+	return test::getTestResult();
+}
@@ -0,0 +1,511 @@
+#include "GpuCulling.h"
+#include "CapabilityUtils.h"
+#include "MathUtils.h"
+#include "MemoryUtils.h"
+#include "TestUtils.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Runs cull.comp on a real Vulkan implementation and checks every draw and instance it writes
+ * against isSphereInFrustum. A CPU implementation is preferred when the loader offers one, so
+ * pointing VK_ICD_FILENAMES at lavapipe's or SwiftShader's ICD runs it on any machine without a
+ * GPU. Skipped when there's no Vulkan at all.
+ */
+namespace {
+	const uint32_t FRAMES_IN_FLIGHT = 2;
+	const uint32_t MESH_COUNT = 3;
+
+	/** What cull.comp writes per survivor. */
+	struct Instance {
+		float x;
+		float y;
+		float z;
+		float scale;
+		uint32_t color;
+	};
+	static_assert(sizeof(Instance) == GpuCulling::INSTANCE_STRIDE, "Instance must match cull.comp.");
+
+	struct Context {
+		VkInstance instance = VK_NULL_HANDLE;
+		VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+		VkDevice device = VK_NULL_HANDLE;
+		VkQueue queue = VK_NULL_HANDLE;
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		GpuCullingSupport support;
+
+		PipelineLayoutCache pipelineLayoutCache;
+		PipelineLayoutInfo layoutInfo;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		DescriptorAllocator descriptorAllocator;
+	};
+
+	Context context;
+
+	struct Readback {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+	};
+
+	/** Picks a device with a compute queue, preferring a CPU implementation. */
+	bool pickDevice(uint32_t& queueFamilyIndex) {
+		for(VkPhysicalDevice physicalDevice : getPhysicalDevices(context.instance)) {
+			std::vector<VkQueueFamilyProperties> families = getQueueFamilyProperties(physicalDevice);
+			for(uint32_t i = 0; i < families.size(); i++) {
+				if(!(families[i].queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+					continue;
+				}
+
+				bool isCpu = getPhysicalDeviceProperties(physicalDevice).deviceType ==
+						VK_PHYSICAL_DEVICE_TYPE_CPU;
+				if(context.physicalDevice == VK_NULL_HANDLE || isCpu) {
+					context.physicalDevice = physicalDevice;
+					queueFamilyIndex = i;
+				}
+				break;
+			}
+		}
+
+		return context.physicalDevice != VK_NULL_HANDLE;
+	}
+
+	/** False when there's no Vulkan loader or device to run on. */
+	bool createContext() {
+		if(!InitVulkan()) {
+			return false;
+		}
+
+		VkApplicationInfo appInfo = {};
+		appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		appInfo.pApplicationName = "GpuCullingTest";
+		appInfo.apiVersion = VK_API_VERSION_1_0;
+
+		VkInstanceCreateInfo instanceInfo = {};
+		instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		instanceInfo.pApplicationInfo = &appInfo;
+		if(vkCreateInstance(&instanceInfo, nullptr, &context.instance) != VK_SUCCESS) {
+			return false;
+		}
+
+		uint32_t queueFamilyIndex = 0;
+		if(!pickDevice(queueFamilyIndex)) {
+			return false;
+		}
+		printf("Culling on %s\n", getPhysicalDeviceProperties(context.physicalDevice).deviceName);
+
+		context.support = queryGpuCullingSupport(context.physicalDevice);
+		context.memoryProperties = getPhysicalDeviceMemoryProperties(context.physicalDevice);
+
+		float queuePriority = 1.0f;
+		VkDeviceQueueCreateInfo queueInfo = {};
+		queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueInfo.queueFamilyIndex = queueFamilyIndex;
+		queueInfo.queueCount = 1;
+		queueInfo.pQueuePriorities = &queuePriority;
+
+		VkPhysicalDeviceFeatures features = {};
+		enableGpuCullingFeatures(context.support, features);
+		std::vector<const char*> extensions;
+		if(context.support.drawIndirectCount) {
+			extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		}
+
+		VkDeviceCreateInfo deviceInfo = {};
+		deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceInfo.queueCreateInfoCount = 1;
+		deviceInfo.pQueueCreateInfos = &queueInfo;
+		deviceInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+		deviceInfo.ppEnabledExtensionNames = extensions.data();
+		deviceInfo.pEnabledFeatures = &features;
+		assertSuccess(vkCreateDevice(context.physicalDevice, &deviceInfo, nullptr, &context.device),
+				"Failed to create device.");
+		vkGetDeviceQueue(context.device, queueFamilyIndex, 0, &context.queue);
+
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = queueFamilyIndex;
+		assertSuccess(vkCreateCommandPool(context.device, &poolInfo, nullptr, &context.commandPool),
+				"Failed to create command pool.");
+
+		// Built as VulkanNativeApp::initializeGpuCulling builds it
+		std::vector<char> bytecode = test::readFile(std::string(SHADER_DIRECTORY) + "/cull.comp.spv");
+		ShaderReflection reflection = reflectShader(bytecode);
+		context.pipelineLayoutCache.initialize(context.device);
+		context.layoutInfo = context.pipelineLayoutCache.getPipelineLayout(reflection);
+
+		VkShaderModule shaderModule = createShaderModule(context.device, bytecode);
+
+		VkComputePipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = shaderModule;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = context.layoutInfo.layout;
+		pipelineInfo.basePipelineIndex = -1;
+		assertSuccess(vkCreateComputePipelines(context.device, VK_NULL_HANDLE, 1, &pipelineInfo,
+				nullptr, &context.pipeline), "Failed to create culling pipeline.");
+		vkDestroyShaderModule(context.device, shaderModule, nullptr);
+
+		context.descriptorAllocator.initialize(context.device, FRAMES_IN_FLIGHT);
+		return true;
+	}
+
+	void destroyContext() {
+		if(context.device != VK_NULL_HANDLE) {
+			vkDeviceWaitIdle(context.device);
+			context.descriptorAllocator.destroy();
+			vkDestroyPipeline(context.device, context.pipeline, nullptr);
+			context.pipelineLayoutCache.destroy();
+			vkDestroyCommandPool(context.device, context.commandPool, nullptr);
+			vkDestroyDevice(context.device, nullptr);
+		}
+		if(context.instance != VK_NULL_HANDLE) {
+			vkDestroyInstance(context.instance, nullptr);
+		}
+	}
+
+	void initializeCulling(GpuCulling& culling, const GpuCullingSupport& support, uint32_t initialCapacity) {
+		culling.initialize(context.device, context.memoryProperties, support,
+				&context.descriptorAllocator, FRAMES_IN_FLIGHT, initialCapacity, context.pipeline,
+				context.layoutInfo);
+	}
+
+	Readback createReadback(VkDeviceSize size) {
+		Readback readback;
+		createBuffer(context.device, context.memoryProperties, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				readback.buffer, readback.memory);
+		return readback;
+	}
+
+	template<typename T> void readAndDestroy(Readback& readback, std::vector<T>& values) {
+		void* mapped;
+		assertSuccess(vkMapMemory(context.device, readback.memory, 0, VK_WHOLE_SIZE, 0, &mapped),
+				"Failed to map readback memory.");
+		memcpy(values.data(), mapped, values.size() * sizeof(T));
+		vkUnmapMemory(context.device, readback.memory);
+
+		vkDestroyBuffer(context.device, readback.buffer, nullptr);
+		vkFreeMemory(context.device, readback.memory, nullptr);
+	}
+
+	/** Culls in the given frame slot and waits for it, returning one draw and instance per object. */
+	uint32_t cullAndRead(GpuCulling& culling, uint32_t frameIndex, const glm::mat4& viewProjection,
+			std::vector<VkDrawIndexedIndirectCommand>& commands, std::vector<Instance>& instances) {
+		uint32_t objectCount = culling.getObjectCount();
+		commands.assign(objectCount, VkDrawIndexedIndirectCommand());
+		instances.assign(objectCount, Instance());
+		Readback commandReadback = createReadback(
+				std::max(objectCount, 1u) * sizeof(VkDrawIndexedIndirectCommand));
+		Readback instanceReadback = createReadback(std::max(objectCount, 1u) * sizeof(Instance));
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = context.commandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+		VkCommandBuffer commandBuffer;
+		assertSuccess(vkAllocateCommandBuffers(context.device, &allocInfo, &commandBuffer),
+				"Failed to allocate command buffer.");
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+		context.descriptorAllocator.beginFrame(frameIndex);
+		culling.cull(commandBuffer, frameIndex, viewProjection);
+
+		if(objectCount > 0) {
+			VkMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer,
+					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+					VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+			VkBufferCopy commandCopy = {0, 0, objectCount * sizeof(VkDrawIndexedIndirectCommand)};
+			vkCmdCopyBuffer(commandBuffer, culling.getDrawCommandBuffer(frameIndex),
+					commandReadback.buffer, 1, &commandCopy);
+			VkBufferCopy instanceCopy = {0, 0, objectCount * sizeof(Instance)};
+			vkCmdCopyBuffer(commandBuffer, culling.getInstanceBuffer(frameIndex),
+					instanceReadback.buffer, 1, &instanceCopy);
+		}
+
+		VkMemoryBarrier hostBarrier = {};
+		hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		hostBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+		vkEndCommandBuffer(commandBuffer);
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		assertSuccess(vkQueueSubmit(context.queue, 1, &submitInfo, VK_NULL_HANDLE),
+				"Failed to submit culling.");
+		vkQueueWaitIdle(context.queue);
+		vkFreeCommandBuffers(context.device, context.commandPool, 1, &commandBuffer);
+
+		readAndDestroy(commandReadback, commands);
+		readAndDestroy(instanceReadback, instances);
+		return culling.getVisibleCount(frameIndex);
+	}
+
+	std::vector<CullMesh> makeMeshes() {
+		std::vector<CullMesh> meshes;
+		for(uint32_t i = 0; i < MESH_COUNT; i++) {
+			CullMesh mesh;
+			mesh.indexCount = 6 + 3 * i;
+			mesh.firstIndex = 100 * i;
+			mesh.vertexOffset = -static_cast<int32_t>(i);
+			meshes.push_back(mesh);
+		}
+
+		return meshes;
+	}
+
+	glm::mat4 makeViewProjection(const glm::vec3& eye) {
+		return glm::perspective(glm::radians(60.0f), 1.5f, 0.5f, 60.0f) *
+				glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+
+	/**
+	 * Random spheres, some inside the frustum of every given view. Spheres within rounding of a
+	 * plane could fairly go either way on the GPU, so none are made that close. Each object's x
+	 * is its index, so a survivor's instance tells which object it came from.
+	 */
+	std::vector<CullObject> makeObjects(uint32_t count, const std::vector<glm::mat4>& viewProjections,
+			uint32_t seed) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+		std::uniform_real_distribution<float> radius(0.1f, 4.0f);
+
+		std::vector<glm::vec4> planes(6 * viewProjections.size());
+		for(size_t i = 0; i < viewProjections.size(); i++) {
+			extractFrustumPlanes(viewProjections[i], &planes[6 * i]);
+		}
+
+		std::vector<CullObject> objects;
+		while(objects.size() < count) {
+			glm::vec4 sphere(position(random), position(random), position(random), radius(random));
+
+			bool borderline = false;
+			for(const glm::vec4& plane : planes) {
+				float distance = glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w + sphere.w;
+				borderline = borderline || std::abs(distance) < 1e-3f * glm::length(glm::vec3(plane));
+			}
+			if(borderline) {
+				continue;
+			}
+
+			uint32_t index = static_cast<uint32_t>(objects.size());
+			CullObject object;
+			object.boundingSphere = sphere;
+			object.positionScale = glm::vec4(static_cast<float>(index), sphere.y, sphere.z, sphere.w);
+			object.color = index * 2654435761u;
+			object.mesh = index % MESH_COUNT;
+			objects.push_back(object);
+		}
+
+		return objects;
+	}
+
+	/**
+	 * Culls and checks that the survivors are exactly the objects isSphereInFrustum keeps, each
+	 * drawn once with its own mesh and instance. With emptyTail, the slots past the survivors
+	 * must hold empty draws, as they do when there's no count buffer to stop the indirect draw.
+	 */
+	void checkCulling(GpuCulling& culling, const std::vector<CullObject>& objects,
+			const std::vector<CullMesh>& meshes, uint32_t frameIndex, const glm::mat4& viewProjection,
+			bool emptyTail) {
+		std::vector<VkDrawIndexedIndirectCommand> commands;
+		std::vector<Instance> instances;
+		uint32_t visibleCount = cullAndRead(culling, frameIndex, viewProjection, commands, instances);
+
+		glm::vec4 planes[6];
+		extractFrustumPlanes(viewProjection, planes);
+		std::vector<bool> expected(objects.size());
+		uint32_t expectedCount = 0;
+		for(size_t i = 0; i < objects.size(); i++) {
+			expected[i] = isSphereInFrustum(planes, objects[i].boundingSphere);
+			expectedCount += expected[i] ? 1 : 0;
+		}
+		CHECK_EQUAL(expectedCount, visibleCount);
+
+		uint32_t cpuCount = 0;
+		CHECK(culling.countVisibleOnCpu(frameIndex, cpuCount));
+		CHECK_EQUAL(expectedCount, cpuCount);
+
+		// One mismatch tends to shift everything after it, so stop at the first
+		int failuresBefore = test::getFailureCount();
+		std::vector<bool> drawn(objects.size(), false);
+		uint32_t slotCount = std::min(visibleCount, static_cast<uint32_t>(objects.size()));
+		for(uint32_t slot = 0; slot < slotCount && test::getFailureCount() == failuresBefore; slot++) {
+			const Instance& instance = instances[slot];
+			uint32_t index = static_cast<uint32_t>(instance.x);
+			if(index >= objects.size() || !expected[index] || drawn[index]) {
+				test::fail(__FILE__, __LINE__, "slot " + std::to_string(slot) + " draws object " +
+						std::to_string(index) + ", which should be culled or was already drawn");
+				break;
+			}
+			drawn[index] = true;
+
+			const CullObject& object = objects[index];
+			CHECK_EQUAL(object.positionScale.y, instance.y);
+			CHECK_EQUAL(object.positionScale.z, instance.z);
+			CHECK_EQUAL(object.positionScale.w, instance.scale);
+			CHECK_EQUAL(object.color, instance.color);
+
+			const CullMesh& mesh = meshes[object.mesh];
+			const VkDrawIndexedIndirectCommand& command = commands[slot];
+			CHECK_EQUAL(mesh.indexCount, command.indexCount);
+			CHECK_EQUAL(1u, command.instanceCount);
+			CHECK_EQUAL(mesh.firstIndex, command.firstIndex);
+			CHECK_EQUAL(mesh.vertexOffset, command.vertexOffset);
+			CHECK_EQUAL(slot, command.firstInstance);
+		}
+
+		if(emptyTail) {
+			for(size_t slot = slotCount; slot < objects.size(); slot++) {
+				if(commands[slot].indexCount != 0 || commands[slot].instanceCount != 0) {
+					test::fail(__FILE__, __LINE__, "slot " + std::to_string(slot) +
+							" past the survivors isn't an empty draw");
+					break;
+				}
+			}
+		}
+	}
+
+	void testCulling(bool drawIndirectCount) {
+		GpuCullingSupport support = context.support;
+		support.drawIndirectCount = support.drawIndirectCount && drawIndirectCount;
+		GpuCulling culling;
+		initializeCulling(culling, support, 1024);
+
+		std::vector<glm::mat4> views = {
+				makeViewProjection(glm::vec3(0.0f, 0.0f, -40.0f)),
+				makeViewProjection(glm::vec3(30.0f, 20.0f, 10.0f))};
+		std::vector<CullMesh> meshes = makeMeshes();
+		std::vector<CullObject> objects = makeObjects(5000, views, 1);
+		culling.setMeshes(meshes);
+		culling.setObjects(objects);
+
+		// Both frame slots, each culled again from a new view without new objects
+		for(uint32_t frame = 0; frame < 4; frame++) {
+			checkCulling(culling, objects, meshes, frame % FRAMES_IN_FLIGHT, views[frame / 2],
+					!support.drawIndirectCount);
+		}
+
+		culling.destroy();
+	}
+
+	void testWithoutCountBuffer() {
+		testCulling(false);
+	}
+
+	void testWithCountBuffer() {
+		if(!context.support.drawIndirectCount) {
+			printf("VK_KHR_draw_indirect_count unavailable, culling for plain indirect draws.\n");
+		}
+		testCulling(true);
+	}
+
+	void testObjectsOutgrowingBuffers() {
+		GpuCulling culling;
+		initializeCulling(culling, context.support, 16);
+
+		std::vector<glm::mat4> views = {makeViewProjection(glm::vec3(0.0f, 0.0f, -40.0f))};
+		std::vector<CullMesh> meshes = makeMeshes();
+		culling.setMeshes(meshes);
+
+		// Every growth replaces the frame's buffers, which the next cull must bind instead of the old ones
+		for(uint32_t count : {10u, 300u, 3000u, 20u}) {
+			std::vector<CullObject> objects = makeObjects(count, views, count);
+			culling.setObjects(objects);
+			checkCulling(culling, objects, meshes, 0, views[0], !context.support.drawIndirectCount);
+		}
+
+		culling.destroy();
+	}
+
+	void testNothingVisible() {
+		GpuCulling culling;
+		initializeCulling(culling, context.support, 16);
+
+		// Everything sits behind the camera
+		std::vector<CullObject> objects = makeObjects(500, {}, 2);
+		for(CullObject& object : objects) {
+			object.boundingSphere.z = -100.0f - std::abs(object.boundingSphere.z);
+		}
+		culling.setMeshes(makeMeshes());
+		culling.setObjects(objects);
+
+		std::vector<VkDrawIndexedIndirectCommand> commands;
+		std::vector<Instance> instances;
+		glm::mat4 viewProjection = makeViewProjection(glm::vec3(0.0f, 0.0f, -40.0f));
+		CHECK_EQUAL(0u, cullAndRead(culling, 0, viewProjection, commands, instances));
+
+		// No objects at all still resets the count
+		culling.setObjects({});
+		CHECK_EQUAL(0u, cullAndRead(culling, 0, viewProjection, commands, instances));
+
+		culling.destroy();
+	}
+
+	void testCpuCountAfterChange() {
+		GpuCulling culling;
+		initializeCulling(culling, context.support, 16);
+
+		std::vector<glm::mat4> views = {makeViewProjection(glm::vec3(0.0f, 0.0f, -40.0f))};
+		culling.setMeshes(makeMeshes());
+		culling.setObjects(makeObjects(100, views, 3));
+
+		std::vector<VkDrawIndexedIndirectCommand> commands;
+		std::vector<Instance> instances;
+		cullAndRead(culling, 0, views[0], commands, instances);
+
+		// The last cull no longer describes the objects, so there's nothing to compare against
+		uint32_t visibleCount = 12345;
+		culling.setObjects(makeObjects(50, views, 4));
+		CHECK(!culling.countVisibleOnCpu(0, visibleCount));
+		CHECK_EQUAL(12345u, visibleCount);
+
+		culling.destroy();
+	}
+}
+
+int main() {
+	try {
+		if(!createContext()) {
+			printf("No Vulkan implementation to cull on, skipping.\n");
+			destroyContext();
+			return test::SKIPPED;
+		}
+	} catch(const std::exception& exception) {
+		printf("Failed to set up culling: %s\n", exception.what());
+		destroyContext();
+		return 1;
+	}
+
+	RUN_TEST(testWithoutCountBuffer);
+	RUN_TEST(testWithCountBuffer);
+	RUN_TEST(testObjectsOutgrowingBuffers);
+	RUN_TEST(testNothingVisible);
+	RUN_TEST(testCpuCountAfterChange);
+
+	destroyContext();
+	return test::getTestResult();
+}
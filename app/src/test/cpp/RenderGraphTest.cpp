@@ -0,0 +1,368 @@
+#include "RenderGraph.h"
+#include "TestUtils.h"
+
+#include <vector>
+
+namespace {
+	const VkExtent2D EXTENT = {64, 32};
+	const VkExtent2D HALF_EXTENT = {32, 16};
+	// Every format here is four bytes a texel
+	const VkDeviceSize IMAGE_BYTES = 64 * 32 * 4;
+
+	void record(VkCommandBuffer) {}
+
+	uint32_t importSwapchain(RenderGraph& graph, VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED) {
+		return graph.importImage("swapchain", VK_FORMAT_R8G8B8A8_UNORM, EXTENT, initialLayout,
+				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	}
+
+	uint32_t createColor(RenderGraph& graph, const char* name, VkExtent2D extent = EXTENT,
+			VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT) {
+		return graph.createImage(name, VK_FORMAT_R8G8B8A8_UNORM, extent, samples);
+	}
+
+	VkClearValue getClearValue() {
+		VkClearValue value = {};
+		return value;
+	}
+
+	void checkBarrier(const RenderGraph::Barrier& barrier, uint32_t resource,
+			VkImageLayout oldLayout, VkImageLayout newLayout,
+			VkPipelineStageFlags sourceStages, VkAccessFlags sourceAccess,
+			VkPipelineStageFlags destinationStages, VkAccessFlags destinationAccess) {
+		CHECK_EQUAL(resource, barrier.resource);
+		CHECK_EQUAL(oldLayout, barrier.oldLayout);
+		CHECK_EQUAL(newLayout, barrier.newLayout);
+		CHECK_EQUAL(sourceStages, barrier.sourceStages);
+		CHECK_EQUAL(sourceAccess, barrier.sourceAccess);
+		CHECK_EQUAL(destinationStages, barrier.destinationStages);
+		CHECK_EQUAL(destinationAccess, barrier.destinationAccess);
+	}
+
+	void checkAttachment(const RenderGraph::Attachment& attachment, uint32_t resource,
+			VkAttachmentLoadOp loadOp, VkAttachmentStoreOp storeOp,
+			VkImageLayout initialLayout, VkImageLayout finalLayout) {
+		CHECK_EQUAL(resource, attachment.resource);
+		CHECK_EQUAL(loadOp, attachment.loadOp);
+		CHECK_EQUAL(storeOp, attachment.storeOp);
+		CHECK_EQUAL(initialLayout, attachment.initialLayout);
+		CHECK_EQUAL(finalLayout, attachment.finalLayout);
+	}
+
+	void testCulling() {
+		RenderGraph graph;
+		uint32_t swapchain = importSwapchain(graph);
+		uint32_t unused = createColor(graph, "unused");
+		uint32_t source = createColor(graph, "source");
+
+		// A chain nothing reads in the end goes whole, as does a write the next pass draws over
+		uint32_t feed = graph.addPass("feed", record);
+		graph.write(feed, source, RenderGraphUsage::COLOR_ATTACHMENT);
+		uint32_t dead = graph.addPass("dead", record);
+		graph.read(dead, source, RenderGraphUsage::SAMPLED);
+		graph.write(dead, unused, RenderGraphUsage::COLOR_ATTACHMENT);
+		uint32_t overdrawn = graph.addPass("overdrawn", record);
+		graph.write(overdrawn, swapchain, RenderGraphUsage::COLOR_ATTACHMENT);
+		uint32_t draw = graph.addPass("draw", record);
+		graph.write(draw, swapchain, RenderGraphUsage::COLOR_ATTACHMENT);
+		uint32_t overlay = graph.addPass("overlay", record);
+		graph.modify(overlay, swapchain, RenderGraphUsage::COLOR_ATTACHMENT);
+
+		// Reads alone keep nothing, unless the pass says it has effects of its own
+		uint32_t ignored = graph.addPass("ignored", record);
+		graph.read(ignored, swapchain, RenderGraphUsage::TRANSFER_SOURCE);
+		uint32_t capture = graph.addPass("capture", record);
+		graph.read(capture, swapchain, RenderGraphUsage::TRANSFER_SOURCE);
+		graph.setSideEffects(capture);
+		graph.compile();
+
+		CHECK(graph.isCulled(feed));
+		CHECK(graph.isCulled(dead));
+		CHECK(graph.isCulled(overdrawn));
+		CHECK(graph.isCulled(ignored));
+		CHECK(!graph.isCulled(draw));
+		CHECK(!graph.isCulled(overlay));
+		CHECK(!graph.isCulled(capture));
+		CHECK(graph.getSchedule() == std::vector<uint32_t>({draw, overlay, capture}));
+
+		// Culled images get no memory
+		CHECK_EQUAL(RenderGraph::NONE, graph.getMemorySlot(unused));
+		CHECK_EQUAL(RenderGraph::NONE, graph.getMemorySlot(source));
+		CHECK_EQUAL(static_cast<VkDeviceSize>(0), graph.getUnaliasedBytes());
+	}
+
+	void testImageBarriers() {
+		RenderGraph graph;
+		uint32_t swapchain = importSwapchain(graph);
+		uint32_t color = createColor(graph, "color");
+
+		uint32_t scene = graph.addPass("scene", record);
+		graph.write(scene, color, RenderGraphUsage::COLOR_ATTACHMENT);
+		uint32_t post = graph.addPass("post", record);
+		graph.read(post, color, RenderGraphUsage::SAMPLED);
+		graph.write(post, swapchain, RenderGraphUsage::COLOR_ATTACHMENT);
+		graph.compile();
+
+		// The first write waits for the previous frame's reads, whose contents it discards
+		const std::vector<RenderGraph::Barrier>& sceneBarriers = graph.getBarriers(scene);
+		CHECK_EQUAL(static_cast<size_t>(1), sceneBarriers.size());
+		if(sceneBarriers.size() == 1) {
+			checkBarrier(sceneBarriers[0], color,
+					VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+					VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+					VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+		}
+
+		const std::vector<RenderGraph::Barrier>& postBarriers = graph.getBarriers(post);
+		CHECK_EQUAL(static_cast<size_t>(2), postBarriers.size());
+		if(postBarriers.size() == 2) {
+			checkBarrier(postBarriers[0], color,
+					VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+					VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+			checkBarrier(postBarriers[1], swapchain,
+					VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+					VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+					VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+		}
+
+		const std::vector<RenderGraph::Barrier>& finalBarriers = graph.getFinalBarriers();
+		CHECK_EQUAL(static_cast<size_t>(1), finalBarriers.size());
+		if(finalBarriers.size() == 1) {
+			checkBarrier(finalBarriers[0], swapchain,
+					VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+					VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+					VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+		}
+
+		// Sampling what the scene drew can't be a subpass, so each gets a render pass of its own
+		CHECK_EQUAL(0u, graph.getSubpass(scene));
+		CHECK_EQUAL(0u, graph.getSubpass(post));
+		CHECK_EQUAL(static_cast<size_t>(1), graph.getAttachments(scene).size());
+		CHECK_EQUAL(static_cast<size_t>(1), graph.getAttachments(post).size());
+		CHECK(!graph.isLazy(color));
+	}
+
+	void testBufferBarriers() {
+		RenderGraph graph;
+		// Nothing to wait for at the start of the frame, so the transition waits on the top of the pipe
+		uint32_t target = graph.importImage("target", VK_FORMAT_R8G8B8A8_UNORM, EXTENT,
+				VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		uint32_t commands = graph.importBuffer("commands");
+
+		uint32_t cull = graph.addPass("cull", record);
+		graph.write(cull, commands, RenderGraphUsage::COMPUTE_STORAGE);
+		uint32_t draw = graph.addPass("draw", record);
+		graph.read(draw, commands, RenderGraphUsage::INDIRECT_BUFFER);
+		graph.read(draw, commands, RenderGraphUsage::VERTEX_BUFFER);
+		graph.write(draw, target, RenderGraphUsage::COLOR_ATTACHMENT);
+		graph.compile();
+
+		// The buffer is culled into without anything earlier to wait for, then read in one barrier
+		CHECK(graph.getBarriers(cull).empty());
+		const std::vector<RenderGraph::Barrier>& drawBarriers = graph.getBarriers(draw);
+		CHECK_EQUAL(static_cast<size_t>(2), drawBarriers.size());
+		if(drawBarriers.size() == 2) {
+			checkBarrier(drawBarriers[0], commands,
+					VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED,
+					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+					VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+					VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+			checkBarrier(drawBarriers[1], target,
+					VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+					VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+					VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+		}
+		CHECK_EQUAL(static_cast<size_t>(1), graph.getFinalBarriers().size());
+	}
+
+	void testMemorySlots() {
+		RenderGraph graph;
+		uint32_t swapchain = importSwapchain(graph);
+		uint32_t first = createColor(graph, "first");
+		uint32_t second = createColor(graph, "second");
+		uint32_t third = createColor(graph, "third");
+
+		// Each image is sampled by the pass after the one drawing it, so only neighbours overlap
+		uint32_t draw = graph.addPass("draw", record);
+		graph.write(draw, first, RenderGraphUsage::COLOR_ATTACHMENT);
+		uint32_t blur = graph.addPass("blur", record);
+		graph.read(blur, first, RenderGraphUsage::SAMPLED);
+		graph.write(blur, second, RenderGraphUsage::COLOR_ATTACHMENT);
+		uint32_t sharpen = graph.addPass("sharpen", record);
+		graph.read(sharpen, second, RenderGraphUsage::SAMPLED);
+		graph.write(sharpen, third, RenderGraphUsage::COLOR_ATTACHMENT);
+		uint32_t present = graph.addPass("present", record);
+		graph.read(present, third, RenderGraphUsage::SAMPLED);
+		graph.write(present, swapchain, RenderGraphUsage::COLOR_ATTACHMENT);
+		graph.compile();
+
+		CHECK(graph.getMemorySlot(first) != RenderGraph::NONE);
+		CHECK(graph.getMemorySlot(second) != RenderGraph::NONE);
+		CHECK_EQUAL(graph.getMemorySlot(first), graph.getMemorySlot(third));
+		CHECK(graph.getMemorySlot(first) != graph.getMemorySlot(second));
+		CHECK_EQUAL(RenderGraph::NONE, graph.getMemorySlot(swapchain));
+		CHECK_EQUAL(3 * IMAGE_BYTES, graph.getUnaliasedBytes());
+		CHECK_EQUAL(2 * IMAGE_BYTES, graph.getAliasedBytes());
+
+		// The third image takes over the first one's memory once its last reader is done
+		const std::vector<RenderGraph::Barrier>& barriers = graph.getBarriers(sharpen);
+		CHECK_EQUAL(static_cast<size_t>(2), barriers.size());
+		if(barriers.size() == 2) {
+			CHECK_EQUAL(third, barriers[1].resource);
+			CHECK_EQUAL(static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT),
+					barriers[1].sourceStages);
+			CHECK_EQUAL(VK_IMAGE_LAYOUT_UNDEFINED, barriers[1].oldLayout);
+		}
+	}
+
+	void testSubpassMerge() {
+		RenderGraph graph;
+		uint32_t swapchain = importSwapchain(graph);
+		uint32_t albedo = createColor(graph, "albedo");
+		uint32_t depth = graph.createImage("depth", VK_FORMAT_D32_SFLOAT, EXTENT, VK_SAMPLE_COUNT_1_BIT);
+		graph.setClearValue(albedo, getClearValue());
+		graph.setClearValue(depth, getClearValue());
+
+		uint32_t geometry = graph.addPass("geometry", record);
+		graph.write(geometry, albedo, RenderGraphUsage::COLOR_ATTACHMENT);
+		graph.write(geometry, depth, RenderGraphUsage::DEPTH_ATTACHMENT);
+		uint32_t lighting = graph.addPass("lighting", record);
+		graph.read(lighting, albedo, RenderGraphUsage::INPUT_ATTACHMENT);
+		graph.read(lighting, depth, RenderGraphUsage::DEPTH_READ);
+		graph.write(lighting, swapchain, RenderGraphUsage::COLOR_ATTACHMENT);
+		graph.compile();
+
+		CHECK_EQUAL(0u, graph.getSubpass(geometry));
+		CHECK_EQUAL(1u, graph.getSubpass(lighting));
+		CHECK(&graph.getAttachments(geometry) == &graph.getAttachments(lighting));
+
+		// Nothing leaves the tile but the swapchain, so the G-buffer needs no memory of its own
+		CHECK(graph.isLazy(albedo));
+		CHECK(graph.isLazy(depth));
+		CHECK_EQUAL(RenderGraph::NONE, graph.getMemorySlot(albedo));
+		CHECK_EQUAL(static_cast<VkDeviceSize>(0), graph.getAliasedBytes());
+
+		const std::vector<RenderGraph::Attachment>& attachments = graph.getAttachments(geometry);
+		CHECK_EQUAL(static_cast<size_t>(3), attachments.size());
+		if(attachments.size() == 3) {
+			checkAttachment(attachments[0], albedo, VK_ATTACHMENT_LOAD_OP_CLEAR,
+					VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+					VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+			checkAttachment(attachments[1], depth, VK_ATTACHMENT_LOAD_OP_CLEAR,
+					VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+					VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+			checkAttachment(attachments[2], swapchain, VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+					VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+					VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+			CHECK_EQUAL(static_cast<VkDeviceSize>(0), attachments[2].loadedBytes);
+			CHECK_EQUAL(IMAGE_BYTES, attachments[2].storedBytes);
+		}
+
+		// Apart, the G-buffer would be stored by the first pass and loaded by the second
+		CHECK_EQUAL(IMAGE_BYTES, graph.getAttachmentTraffic());
+		CHECK_EQUAL(5 * IMAGE_BYTES, graph.getUnmergedAttachmentTraffic());
+
+		// The G-buffer waits on the first subpass through a dependency, not a barrier before the pass
+		const std::vector<RenderGraph::Barrier>& barriers = graph.getBarriers(lighting);
+		CHECK_EQUAL(static_cast<size_t>(1), barriers.size());
+		if(barriers.size() == 1) {
+			CHECK_EQUAL(swapchain, barriers[0].resource);
+		}
+	}
+
+	void testMergeBoundaries() {
+		RenderGraph graph;
+		uint32_t swapchain = importSwapchain(graph);
+		uint32_t color = createColor(graph, "color");
+		uint32_t half = createColor(graph, "half", HALF_EXTENT);
+
+		// A different size can't share a render pass, nor can sampling an attachment or drawing over
+		// an input
+		uint32_t scene = graph.addPass("scene", record);
+		graph.write(scene, color, RenderGraphUsage::COLOR_ATTACHMENT);
+		uint32_t shadow = graph.addPass("shadow", record);
+		graph.write(shadow, half, RenderGraphUsage::COLOR_ATTACHMENT);
+		uint32_t composite = graph.addPass("composite", record);
+		graph.read(composite, half, RenderGraphUsage::SAMPLED);
+		graph.read(composite, color, RenderGraphUsage::INPUT_ATTACHMENT);
+		graph.write(composite, swapchain, RenderGraphUsage::COLOR_ATTACHMENT);
+		uint32_t overlay = graph.addPass("overlay", record);
+		graph.modify(overlay, swapchain, RenderGraphUsage::COLOR_ATTACHMENT);
+		graph.write(overlay, color, RenderGraphUsage::COLOR_ATTACHMENT);
+		graph.compile();
+
+		CHECK(graph.getSchedule() == std::vector<uint32_t>({scene, shadow, composite, overlay}));
+		for(uint32_t pass : graph.getSchedule()) {
+			CHECK_EQUAL(0u, graph.getSubpass(pass));
+		}
+		CHECK(&graph.getAttachments(scene) != &graph.getAttachments(shadow));
+		CHECK(&graph.getAttachments(shadow) != &graph.getAttachments(composite));
+		CHECK(&graph.getAttachments(composite) != &graph.getAttachments(overlay));
+	}
+
+	void testLoadAndStore() {
+		RenderGraph graph;
+		// The swapchain arrives holding an earlier frame's picture, which the overlay draws onto
+		uint32_t swapchain = importSwapchain(graph, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+		uint32_t multisampled = createColor(graph, "multisampled", EXTENT, VK_SAMPLE_COUNT_4_BIT);
+		graph.setClearValue(multisampled, getClearValue());
+		graph.setClearValue(swapchain, getClearValue());
+
+		uint32_t overlay = graph.addPass("overlay", record);
+		graph.modify(overlay, swapchain, RenderGraphUsage::COLOR_ATTACHMENT);
+		graph.compile();
+		const std::vector<RenderGraph::Attachment>& loaded = graph.getAttachments(overlay);
+		CHECK_EQUAL(static_cast<size_t>(1), loaded.size());
+		if(loaded.size() == 1) {
+			checkAttachment(loaded[0], swapchain, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_STORE,
+					VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+			CHECK_EQUAL(IMAGE_BYTES, loaded[0].loadedBytes);
+		}
+
+		// A resolve covers every pixel, so even a cleared destination is neither cleared nor loaded
+		RenderGraph resolveGraph;
+		swapchain = importSwapchain(resolveGraph, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+		multisampled = createColor(resolveGraph, "multisampled", EXTENT, VK_SAMPLE_COUNT_4_BIT);
+		resolveGraph.setClearValue(multisampled, getClearValue());
+		resolveGraph.setClearValue(swapchain, getClearValue());
+		uint32_t draw = resolveGraph.addPass("draw", record);
+		resolveGraph.write(draw, multisampled, RenderGraphUsage::COLOR_ATTACHMENT);
+		resolveGraph.resolve(draw, multisampled, swapchain);
+		resolveGraph.compile();
+
+		CHECK(resolveGraph.isLazy(multisampled));
+		CHECK_EQUAL(4 * IMAGE_BYTES, resolveGraph.getLazyBytes());
+		const std::vector<RenderGraph::Attachment>& resolved = resolveGraph.getAttachments(draw);
+		CHECK_EQUAL(static_cast<size_t>(2), resolved.size());
+		if(resolved.size() == 2) {
+			checkAttachment(resolved[0], multisampled, VK_ATTACHMENT_LOAD_OP_CLEAR,
+					VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+					VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+			checkAttachment(resolved[1], swapchain, VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+					VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+					VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		}
+		CHECK_EQUAL(IMAGE_BYTES, resolveGraph.getAttachmentTraffic());
+	}
+
+	void testConflictingLayouts() {
+		RenderGraph graph;
+		uint32_t color = createColor(graph, "color");
+		uint32_t pass = graph.addPass("feedback", record);
+		graph.write(pass, color, RenderGraphUsage::COLOR_ATTACHMENT);
+		CHECK_THROWS(graph.read(pass, color, RenderGraphUsage::SAMPLED));
+	}
+}
+
+int main() {
+	RUN_TEST(testCulling);
+	RUN_TEST(testImageBarriers);
+	RUN_TEST(testBufferBarriers);
+	RUN_TEST(testMemorySlots);
+	RUN_TEST(testSubpassMerge);
+	RUN_TEST(testMergeBoundaries);
+	RUN_TEST(testLoadAndStore);
+	RUN_TEST(testConflictingLayouts);
+	return test::getTestResult();
+}
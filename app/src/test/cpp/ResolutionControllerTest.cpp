@@ -0,0 +1,159 @@
+#include "ResolutionController.h"
+#include "TestUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+	const uint32_t TRACE_FRAMES = 3600;
+
+	/**
+	 * 11 ms frames at native resolution, slowing to 1.9x over the middle half as the GPU clocks
+	 * down, then settling back to 1.3x. Every five seconds one frame spikes 6 ms.
+	 */
+	std::vector<ResolutionTraceFrame> createThrottlingTrace(uint32_t frameCount) {
+		std::mt19937 random(1);
+		std::normal_distribution<double> noise(0.0, 0.6);
+
+		std::vector<ResolutionTraceFrame> trace(frameCount);
+		for(uint32_t i = 0; i < frameCount; i++) {
+			double progress = i / static_cast<double>(frameCount);
+			double slowdown = 1.0;
+			if(progress > 0.8) {
+				slowdown = 1.3;
+			} else if(progress > 0.25) {
+				slowdown = 1.0 + 0.9 * std::min(1.0, (progress - 0.25) / 0.5);
+			}
+
+			trace[i].scale = 1.0f;
+			trace[i].gpuMilliseconds = std::max(1.0, 11.0 * slowdown + noise(random));
+			if(i % 300 == 299) {
+				trace[i].gpuMilliseconds += 6.0;
+			}
+		}
+		return trace;
+	}
+
+	std::vector<ResolutionTraceFrame> createSteadyTrace(uint32_t frameCount, double gpuMilliseconds) {
+		ResolutionTraceFrame frame = {1.0f, gpuMilliseconds};
+		return std::vector<ResolutionTraceFrame>(frameCount, frame);
+	}
+
+	/** Every scale in bounds and on a whole step, and no change within the settling time of the last. */
+	void checkScales(const std::vector<float>& scales, const ResolutionSettings& settings) {
+		uint32_t lastChange = 0;
+		for(size_t i = 0; i < scales.size(); i++) {
+			std::string frame = "frame " + std::to_string(i) + " at scale " + std::to_string(scales[i]);
+			if(scales[i] < settings.minScale || scales[i] > settings.maxScale) {
+				test::fail(__FILE__, __LINE__, frame + " is out of bounds");
+				return;
+			}
+			float steps = scales[i] / settings.step;
+			if(std::fabs(steps - std::round(steps)) > 0.01f) {
+				test::fail(__FILE__, __LINE__, frame + " is off a step");
+				return;
+			}
+			if(i > 0 && scales[i] != scales[i - 1]) {
+				if(lastChange > 0 && i - lastChange <= settings.settleFrames) {
+					test::fail(__FILE__, __LINE__, frame + " changed " + std::to_string(i - lastChange) +
+							" frames after the last change");
+					return;
+				}
+				lastChange = static_cast<uint32_t>(i);
+			}
+		}
+	}
+
+	void testThrottlingTrace() {
+		std::vector<ResolutionTraceFrame> trace = createThrottlingTrace(TRACE_FRAMES);
+		ResolutionSettings settings;
+		ResolutionSettings nativeSettings = settings;
+		nativeSettings.minScale = nativeSettings.maxScale;
+
+		ResolutionController native(nativeSettings);
+		ResolutionTraceSummary nativeSummary = replayResolutionTrace(native, trace);
+		ResolutionController dynamic(settings);
+		std::vector<float> scales;
+		ResolutionTraceSummary dynamicSummary = replayResolutionTrace(dynamic, trace, &scales);
+
+		CHECK_EQUAL(TRACE_FRAMES, static_cast<uint32_t>(scales.size()));
+		checkScales(scales, settings);
+
+		// Native misses the budget through most of the slowdown; scaling should cut that by far, with
+		// what's left down to spikes and the frames before each drop catches up
+		CHECK_EQUAL(0u, nativeSummary.scaleChanges);
+		CHECK(nativeSummary.framesOverBudget > TRACE_FRAMES / 4);
+		CHECK(dynamicSummary.framesOverBudget * 8 < nativeSummary.framesOverBudget);
+		CHECK(dynamicSummary.minimumScale < settings.maxScale);
+		CHECK(dynamicSummary.averageScale > settings.minScale);
+
+		// Not hunting: a change every second or so at most, over the whole minute
+		CHECK(dynamicSummary.scaleChanges > 0);
+		CHECK(dynamicSummary.scaleChanges < TRACE_FRAMES / 60);
+	}
+
+	void testUnderBudget() {
+		ResolutionSettings settings;
+		ResolutionController controller(settings);
+		ResolutionTraceSummary summary = replayResolutionTrace(controller,
+				createSteadyTrace(600, settings.budgetMilliseconds * 0.5));
+
+		CHECK_EQUAL(0u, summary.framesOverBudget);
+		CHECK_EQUAL(0u, summary.scaleChanges);
+		CHECK_EQUAL(settings.maxScale, controller.getScale());
+	}
+
+	void testOverBudgetAtMinimum() {
+		// Too slow even at the smallest scale, which is as far as it goes
+		ResolutionSettings settings;
+		ResolutionController controller(settings);
+		std::vector<float> scales;
+		replayResolutionTrace(controller, createSteadyTrace(600, settings.budgetMilliseconds * 10.0), &scales);
+
+		checkScales(scales, settings);
+		CHECK_EQUAL(settings.minScale, controller.getScale());
+	}
+
+	void testRecovery() {
+		// After a slow stretch, climbs back to full resolution one step at a time
+		ResolutionSettings settings;
+		ResolutionController controller(settings);
+		std::vector<ResolutionTraceFrame> trace = createSteadyTrace(300, settings.budgetMilliseconds * 2.0);
+		std::vector<ResolutionTraceFrame> fast = createSteadyTrace(3000, settings.budgetMilliseconds * 0.5);
+		trace.insert(trace.end(), fast.begin(), fast.end());
+
+		std::vector<float> scales;
+		ResolutionTraceSummary summary = replayResolutionTrace(controller, trace, &scales);
+		checkScales(scales, settings);
+		CHECK(summary.minimumScale < settings.maxScale);
+		CHECK_EQUAL(settings.maxScale, controller.getScale());
+		for(size_t i = 1; i < scales.size(); i++) {
+			if(scales[i] > scales[i - 1] + settings.step * 1.01f) {
+				test::fail(__FILE__, __LINE__, "frame " + std::to_string(i) + " climbed more than a step");
+				break;
+			}
+		}
+	}
+
+	void testReset() {
+		ResolutionSettings settings;
+		ResolutionController controller(settings);
+		replayResolutionTrace(controller, createSteadyTrace(300, settings.budgetMilliseconds * 2.0));
+		CHECK(controller.getScale() < settings.maxScale);
+
+		controller.reset();
+		CHECK_EQUAL(settings.maxScale, controller.getScale());
+	}
+}
+
+int main() {
+	RUN_TEST(testThrottlingTrace);
+	RUN_TEST(testUnderBudget);
+	RUN_TEST(testOverBudgetAtMinimum);
+	RUN_TEST(testRecovery);
+	RUN_TEST(testReset);
+	return test::getTestResult();
+}
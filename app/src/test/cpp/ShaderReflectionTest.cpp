@@ -0,0 +1,217 @@
+#include "ShaderReflection.h"
+#include "TestUtils.h"
+
+#include <cstring>
+#include <string>
+
+namespace {
+	ShaderReflection reflect(const std::string& name) {
+		return reflectShader(test::readFile(std::string(SHADER_DIRECTORY) + "/" + name + ".spv"));
+	}
+
+	void checkBinding(const ShaderReflection& reflection, size_t index, uint32_t set, uint32_t binding,
+			VkDescriptorType type, uint32_t count, const char* name) {
+		if(index >= reflection.descriptorBindings.size()) {
+			test::fail(__FILE__, __LINE__, std::string("missing binding ") + name);
+			return;
+		}
+
+		const ReflectedDescriptorBinding& reflected = reflection.descriptorBindings[index];
+		CHECK_EQUAL(set, reflected.set);
+		CHECK_EQUAL(binding, reflected.binding);
+		CHECK_EQUAL(type, reflected.type);
+		CHECK_EQUAL(count, reflected.count);
+		CHECK_EQUAL(reflection.stages, reflected.stages);
+		CHECK_EQUAL(std::string(name), reflected.name);
+	}
+
+	void checkPushConstants(const ShaderReflection& reflection, VkShaderStageFlags stages,
+			uint32_t offset, uint32_t size) {
+		CHECK_EQUAL(1u, reflection.pushConstantRanges.size());
+		if(!reflection.pushConstantRanges.empty()) {
+			CHECK_EQUAL(stages, reflection.pushConstantRanges[0].stageFlags);
+			CHECK_EQUAL(offset, reflection.pushConstantRanges[0].offset);
+			CHECK_EQUAL(size, reflection.pushConstantRanges[0].size);
+		}
+	}
+
+	void checkInput(const ShaderReflection& reflection, uint32_t location, VkFormat format, const char* name) {
+		const ReflectedInput* input = reflection.findInput(location);
+		CHECK(input != nullptr);
+		if(input != nullptr) {
+			CHECK_EQUAL(format, input->format);
+			CHECK_EQUAL(std::string(name), input->name);
+		}
+	}
+
+	const ReflectedSpecializationConstant* findSpecializationConstant(const ShaderReflection& reflection,
+			uint32_t constantId) {
+		for(const ReflectedSpecializationConstant& constant : reflection.specializationConstants) {
+			if(constant.constantId == constantId) {
+				return &constant;
+			}
+		}
+
+		return nullptr;
+	}
+
+	void testSceneShaders() {
+		ShaderReflection vertex = reflect("shader_base.vert");
+		CHECK_EQUAL(static_cast<VkShaderStageFlags>(VK_SHADER_STAGE_VERTEX_BIT), vertex.stages);
+		CHECK_EQUAL(std::string("main"), vertex.entryPoint);
+		CHECK(vertex.descriptorBindings.empty());
+		checkPushConstants(vertex, VK_SHADER_STAGE_VERTEX_BIT, 0, 64);
+		CHECK_EQUAL(4u, vertex.inputs.size());
+		checkInput(vertex, 0, VK_FORMAT_R32G32_SFLOAT, "inPosition");
+		checkInput(vertex, 1, VK_FORMAT_R32G32B32_SFLOAT, "inColor");
+		checkInput(vertex, 2, VK_FORMAT_R32G32B32A32_SFLOAT, "inInstancePositionScale");
+		checkInput(vertex, 3, VK_FORMAT_R32G32B32A32_SFLOAT, "inInstanceColor");
+		CHECK(vertex.specializationConstants.empty());
+
+		ShaderReflection fragment = reflect("shader_base.frag");
+		CHECK_EQUAL(static_cast<VkShaderStageFlags>(VK_SHADER_STAGE_FRAGMENT_BIT), fragment.stages);
+		CHECK(fragment.descriptorBindings.empty());
+		CHECK(fragment.pushConstantRanges.empty());
+		CHECK_EQUAL(1u, fragment.inputs.size());
+		checkInput(fragment, 0, VK_FORMAT_R32G32B32_SFLOAT, "fragColor");
+		CHECK(fragment.specializationConstants.empty());
+
+		ShaderReflection merged = mergeShaderReflections({vertex, fragment});
+		CHECK_EQUAL(static_cast<VkShaderStageFlags>(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT),
+				merged.stages);
+		CHECK_EQUAL(4u, merged.inputs.size());
+		checkPushConstants(merged, VK_SHADER_STAGE_VERTEX_BIT, 0, 64);
+	}
+
+	void testSpriteShaders() {
+		ShaderReflection vertex = reflect("sprite.vert");
+		CHECK(vertex.descriptorBindings.empty());
+		checkPushConstants(vertex, VK_SHADER_STAGE_VERTEX_BIT, 0, 24);
+		CHECK_EQUAL(3u, vertex.inputs.size());
+		checkInput(vertex, 0, VK_FORMAT_R32G32_SFLOAT, "inPosition");
+		checkInput(vertex, 1, VK_FORMAT_R32G32_SFLOAT, "inUv");
+		checkInput(vertex, 2, VK_FORMAT_R32G32B32A32_SFLOAT, "inColor");
+
+		// The bindless table is a runtime-sized array
+		ShaderReflection bindless = reflect("sprite.frag");
+		CHECK_EQUAL(1u, bindless.descriptorBindings.size());
+		checkBinding(bindless, 0, 0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, "textures");
+		checkPushConstants(bindless, VK_SHADER_STAGE_FRAGMENT_BIT, 24, 4);
+		checkInput(bindless, 0, VK_FORMAT_R32G32_SFLOAT, "fragUv");
+		checkInput(bindless, 1, VK_FORMAT_R32G32B32A32_SFLOAT, "fragColor");
+
+		ShaderReflection classic = reflect("sprite_classic.frag");
+		CHECK_EQUAL(1u, classic.descriptorBindings.size());
+		checkBinding(classic, 0, 0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, "spriteTexture");
+		CHECK(classic.pushConstantRanges.empty());
+
+		// One range covering the transform, offset and texture index, visible to both stages
+		ShaderReflection merged = mergeShaderReflections({vertex, bindless});
+		checkPushConstants(merged, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, 28);
+		CHECK_EQUAL(1u, merged.descriptorBindings.size());
+		CHECK_EQUAL(3u, merged.inputs.size());
+	}
+
+	void testFullscreenShaders() {
+		// gl_VertexIndex is built in, so the vertex shader takes no attributes at all
+		ShaderReflection vertex = reflect("fullscreen.vert");
+		CHECK(vertex.inputs.empty());
+		CHECK(vertex.descriptorBindings.empty());
+		CHECK(vertex.pushConstantRanges.empty());
+
+		ShaderReflection tonemap = reflect("tonemap.frag");
+		CHECK_EQUAL(1u, tonemap.descriptorBindings.size());
+		checkBinding(tonemap, 0, 0, 0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1, "sceneColor");
+		CHECK(tonemap.inputs.empty());
+
+		ShaderReflection upscale = reflect("upscale.frag");
+		CHECK_EQUAL(1u, upscale.descriptorBindings.size());
+		checkBinding(upscale, 0, 0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, "sceneColor");
+		checkInput(upscale, 0, VK_FORMAT_R32G32_SFLOAT, "fragUv");
+	}
+
+	void testCullShader() {
+		ShaderReflection reflection = reflect("cull.comp");
+		CHECK_EQUAL(static_cast<VkShaderStageFlags>(VK_SHADER_STAGE_COMPUTE_BIT), reflection.stages);
+		CHECK_EQUAL(5u, reflection.descriptorBindings.size());
+		checkBinding(reflection, 0, 0, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, "Objects");
+		checkBinding(reflection, 1, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, "Meshes");
+		checkBinding(reflection, 2, 0, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, "DrawCommands");
+		checkBinding(reflection, 3, 0, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, "DrawCount");
+		checkBinding(reflection, 4, 0, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, "Instances");
+
+		// Six planes, then the object count
+		checkPushConstants(reflection, VK_SHADER_STAGE_COMPUTE_BIT, 0, 6 * 16 + 4);
+		CHECK(reflection.inputs.empty());
+		CHECK(reflection.specializationConstants.empty());
+	}
+
+	void testSpecializedShader() {
+		ShaderReflection reflection = reflect("specialized.comp");
+		CHECK_EQUAL(3u, reflection.descriptorBindings.size());
+		checkBinding(reflection, 0, 0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, "parameters");
+		checkBinding(reflection, 1, 1, 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4, "lookups");
+		checkBinding(reflection, 2, 1, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, "Results");
+		CHECK(reflection.pushConstantRanges.empty());
+
+		CHECK_EQUAL(3u, reflection.specializationConstants.size());
+		const ReflectedSpecializationConstant* groupSize = findSpecializationConstant(reflection, 0);
+		const ReflectedSpecializationConstant* clampResult = findSpecializationConstant(reflection, 1);
+		const ReflectedSpecializationConstant* scale = findSpecializationConstant(reflection, 2);
+		CHECK(groupSize != nullptr && clampResult != nullptr && scale != nullptr);
+		if(groupSize != nullptr && clampResult != nullptr && scale != nullptr) {
+			CHECK_EQUAL(std::string("GROUP_SIZE"), groupSize->name);
+			CHECK_EQUAL(4u, groupSize->size);
+			CHECK_EQUAL(64u, groupSize->defaultValue);
+			CHECK_EQUAL(std::string("CLAMP_RESULT"), clampResult->name);
+			CHECK_EQUAL(1u, clampResult->defaultValue);
+			CHECK_EQUAL(std::string("SCALE"), scale->name);
+			// The bits of 2.0f
+			CHECK_EQUAL(0x40000000u, scale->defaultValue);
+		}
+	}
+
+	void testMergeConflicts() {
+		// Both read binding 0.0, one as a sampler and one as an input attachment
+		CHECK_THROWS(mergeShaderReflections({reflect("upscale.frag"), reflect("tonemap.frag")}));
+	}
+
+	void testVertexInputsProvided() {
+		ShaderReflection vertex = reflect("sprite.vert");
+		VkVertexInputAttributeDescription attributes[3] = {};
+		for(uint32_t i = 0; i < 3; i++) {
+			attributes[i].location = i;
+		}
+		assertVertexInputsProvided(vertex, attributes, 3);
+		CHECK_THROWS(assertVertexInputsProvided(vertex, attributes, 2));
+	}
+
+	void testInvalidBytecode() {
+		CHECK_THROWS(reflectShader(std::vector<char>()));
+		CHECK_THROWS(reflectShader(std::vector<char>(20, 0)));
+
+		std::vector<char> bytecode = test::readFile(std::string(SHADER_DIRECTORY) + "/sprite.vert.spv");
+		std::vector<char> unaligned(bytecode.begin(), bytecode.end() - 1);
+		CHECK_THROWS(reflectShader(unaligned));
+
+		// The first instruction claims more words than the module has
+		std::vector<char> overrun = bytecode;
+		uint32_t header[6];
+		memcpy(header, overrun.data(), sizeof(header));
+		header[5] |= 0xFFFF0000;
+		memcpy(overrun.data(), header, sizeof(header));
+		CHECK_THROWS(reflectShader(overrun));
+	}
+}
+
+int main() {
+	RUN_TEST(testSceneShaders);
+	RUN_TEST(testSpriteShaders);
+	RUN_TEST(testFullscreenShaders);
+	RUN_TEST(testCullShader);
+	RUN_TEST(testSpecializedShader);
+	RUN_TEST(testMergeConflicts);
+	RUN_TEST(testVertexInputsProvided);
+	RUN_TEST(testInvalidBytecode);
+	return test::getTestResult();
+}
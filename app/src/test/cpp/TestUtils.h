@@ -0,0 +1,78 @@
+#ifndef TEST_UTILS_H
+#define TEST_UTILS_H
+
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Just enough of a test harness for the host tests: checks log what failed and keep going, and
+ * main returns getTestResult, which ctest reads as pass or fail.
+ */
+namespace test {
+	inline int& getFailureCount() {
+		static int failureCount = 0;
+		return failureCount;
+	}
+
+	inline void fail(const char* file, int line, const std::string& message) {
+		printf("%s:%d: %s\n", file, line, message.c_str());
+		getFailureCount()++;
+	}
+
+	template<typename E, typename A> void checkEqual(const E& expected, const A& actual,
+			const char* expression, const char* file, int line) {
+		if(!(expected == actual)) {
+			std::ostringstream message;
+			message << expression << " is " << actual << ", expected " << expected;
+			fail(file, line, message.str());
+		}
+	}
+
+	/** Runs a test function, counting an escaped exception as a failure rather than ending the run. */
+	template<typename F> void run(const char* name, F function) {
+		int failuresBefore = getFailureCount();
+		try {
+			function();
+		} catch(const std::exception& exception) {
+			fail(name, 0, std::string("threw ") + exception.what());
+		}
+		printf("%s %s\n", getFailureCount() == failuresBefore ? "PASS" : "FAIL", name);
+	}
+
+	inline int getTestResult() {
+		return getFailureCount() == 0 ? 0 : 1;
+	}
+
+	/** The whole file, as readAsset would return it on the device. */
+	inline std::vector<char> readFile(const std::string& path) {
+		std::ifstream file(path, std::ios::binary);
+		if(!file) {
+			throw std::runtime_error("Failed to open " + path + ".");
+		}
+
+		return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	/** ctest reports a test returning this as skipped rather than passed or failed. */
+	const int SKIPPED = 77;
+}
+
+#define CHECK(condition) \
+		((condition) ? (void)0 : test::fail(__FILE__, __LINE__, "check failed: " #condition))
+#define CHECK_EQUAL(expected, actual) \
+		test::checkEqual((expected), (actual), #actual, __FILE__, __LINE__)
+#define CHECK_THROWS(statement) \
+		do { \
+			bool thrown = false; \
+			try { statement; } catch(const std::exception&) { thrown = true; } \
+			if(!thrown) { test::fail(__FILE__, __LINE__, "expected to throw: " #statement); } \
+		} while(false)
+#define RUN_TEST(function) test::run(#function, function)
+
+#endif
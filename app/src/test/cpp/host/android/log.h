@@ -0,0 +1,29 @@
+#ifndef HOST_ANDROID_LOG_H
+#define HOST_ANDROID_LOG_H
+
+#include <cstdarg>
+#include <cstdio>
+
+/** Stands in for the NDK's logging on the host, so the app's LOG_ macros print to stdout. */
+enum android_LogPriority {
+	ANDROID_LOG_DEBUG = 3,
+	ANDROID_LOG_INFO = 4,
+	ANDROID_LOG_WARN = 5,
+	ANDROID_LOG_ERROR = 6
+};
+
+inline int __android_log_print(int priority, const char* tag, const char* format, ...) {
+	static const char* const PRIORITY_NAMES[] = {"D", "I", "W", "E"};
+	int index = priority >= ANDROID_LOG_DEBUG && priority <= ANDROID_LOG_ERROR ? priority - ANDROID_LOG_DEBUG : 0;
+	printf("%s/%s: ", PRIORITY_NAMES[index], tag);
+
+	va_list arguments;
+	va_start(arguments, format);
+	int written = vprintf(format, arguments);
+	va_end(arguments);
+
+	printf("\n");
+	return written;
+}
+
+#endif